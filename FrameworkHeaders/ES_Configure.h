@@ -9,6 +9,31 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 12:00 ahb     MAX_NUM_SERVICES can't go above 32
+ 10/17/26 11:40 ahb     the host test events are only in the test build
+ 10/17/26 09:40 ahb     the host port's test build adds an ISR inbox
+ 10/17/26 09:00 ahb     the host port's test build adds its services, see
+                        HostPort/HostTest.h
+ 10/17/26 08:00 ahb     ES_COMPACT_EVENTS is off by default, like the other
+                        options
+ 10/17/26 05:20 ahb     RobotSM is a plain SERVICE again
+ 10/17/26 05:00 ahb     emptied ISR_INBOX_TABLE, no ISR posts to RobotHSM
+ 10/17/26 04:00 ahb     noted which event a LIFO post drops
+ 10/17/26 00:40 ahb     ES_QUEUE_COALESCE matches the EventParam too
+ 10/17/26 00:10 ahb     added ES_TICK_OVERRUN, subscribed RobotTestHarness
+ 10/16/26 22:40 ahb     added DEFERRED_WORK_TABLE
+ 10/16/26 21:40 ahb     added ES_NUM_SHORT_TIMERS
+ 10/16/26 21:10 ahb     added ES_USE_TIMER_CALLBACKS
+ 10/16/26 20:40 ahb     added ES_NUM_DYNAMIC_TIMERS
+ 10/16/26 19:10 ahb     added ES_USE_EVENT_POOL and EVENT_POOL_RESERVE_TABLE
+ 10/16/26 18:10 ahb     added ES_COMPACT_EVENTS
+ 10/16/26 17:40 ahb     noted that queue sizes are rounded up to powers of 2
+ 10/16/26 17:00 ahb     added ISR_INBOX_TABLE
+ 10/16/26 14:20 ahb     added QUEUE_POLICY_TABLE
+ 10/16/26 12:10 ahb     replaced the distribution lists with SUBSCRIPTION_TABLE
+                        and added NUM_ES_EVENT_TYPES
+ 10/16/26 09:12 ahb     replaced the per-service blocks with SERVICE_TABLE and
+                        raised MAX_NUM_SERVICES to 32
  12/19/16 20:19  jec     removed EVENT_CHECK_HEADER definition. This goes with
                          the V2.3 move to a single wrapper for event checking
                          headers
@@ -26,232 +51,153 @@
 
 /****************************************************************************/
 // The maximum number of services sets an upper bound on the number of
-// services that the framework will handle. Reasonable values are 8 and 16
-// corresponding to an 8-bit(uint8_t) and 16-bit(uint16_t) Ready variable size
-#define MAX_NUM_SERVICES 16
+// services that the framework will handle. 32 is as high as it goes: the
+// subscription sets (ES_ServiceSet_t in ES_PostList.h) are a single 32-bit
+// word and ES_ServiceHeaders.h stops at SERV_31_HEADER. The Ready set is
+// already built from 32-bit words, one word being the fastest case for the
+// scheduler.
+#define MAX_NUM_SERVICES 32
+
+/****************************************************************************/
+// The host port's test build (make -C HostPort test) adds its own services
+// after the robot's, see HostPort/HostTest.h. Every other build has none.
+#ifdef ES_HOST_TEST
+#include "HostTest.h"
+#else
+#define HOST_TEST_NUM_SERVICES 0
+#define HOST_TEST_SERVICES(SERVICE, BATCH_SERVICE)
+#define HOST_TEST_INBOXES(INBOX)
+#endif
 
 /****************************************************************************/
 // This macro determines that nuber of services that are *actually* used in
 // a particular application. It will vary in value from 1 to MAX_NUM_SERVICES
-#define NUM_SERVICES 5
+// It must match the number of entries in SERVICE_TABLE below.
+#define NUM_SERVICES (5 + HOST_TEST_NUM_SERVICES)
 
 /****************************************************************************/
-// These are the definitions for Service 0, the lowest priority service.
-// Every Events and Services application must have a Service 0. Further
-// services are added in numeric sequence (1,2,3,...) with increasing
-// priorities
-// the header file with the public function prototypes
-#define SERV_0_HEADER "SensorService.h"
-// the name of the Init function
-#define SERV_0_INIT InitSensorService
-// the name of the run function
-#define SERV_0_RUN RunSensorService
-// How big should this services Queue be?
-#define SERV_0_QUEUE_SIZE 5
+// The service table. The framework builds the service descriptors and the
+// event queues from this one table. Each entry is one of:
+//   SERVICE(Priority, InitFunction, RunFunction, QueueSize)
+//   BATCH_SERVICE(Priority, InitFunction, RunBatchFunction, QueueSize,
+//                 MaxBatch)
+// Entries must be listed in priority order, starting with Service 0, the
+// lowest priority. Every Events and Services application must have a
+// Service 0. Further services are added in numeric sequence (1,2,3,...)
+// with increasing priorities.
+// A BATCH_SERVICE is handed every event in its queue at dispatch time (up to
+// MaxBatch of them) in a single call to
+//   ES_Event_t RunBatchFunction(const ES_Event_t *pEvents, uint8_t NumEvents)
+// which saves the scheduler pass per event for bursty producers. Only use
+// it where the queue really does hold several events at dispatch time.
+// QueueSize is rounded up to a power of 2 (up to 32768), see ES_Queue.h.
+#define SERVICE_TABLE(SERVICE, BATCH_SERVICE)                               \
+  SERVICE(0, InitSensorService,     RunSensorService,     5)                \
+  SERVICE(1, InitRobotSM,           RunRobotSM,           5)                \
+  SERVICE(2, InitBeaconTestHarness, RunBeaconTestHarness, 3)                \
+  SERVICE(3, InitLeaderSPI,         RunLeaderSPI,         5)                \
+  SERVICE(4, InitRobotTestHarness,  RunRobotTestHarness,  3)                \
+  HOST_TEST_SERVICES(SERVICE, BATCH_SERVICE)
+
+// What a post does when it finds a service's queue full. Services that are
+// not listed use ES_QUEUE_REJECT_NEW: the post returns false and the new
+// event is lost. The other choices are
+//   ES_QUEUE_DROP_OLDEST  throw away the oldest queued event to make room
+//                         (a LIFO post throws away the last in line)
+//   ES_QUEUE_COALESCE     merge the new event into a queued one with the
+//                         same EventType and EventParam (falls back to
+//                         rejecting if there is none)
+//   ES_QUEUE_TRAP         print the service & event and halt, for debugging
+// Overflows are counted for every service whatever the policy, see
+// ES_GetQueueStats.
+#define QUEUE_POLICY_TABLE(POLICY)                                            \
+  POLICY(1, ES_QUEUE_COALESCE)
+
+// Services listed here get an ISR inbox: a lock free queue of InboxSize
+// events that posts made from ISRs go into without interrupts being
+// disabled. ES_Run moves them on to the service's own queue (applying the
+// policy above) before it picks the next service to run. Posts from ISRs
+// to services that aren't listed take the usual critical region.
+//   INBOX(Priority, InboxSize)
+// An inbox has a single producer, so only ISRs at one priority level may
+// post to each of these services. InboxSize must be 1 to 254.
+// No ISR posts to a robot service at present (IC4 and SPI1 defer their
+// work, see below), so only the host port's test build has an inbox.
+#define ISR_INBOX_TABLE(INBOX)                                                \
+  HOST_TEST_INBOXES(INBOX)
+
+// Work that ISRs put off to ES_Run, see ES_DeferredWork.h. An ISR does what
+// can't wait and calls ES_DeferWork(Name), or ES_DeferWorkWithData(Name,
+// Data) to pass a 32 bit value on; ES_Run calls the handler before it
+// dispatches the next service.
+//   DEFERRED_WORK(Priority, Name, HandlerFunction, FifoSize)
+// with the handler a void HandlerFunction(uint32_t Data). Entries must be
+// listed in priority order starting at 0, as for SERVICE_TABLE, and pending
+// work is handled highest priority first. FifoSize values (up to 254) are
+// kept for the handler, which is called once for each of them; with
+// FifoSize 0 it is called once, with Data 0, however many times the work
+// was deferred. Only ISRs at one priority level may defer work that has a
+// FIFO. At most 32 entries.
+#define DEFERRED_WORK_TABLE(DEFERRED_WORK)                                    \
+  DEFERRED_WORK(0, DEFER_SPI_XFER_DONE, FinishLeaderSPIXfer,  0)             \
+  DEFERRED_WORK(1, DEFER_BEACON_EDGE,   ProcessBeaconEdge,    8)
+
+// The largest MaxBatch allowed for a BATCH_SERVICE. This sizes the buffer
+// that ES_Run drains the queue into.
+#define ES_MAX_BATCH 8
 
 /****************************************************************************/
-// The following sections are used to define the parameters for each of the
-// services. You only need to fill out as many as the number of services
-// defined by NUM_SERVICES
-/****************************************************************************/
-// These are the definitions for Service 1
-#if NUM_SERVICES > 1
-// the header file with the public function prototypes
-#define SERV_1_HEADER "RobotHSM.h"
-// the name of the Init function
-#define SERV_1_INIT InitRobotSM
-// the name of the run function
-#define SERV_1_RUN RunRobotSM
-// How big should this services Queue be?
-#define SERV_1_QUEUE_SIZE 5
-#endif
+// With ES_USE_EVENT_POOL defined the services' queues share one pool of
+// ES_EVENT_POOL_SIZE events. Each service then keeps only a ring of 1 byte
+// pool indices, so QueueSize in SERVICE_TABLE becomes the deepest that
+// service's queue may get (up to 128) rather than events set aside for it
+// alone, and the pool need only cover the most events queued at once
+// across all of the services. The 'q' key of RobotTestHarness shows how
+// full the pool has been.
+//#define ES_USE_EVENT_POOL
+// 1 to 255 events
+#define ES_EVENT_POOL_SIZE 20
+
+// The events of the pool that are kept back for a service, so that bursts
+// to the other services can't use up the pool and leave it with nothing.
+// Services that are not listed have no reservation. The reservations must
+// add up to no more than ES_EVENT_POOL_SIZE.
+//   RESERVE(Priority, NumEvents)
+#define EVENT_POOL_RESERVE_TABLE(RESERVE)                                     \
+  RESERVE(1, 4)   /* RobotHSM */                                              \
+  RESERVE(3, 4)   /* LeaderSPI */
 
 /****************************************************************************/
-// These are the definitions for Service 2
-#if NUM_SERVICES > 2
-// the header file with the public function prototypes
+// The header files with the public function prototypes for each service in
+// the table above. The preprocessor can't #include from a table, so these
+// stay as a list. Define one SERV_n_HEADER for each service.
+#define SERV_0_HEADER "SensorService.h"
+#define SERV_1_HEADER "RobotHSM.h"
 #define SERV_2_HEADER "BeaconTestHarness.h"
-// the name of the Init function
-#define SERV_2_INIT InitBeaconTestHarness
-// the name of the run function
-#define SERV_2_RUN RunBeaconTestHarness
-// How big should this services Queue be?
-#define SERV_2_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 3
-#if NUM_SERVICES > 3
-// the header file with the public function prototypes
 #define SERV_3_HEADER "LeaderSPI.h"
-// the name of the Init function
-#define SERV_3_INIT InitLeaderSPI
-// the name of the run function
-#define SERV_3_RUN RunLeaderSPI
-// How big should this services Queue be?
-#define SERV_3_QUEUE_SIZE 5
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 4
-#if NUM_SERVICES > 4
-// the header file with the public function prototypes
 #define SERV_4_HEADER "RobotTestHarness.h"
-// the name of the Init function
-#define SERV_4_INIT InitRobotTestHarness
-// the name of the run function
-#define SERV_4_RUN RunRobotTestHarness
-// How big should this services Queue be?
-#define SERV_4_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 5
-#if NUM_SERVICES > 5
-// the header file with the public function prototypes
-#define SERV_5_HEADER "TestHarnessService5.h"
-// the name of the Init function
-#define SERV_5_INIT InitTestHarnessService5
-// the name of the run function
-#define SERV_5_RUN RunTestHarnessService5
-// How big should this services Queue be?
-#define SERV_5_QUEUE_SIZE 3
-#endif
 
 /****************************************************************************/
-// These are the definitions for Service 6
-#if NUM_SERVICES > 6
-// the header file with the public function prototypes
-#define SERV_6_HEADER "TestHarnessService6.h"
-// the name of the Init function
-#define SERV_6_INIT InitTestHarnessService6
-// the name of the run function
-#define SERV_6_RUN RunTestHarnessService6
-// How big should this services Queue be?
-#define SERV_6_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 7
-#if NUM_SERVICES > 7
-// the header file with the public function prototypes
-#define SERV_7_HEADER "TestHarnessService7.h"
-// the name of the Init function
-#define SERV_7_INIT InitTestHarnessService7
-// the name of the run function
-#define SERV_7_RUN RunTestHarnessService7
-// How big should this services Queue be?
-#define SERV_7_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 8
-#if NUM_SERVICES > 8
-// the header file with the public function prototypes
-#define SERV_8_HEADER "TestHarnessService8.h"
-// the name of the Init function
-#define SERV_8_INIT InitTestHarnessService8
-// the name of the run function
-#define SERV_8_RUN RunTestHarnessService8
-// How big should this services Queue be?
-#define SERV_8_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 9
-#if NUM_SERVICES > 9
-// the header file with the public function prototypes
-#define SERV_9_HEADER "TestHarnessService9.h"
-// the name of the Init function
-#define SERV_9_INIT InitTestHarnessService9
-// the name of the run function
-#define SERV_9_RUN RunTestHarnessService9
-// How big should this services Queue be?
-#define SERV_9_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 10
-#if NUM_SERVICES > 10
-// the header file with the public function prototypes
-#define SERV_10_HEADER "TestHarnessService10.h"
-// the name of the Init function
-#define SERV_10_INIT InitTestHarnessService10
-// the name of the run function
-#define SERV_10_RUN RunTestHarnessService10
-// How big should this services Queue be?
-#define SERV_10_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 11
-#if NUM_SERVICES > 11
-// the header file with the public function prototypes
-#define SERV_11_HEADER "TestHarnessService11.h"
-// the name of the Init function
-#define SERV_11_INIT InitTestHarnessService11
-// the name of the run function
-#define SERV_11_RUN RunTestHarnessService11
-// How big should this services Queue be?
-#define SERV_11_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 12
-#if NUM_SERVICES > 12
-// the header file with the public function prototypes
-#define SERV_12_HEADER "TestHarnessService12.h"
-// the name of the Init function
-#define SERV_12_INIT InitTestHarnessService12
-// the name of the run function
-#define SERV_12_RUN RunTestHarnessService12
-// How big should this services Queue be?
-#define SERV_12_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 13
-#if NUM_SERVICES > 13
-// the header file with the public function prototypes
-#define SERV_13_HEADER "TestHarnessService13.h"
-// the name of the Init function
-#define SERV_13_INIT InitTestHarnessService13
-// the name of the run function
-#define SERV_13_RUN RunTestHarnessService13
-// How big should this services Queue be?
-#define SERV_13_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 14
-#if NUM_SERVICES > 14
-// the header file with the public function prototypes
-#define SERV_14_HEADER "TestHarnessService14.h"
-// the name of the Init function
-#define SERV_14_INIT InitTestHarnessService14
-// the name of the run function
-#define SERV_14_RUN RunTestHarnessService14
-// How big should this services Queue be?
-#define SERV_14_QUEUE_SIZE 3
-#endif
-
-/****************************************************************************/
-// These are the definitions for Service 15
-#if NUM_SERVICES > 15
-// the header file with the public function prototypes
-#define SERV_15_HEADER "TestHarnessService15.h"
-// the name of the Init function
-#define SERV_15_INIT InitTestHarnessService15
-// the name of the run function
-#define SERV_15_RUN RunTestHarnessService15
-// How big should this services Queue be?
-#define SERV_15_QUEUE_SIZE 3
+// With ES_COMPACT_EVENTS defined the event type is stored in the smallest
+// integer that holds all of the event types below, 8 bits for up to 256 of
+// them and 16 bits beyond that, instead of XC32's 32 bit enum. That makes
+// an ES_Event_t 4 bytes instead of 8, halving the RAM of every queue and
+// deferral queue, and an event passed by value fits in one register.
+// (_INCLUDE_LATENCY_STATS_ still adds its 4 byte TimeStamp to each event.)
+// The queue header then takes 2 of the smaller events instead of 1, see
+// ES_QUEUE_BLOCK_SIZE in ES_Queue.h.
+//#define ES_COMPACT_EVENTS
+
+#ifdef ES_COMPACT_EVENTS
+#define ES_EVENT_TYPE_PACKING __attribute__((packed))
+#else
+#define ES_EVENT_TYPE_PACKING
 #endif
 
 /****************************************************************************/
 // Name/define the events of interest
 // Universal events occupy the lowest entries, followed by user-defined events
-typedef enum
+typedef enum ES_EVENT_TYPE_PACKING
 {
     ES_NO_EVENT = 0,
     ES_ERROR,                 /* used to indicate an error from the service */
@@ -261,6 +207,7 @@ typedef enum
     ES_ENTRY,
     ES_ENTRY_HISTORY,
     ES_EXIT,
+    ES_TICK_OVERRUN,          /* the tick missed ticks, see ES_Port.h */
     /* User-defined events start here */
     EV_NEW_KEY,               /* signals a new key received from terminal */
 
@@ -298,39 +245,26 @@ typedef enum
 
     // Sensor Events
     SENSE_START_BEACON_IC,
-    SENSE_STOP_BEACON_IC
-            
+    SENSE_STOP_BEACON_IC,
+
+#ifdef ES_HOST_TEST
+    // the host port's test service, see HostPort/HostTest.h
+    HOST_TEST_BURST,
+    HOST_TEST_INBOX,
+    HOST_TEST_ECHO,
+#endif
+
+    NUM_ES_EVENT_TYPES        /* must be last, sizes the subscription table */
 } ES_EventType_t;
 
 /****************************************************************************/
-// These are the definitions for the Distribution lists. Each definition
-// should be a comma separated list of post functions to indicate which
-// services are on that distribution list.
-#define NUM_DIST_LISTS 0
-#if NUM_DIST_LISTS > 0
-#define DIST_LIST0 PostTestHarnessService0, PostTestHarnessService0
-#endif
-#if NUM_DIST_LISTS > 1
-#define DIST_LIST1 PostTestHarnessService1, PostTestHarnessService1
-#endif
-#if NUM_DIST_LISTS > 2
-#define DIST_LIST2 PostTemplateFSM
-#endif
-#if NUM_DIST_LISTS > 3
-#define DIST_LIST3 PostTemplateFSM
-#endif
-#if NUM_DIST_LISTS > 4
-#define DIST_LIST4 PostTemplateFSM
-#endif
-#if NUM_DIST_LISTS > 5
-#define DIST_LIST5 PostTemplateFSM
-#endif
-#if NUM_DIST_LISTS > 6
-#define DIST_LIST6 PostTemplateFSM
-#endif
-#if NUM_DIST_LISTS > 7
-#define DIST_LIST7 PostTemplateFSM
-#endif
+// The startup subscriptions for ES_Publish. Each entry names an event and
+// the set of services that receive it when it is published, built by OR'ing
+// together ES_SERVICE_BIT(n) for the service at priority n. Events that are
+// not listed have no subscribers until a service calls ES_Subscribe.
+#define SUBSCRIPTION_TABLE(SUBSCRIBE)                                         \
+  SUBSCRIBE(EV_NEW_KEY,      ES_SERVICE_BIT(4))                               \
+  SUBSCRIBE(ES_TICK_OVERRUN, ES_SERVICE_BIT(4))
 
 /****************************************************************************/
 // This is the list of event checking functions
@@ -374,5 +308,22 @@ typedef enum
 #define SHOOTING_TIMER 11
 #define RELOADING_TIMER 10
 
+/****************************************************************************/
+// The number of timers, on top of the 16 above, that services can take and
+// give back at run time with ES_Timer_Alloc and ES_Timer_Free. Each one
+// takes 7 bytes of RAM and a bit. At most 238, 0 leaves them out.
+#define ES_NUM_DYNAMIC_TIMERS 64
+
+// With ES_USE_TIMER_CALLBACKS defined, ES_Timer_SetCallback can have one of
+// the 16 timers above call a function when it expires, from the tick
+// processing in ES_Run, in place of posting ES_TIMEOUT. Costs a pointer of
+// RAM per timer.
+//#define ES_USE_TIMER_CALLBACKS
+
+// The number of one shot microsecond timers that ES_ShortTimer runs on
+// Timer4/Timer5, at least 2 (TIMER_A and TIMER_B). Each one takes 11 bytes
+// of RAM.
+#define ES_NUM_SHORT_TIMERS 4
+
 
 #endif /* ES_CONFIGURE_H */
@@ -16,11 +16,8 @@
  Description
    Initializes a queue structure at the beginning of the block of memory
  Notes
-   you should pass it a block that is at least sizeof(ES_Queue_t) larger than
-   the number of entries that you want in the queue. Since the size of an
-   ES_Event (at 4 bytes; 2 enum, 2 param) is greater than the
-   sizeof(ES_Queue_t), you only need to declare an array of ES_Event
-   with 1 more element than you need for the actual queue.
+   declare the block with ES_QUEUE_BLOCK_SIZE(n) events to get room for
+   n entries plus the queue's header
 ****************************************************************************/
 #define ES_InitDeferralQueueWith(a, b) ES_InitQueue(a, b)
 
@@ -48,8 +45,8 @@
  Returns
      bool true if an event was recalled, false if no event was left in queue
  Description
-     pulls an event off the deferral queue if one is available. It there was
-     something in the queue, then it posts it LIFO fashion to the queue
+     pulls all events off the deferral queue if any are available. If there
+     was something in the queue, then it posts them LIFO fashion to the queue
      indicated by WhichService
  Notes
      None.
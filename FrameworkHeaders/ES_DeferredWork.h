@@ -0,0 +1,55 @@
+/****************************************************************************
+ Module
+     ES_DeferredWork.h
+ Description
+     header file for the deferred interrupt work, the part of an ISR's job
+     that is put off to ES_Run, configured with DEFERRED_WORK_TABLE in
+     ES_Configure.h
+ Notes
+     The names in DEFERRED_WORK_TABLE become the values of
+     ES_DeferredWork_t, so an ISR defers its work with, e.g.,
+       ES_DeferWork(DEFER_SPI_XFER_DONE);
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 22:40 ahb      started coding
+*****************************************************************************/
+#ifndef ES_DeferredWork_H
+#define ES_DeferredWork_H
+
+#include "ES_Types.h"
+#include "ES_Configure.h"
+
+// what a handler looks like, Data is the value the ISR deferred with
+typedef void DeferredHandler_t (uint32_t Data);
+
+#define DEFERRED_WORK_NAME(Prio, Name, Handler, FifoSize) Name,
+
+typedef enum
+{
+  DEFERRED_WORK_TABLE(DEFERRED_WORK_NAME)
+  NUM_DEFERRED_WORK
+}ES_DeferredWork_t;
+
+// the cost of each entry's handler, read with ES_GetDeferredWorkStats
+typedef struct
+{
+  uint32_t NumRuns;             // calls to the handler
+  uint32_t TotalCycles;         // time in the handler, in _HW_GetCycleCount
+  uint32_t MaxCycles;           // counts, and the longest single call
+  uint16_t NumOverflows;        // values lost to a full FIFO
+}ES_DeferredWorkStats_t;
+
+/* prototypes for public functions */
+
+void ES_InitDeferredWork(void);
+bool ES_DeferWork(ES_DeferredWork_t Which);
+bool ES_DeferWorkWithData(ES_DeferredWork_t Which, uint32_t Data);
+bool ES_RunDeferredWork(void);
+bool ES_IsDeferredWorkPending(void);
+bool ES_GetDeferredWorkStats(ES_DeferredWork_t Which,
+                             ES_DeferredWorkStats_t *pStats);
+void ES_ClearDeferredWorkStats(void);
+
+#endif /* ES_DeferredWork_H */
@@ -0,0 +1,73 @@
+/****************************************************************************
+ Module
+     ES_EventPool.h
+ Description
+     header file for the shared event pool, which holds the queued events of
+     all of the services when ES_USE_EVENT_POOL is defined
+ Notes
+     Each service's queue is a ring of 1 byte indices into the pool. The
+     functions mirror those in ES_Queue.h, taking the service's ring in place
+     of its block of memory.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 04:00 ahb      added ES_Pool_DropNewest
+ 10/17/26 00:40 ahb      ES_Pool_ReplaceSameType is now ES_Pool_ReplaceSameEvent
+ 10/16/26 19:10 ahb      started coding
+*****************************************************************************/
+#ifndef ES_EventPool_H
+#define ES_EventPool_H
+
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+// the pool is indexed with a uint8_t
+#define ES_POOL_MAX_SIZE 255
+// and so is a ring, which holds a power of 2 entries
+#define ES_POOL_MAX_RING 128
+
+// one service's queue. It holds at most Mask + 1 events, and may always
+// take an event from the pool while it holds fewer than Reserve.
+typedef struct
+{
+  uint8_t Mask;
+  uint8_t CurrentIndex;         // ring position of the oldest entry
+  uint8_t NumEntries;
+  uint8_t Reserve;
+  uint8_t *pIndices;            // the ring itself, pool indices
+}ES_PoolRing_t;
+
+// the occupancy of the pool, read with ES_Pool_GetStats
+typedef struct
+{
+  uint8_t Size;                 // events in the pool
+  uint8_t InUse;                // events queued right now
+  uint8_t HighWater;            // most events that have been queued at once
+  uint8_t NumReserved;          // total of the rings' reservations
+  uint16_t NumRefused;          // posts refused for want of a free event,
+                                // stops at 65535
+  uint16_t Bytes;               // RAM taken by the pool and the rings
+}ES_PoolStats_t;
+
+/* prototypes for public functions */
+
+void ES_Pool_Init(ES_Event_t *pEvents, uint8_t *pFreeList, uint8_t Size);
+uint8_t ES_Pool_InitRing(ES_PoolRing_t *pRing, uint8_t *pIndices,
+                         uint8_t RingSize, uint8_t Reserve);
+bool ES_Pool_EnQueueFIFO(ES_PoolRing_t *pRing, ES_Event_t Event2Add);
+bool ES_Pool_EnQueueLIFO(ES_PoolRing_t *pRing, ES_Event_t Event2Add);
+uint16_t ES_Pool_DeQueue(ES_PoolRing_t *pRing, ES_Event_t *pReturnEvent);
+bool ES_Pool_IsEmpty(ES_PoolRing_t *pRing);
+uint16_t ES_Pool_GetDepth(ES_PoolRing_t *pRing);
+bool ES_Pool_DropOldest(ES_PoolRing_t *pRing);
+bool ES_Pool_DropNewest(ES_PoolRing_t *pRing);
+bool ES_Pool_ReplaceSameEvent(ES_PoolRing_t *pRing, ES_Event_t NewEvent);
+uint16_t ES_Pool_EnQueueBatch(ES_PoolRing_t *pRing, const ES_Event_t *pEvents,
+                              uint16_t NumEvents, bool AtFront);
+uint16_t ES_Pool_DeQueueBatch(ES_PoolRing_t *pRing, ES_Event_t *pEvents,
+                              uint16_t MaxEvents);
+void ES_Pool_GetStats(ES_PoolStats_t *pStats);
+void ES_Pool_ClearStats(void);
+
+#endif /* ES_EventPool_H */
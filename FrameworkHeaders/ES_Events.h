@@ -8,6 +8,9 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 01:40 ahb      TimeStamp is set by the posts and the ISR inboxes
+ 10/16/26 18:10 ahb      checks on the size of compact events
+ 10/16/26 13:40 ahb      added TimeStamp for the latency statistics
  10/19/17 14:22 jec      changed include to ES_Cpnfigre to get definition of
                          ES_EventTyp_t
  08/05/13 15:19 jec      modifications to suit new portable type definitions
@@ -23,11 +26,34 @@
 #include <stdint.h>
 
 #include "ES_Configure.h"
+#include "ES_General.h"
 
 typedef struct ES_Event
 {
   ES_EventType_t EventType;      // what kind of event?
   uint16_t EventParam;          // parameter value for use w/ this event
+#ifdef _INCLUDE_LATENCY_STATS_
+  // _HW_GetCycleCount() when the event was posted, set by the framework's
+  // post functions or, for a post from an ISR, the ISR inbox. Adds 4 bytes
+  // to every event, in every queue.
+  uint32_t TimeStamp;
+#endif
 }ES_Event_t;
 
+// the size of an ES_Event_t with XC32's 32 bit enum, as it is without
+// ES_COMPACT_EVENTS, for reporting what the compact events save
+#ifdef _INCLUDE_LATENCY_STATS_
+#define ES_WIDE_EVENT_BYTES 12
+#else
+#define ES_WIDE_EVENT_BYTES 8
+#endif
+
+#ifdef ES_COMPACT_EVENTS
+ES_STATIC_ASSERT(sizeof(ES_EventType_t) <= sizeof(uint16_t),
+    ES_EventType_t_does_not_fit_in_16_bits);
+#ifndef _INCLUDE_LATENCY_STATS_
+ES_STATIC_ASSERT(sizeof(ES_Event_t) == 4, ES_Event_t_is_not_4_bytes);
+#endif
+#endif
+
 #endif /* ES_Events_H */
@@ -8,6 +8,14 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/16/26 22:40 ahb      include ES_DeferredWork.h
+ 10/16/26 18:40 ahb      added ES_PostBatchToService prototype
+ 10/16/26 17:40 ahb      queue stats sizes are 16 bits for the larger queues
+ 10/16/26 14:20 ahb      added the queue overflow policies and queue stats
+ 10/16/26 13:40 ahb      added ES_LatencyStats_t and its access functions
+ 10/16/26 11:30 ahb      added the mutex, ES_ScheduleFromISR and
+                         ES_GetMaxDispatchLatency prototypes
+ 10/16/26 10:05 ahb      added ES_DispatchStats_t & ES_GetDispatchStats
  11/02/13 17:06 jec      added ES_PostToServiceLIFO prototype
  08/05/13 15:00 jec      added #include for ES_Port.h to get portability stuff
  10/17/06 07:41 jec      started coding
@@ -28,6 +36,7 @@
 #include "ES_PostList.h"
 #include "ES_General.h"
 #include "ES_Timers.h"
+#include "ES_DeferredWork.h"
 
 typedef enum
 {
@@ -40,10 +49,71 @@ typedef enum
   FailedOther
 }ES_Return_t;
 
+// counters kept by ES_Run when _INCLUDE_DISPATCH_STATS_ is defined
+typedef struct
+{
+  uint32_t SchedulerPasses;   // times ES_Run picked a service to run
+  uint32_t RunCalls;          // calls to a RunFunc or RunBatchFunc
+  uint32_t EventsDispatched;  // events handed to services
+  uint32_t IdleLoops;         // passes through the idle part of ES_Run
+}ES_DispatchStats_t;
+
+// number of buckets in the latency histograms. Bucket n counts latencies
+// of 2^n to 2^(n+1)-1 _HW_GetCycleCount counts, bucket 0 also counts 0.
+#define ES_LATENCY_BUCKETS 32
+
+// the enqueue to run function latency of one service's events, kept when
+// _INCLUDE_LATENCY_STATS_ is defined
+typedef struct
+{
+  uint32_t NumEvents;           // events measured
+  uint32_t MaxLatency;          // in _HW_GetCycleCount counts
+  uint64_t TotalLatency;        // divide by NumEvents for the mean
+  uint16_t Buckets[ES_LATENCY_BUCKETS]; // these stop counting at 65535
+}ES_LatencyStats_t;
+
+// what a post does when the service's queue is full, set per service by
+// QUEUE_POLICY_TABLE in ES_Configure.h
+typedef enum
+{
+  ES_QUEUE_REJECT_NEW = 0,    // the default
+  ES_QUEUE_DROP_OLDEST,
+  ES_QUEUE_COALESCE,
+  ES_QUEUE_TRAP
+}ES_QueuePolicy_t;
+
+// the usage of one service's queue, read with ES_GetQueueStats
+typedef struct
+{
+  uint16_t Size;              // number of events the queue can hold
+  uint16_t HighWater;         // most events that have been in it at once
+  uint16_t NumOverflows;      // posts that found it full, stops at 65535
+}ES_QueueStats_t;
+
+// returned by ES_MutexLock, to be handed back to ES_MutexUnlock
+typedef uint8_t ES_MutexState_t;
+
 ES_Return_t ES_Initialize(TimerRate_t NewRate);
 ES_Return_t ES_Run(void);
 bool ES_PostAll(ES_Event_t ThisEvent);
 bool ES_PostToService(uint8_t WhichService, ES_Event_t ThisEvent);
 bool ES_PostToServiceLIFO(uint8_t WhichService, ES_Event_t TheEvent);
+bool ES_PostBatchToService(uint8_t WhichService, const ES_Event_t *pEvents,
+                           uint8_t NumEvents, bool AtFront);
+bool ES_GetQueueStats(uint8_t WhichService, ES_QueueStats_t *pStats);
+void ES_ClearQueueStats(void);
+ES_MutexState_t ES_MutexLock(uint8_t PrioCeiling);
+void ES_MutexUnlock(ES_MutexState_t PrevState);
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+void ES_ScheduleFromISR(void);
+#endif
+#ifdef _INCLUDE_LATENCY_STATS_
+bool ES_GetLatencyStats(uint8_t WhichService, ES_LatencyStats_t *pStats);
+void ES_ClearLatencyStats(void);
+#endif
+#ifdef _INCLUDE_DISPATCH_STATS_
+void ES_GetDispatchStats(ES_DispatchStats_t *pStats);
+uint32_t ES_GetMaxDispatchLatency(uint8_t WhichService);
+#endif
 
 #endif   // ES_Framework_H
@@ -6,4 +6,9 @@
 #define BITS_PER_BYTE 8
 #define BITS_PER_NYBBLE 4
 
+// compile time check, the build fails with a negative array size if the
+// condition is false. msg must be a valid identifier and names the check.
+#define ES_STATIC_ASSERT(cond, msg) \
+  typedef char ES_static_assert_##msg[(cond) ? 1 : -1]
+
 #endif //ES_General_H
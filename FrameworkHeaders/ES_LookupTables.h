@@ -17,12 +17,17 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/16/26 09:12 ahb      added ES_GetMSBitSet32, a count leading zeros based
+                         version for the 32 bit Ready set
  10/20/13 21:19 jec      got rid of BitNum2ClrMask and replaced with #define
                          replaced Byte2MSBNum with function ES_GetMSBSet
                          replaced Byte2MSBNum array with Nybble2MSBNum
  08/05/13 15:45 jec      added #include for ES_Types.h since we depend on it
  01/15/12 13:03 jec      started coding
 *****************************************************************************/
+#ifndef ES_LookupTables_H
+#define ES_LookupTables_H
+
 #include "ES_Types.h"
 /*
   Since we moved up to 16 timers & services, this table got too big to justify
@@ -61,3 +66,38 @@ extern uint8_t const Nybble2MSBitNum[15];
    J. Edward Carryer, 10/20/13, 17:03
 ****************************************************************************/
 uint8_t ES_GetMSBitSet(uint16_t Val2Check);
+
+/****************************************************************************
+ Function
+   ES_GetMSBitSet32
+ Parameters
+   uint32_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   find the MSB that is set in Val2Check and returns that bit number
+ Notes
+   On the PIC32 (and any GCC target) this compiles to a single count leading
+   zeros instruction (clz on the MIPS32 M4K core). The binary search version
+   is the portable fallback for other compilers.
+****************************************************************************/
+static inline uint8_t ES_GetMSBitSet32(uint32_t Val2Check)
+{
+  if (Val2Check == 0)
+  {
+    return 128; // same error return as ES_GetMSBitSet
+  }
+#if defined(__GNUC__)
+  return (uint8_t)(31 - __builtin_clz(Val2Check));
+#else
+  {
+    uint8_t BitNum = 0;
+    if (Val2Check & 0xFFFF0000UL) { Val2Check >>= 16; BitNum += 16; }
+    if (Val2Check & 0x0000FF00UL) { Val2Check >>= 8;  BitNum += 8; }
+    if (Val2Check & 0x000000F0UL) { Val2Check >>= 4;  BitNum += 4; }
+    return BitNum + Nybble2MSBitNum[Val2Check - 1];
+  }
+#endif
+}
+
+#endif /* ES_LookupTables_H */
@@ -9,6 +9,27 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 12:10 ahb     ES_USE_IDLE_WAIT is off by default, like the other
+                        options
+ 10/17/26 01:20 ahb     ES_USE_TICK_STATS is off by default, ES_TICK_OVERRUN
+                        needs 5 missed ticks and is rate limited by
+                        ES_TICK_OVERRUN_HOLDOFF
+ 10/17/26 00:10 ahb     added ES_USE_TICK_STATS, the missed tick and tick
+                        lateness telemetry, and ES_TICK_OVERRUN
+ 10/16/26 23:40 ahb     EnterCritical/ExitCritical feed the profiler when
+                        ES_USE_PROFILER is defined, which replaces
+                        ES_MEASURE_CRITICAL. Added _HW_AtomicSwapPtr
+ 10/16/26 23:10 ahb     EnterCritical/ExitCritical raise the IPL to
+                        ES_CRITICAL_IPL and restore it, so they nest and leave
+                        the capture ISRs unmasked. Added ES_MEASURE_CRITICAL
+ 10/16/26 22:40 ahb     added _HW_AtomicSetBits32 & _HW_AtomicTakeBits32 for
+                        the deferred interrupt work
+ 10/16/26 22:10 ahb     added the tickless mode and the tick interrupt count
+ 10/16/26 20:10 ahb     added _HW_GetCycleCount64 for the 64 bit clock
+ 10/16/26 17:00 ahb     added _HW_MemoryBarrier for the lock free ISR inboxes
+ 10/16/26 15:00 ahb     noted the host port, built with ES_HOST_PORT defined
+ 10/16/26 11:30 ahb     added the preemptive kernel switch and its port hooks
+ 10/16/26 10:40 ahb     added the idle wait mode and its prototypes
  10/26/17 18:39 jec     moves definition of ALL_BITS to here
  10/14/15 21:50 jec     added prototype for ES_Timer_GetTime
  01/18/15 13:24 jec     clean up and adapt to use TI driver lib functions
@@ -22,7 +43,9 @@
 #ifndef ES_PORT_H
 #define ES_PORT_H
 
-// pull in the hardware header files that we need
+// pull in the hardware header files that we need. When ES_HOST_PORT is
+// defined (by HostPort/Makefile) this is the stand-in in HostPort/include
+// and the functions below come from HostPort/ES_Port_Host.c
 #include <xc.h>
 
 #include <stdio.h>
@@ -30,6 +53,7 @@
 #include "bitdefs.h"        /* generic bit defs (BIT0HI, BIT0LO,...) */
 #include "Bin_Const.h"      /* macros to specify binary constants in C */
 #include "ES_Types.h"
+#include "ES_Profile.h"
 
 #include "terminal.h"
 
@@ -60,9 +84,6 @@
 // allocation of temp var for saving interrupt enable status should be defined
 // in ES_Port.c
 
-
-extern  uint8_t _INTCON_temp;
-
 // for the PIC, at this time, we can not post from within interrupts so keep 
 // this definition commented. if you ever get posting from within a int working
 // then uncomment it.
@@ -71,18 +92,170 @@ extern  uint8_t _INTCON_temp;
 
 // in the MIPS architecture, interrupts are not disabled on entry to an ISR
 // the interrupt controller simply prevents interrupts from lower or the
-// same priority. As a result, we can create a critical region by simply
-// disabling interrupts. 
-// NOTE: This means that critical regions can not be nested
-// I don't think that this should be a serious limitation for the framework
+// same priority. As a result, we can create a critical region by raising
+// the CPU's IPL to that of the highest priority ISR that touches the
+// framework's state, ES_CRITICAL_IPL, rather than disabling interrupts.
+// ISRs above it are never held off by the framework, but must not call
+// anything that takes a critical region (posts, the timer functions, ...).
+// They may use ES_DeferWork, ES_DeferWorkWithData and ES_Time_Now.
+// The outermost EnterCritical saves the IPL it found in
+// _HW_CriticalStatus and its ExitCritical puts it back, so critical regions
+// nest and may be used from ISRs at or below ES_CRITICAL_IPL.
+// With ES_USE_PROFILER defined (ES_Profile.h) each EnterCritical is a site
+// of its own, and the outermost region is timed from the site it started at.
 #ifdef POST_FROM_INTS
-#define EnterCritical()__builtin_disable_interrupts()
-#define ExitCritical() __builtin_enable_interrupts()
+#ifdef ES_USE_PROFILER
+#define EnterCritical() \
+  do { \
+    static ES_ProfileSite_t ProfileSite = \
+        ES_PROFILE_SITE(ES_PROFILE_CRITICAL); \
+    _HW_EnterCritical(); \
+    ES_Profile_CriticalEntered(&ProfileSite); \
+  } while (0)
+#define ExitCritical() \
+  do { \
+    ES_Profile_CriticalLeaving(); \
+    _HW_ExitCritical(); \
+  } while (0)
+#else
+#define EnterCritical() _HW_EnterCritical()
+#define ExitCritical() _HW_ExitCritical()
+#endif
 #else
 #define EnterCritical()
 #define ExitCritical()
 #endif
 
+// The ISRs that post or use the timers: the core timer tick (IPL3),
+// Timer3 (IPL5, BeaconTestHarness), Timer2 (IPL2), the short timers (IPL6)
+// and the UART and scheduler (IPL1). IC4 and SPI1 (IPL7) only defer work.
+#define ES_CRITICAL_IPL 6
+
+// the Status register at the outermost EnterCritical, and how deep the
+// critical regions are nested, kept by ES_Port.c
+extern volatile uint32_t _HW_CriticalStatus;
+extern volatile uint8_t _HW_CriticalNesting;
+
+// With ES_USE_IDLE_WAIT defined, ES_Run executes the MIPS wait instruction
+// when all of the queues are empty, no user events were found and the
+// terminal has nothing left to send. The core timer compare is pushed out
+// to the next ES_Timers expiry, so an idle framework is not woken every tick.
+// Any enabled interrupt (tick, change notice, UART RX, SPI, input capture)
+// wakes the core.
+// Off by default like the other options: the robot's polled event checkers
+// (Check4Lock, CheckStartButtonPressed, CheckFireUpdate) have no change
+// notice interrupt behind them, so they would only run on a wake.
+//#define ES_USE_IDLE_WAIT
+// ES_IDLE_MAX_TICKS caps how long we stay asleep without a timer expiring.
+// Polled event checkers only run when we wake, so this is also the worst
+// case latency for them. Raise it if the event checkers are all backed by
+// change notice interrupts. Must be less than 200.
+#define ES_IDLE_MAX_TICKS 10
+
+// With ES_USE_TICKLESS defined as well, the core timer compare is no longer
+// moved on a tick at a time. It is set for the tick on which the first
+// ES_Timers timer expires, busy or idle, and the ticks in between are
+// counted from the core timer only when they are needed: when the tick is
+// processed, when a timer is started or stopped and by ES_Timer_GetTime.
+// The only tick interrupts are then the ones that expire a timer.
+// Needs ES_USE_IDLE_WAIT and the cooperative ES_Run.
+//#define ES_USE_TICKLESS
+// ES_TICKLESS_MAX_TICKS is the furthest out the compare is ever set, which
+// is also how often the tick interrupt keeps _HW_GetCycleCount64 up to date,
+// so it must come to less than 2^31 core timer counts at the slowest tick
+// rate (21474 ticks of 5ms).
+#define ES_TICKLESS_MAX_TICKS 20000
+
+// With ES_USE_PREEMPTIVE_KERNEL defined, ES_Run becomes the idle loop of a
+// single stack, run to completion, preemptive kernel. A post to a service
+// with a higher priority than the one running runs that service right away:
+// directly when posted from a service, or from the core software interrupt
+// 0 (at IPL1) when posted from an ISR. The timer tick is processed from the
+// same software interrupt, ahead of the services.
+// Services at different priorities can now interrupt each other, so any
+// data they share (including the terminal output buffer behind printf) must
+// be protected with ES_MutexLock/ES_MutexUnlock.
+// Leave it undefined to get the cooperative ES_Run.
+//#define ES_USE_PREEMPTIVE_KERNEL
+
+// free running cycle counter used for the dispatch latency measurements,
+// the core timer counts at 20MHz (50ns per count)
+#define _HW_GetCycleCount() _CP0_GET_COUNT()
+// _HW_GetCycleCount64 extends it to 64 bits, the clock behind ES_Time_Now
+#define _HW_COUNTS_PER_US 20
+
+// _HW_InISR is true when called from an ISR. Services run by the scheduler
+// interrupt run at IPL0, so they look like task code to it.
+
+// request the scheduler software interrupt (core software interrupt 0)
+#define _HW_RequestSchedule() _CP0_BIS_CAUSE(_CP0_CAUSE_IP0_MASK)
+
+// keeps memory accesses from being moved across it, for the lock free ISR
+// inboxes (ES_SPSCQueue.c). The PIC32MX has a single core that sees its own
+// accesses in program order, ISRs included, so only the compiler needs to
+// be held back. The host port's stress test has the producer on another
+// thread, so there it is a full fence.
+#ifdef ES_HOST_PORT
+#define _HW_MemoryBarrier() __sync_synchronize()
+#else
+#define _HW_MemoryBarrier() __asm__ __volatile__("" ::: "memory")
+#endif
+
+// atomic read-modify-writes of a 32 bit word, for the deferred work mask
+// (ES_DeferredWork.c) that ISRs at any priority set bits in. The M4K has
+// ll/sc, which XC32 uses for these builtins, so no critical region is
+// needed. Take returns the word and leaves it 0.
+#define _HW_AtomicSetBits32(pWord, Bits) \
+  ((void)__sync_fetch_and_or((pWord), (Bits)))
+#define _HW_AtomicTakeBits32(pWord) __sync_fetch_and_and((pWord), 0)
+// stores New in *pPtr if it still holds Old, true if it did. For the
+// profiler's list of sites, which ISRs at any priority may add to.
+#define _HW_AtomicSwapPtr(pPtr, Old, New) \
+  __sync_bool_compare_and_swap((pPtr), (Old), (New))
+
+// counters kept by the idle code, read with _HW_GetIdleStats
+typedef struct
+{
+  uint32_t NumWaits;          // times the core executed wait
+  uint32_t TicksSlept;        // ticks that passed while waiting
+  uint32_t LastWakeLatency;   // core timer counts from the tick compare to
+  uint32_t MaxWakeLatency;    // running again after the wait
+  uint32_t NumTickInts;       // core timer (tick) interrupts taken
+}ES_IdleStats_t;
+
+// With ES_USE_TICK_STATS defined the tick interrupt keeps count of the
+// ticks that it had to catch up on, because interrupts were held off past
+// the next tick, and a histogram of how late it ran after the compare
+// match, read with _HW_GetTickStats. An interrupt that finds
+// ES_TICK_OVERRUN_THRESHOLD or more ticks missed has ES_TICK_OVERRUN
+// published from _HW_Process_Pending_Ints, with the most ticks missed by
+// any one interrupt since the last one in EventParam, but no more than
+// once every ES_TICK_OVERRUN_HOLDOFF ticks, so that a subscriber that
+// prints it can't cause the next one. Subscribe a service to it in
+// SUBSCRIPTION_TABLE. The ticks slept through by the idle wait are not
+// missed. In tickless mode there is no tick to miss, only the lateness is
+// kept.
+// uncomment to build the tick stats into the port
+//#define ES_USE_TICK_STATS
+#define ES_TICK_OVERRUN_THRESHOLD 5
+#define ES_TICK_OVERRUN_HOLDOFF 1000
+
+// number of buckets in the lateness histogram. Bucket n counts 2^n to
+// 2^(n+1)-1 core timer counts, bucket 0 also counts 0 and the last one
+// everything longer (from 3.3ms on).
+#define ES_TICK_LATE_BUCKETS 17
+
+// what the tick interrupt has seen, read with _HW_GetTickStats
+typedef struct
+{
+  uint32_t NumMissedTicks;    // ticks whose interrupt never came
+  uint16_t NumOverruns;       // interrupts that found that many missed
+  uint16_t MaxCatchUp;        // most ticks counted by one interrupt
+  uint32_t MaxLateness;       // core timer counts from the compare match to
+                              // the interrupt reading the count
+  uint16_t LateBuckets[ES_TICK_LATE_BUCKETS]; // these stop at 65535
+}ES_TickStats_t;
+
 /* Rate constants for programming the SysTick Period to generate tick interrupts.
    These assume that we are using the M4K core timer running at 20MHz. Even
    thought the processor clock is 40MHz the core timer increments every other 
@@ -117,8 +290,20 @@ void _HW_PIC32Init(void);
 void _HW_Timer_Init(const TimerRate_t Rate);
 bool _HW_Process_Pending_Ints(void);
 uint16_t _HW_GetTickCount(void);
+uint16_t _HW_TakeElapsedTicks(void);
+uint64_t _HW_GetCycleCount64(void);
 void _HW_ConsoleInit(void);
 void _HW_SysTickIntHandler(void);
+void _HW_IdleWait(void);
+void _HW_GetIdleStats(ES_IdleStats_t *pStats);
+#ifdef ES_USE_TICK_STATS
+void _HW_GetTickStats(ES_TickStats_t *pStats);
+void _HW_ClearTickStats(void);
+#endif
+void _HW_SchedulerInit(void);
+void _HW_EnterCritical(void);
+void _HW_ExitCritical(void);
+bool _HW_InISR(void);
 
 // and the one Framework function that we define here
 uint16_t ES_Timer_GetTime(void);
@@ -2,13 +2,15 @@
  Module
      EF_PostList.h
  Description
-     header file for use with the module to post events to lists of state
-     machines
+     header file for use with the module to publish events to the services
+     that have subscribed to them
  Notes
 
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/16/26 12:10 ahb      replaced the ES_PostListxx functions with
+                         ES_Publish, ES_Subscribe & ES_Unsubscribe
  08/05/13 15:19 jec      modifications to suit new portable type definitions
  01/15/12 11:57 jec      modified includes to match Events & Services
  10/16/11 12:28 jec      started coding
@@ -23,13 +25,14 @@ typedef bool PostFunc_t (ES_Event_t);
 
 typedef PostFunc_t (*pPostFunc);
 
-bool  ES_PostList00(ES_Event_t);
-bool  ES_PostList01(ES_Event_t);
-bool  ES_PostList02(ES_Event_t);
-bool  ES_PostList03(ES_Event_t);
-bool  ES_PostList04(ES_Event_t);
-bool  ES_PostList05(ES_Event_t);
-bool  ES_PostList06(ES_Event_t);
-bool  ES_PostList07(ES_Event_t);
+// a set of services, one bit per service priority
+typedef uint32_t ES_ServiceSet_t;
+
+// the bit for the service at priority n, used to build SUBSCRIPTION_TABLE
+#define ES_SERVICE_BIT(n) ((ES_ServiceSet_t)1 << (n))
+
+bool ES_Publish(ES_Event_t ThisEvent);
+bool ES_Subscribe(uint8_t WhichService, ES_EventType_t WhichEvent);
+bool ES_Unsubscribe(uint8_t WhichService, ES_EventType_t WhichEvent);
 
 #endif // ES_PostList_H
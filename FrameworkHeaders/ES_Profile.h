@@ -0,0 +1,100 @@
+/****************************************************************************
+ Module
+     ES_Profile.h
+ Description
+     header file for the interrupt latency profiler. When enabled, every
+     outermost EnterCritical/ExitCritical pair, every ISR that is marked
+     with ES_PROFILE_ISR_ENTER/ES_PROFILE_ISR_EXIT and every region marked
+     with ES_PROFILE_BEGIN/ES_PROFILE_END is timed with _HW_GetCycleCount,
+     and the worst case and a histogram are kept for each place in the code
+     that it happens.
+ Notes
+     With ES_USE_PROFILER left undefined the macros expand to nothing,
+     EnterCritical/ExitCritical are the plain port functions and none of
+     the profiler code or RAM is built.
+     Each marked place gets a static ES_ProfileSite_t of its own, tagged
+     with __FILE__ and __LINE__, which is put on the list of sites the first
+     time it runs. So only the places that have run are reported, in the
+     order they first ran, and there is nothing to look up at run time.
+     ES_PROFILE_BEGIN and ES_PROFILE_ISR_ENTER declare the site, so they
+     must be at the outermost level of the function, and come before their
+     END in the same function.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 23:40 ahb     started coding
+*****************************************************************************/
+#ifndef ES_Profile_H
+#define ES_Profile_H
+
+#include "ES_Types.h"
+
+// uncomment to build the profiler into the framework. Each site that
+// runs takes about 70 bytes of RAM.
+//#define ES_USE_PROFILER
+
+// number of buckets in the histograms. Bucket n counts times of 2^n to
+// 2^(n+1)-1 _HW_GetCycleCount counts, bucket 0 also counts 0 and the last
+// one everything longer (at 50ns a count, from 1.6ms on).
+#define ES_PROFILE_BUCKETS 16
+
+// what a site is timing
+typedef enum
+{
+  ES_PROFILE_CRITICAL = 1,  // an outermost EnterCritical to its ExitCritical
+  ES_PROFILE_ISR,           // an ISR, from ES_PROFILE_ISR_ENTER to _EXIT
+  ES_PROFILE_INTS_OFF       // a region marked by hand, usually one with
+                            // interrupts disabled
+}ES_ProfileKind_t;
+
+// what has been measured at one site
+typedef struct
+{
+  const char *pFile;            // where the site is
+  uint16_t Line;
+  uint8_t Kind;                 // an ES_ProfileKind_t
+  uint32_t NumRuns;
+  uint32_t MaxCycles;           // in _HW_GetCycleCount counts
+  uint64_t TotalCycles;         // divide by NumRuns for the mean
+  uint16_t Buckets[ES_PROFILE_BUCKETS]; // these stop counting at 65535
+}ES_ProfileStats_t;
+
+// one site, declared by the macros below. Don't touch the fields.
+typedef struct ES_ProfileSite
+{
+  ES_ProfileStats_t Stats;
+  uint32_t StartTime;
+  struct ES_ProfileSite *volatile pNext; // the list of sites that have run
+  bool IsListed;
+}ES_ProfileSite_t;
+
+#ifdef ES_USE_PROFILER
+#define ES_PROFILE_SITE(Kind) { { __FILE__, __LINE__, (Kind) } }
+
+#define ES_PROFILE_BEGIN(Tag) \
+  static ES_ProfileSite_t ProfileSite_##Tag = \
+      ES_PROFILE_SITE(ES_PROFILE_INTS_OFF); \
+  ES_Profile_Begin(&ProfileSite_##Tag)
+#define ES_PROFILE_END(Tag) ES_Profile_End(&ProfileSite_##Tag)
+
+#define ES_PROFILE_ISR_ENTER() \
+  static ES_ProfileSite_t ProfileSite_ISR = ES_PROFILE_SITE(ES_PROFILE_ISR); \
+  ES_Profile_Begin(&ProfileSite_ISR)
+#define ES_PROFILE_ISR_EXIT() ES_Profile_End(&ProfileSite_ISR)
+
+void ES_Profile_Begin(ES_ProfileSite_t *pSite);
+void ES_Profile_End(ES_ProfileSite_t *pSite);
+void ES_Profile_CriticalEntered(ES_ProfileSite_t *pSite);
+void ES_Profile_CriticalLeaving(void);
+void ES_Profile_RestartCritical(void);
+bool ES_Profile_GetStats(uint8_t Which, ES_ProfileStats_t *pStats);
+void ES_Profile_ClearStats(void);
+#else
+#define ES_PROFILE_BEGIN(Tag)
+#define ES_PROFILE_END(Tag)
+#define ES_PROFILE_ISR_ENTER()
+#define ES_PROFILE_ISR_EXIT()
+#endif
+
+#endif /* ES_Profile_H */
@@ -9,6 +9,16 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 11:30 ahb      a block declared the old way keeps its size
+ 10/17/26 08:20 ahb      noted what a block declared the old way now holds
+ 10/17/26 06:20 ahb      ES_QUEUE_BLOCK_SIZE(0) fails to build
+ 10/17/26 04:00 ahb      added ES_QueueDropNewest
+ 10/17/26 00:40 ahb      ES_QueueReplaceSameType is now ES_QueueReplaceSameEvent
+ 10/16/26 18:40 ahb      added the batch, peek and purge functions
+ 10/16/26 18:10 ahb      added ES_GetQueueMemory
+ 10/16/26 17:40 ahb      added ES_QUEUE_BLOCK_SIZE, 16 bit sizes and depths
+ 10/16/26 14:20 ahb      added ES_QueueDropOldest & ES_QueueReplaceSameType
+ 10/16/26 13:00 ahb      added ES_GetQueueDepth prototype
  08/05/13 15:19 jec      modifications to suit new portable type definitions
  01/15/12 09:36 jec      converted to use new types from ES_Types.h
  10/17/11 07:49 jec      new header to match the rest of the framework
@@ -20,14 +30,67 @@
 #include "ES_Types.h"
 #include "ES_Events.h"
 
+// The queue's indices are kept in the first ES_QUEUE_HEADER_SLOTS events of
+// its block of memory and the rest holds the queued events. The number of
+// entries is always a power of 2, so that the indices wrap with a mask.
+#define ES_QUEUE_HEADER_BYTES 6
+#define ES_QUEUE_HEADER_SLOTS \
+  ((ES_QUEUE_HEADER_BYTES + sizeof(ES_Event_t) - 1) / sizeof(ES_Event_t))
+
+// NumEvents rounded up to a power of 2, for 1 to 32768 events
+#define ES_QUEUE_CAPACITY(NumEvents) (ES_POW2_SMEAR16((NumEvents) - 1) + 1)
+
+// the number of events to declare the block with for a queue of at least
+// NumEvents entries, e.g.
+//   static ES_Event_t MyQueue[ES_QUEUE_BLOCK_SIZE(10)]; // holds 16
+// NumEvents of 0 fails to build, with a negative array size.
+// A block declared the old way, ES_Event_t Q[N+1] for N events, still
+// holds N (less one more with the 2 header slots of ES_COMPACT_EVENTS),
+// but unless that is a power of 2 its indices wrap with a compare rather
+// than a mask, which is a little slower, so move such blocks over to
+// ES_QUEUE_BLOCK_SIZE(N).
+#define ES_QUEUE_BLOCK_SIZE(NumEvents) \
+  (ES_QUEUE_CAPACITY(NumEvents) + ES_QUEUE_HEADER_SLOTS + \
+   (0 * sizeof(char[((NumEvents) > 0) ? 1 : -1])))
+
+// copy the highest bit set in x into all of the bits below it
+#define ES_POW2_SMEAR1(x) ((x) | ((x) >> 1))
+#define ES_POW2_SMEAR2(x) (ES_POW2_SMEAR1(x) | (ES_POW2_SMEAR1(x) >> 2))
+#define ES_POW2_SMEAR4(x) (ES_POW2_SMEAR2(x) | (ES_POW2_SMEAR2(x) >> 4))
+#define ES_POW2_SMEAR16(x) (ES_POW2_SMEAR4(x) | (ES_POW2_SMEAR4(x) >> 8))
+
+// the RAM taken by all of the queues set up so far, from ES_GetQueueMemory
+typedef struct
+{
+  uint16_t NumQueues;         // calls to ES_InitQueue
+  uint32_t NumEntries;        // events they can hold, in total
+  uint32_t Bytes;             // size of their blocks, in total
+}ES_QueueMemory_t;
+
+// picks out the events for ES_PurgeQueue to remove
+typedef bool ES_QueueMatchFunc_t(const ES_Event_t *pEvent, void *pContext);
+
 /* prototypes for public functions */
 
-uint8_t ES_InitQueue(ES_Event_t *pBlock, uint8_t BlockSize);
+uint16_t ES_InitQueue(ES_Event_t *pBlock, uint16_t BlockSize);
 bool ES_EnQueueFIFO(ES_Event_t *pBlock, ES_Event_t Event2Add);
 bool ES_EnQueueLIFO(ES_Event_t *pBlock, ES_Event_t Event2Add);
-uint8_t ES_DeQueue(ES_Event_t *pBlock, ES_Event_t *pReturnEvent);
+uint16_t ES_DeQueue(ES_Event_t *pBlock, ES_Event_t *pReturnEvent);
 //void EF_FlushQueue( unsigned char * pBlock );
 bool ES_IsQueueEmpty(ES_Event_t *pBlock);
+uint16_t ES_GetQueueDepth(ES_Event_t *pBlock);
+bool ES_QueueDropOldest(ES_Event_t *pBlock);
+bool ES_QueueDropNewest(ES_Event_t *pBlock);
+bool ES_QueueReplaceSameEvent(ES_Event_t *pBlock, ES_Event_t NewEvent);
+void ES_GetQueueMemory(ES_QueueMemory_t *pMemory);
+uint16_t ES_EnQueueBatch(ES_Event_t *pBlock, const ES_Event_t *pEvents,
+                         uint16_t NumEvents, bool AtFront);
+uint16_t ES_DeQueueBatch(ES_Event_t *pBlock, ES_Event_t *pEvents,
+                         uint16_t MaxEvents);
+bool ES_PeekQueue(ES_Event_t *pBlock, uint16_t Position,
+                  ES_Event_t *pReturnEvent);
+uint16_t ES_PurgeQueue(ES_Event_t *pBlock, ES_QueueMatchFunc_t *pMatchFunc,
+                       void *pContext);
 
 #endif /*ES_Queue_H */
 
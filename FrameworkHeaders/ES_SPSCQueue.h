@@ -0,0 +1,41 @@
+/****************************************************************************
+ Module
+     ES_SPSCQueue.h
+ Description
+     header file for the lock free single producer, single consumer event
+     queues that ISRs post into without disabling interrupts
+ Notes
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 17:00 ahb      started coding
+*****************************************************************************/
+#ifndef ES_SPSCQueue_H
+#define ES_SPSCQueue_H
+
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+// Head is only ever written by the producer and Tail only by the consumer,
+// so neither side needs a critical region. One slot is always left empty
+// to tell a full queue from an empty one.
+typedef struct
+{
+  volatile uint8_t Head;          // next slot to fill, producer owned
+  volatile uint8_t Tail;          // next slot to empty, consumer owned
+  uint8_t NumSlots;               // the queue holds NumSlots - 1 events
+  volatile uint16_t NumOverflows; // Puts that found it full, producer owned
+  ES_Event_t *pSlots;
+}ES_SPSCQueue_t;
+
+/* prototypes for public functions */
+
+void ES_SPSC_Init(ES_SPSCQueue_t *pQueue, ES_Event_t *pSlots,
+                  uint8_t NumSlots);
+bool ES_SPSC_Put(ES_SPSCQueue_t *pQueue, ES_Event_t Event2Add);
+bool ES_SPSC_Get(ES_SPSCQueue_t *pQueue, ES_Event_t *pReturnEvent);
+bool ES_SPSC_IsEmpty(const ES_SPSCQueue_t *pQueue);
+uint16_t ES_SPSC_GetOverflows(const ES_SPSCQueue_t *pQueue);
+
+#endif /* ES_SPSCQueue_H */
@@ -4,72 +4,140 @@
  Description
      This file serves to keep the clutter down in ES_Framework.h
  Notes
+     Pulls in the SERV_n_HEADER for every service defined in ES_Configure.h
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/16/26 09:12 ahb      test for each SERV_n_HEADER directly, up to 32
  01/15/12 10:35 jec      started coding
 *****************************************************************************/
 
 #include "ES_Configure.h"
 
+#ifdef SERV_0_HEADER
 #include SERV_0_HEADER
+#endif
 
-#if NUM_SERVICES > 1
+#ifdef SERV_1_HEADER
 #include SERV_1_HEADER
 #endif
 
-#if NUM_SERVICES > 2
+#ifdef SERV_2_HEADER
 #include SERV_2_HEADER
 #endif
 
-#if NUM_SERVICES > 3
+#ifdef SERV_3_HEADER
 #include SERV_3_HEADER
 #endif
 
-#if NUM_SERVICES > 4
+#ifdef SERV_4_HEADER
 #include SERV_4_HEADER
 #endif
 
-#if NUM_SERVICES > 5
+#ifdef SERV_5_HEADER
 #include SERV_5_HEADER
 #endif
 
-#if NUM_SERVICES > 6
+#ifdef SERV_6_HEADER
 #include SERV_6_HEADER
 #endif
 
-#if NUM_SERVICES > 7
+#ifdef SERV_7_HEADER
 #include SERV_7_HEADER
 #endif
 
-#if NUM_SERVICES > 8
+#ifdef SERV_8_HEADER
 #include SERV_8_HEADER
 #endif
 
-#if NUM_SERVICES > 9
+#ifdef SERV_9_HEADER
 #include SERV_9_HEADER
 #endif
 
-#if NUM_SERVICES > 10
+#ifdef SERV_10_HEADER
 #include SERV_10_HEADER
 #endif
 
-#if NUM_SERVICES > 11
+#ifdef SERV_11_HEADER
 #include SERV_11_HEADER
 #endif
 
-#if NUM_SERVICES > 12
+#ifdef SERV_12_HEADER
 #include SERV_12_HEADER
 #endif
 
-#if NUM_SERVICES > 13
+#ifdef SERV_13_HEADER
 #include SERV_13_HEADER
 #endif
 
-#if NUM_SERVICES > 14
+#ifdef SERV_14_HEADER
 #include SERV_14_HEADER
 #endif
 
-#if NUM_SERVICES > 15
+#ifdef SERV_15_HEADER
 #include SERV_15_HEADER
 #endif
+
+#ifdef SERV_16_HEADER
+#include SERV_16_HEADER
+#endif
+
+#ifdef SERV_17_HEADER
+#include SERV_17_HEADER
+#endif
+
+#ifdef SERV_18_HEADER
+#include SERV_18_HEADER
+#endif
+
+#ifdef SERV_19_HEADER
+#include SERV_19_HEADER
+#endif
+
+#ifdef SERV_20_HEADER
+#include SERV_20_HEADER
+#endif
+
+#ifdef SERV_21_HEADER
+#include SERV_21_HEADER
+#endif
+
+#ifdef SERV_22_HEADER
+#include SERV_22_HEADER
+#endif
+
+#ifdef SERV_23_HEADER
+#include SERV_23_HEADER
+#endif
+
+#ifdef SERV_24_HEADER
+#include SERV_24_HEADER
+#endif
+
+#ifdef SERV_25_HEADER
+#include SERV_25_HEADER
+#endif
+
+#ifdef SERV_26_HEADER
+#include SERV_26_HEADER
+#endif
+
+#ifdef SERV_27_HEADER
+#include SERV_27_HEADER
+#endif
+
+#ifdef SERV_28_HEADER
+#include SERV_28_HEADER
+#endif
+
+#ifdef SERV_29_HEADER
+#include SERV_29_HEADER
+#endif
+
+#ifdef SERV_30_HEADER
+#include SERV_30_HEADER
+#endif
+
+#ifdef SERV_31_HEADER
+#include SERV_31_HEADER
+#endif
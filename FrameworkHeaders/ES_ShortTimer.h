@@ -0,0 +1,39 @@
+/****************************************************************************
+ Module
+     ES_ShortTimer.h
+ Description
+     header file for the short timers, one shot timers with 1us resolution
+     for times shorter than the ES_Timers tick
+ Notes
+     Timer numbers run from 0 to ES_NUM_SHORT_TIMERS - 1. TIMER_A and
+     TIMER_B are kept from the TI version as the names of the first two.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 21:40 ahb     started coding
+*****************************************************************************/
+#ifndef ES_ShortTimer_H
+#define ES_ShortTimer_H
+
+#include "ES_Types.h"
+#include "ES_Configure.h"
+
+// a timer whose timeouts go nowhere
+#define SHORT_TIMER_UNUSED 0xFF
+
+#define SHORT_TIMER_A 0
+#define SHORT_TIMER_B 1
+#ifndef TIMER_A
+#define TIMER_A SHORT_TIMER_A
+#define TIMER_B SHORT_TIMER_B
+#endif
+
+/* prototypes for public functions */
+
+void ES_ShortTimerInit(uint8_t TimeAPrio, uint8_t TimeBPrio);
+bool ES_ShortTimerSetService(uint8_t Which, uint8_t Priority);
+void ES_ShortTimerStart(uint32_t Which, uint16_t TimeoutValue);
+void ES_ShortTimerStop(uint32_t Which);
+
+#endif /* ES_ShortTimer_H */
@@ -14,6 +14,12 @@
  History
  When           Who	What/Why
  -------------- ---	--------
+ 10/17/26 05:40 ahb noted how often the 64 bit clock must be read
+ 10/16/26 21:10 ahb added periodic timers and the timer callbacks
+ 10/16/26 20:40 ahb added the dynamic timers
+ 10/16/26 20:10 ahb added the 64 bit ES_Time clock
+ 10/16/26 19:40 ahb added ES_Timer_AdvanceTicks
+ 10/16/26 10:40 ahb added ES_Timer_GetTicksToNextExpiry
  10/13/15 20:48 jec  removed prototype for IsTimerActive, I had removed the code
                      a couple of years ago
  08/13/13 12:03 jec  added prototype for ES_Timer_Tick_Resp as part of
@@ -33,6 +39,7 @@
 
 #include "ES_Port.h"
 #include "ES_Types.h"
+#include "ES_Events.h"
 
 typedef enum
 {
@@ -42,13 +49,55 @@ typedef enum
   ES_Timer_NOT_ACTIVE = 0
 }ES_TimerReturn_t;
 
+// returned by ES_Timer_GetTicksToNextExpiry when no timer is running
+#define ES_Timer_NONE_ACTIVE 0
+
+// a dynamic timer, from ES_Timer_Alloc. Treat it as opaque.
+typedef uint16_t ES_TimerHandle_t;
+
+// returned by ES_Timer_Alloc when there are no timers left
+#define ES_TIMER_NO_HANDLE 0
+
+// called by an expiring timer in place of posting ES_TIMEOUT, with what
+// would have been the EventParam
+typedef void ES_TimerCallback_t(uint16_t TimerParam);
+
 void ES_Timer_Init(TimerRate_t Rate);
 void ES_Timer_Tick_Resp(void);
+void ES_Timer_AdvanceTicks(uint16_t NumTicks);
 ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime);
 ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime);
 ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num);
 ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num);
+ES_TimerReturn_t ES_Timer_InitPeriodic(uint8_t Num, uint16_t Period);
+ES_TimerReturn_t ES_Timer_SetPeriod(uint8_t Num, uint16_t Period);
+#ifdef ES_USE_TIMER_CALLBACKS
+ES_TimerReturn_t ES_Timer_SetCallback(uint8_t Num,
+                                      ES_TimerCallback_t *pCallback);
+#endif
 uint16_t ES_Timer_GetTime(void);
+uint16_t ES_Timer_GetTicksToNextExpiry(void);
+#if ES_NUM_DYNAMIC_TIMERS > 0
+ES_TimerHandle_t ES_Timer_Alloc(uint8_t WhichService);
+ES_TimerReturn_t ES_Timer_Free(ES_TimerHandle_t Handle);
+ES_TimerReturn_t ES_Timer_Arm(ES_TimerHandle_t Handle, uint16_t NewTime);
+ES_TimerReturn_t ES_Timer_ArmPeriodic(ES_TimerHandle_t Handle,
+                                      uint16_t Period);
+ES_TimerReturn_t ES_Timer_Disarm(ES_TimerHandle_t Handle);
+bool ES_Timer_IsTimeoutFrom(ES_Event_t ThisEvent, ES_TimerHandle_t Handle);
+#endif
+
+// the 64 bit monotonic clock. ES_Time_Now is in core timer counts
+// (_HW_COUNTS_PER_US to the microsecond) and is the cheapest to read, so
+// take start times with it and hand them to the elapsed functions.
+// The PIC32's core timer wraps every 2^32 counts (215s) and the clock
+// follows it from the tick and from its own reads, so with the tick off
+// (ES_Timer_RATE_OFF) it must still be read at least every 107s.
+uint64_t ES_Time_Now(void);
+uint64_t ES_Time_Now_us(void);
+uint64_t ES_Time_Now_ns(void);
+uint64_t ES_Time_Elapsed_us(uint64_t StartTime);
+uint64_t ES_Time_Elapsed_ns(uint64_t StartTime);
 
 #endif   /* ES_Timers_H */
 /*------------------------------ End of file ------------------------------*/
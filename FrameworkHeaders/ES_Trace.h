@@ -0,0 +1,66 @@
+/****************************************************************************
+ Module
+     ES_Trace.h
+ Description
+     header file for the framework event trace. When enabled, the framework
+     records every post, dispatch and timer expiry into a RAM ring and the
+     terminal drains the ring over the UART, in binary, when it has no text
+     to send. Tools/es_trace_decode.py turns the capture into a timeline.
+ Notes
+     With ES_USE_TRACE left undefined, the ES_TRACE macro expands to nothing
+     and none of the trace code or RAM is built.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 17:40 ahb     queue depths are passed as 16 bits, 255 is recorded
+                        for anything deeper
+ 10/16/26 13:00 ahb     started coding
+*****************************************************************************/
+#ifndef ES_Trace_H
+#define ES_Trace_H
+
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+// uncomment to build the trace into the framework
+//#define ES_USE_TRACE
+
+// number of records in the ring, must be a power of 2. Each record takes
+// 12 bytes of RAM and 15 bytes on the wire.
+#define ES_TRACE_SIZE 128
+
+// what the record is for (the Kind field)
+typedef enum
+{
+  ES_TRACE_POST = 1,      // event posted, Dest is the service posted to
+  ES_TRACE_POST_FAILED,   // post found Dest's queue full
+  ES_TRACE_DISPATCH,      // event handed to the run function of Dest
+  ES_TRACE_TIMEOUT,       // timer Source expired
+  ES_TRACE_DROPPED        // ring was full, EventParam records were lost
+}ES_TraceKind_t;
+
+// values used in the Source & Dest fields when they are not a service
+#define ES_TRACE_FROM_IDLE  0xFD  // ES_Run outside of any service
+#define ES_TRACE_FROM_ISR   0xFE  // an interrupt response
+#define ES_TRACE_NONE       0xFF  // no service
+
+// the framing used on the wire: sync bytes, the record, then the XOR of
+// the record bytes
+#define ES_TRACE_SYNC0 0xA5
+#define ES_TRACE_SYNC1 0x5A
+
+#ifdef ES_USE_TRACE
+#define ES_TRACE(Kind, Source, Dest, ThisEvent, QueueDepth) \
+  ES_Trace_Record((Kind), (Source), (Dest), (ThisEvent), (QueueDepth))
+
+void ES_Trace_Record(ES_TraceKind_t Kind, uint8_t Source, uint8_t Dest,
+    ES_Event_t ThisEvent, uint16_t QueueDepth);
+bool ES_Trace_GetByte(uint8_t *pByte);
+bool ES_Trace_IsFrameOpen(void);
+bool ES_Trace_IsPending(void);
+#else
+#define ES_TRACE(Kind, Source, Dest, ThisEvent, QueueDepth)
+#endif
+
+#endif /* ES_Trace_H */
@@ -23,16 +23,29 @@ extern "C" {
     
 // map the generic functions for testing the serial port to actual functions
 // for this platform.
+#ifdef ES_HOST_PORT
+// on the host there is no UART status to look at, stdin has to be polled
+#define IsNewKeyReady() Terminal_IsRxData()
+#define kbhit() Terminal_IsRxData()
+#else
 #define IsNewKeyReady() (U1STAbits.URXDA)
+#define kbhit() (U1STAbits.URXDA)
+#endif
 #define GetNewKey Terminal_ReadByte
 //#define putch Terminal_WriteByte
-#define kbhit() (U1STAbits.URXDA)
     
 void Terminal_HWInit(void);
 uint8_t Terminal_ReadByte(void);
 void Terminal_WriteByte(uint8_t txByte);
 bool Terminal_IsRxData(void);
 void Terminal_MoveBuffer2UART( void );
+bool Terminal_IsXmitIdle(void);
+void Terminal_EnableRxWake(void);
+// prints the failure and halts, assert calls it when NDEBUG isn't defined
+void __attribute__((noreturn)) _fassert(int nLineNumber,
+                                        const char * sFileName,
+                                        const char * sFailedExpression,
+                                        const char * sFunction );
 
 #ifdef __XC16__  // DEPRICATED, USE FOR xc16 of xc32 v1.34 or lower
 int write(int handle, void *buffer, unsigned int len);
@@ -12,6 +12,8 @@
  When           Who     What/Why
  -------------- ---     --------
 
+ 10/16/26 18:40 ahb     RecallEvents moves the events in batches, taking
+                        each queue's critical region once per batch
  10/11/14 14:58 jec     converted RecallEvent to RecallEvents to pull all
                         deferred events off the deferral queue
  11/02/13 16:38 jec      Began Coding
@@ -27,6 +29,9 @@
 /*--------------------------- External Variables --------------------------*/
 
 /*----------------------------- Module Defines ----------------------------*/
+// how many events are moved from the deferral queue to the service's queue
+// at a time, they are held on the stack on the way
+#define RECALL_BATCH_SIZE 8
 
 /*------------------------------ Module Types -----------------------------*/
 
@@ -49,24 +54,30 @@
      something in the queue, then it posts it LIFO fashion to the queue
      indicated by WhichService
  Notes
-     None.
+     the events are moved RECALL_BATCH_SIZE at a time with ES_DeQueueBatch
+     and ES_PostBatchToService, so a deep deferral queue is recalled in one
+     pass. They end up in the same order as posting them one by one would
+     leave them.
  Author
      J. Edward Carryer, 11/20/13 16:49
 ****************************************************************************/
 bool ES_RecallEvents(uint8_t WhichService, ES_Event_t *pBlock)
 {
-  ES_Event_t  RecalledEvent;
+  ES_Event_t  RecalledEvents[RECALL_BATCH_SIZE];
+  uint16_t    NumRecalled;
   bool      WereEventsPulled = false;
   // recall any events from the queue
   do
   {
-    ES_DeQueue(pBlock, &RecalledEvent);
-    if (RecalledEvent.EventType != ES_NO_EVENT)
+    NumRecalled = ES_DeQueueBatch(pBlock, RecalledEvents,
+        ARRAY_SIZE(RecalledEvents));
+    if (NumRecalled > 0)
     {
-      ES_PostToServiceLIFO(WhichService, RecalledEvent);
+      ES_PostBatchToService(WhichService, RecalledEvents, (uint8_t)NumRecalled,
+          true);
       WereEventsPulled = true;
     }
-  } while (RecalledEvent.EventType != ES_NO_EVENT);
+  } while (NumRecalled == ARRAY_SIZE(RecalledEvents));
   return WereEventsPulled;
 }
 
@@ -0,0 +1,376 @@
+/****************************************************************************
+ Module
+     ES_DeferredWork.c
+ Description
+     Deferred interrupt work. An ISR does only what has to be done while
+     the hardware is waiting (read the capture, clear the flag) and hands
+     the rest to a handler listed in DEFERRED_WORK_TABLE by setting its bit
+     in the pending mask, optionally with a 32 bit value for the handler.
+     ES_Run calls the handlers of whatever is pending, highest priority
+     first, before it dispatches the next service, so they run at task level
+     and may post, recall or print like any service.
+ Notes
+     This is the tick's 'ISR sets a flag, ES_Run does the work' pattern of
+     _HW_Process_Pending_Ints made general.
+     The pending mask is set and taken with the port's atomic operations, so
+     ISRs at any priority may defer work without a critical region. An
+     entry's FIFO is a lock free ring like the ISR inboxes (ES_SPSCQueue.c):
+     only ISRs at a single priority level may put values in it, and the
+     value is written before the mask bit is set, so a handler never sees
+     its bit without its data.
+     Each handler call is timed with _HW_GetCycleCount.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 22:40 ahb      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "../FrameworkHeaders/ES_Configure.h"
+#include "../FrameworkHeaders/ES_DeferredWork.h"
+#include "../FrameworkHeaders/ES_General.h"
+#include "../FrameworkHeaders/ES_LookupTables.h"
+#include "../FrameworkHeaders/ES_Port.h"
+// the handlers are declared in the services' headers
+#include "ES_ServiceHeaders.h"
+
+#include <string.h>
+
+/*----------------------------- Module Defines ----------------------------*/
+// each entry has a bit in the 32 bit pending mask
+#define MAX_DEFERRED_WORK 32
+
+// the FIFO of an entry holds one fewer value than it has slots
+#define WORK_FIFO_DECL(Prio, Name, Handler, FifoSize)                   \
+  static uint32_t WorkSlots##Prio[(FifoSize) + 1];                      \
+  ES_STATIC_ASSERT((FifoSize) < 255, FifoSize_out_of_range_for_##Name); \
+  ES_STATIC_ASSERT(Name == (Prio), Name##_is_out_of_priority_order);
+#define WORK_DESC_ENTRY(Prio, Name, Handler, FifoSize) \
+  { Handler, WorkSlots##Prio, ((FifoSize) == 0) ? 0 : (FifoSize) + 1 },
+
+typedef struct
+{
+  DeferredHandler_t *pHandler;
+  uint32_t *pSlots;
+  uint8_t NumSlots;             // 0 for an entry without a FIFO
+}WorkDesc_t;
+
+ES_STATIC_ASSERT(NUM_DEFERRED_WORK <= MAX_DEFERRED_WORK,
+    too_many_entries_in_DEFERRED_WORK_TABLE);
+
+/*---------------------------- Module Functions ---------------------------*/
+static bool PutData(ES_DeferredWork_t Which, uint32_t Data);
+static bool GetData(ES_DeferredWork_t Which, uint32_t *pData);
+static void RunHandler(ES_DeferredWork_t Which, uint32_t Data);
+
+/*---------------------------- Module Variables ---------------------------*/
+// the FIFOs and handlers, built from DEFERRED_WORK_TABLE in ES_Configure.h
+DEFERRED_WORK_TABLE(WORK_FIFO_DECL)
+
+static WorkDesc_t const WorkDesc[NUM_DEFERRED_WORK] = {
+  DEFERRED_WORK_TABLE(WORK_DESC_ENTRY)
+};
+
+// bit n is set while entry n has work waiting
+static volatile uint32_t Pending;
+
+// the FIFO indices. Head and NumOverflows belong to the ISR, Tail to ES_Run
+static volatile uint8_t Head[NUM_DEFERRED_WORK];
+static volatile uint8_t Tail[NUM_DEFERRED_WORK];
+static volatile uint16_t NumOverflows[NUM_DEFERRED_WORK];
+// each FIFO's overflow count when the stats were last cleared
+static uint16_t OverflowBase[NUM_DEFERRED_WORK];
+
+// handler timing, read with ES_GetDeferredWorkStats
+static ES_DeferredWorkStats_t WorkStats[NUM_DEFERRED_WORK];
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_InitDeferredWork
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   clears the pending mask, the FIFOs and the stats
+ Notes
+   called from ES_Initialize, before the services' init functions can
+   enable the interrupts that defer work
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_InitDeferredWork(void)
+{
+  Pending = 0;
+  memset((void *)Head, 0, sizeof(Head));
+  memset((void *)Tail, 0, sizeof(Tail));
+  memset((void *)NumOverflows, 0, sizeof(NumOverflows));
+  memset(OverflowBase, 0, sizeof(OverflowBase));
+  memset(WorkStats, 0, sizeof(WorkStats));
+}
+
+/****************************************************************************
+ Function
+   ES_DeferWork
+ Parameters
+   ES_DeferredWork_t Which : the entry in DEFERRED_WORK_TABLE
+ Returns
+   bool : false if there is no such entry
+ Description
+   for ISRs. Marks the entry's work as pending, its handler is called with
+   Data 0 the next time ES_Run gets to it. Deferring work that is already
+   pending gets one handler call, not two.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_DeferWork(ES_DeferredWork_t Which)
+{
+  if (Which >= NUM_DEFERRED_WORK)
+  {
+    return false;
+  }
+  _HW_AtomicSetBits32(&Pending, (uint32_t)1 << Which);
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  _HW_RequestSchedule();
+#endif
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_DeferWorkWithData
+ Parameters
+   ES_DeferredWork_t Which : the entry in DEFERRED_WORK_TABLE
+   uint32_t Data : the value to hand to its handler
+ Returns
+   bool : false if there is no such entry or its FIFO was full
+ Description
+   for ISRs. Puts Data in the entry's FIFO and marks its work as pending.
+   The handler is called once for each value, in the order they were put.
+ Notes
+   never disables interrupts. A full FIFO is counted in the stats, and the
+   work is still marked as pending so that the values already in the FIFO
+   are handled.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_DeferWorkWithData(ES_DeferredWork_t Which, uint32_t Data)
+{
+  bool ReturnVal;
+
+  if (Which >= NUM_DEFERRED_WORK)
+  {
+    return false;
+  }
+  ReturnVal = PutData(Which, Data);
+  _HW_AtomicSetBits32(&Pending, (uint32_t)1 << Which);
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  _HW_RequestSchedule();
+#endif
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_RunDeferredWork
+ Parameters
+   None
+ Returns
+   bool : always true, so that ES_Run can call it in its loop test
+ Description
+   calls the handlers of the pending work, highest priority first, until
+   none is left. Work deferred while a handler runs is picked up before we
+   return.
+ Notes
+   only ES_Run (or ES_ScheduleFromISR under the preemptive kernel) may call
+   this, it is the consumer side of the FIFOs
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_RunDeferredWork(void)
+{
+  uint32_t Work;
+  uint32_t Data;
+  uint8_t Which;
+
+  while (Pending != 0)
+  {
+    Work = _HW_AtomicTakeBits32(&Pending);
+    while (Work != 0)
+    {
+      Which = ES_GetMSBitSet32(Work);
+      Work &= ~((uint32_t)1 << Which);
+      if (WorkDesc[Which].NumSlots == 0)
+      {
+        RunHandler(Which, 0);
+      }
+      else
+      {
+        // the bit may have been set again for values we have already
+        // taken, so the FIFO may be empty
+        while (GetData(Which, &Data))
+        {
+          RunHandler(Which, Data);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_IsDeferredWorkPending
+ Parameters
+   None
+ Returns
+   bool : true if any work is waiting for its handler
+ Description
+   for the idle test in ES_Run
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_IsDeferredWorkPending(void)
+{
+  return Pending != 0;
+}
+
+/****************************************************************************
+ Function
+   ES_GetDeferredWorkStats
+ Parameters
+   ES_DeferredWork_t Which : the entry to report on
+   ES_DeferredWorkStats_t * pStats : where to copy its stats
+ Returns
+   bool : false if there is no such entry
+ Description
+   copies out how often the entry's handler has run, how long it took and
+   how many values its FIFO has lost since the stats were last cleared
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_GetDeferredWorkStats(ES_DeferredWork_t Which,
+                             ES_DeferredWorkStats_t *pStats)
+{
+  if (Which >= NUM_DEFERRED_WORK)
+  {
+    return false;
+  }
+  *pStats = WorkStats[Which];
+  pStats->NumOverflows = NumOverflows[Which] - OverflowBase[Which];
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ClearDeferredWorkStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   starts the stats of all of the entries over
+ Notes
+   the overflow counts belong to the ISRs, so they are not written here,
+   the count at the time of the clear is kept and subtracted instead
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_ClearDeferredWorkStats(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < NUM_DEFERRED_WORK; i++)
+  {
+    memset(&WorkStats[i], 0, sizeof(WorkStats[i]));
+    OverflowBase[i] = NumOverflows[i];
+  }
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+   PutData
+ Description
+   the ISR side of an entry's FIFO, copies the value into the slot at Head
+   and then moves Head on. Returns false, and counts it, if it was full.
+****************************************************************************/
+static bool PutData(ES_DeferredWork_t Which, uint32_t Data)
+{
+  uint8_t ThisHead = Head[Which];
+  uint8_t NextHead = ThisHead + 1;
+
+  if (WorkDesc[Which].NumSlots == 0)
+  {
+    return false;   // no FIFO to put it in
+  }
+  if (NextHead == WorkDesc[Which].NumSlots)
+  {
+    NextHead = 0;
+  }
+  if (NextHead == Tail[Which])
+  {
+    NumOverflows[Which]++;
+    return false;
+  }
+  WorkDesc[Which].pSlots[ThisHead] = Data;
+  _HW_MemoryBarrier();  // the value must be in place before Head moves
+  Head[Which] = NextHead;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   GetData
+ Description
+   the ES_Run side of an entry's FIFO, copies the value out of the slot at
+   Tail and then moves Tail on. Returns false if it was empty.
+****************************************************************************/
+static bool GetData(ES_DeferredWork_t Which, uint32_t *pData)
+{
+  uint8_t ThisTail = Tail[Which];
+  uint8_t NextTail;
+
+  if (ThisTail == Head[Which])
+  {
+    return false;
+  }
+  _HW_MemoryBarrier();  // don't read the slot before we have seen Head
+  *pData = WorkDesc[Which].pSlots[ThisTail];
+  NextTail = ThisTail + 1;
+  if (NextTail == WorkDesc[Which].NumSlots)
+  {
+    NextTail = 0;
+  }
+  _HW_MemoryBarrier();  // the value must be out before the slot is freed
+  Tail[Which] = NextTail;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   RunHandler
+ Description
+   calls the entry's handler and adds the time it took to its stats
+****************************************************************************/
+static void RunHandler(ES_DeferredWork_t Which, uint32_t Data)
+{
+  uint32_t StartTime = _HW_GetCycleCount();
+  uint32_t Cycles;
+
+  WorkDesc[Which].pHandler(Data);
+  Cycles = _HW_GetCycleCount() - StartTime;
+
+  WorkStats[Which].NumRuns++;
+  WorkStats[Which].TotalCycles += Cycles;
+  if (Cycles > WorkStats[Which].MaxCycles)
+  {
+    WorkStats[Which].MaxCycles = Cycles;
+  }
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,546 @@
+/****************************************************************************
+ Module
+     ES_EventPool.c
+ Description
+     the shared event pool. With ES_USE_EVENT_POOL defined the services'
+     queues don't hold events themselves, each is a small ring of indices
+     into one pool of events that they all draw from. The pool only has to
+     cover the most events that are ever queued at once, rather than the
+     sum of every service's worst case.
+ Notes
+     Free events are kept on a stack of pool indices. Each ring may hold a
+     reservation, a number of events that are kept back for it alone. A
+     ring holding fewer events than its reservation can always take one
+     from the pool, any other ring can only take one if more events are
+     free than are still owed to the rings' reservations.
+
+     Every function takes the critical region, since the free list and the
+     reservations are shared between all of the rings and ISRs post too.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 04:00 ahb      added ES_Pool_DropNewest
+ 10/17/26 01:40 ahb      single events are stamped by the framework's posts
+ 10/17/26 00:40 ahb      ES_Pool_ReplaceSameType is now ES_Pool_ReplaceSameEvent
+                         and matches the EventParam too
+ 10/16/26 19:10 ahb      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "../FrameworkHeaders/ES_Configure.h"
+#include "../FrameworkHeaders/ES_EventPool.h"
+#include "../FrameworkHeaders/ES_Port.h" /* get the macros for EnterCritical and ExitCritical */
+#include "../FrameworkHeaders/ES_General.h"
+#include "../FrameworkHeaders/ES_LookupTables.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// the event at ring position Index
+#define RING_EVENT(pRing, Index) (pPool[(pRing)->pIndices[(Index)]])
+
+// returned by TakeEvent when the ring may not have another event
+#define NO_POOL_EVENT 0xFF
+
+/*---------------------------- Module Functions ---------------------------*/
+static uint8_t TakeEvent(ES_PoolRing_t *pRing);
+static void GiveBackEvent(ES_PoolRing_t *pRing, uint8_t PoolIndex);
+
+/*---------------------------- Module Variables ---------------------------*/
+static ES_Event_t *pPool;
+static uint8_t *pFree;          // stack of the free pool indices
+static uint8_t NumFree;
+// events kept back for rings that are holding fewer than their reservation
+static uint8_t NumOwed;
+
+static ES_PoolStats_t PoolStats;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_Pool_Init
+ Parameters
+   ES_Event_t * pEvents : the events that make up the pool
+   uint8_t * pFreeList : room for Size pool indices, for the free list
+   uint8_t Size : the number of events in pEvents, up to ES_POOL_MAX_SIZE
+ Returns
+   nothing
+ Description
+   marks all of the pool's events free
+ Notes
+   must be called before any of the rings are set up
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Pool_Init(ES_Event_t *pEvents, uint8_t *pFreeList, uint8_t Size)
+{
+  uint8_t i;
+
+  pPool = pEvents;
+  pFree = pFreeList;
+  for (i = 0; i < Size; i++)
+  {
+    pFree[i] = i;
+  }
+  NumFree = Size;
+  NumOwed = 0;
+  PoolStats.Size = Size;
+  PoolStats.InUse = 0;
+  PoolStats.HighWater = 0;
+  PoolStats.NumReserved = 0;
+  PoolStats.NumRefused = 0;
+  PoolStats.Bytes = (uint16_t)Size * (sizeof(ES_Event_t) + 1);
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_InitRing
+ Parameters
+   ES_PoolRing_t * pRing : the ring to set up
+   uint8_t * pIndices : room for RingSize pool indices
+   uint8_t RingSize : the most events the ring may hold, 1 to
+                      ES_POOL_MAX_RING
+   uint8_t Reserve : events to keep back in the pool for this ring
+ Returns
+   uint8_t : the number of events the ring can hold, the largest power of
+             2 that fits in RingSize
+ Description
+   empties the ring and adds its reservation to the pool's
+ Notes
+   the reservations must not add up to more than the pool's size, the
+   framework checks this when it builds the rings from ES_Configure.h
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint8_t ES_Pool_InitRing(ES_PoolRing_t *pRing, uint8_t *pIndices,
+                         uint8_t RingSize, uint8_t Reserve)
+{
+  uint8_t Capacity;
+
+  Capacity = (uint8_t)(1u << ES_GetMSBitSet32(RingSize));
+  pRing->pIndices = pIndices;
+  pRing->Mask = Capacity - 1;
+  pRing->CurrentIndex = 0;
+  pRing->NumEntries = 0;
+  pRing->Reserve = Reserve;
+  NumOwed += Reserve;
+  PoolStats.NumReserved += Reserve;
+  PoolStats.Bytes += sizeof(ES_PoolRing_t) + RingSize;
+  return Capacity;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_EnQueueFIFO
+ Parameters
+   ES_PoolRing_t * pRing : the ring to add to
+   ES_Event_t Event2Add : event to be added
+ Returns
+   bool : false if the ring was full or the pool had no event for it
+ Description
+   copies Event2Add into an event from the pool and puts it at the end of
+   the ring
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Pool_EnQueueFIFO(ES_PoolRing_t *pRing, ES_Event_t Event2Add)
+{
+  uint8_t PoolIndex;
+
+  EnterCritical();  // save interrupt state, turn ints off
+  PoolIndex = TakeEvent(pRing);
+  if (PoolIndex != NO_POOL_EVENT)
+  {
+    pPool[PoolIndex] = Event2Add;
+    pRing->pIndices[(pRing->CurrentIndex + pRing->NumEntries) &
+        pRing->Mask] = PoolIndex;
+    pRing->NumEntries++;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return PoolIndex != NO_POOL_EVENT;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_EnQueueLIFO
+ Parameters
+   ES_PoolRing_t * pRing : the ring to add to
+   ES_Event_t Event2Add : event to be added
+ Returns
+   bool : false if the ring was full or the pool had no event for it
+ Description
+   as ES_Pool_EnQueueFIFO, but puts the event at the front of the ring so
+   that it is the next one taken off
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Pool_EnQueueLIFO(ES_PoolRing_t *pRing, ES_Event_t Event2Add)
+{
+  uint8_t PoolIndex;
+
+  EnterCritical();  // save interrupt state, turn ints off
+  PoolIndex = TakeEvent(pRing);
+  if (PoolIndex != NO_POOL_EVENT)
+  {
+    pPool[PoolIndex] = Event2Add;
+    pRing->CurrentIndex = (pRing->CurrentIndex - 1) & pRing->Mask;
+    pRing->pIndices[pRing->CurrentIndex] = PoolIndex;
+    pRing->NumEntries++;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return PoolIndex != NO_POOL_EVENT;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_DeQueue
+ Parameters
+   ES_PoolRing_t * pRing : the ring to take from
+   ES_Event_t * pReturnEvent : where to copy the event
+ Returns
+   uint16_t : the number of entries left in the ring
+ Description
+   takes the event at the front of the ring and returns it to the pool,
+   ES_NO_EVENT if the ring was empty
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_Pool_DeQueue(ES_PoolRing_t *pRing, ES_Event_t *pReturnEvent)
+{
+  uint16_t NumLeft = 0;
+
+  EnterCritical();  // save interrupt state, turn ints off
+  if (pRing->NumEntries > 0)
+  {
+    *pReturnEvent = RING_EVENT(pRing, pRing->CurrentIndex);
+    GiveBackEvent(pRing, pRing->pIndices[pRing->CurrentIndex]);
+    pRing->CurrentIndex = (pRing->CurrentIndex + 1) & pRing->Mask;
+    NumLeft = pRing->NumEntries;
+  }
+  else
+  {
+    pReturnEvent->EventType = ES_NO_EVENT;
+    pReturnEvent->EventParam = 0;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return NumLeft;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_IsEmpty
+ Parameters
+   ES_PoolRing_t * pRing : the ring to test
+ Returns
+   bool : true if the ring is empty
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Pool_IsEmpty(ES_PoolRing_t *pRing)
+{
+  return pRing->NumEntries == 0;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_GetDepth
+ Parameters
+   ES_PoolRing_t * pRing : the ring to report on
+ Returns
+   uint16_t : the number of entries in the ring
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_Pool_GetDepth(ES_PoolRing_t *pRing)
+{
+  return pRing->NumEntries;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_DropOldest
+ Parameters
+   ES_PoolRing_t * pRing : the ring to drop from
+ Returns
+   bool : true if an event was thrown away, false if the ring was empty
+ Description
+   discards the event at the front of the ring, returning it to the pool
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Pool_DropOldest(ES_PoolRing_t *pRing)
+{
+  bool ReturnVal = false;
+
+  EnterCritical();  // save interrupt state, turn ints off
+  if (pRing->NumEntries > 0)
+  {
+    GiveBackEvent(pRing, pRing->pIndices[pRing->CurrentIndex]);
+    pRing->CurrentIndex = (pRing->CurrentIndex + 1) & pRing->Mask;
+    ReturnVal = true;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_DropNewest
+ Parameters
+   ES_PoolRing_t * pRing : the ring to drop from
+ Returns
+   bool : true if an event was thrown away, false if the ring was empty
+ Description
+   discards the event at the back of the ring, returning it to the pool
+ Author
+   A. Brown, 10/17/26
+****************************************************************************/
+bool ES_Pool_DropNewest(ES_PoolRing_t *pRing)
+{
+  bool ReturnVal = false;
+
+  EnterCritical();  // save interrupt state, turn ints off
+  if (pRing->NumEntries > 0)
+  {
+    GiveBackEvent(pRing, pRing->pIndices[(pRing->CurrentIndex +
+        pRing->NumEntries - 1) & pRing->Mask]);
+    ReturnVal = true;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_ReplaceSameEvent
+ Parameters
+   ES_PoolRing_t * pRing : the ring to search
+   ES_Event_t NewEvent : event to merge with a queued copy of itself
+ Returns
+   bool : true if an event with the same EventType and EventParam was found
+ Description
+   as ES_QueueReplaceSameEvent, overwrites the oldest queued event with
+   NewEvent's EventType and EventParam so that it keeps its place in line
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Pool_ReplaceSameEvent(ES_PoolRing_t *pRing, ES_Event_t NewEvent)
+{
+  uint8_t Index;
+  uint8_t i;
+  bool    ReturnVal = false;
+
+  EnterCritical();  // save interrupt state, turn ints off
+  Index = pRing->CurrentIndex;
+  for (i = 0; i < pRing->NumEntries; i++)
+  {
+    if ((RING_EVENT(pRing, Index).EventType == NewEvent.EventType) &&
+        (RING_EVENT(pRing, Index).EventParam == NewEvent.EventParam))
+    {
+#ifdef _INCLUDE_LATENCY_STATS_
+      NewEvent.TimeStamp = RING_EVENT(pRing, Index).TimeStamp; // it has been waiting
+#endif
+      RING_EVENT(pRing, Index) = NewEvent;
+      ReturnVal = true;
+      break;
+    }
+    Index = (Index + 1) & pRing->Mask;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_EnQueueBatch
+ Parameters
+   ES_PoolRing_t * pRing : the ring to add to
+   const ES_Event_t * pEvents : the events to add, in order
+   uint16_t NumEvents : how many there are
+   bool AtFront : false to add them FIFO, true to add each in turn LIFO
+ Returns
+   uint16_t : the number added, fewer than NumEvents when the ring filled
+              or the pool ran out
+ Description
+   as ES_EnQueueBatch, adds the events in one critical region
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_Pool_EnQueueBatch(ES_PoolRing_t *pRing, const ES_Event_t *pEvents,
+                              uint16_t NumEvents, bool AtFront)
+{
+  uint16_t NumAdded;
+  uint8_t  PoolIndex;
+  uint8_t  Index;
+#ifdef _INCLUDE_LATENCY_STATS_
+  uint32_t Now = _HW_GetCycleCount();
+#endif
+
+  EnterCritical();  // save interrupt state, turn ints off
+  for (NumAdded = 0; NumAdded < NumEvents; NumAdded++)
+  {
+    PoolIndex = TakeEvent(pRing);
+    if (PoolIndex == NO_POOL_EVENT)
+    {
+      break;
+    }
+    if (AtFront)
+    {
+      pRing->CurrentIndex = (pRing->CurrentIndex - 1) & pRing->Mask;
+      Index = pRing->CurrentIndex;
+    }
+    else
+    {
+      Index = (pRing->CurrentIndex + pRing->NumEntries) & pRing->Mask;
+    }
+    pPool[PoolIndex] = pEvents[NumAdded];
+#ifdef _INCLUDE_LATENCY_STATS_
+    pPool[PoolIndex].TimeStamp = Now;
+#endif
+    pRing->pIndices[Index] = PoolIndex;
+    pRing->NumEntries++;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return NumAdded;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_DeQueueBatch
+ Parameters
+   ES_PoolRing_t * pRing : the ring to take from
+   ES_Event_t * pEvents : where to copy the events, oldest first
+   uint16_t MaxEvents : the most to take
+ Returns
+   uint16_t : the number of events taken, 0 if the ring was empty
+ Description
+   as ES_DeQueueBatch, takes the events in one critical region
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_Pool_DeQueueBatch(ES_PoolRing_t *pRing, ES_Event_t *pEvents,
+                              uint16_t MaxEvents)
+{
+  uint16_t NumTaken;
+
+  EnterCritical();  // save interrupt state, turn ints off
+  for (NumTaken = 0; (NumTaken < MaxEvents) && (pRing->NumEntries > 0);
+       NumTaken++)
+  {
+    pEvents[NumTaken] = RING_EVENT(pRing, pRing->CurrentIndex);
+    GiveBackEvent(pRing, pRing->pIndices[pRing->CurrentIndex]);
+    pRing->CurrentIndex = (pRing->CurrentIndex + 1) & pRing->Mask;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return NumTaken;
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_GetStats
+ Parameters
+   ES_PoolStats_t * pStats : where to copy the pool's occupancy
+ Returns
+   nothing
+ Description
+   reports the pool's size, how much of it is in use now and at most, and
+   how many posts it has refused. A high water mark well below the size
+   means the pool can be made smaller, refusals mean it (or a reservation)
+   should be bigger.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Pool_GetStats(ES_PoolStats_t *pStats)
+{
+  EnterCritical();
+  *pStats = PoolStats;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   ES_Pool_ClearStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   starts the high water mark over from the events in use now and zeroes
+   the count of refusals
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Pool_ClearStats(void)
+{
+  EnterCritical();
+  PoolStats.HighWater = PoolStats.InUse;
+  PoolStats.NumRefused = 0;
+  ExitCritical();
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+   TakeEvent
+ Parameters
+   ES_PoolRing_t * pRing : the ring that wants an event
+ Returns
+   uint8_t : the pool index of the event, NO_POOL_EVENT if the ring is full
+             or may not have one
+ Description
+   pops an event off the free list for the ring, keeping the reservations.
+   Called with interrupts off.
+****************************************************************************/
+static uint8_t TakeEvent(ES_PoolRing_t *pRing)
+{
+  if (pRing->NumEntries > pRing->Mask)
+  {
+    return NO_POOL_EVENT;  // the ring itself is full
+  }
+  if (pRing->NumEntries < pRing->Reserve)
+  {
+    NumOwed--;  // one of its own, there is always one free
+  }
+  else if (NumFree <= NumOwed)
+  {
+    // the rest are kept for the reservations
+    if (PoolStats.NumRefused != UINT16_MAX)
+    {
+      PoolStats.NumRefused++;
+    }
+    return NO_POOL_EVENT;
+  }
+  PoolStats.InUse++;
+  if (PoolStats.InUse > PoolStats.HighWater)
+  {
+    PoolStats.HighWater = PoolStats.InUse;
+  }
+  return pFree[--NumFree];
+}
+
+/****************************************************************************
+ Function
+   GiveBackEvent
+ Parameters
+   ES_PoolRing_t * pRing : the ring the event is being taken out of
+   uint8_t PoolIndex : the event's pool index
+ Returns
+   nothing
+ Description
+   pushes the event back on the free list and takes it out of the ring's
+   count, the caller moves the ring's CurrentIndex. Called with interrupts
+   off.
+****************************************************************************/
+static void GiveBackEvent(ES_PoolRing_t *pRing, uint8_t PoolIndex)
+{
+  pFree[NumFree++] = PoolIndex;
+  PoolStats.InUse--;
+  pRing->NumEntries--;
+  if (pRing->NumEntries < pRing->Reserve)
+  {
+    NumOwed++;
+  }
+}
+
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
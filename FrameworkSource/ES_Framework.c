@@ -8,6 +8,48 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 05:00 ahb     the inbox drain and idle test compile out when
+                        ISR_INBOX_TABLE is empty
+ 10/17/26 04:20 ahb     ES_QUEUE_TRAP calls _fassert directly, so that it
+                        halts with NDEBUG defined too
+ 10/17/26 04:00 ahb     ES_QUEUE_DROP_OLDEST drops and adds in one critical
+                        region, a post to the front drops the back of the
+                        queue
+ 10/17/26 03:20 ahb     a scheduler request that finds the level locked
+                        is remembered, ES_ScheduleFromISR drains again
+                        before it unlocks
+ 10/17/26 01:40 ahb     events are stamped for the latency stats in
+                        PostToQueue, events from the ISR inboxes keep the
+                        stamp they were given by the inbox
+ 10/17/26 01:00 ahb     Schedule called inside another critical region leaves
+                        it to the scheduler interrupt
+ 10/17/26 00:40 ahb     ES_QUEUE_COALESCE matches the EventParam as well as
+                        the EventType
+ 10/16/26 23:10 ahb     Schedule must be called from the outermost critical
+                        region, now that they nest
+ 10/17/26 12:00 ahb     refuses MAX_NUM_SERVICES above 32
+ 10/17/26 11:50 ahb     ES_NYBBLE_LOOKUP, the old lookup for make bench
+ 10/16/26 22:40 ahb     ES_Run calls the handlers of deferred interrupt work
+                        before each dispatch
+ 10/16/26 19:10 ahb     with ES_USE_EVENT_POOL the services' queues are rings
+                        of indices into the shared event pool
+ 10/16/26 18:40 ahb     added ES_PostBatchToService, batch services are
+                        drained with ES_DeQueueBatch
+ 10/16/26 17:40 ahb     queues are declared with ES_QUEUE_BLOCK_SIZE, so their
+                        sizes are rounded up to powers of 2
+ 10/16/26 17:00 ahb     posts from ISRs to services in ISR_INBOX_TABLE go into
+                        lock free inboxes that ES_Run drains
+ 10/16/26 14:20 ahb     posts go through PostToQueue, which applies the queue
+                        overflow policy and keeps the queue stats
+ 10/16/26 13:40 ahb     added the per service enqueue to run latency histograms
+ 10/16/26 13:00 ahb     record posts and dispatches in the event trace
+ 10/16/26 11:30 ahb     added the optional preemptive kernel (Schedule), the
+                        priority ceiling mutex and dispatch latency stats
+ 10/16/26 10:40 ahb     idle the core with _HW_IdleWait when there is no work
+ 10/16/26 10:05 ahb     added batch services and optional dispatch counters
+ 10/16/26 09:12 ahb     build ServDescList & EventQueues from SERVICE_TABLE,
+                        moved Ready to an array of 32 bit words searched with
+                        ES_GetMSBitSet32 (clz) to allow more than 16 services
  08/21/17 13:18 jec     added conditional call to initialize the port lines
                         for the hardware debugging of the framework/apps
  12/19/16 20:18 jec      changed includes to accomodate the change to a fixed
@@ -30,10 +72,14 @@
 #include "../FrameworkHeaders/ES_Configure.h"
 #include "../FrameworkHeaders/ES_Framework.h"
 #include "../FrameworkHeaders/ES_Queue.h"
+#include "../FrameworkHeaders/ES_SPSCQueue.h"
+#include "../FrameworkHeaders/ES_DeferredWork.h"
+#include "../FrameworkHeaders/ES_EventPool.h"
 #include "../FrameworkHeaders/ES_LookupTables.h"
 #include "../FrameworkHeaders/ES_Timers.h"
 #include "../FrameworkHeaders/ES_General.h"
 #include "../FrameworkHeaders/ES_CheckEvents.h"
+#include "../FrameworkHeaders/ES_Trace.h"
 // Include the header files for the Service modules.
 // This gets you the prototypes for the public service functions.
 
@@ -44,6 +90,7 @@
 #include "ES_Port.h"          // needed for definition of REENTRANT
 
 #include <stdio.h>
+#include <string.h>
 
 #ifndef ES_CONFIGURE_H
 #error "ES_Configure.h was not included"
@@ -52,190 +99,292 @@
 /*----------------------------- Module Defines ----------------------------*/
 typedef bool      InitFunc_t (uint8_t Priority);
 typedef ES_Event_t  RunFunc_t (ES_Event_t ThisEvent);
+typedef ES_Event_t  RunBatchFunc_t (const ES_Event_t *pEvents,
+                                     uint8_t NumEvents);
 
 typedef InitFunc_t  *pInitFunc;
 typedef RunFunc_t   *pRunFunc;
+typedef RunBatchFunc_t *pRunBatchFunc;
 
 #define NULL_INIT_FUNC ((pInitFunc)0)
 
 typedef struct
 {
   InitFunc_t *InitFunc;       // Service Initialization function
-  RunFunc_t *RunFunc;         // Service Run function
+  RunFunc_t *RunFunc;         // Service Run function, single event services
+  RunBatchFunc_t *RunBatchFunc; // Service Run function, batch services
+  uint8_t MaxBatch;           // 0 for single event services
+  uint8_t Priority;           // Priority given in SERVICE_TABLE
 }ES_ServDesc_t;
 
+#ifdef ES_USE_EVENT_POOL
+// the services' queues are rings in the event pool, these map the queue
+// functions onto their pool equivalents
+typedef ES_PoolRing_t ServQueue_t;
+#define QUEUE_ENQUEUE_FIFO(pQ, Event) ES_Pool_EnQueueFIFO(pQ, Event)
+#define QUEUE_ENQUEUE_LIFO(pQ, Event) ES_Pool_EnQueueLIFO(pQ, Event)
+#define QUEUE_ENQUEUE_BATCH(pQ, pEvents, Num, AtFront) \
+  ES_Pool_EnQueueBatch(pQ, pEvents, Num, AtFront)
+#define QUEUE_DEQUEUE(pQ, pEvent) ES_Pool_DeQueue(pQ, pEvent)
+#define QUEUE_DEQUEUE_BATCH(pQ, pEvents, Max) \
+  ES_Pool_DeQueueBatch(pQ, pEvents, Max)
+#define QUEUE_IS_EMPTY(pQ) ES_Pool_IsEmpty(pQ)
+#define QUEUE_DEPTH(pQ) ES_Pool_GetDepth(pQ)
+#define QUEUE_DROP_OLDEST(pQ) ES_Pool_DropOldest(pQ)
+#define QUEUE_DROP_NEWEST(pQ) ES_Pool_DropNewest(pQ)
+#define QUEUE_REPLACE_SAME_EVENT(pQ, Event) ES_Pool_ReplaceSameEvent(pQ, Event)
+
+typedef struct
+{
+  ES_PoolRing_t *pMem;    // the service's ring
+  uint8_t *pIndices;      // the ring's memory
+  uint16_t Size;        // how big is it
+}ES_QueueDesc_t;
+#else
+typedef ES_Event_t ServQueue_t;
+#define QUEUE_ENQUEUE_FIFO(pQ, Event) ES_EnQueueFIFO(pQ, Event)
+#define QUEUE_ENQUEUE_LIFO(pQ, Event) ES_EnQueueLIFO(pQ, Event)
+#define QUEUE_ENQUEUE_BATCH(pQ, pEvents, Num, AtFront) \
+  ES_EnQueueBatch(pQ, pEvents, Num, AtFront)
+#define QUEUE_DEQUEUE(pQ, pEvent) ES_DeQueue(pQ, pEvent)
+#define QUEUE_DEQUEUE_BATCH(pQ, pEvents, Max) \
+  ES_DeQueueBatch(pQ, pEvents, Max)
+#define QUEUE_IS_EMPTY(pQ) ES_IsQueueEmpty(pQ)
+#define QUEUE_DEPTH(pQ) ES_GetQueueDepth(pQ)
+#define QUEUE_DROP_OLDEST(pQ) ES_QueueDropOldest(pQ)
+#define QUEUE_DROP_NEWEST(pQ) ES_QueueDropNewest(pQ)
+#define QUEUE_REPLACE_SAME_EVENT(pQ, Event) ES_QueueReplaceSameEvent(pQ, Event)
+
 typedef struct
 {
   ES_Event_t *pMem;       // pointer to the memory
-  uint8_t Size;         // how big is it
+  uint16_t Size;        // how big is it
 }ES_QueueDesc_t;
+#endif
 
-/*---------------------------- Module Functions ---------------------------*/
-//static bool CheckSystemEvents( void );
+typedef struct
+{
+  ES_SPSCQueue_t *pInbox; // NULL for services without an ISR inbox
+  ES_Event_t *pSlots;
+  uint8_t NumSlots;
+}ES_InboxDesc_t;
 
-/*---------------------------- Module Variables ---------------------------*/
-/****************************************************************************/
-// You fill in this array with the names of the service init & run functions
-// for each service that you use.
-// The order is: InitFunction, RunFunction
-// The first entry, at index 0, is the lowest priority, with increasing
-// priority with higher indices
+// the Ready set is an array of 32 bit words, word 0 holds services 0-31,
+// word 1 holds services 32-63 and so on.
+#define BITS_PER_READY_WORD 32
+#define NUM_READY_WORDS ((NUM_SERVICES + BITS_PER_READY_WORD - 1) / \
+                         BITS_PER_READY_WORD)
+#define READY_WORD(n) ((n) / BITS_PER_READY_WORD)
+#define READY_MASK(n) ((uint32_t)1 << ((n) % BITS_PER_READY_WORD))
 
-static ES_ServDesc_t const ServDescList[] =
-{ { SERV_0_INIT, SERV_0_RUN } /* lowest priority  always present */
-#if NUM_SERVICES > 1
-  , { SERV_1_INIT, SERV_1_RUN }
-#endif
-#if NUM_SERVICES > 2
-  , { SERV_2_INIT, SERV_2_RUN }
-#endif
-#if NUM_SERVICES > 3
-  , { SERV_3_INIT, SERV_3_RUN }
-#endif
-#if NUM_SERVICES > 4
-  , { SERV_4_INIT, SERV_4_RUN }
-#endif
-#if NUM_SERVICES > 5
-  , { SERV_5_INIT, SERV_5_RUN }
-#endif
-#if NUM_SERVICES > 6
-  , { SERV_6_INIT, SERV_6_RUN }
-#endif
-#if NUM_SERVICES > 7
-  , { SERV_7_INIT, SERV_7_RUN }
+// returned by GetHighestReady when all of the queues are empty
+#define NO_SERVICE_READY 0xFF
+
+// preemption levels used by the preemptive kernel and the mutex. ES_Run's
+// idle loop runs at level 0 and the service at priority n runs at level n+1.
+// LOCKED_LEVEL is above every service and is used while the tick is being
+// processed and until ES_Run starts the kernel.
+#define IDLE_LEVEL 0
+#define LEVEL_OF(Prio) ((uint8_t)((Prio) + 1))
+#define LOCKED_LEVEL LEVEL_OF(NUM_SERVICES)
+
+// who is doing the posting, for the trace. Events moved on from the ISR
+// inboxes were posted by an ISR too.
+#define TRACE_SOURCE() ((_HW_InISR() || DrainingInboxes) ? \
+                        ES_TRACE_FROM_ISR : RunningService)
+
+#if defined(ES_NYBBLE_LOOKUP) && (NUM_SERVICES > 16)
+#error "ES_NYBBLE_LOOKUP only looks at 16 services"
 #endif
-#if NUM_SERVICES > 8
-  , { SERV_8_INIT, SERV_8_RUN }
+
+// the subscription sets and ES_ServiceHeaders.h stop at 32
+#if MAX_NUM_SERVICES > 32
+#error "MAX_NUM_SERVICES can't be more than 32"
 #endif
-#if NUM_SERVICES > 9
-  , { SERV_9_INIT, SERV_9_RUN }
+
+#if NUM_SERVICES > MAX_NUM_SERVICES
+#error "NUM_SERVICES is larger than MAX_NUM_SERVICES"
 #endif
-#if NUM_SERVICES > 10
-  , { SERV_10_INIT, SERV_10_RUN }
+
+// these expand the entries in SERVICE_TABLE into the pieces we need
+#define SERV_DESC_ENTRY(Prio, Init, Run, QSize) \
+  { Init, Run, (pRunBatchFunc)0, 0, Prio },
+#define BATCH_DESC_ENTRY(Prio, Init, RunBatch, QSize, MaxBatch) \
+  { Init, (pRunFunc)0, RunBatch, MaxBatch, Prio },
+#ifdef ES_USE_EVENT_POOL
+#define SERV_QUEUE_DECL(Prio, Init, Run, QSize)                       \
+  static uint8_t RingIndices##Prio[ES_QUEUE_CAPACITY(QSize)];         \
+  static ES_PoolRing_t Ring##Prio;                                    \
+  ES_STATIC_ASSERT(ES_QUEUE_CAPACITY(QSize) <= ES_POOL_MAX_RING,      \
+      QueueSize_too_big_for_the_pool_for_service_##Prio);
+#else
+#define SERV_QUEUE_DECL(Prio, Init, Run, QSize) \
+  static ES_Event_t Queue##Prio[ES_QUEUE_BLOCK_SIZE(QSize)];
 #endif
-#if NUM_SERVICES > 11
-  , { SERV_11_INIT, SERV_11_RUN }
+#define BATCH_QUEUE_DECL(Prio, Init, RunBatch, QSize, MaxBatch) \
+  SERV_QUEUE_DECL(Prio, Init, RunBatch, QSize)                  \
+  ES_STATIC_ASSERT(((MaxBatch) > 0) && ((MaxBatch) <= ES_MAX_BATCH), \
+      MaxBatch_out_of_range_for_service_##Prio);
+#define POLICY_ENTRY(Prio, Policy) [Prio] = (Policy),
+#ifdef ES_USE_EVENT_POOL
+#define SERV_QUEUE_ENTRY(Prio, Init, Run, QSize) \
+  { &Ring##Prio, RingIndices##Prio, ARRAY_SIZE(RingIndices##Prio) },
+#define RESERVE_ENTRY(Prio, NumEvents) [Prio] = (NumEvents),
+#define RESERVE_SUM(Prio, NumEvents) + (NumEvents)
+#else
+#define SERV_QUEUE_ENTRY(Prio, Init, Run, QSize) \
+  { Queue##Prio, ARRAY_SIZE(Queue##Prio) },
 #endif
-#if NUM_SERVICES > 12
-  , { SERV_12_INIT, SERV_12_RUN }
+#define BATCH_QUEUE_ENTRY(Prio, Init, RunBatch, QSize, MaxBatch) \
+  SERV_QUEUE_ENTRY(Prio, Init, RunBatch, QSize)
+#define INBOX_DECL(Prio, InboxSize)                             \
+  static ES_Event_t InboxSlots##Prio[(InboxSize) + 1];          \
+  static ES_SPSCQueue_t Inbox##Prio;                            \
+  ES_STATIC_ASSERT(((InboxSize) > 0) && ((InboxSize) < 255),    \
+      InboxSize_out_of_range_for_service_##Prio);
+#define INBOX_ENTRY(Prio, InboxSize) \
+  [Prio] = { &Inbox##Prio, InboxSlots##Prio, ARRAY_SIZE(InboxSlots##Prio) },
+#define INBOX_COUNT(Prio, InboxSize) + 1
+#define NUM_INBOXES (0 ISR_INBOX_TABLE(INBOX_COUNT))
+
+/*---------------------------- Module Functions ---------------------------*/
+//static bool CheckSystemEvents( void );
+static uint8_t GetHighestReady(void);
+static bool PostToQueue(uint8_t WhichService, ES_Event_t ThisEvent,
+                        bool AtFront);
+static bool PostBatchToQueue(uint8_t WhichService, const ES_Event_t *pEvents,
+                             uint8_t NumEvents, bool AtFront);
+static void UpdateHighWater(uint8_t WhichService, uint16_t Depth);
+static bool PostToInbox(uint8_t WhichService, ES_Event_t ThisEvent);
+static bool DrainInboxes(void);
+#ifdef ES_USE_IDLE_WAIT
+static bool AreInboxesEmpty(void);
 #endif
-#if NUM_SERVICES > 13
-  , { SERV_13_INIT, SERV_13_RUN }
+static void MarkReady(uint8_t WhichService);
+static void MarkIfEmpty(uint8_t WhichService);
+static bool DispatchService(uint8_t WhichService);
+static bool DispatchBatch(uint8_t WhichService, uint16_t NumLeft,
+                          ES_Event_t FirstEvent);
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+static void Schedule(void);
 #endif
-#if NUM_SERVICES > 14
-  , { SERV_14_INIT, SERV_14_RUN }
+#ifdef _INCLUDE_DISPATCH_STATS_
+static void RecordLatency(uint8_t WhichService);
 #endif
-#if NUM_SERVICES > 15
-  , { SERV_15_INIT, SERV_15_RUN }
+#ifdef _INCLUDE_LATENCY_STATS_
+static void RecordEventLatency(uint8_t WhichService, uint32_t TimeStamp);
 #endif
+
+/*---------------------------- Module Variables ---------------------------*/
+/****************************************************************************/
+// The service descriptors, built from SERVICE_TABLE in ES_Configure.h
+// The first entry, at index 0, is the lowest priority, with increasing
+// priority with higher indices
+
+static ES_ServDesc_t const ServDescList[] =
+{
+  SERVICE_TABLE(SERV_DESC_ENTRY, BATCH_DESC_ENTRY)
 };
 
+ES_STATIC_ASSERT(ARRAY_SIZE(ServDescList) == NUM_SERVICES,
+    NUM_SERVICES_must_match_SERVICE_TABLE);
+
 /****************************************************************************/
 // The queues for the services
 
-static ES_Event_t Queue0[SERV_0_QUEUE_SIZE + 1];
-#if NUM_SERVICES > 1
-static ES_Event_t Queue1[SERV_1_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 2
-static ES_Event_t Queue2[SERV_2_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 3
-static ES_Event_t Queue3[SERV_3_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 4
-static ES_Event_t Queue4[SERV_4_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 5
-static ES_Event_t Queue5[SERV_5_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 6
-static ES_Event_t Queue6[SERV_6_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 7
-static ES_Event_t Queue7[SERV_7_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 8
-static ES_Event_t Queue8[SERV_8_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 9
-static ES_Event_t Queue9[SERV_9_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 10
-static ES_Event_t Queue10[SERV_10_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 11
-static ES_Event_t Queue11[SERV_11_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 12
-static ES_Event_t Queue12[SERV_12_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 13
-static ES_Event_t Queue13[SERV_13_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 14
-static ES_Event_t Queue14[SERV_14_QUEUE_SIZE + 1];
-#endif
-#if NUM_SERVICES > 15
-static ES_Event_t Queue15[SERV_15_QUEUE_SIZE + 1];
-#endif
+SERVICE_TABLE(SERV_QUEUE_DECL, BATCH_QUEUE_DECL)
 
 /****************************************************************************/
 // array of queue descriptors for posting by priority level
 
 static ES_QueueDesc_t const EventQueues[NUM_SERVICES] = {
-  { Queue0, ARRAY_SIZE(Queue0) }
-#if NUM_SERVICES > 1
-  , { Queue1, ARRAY_SIZE(Queue1) }
-#endif
-#if NUM_SERVICES > 2
-  , { Queue2, ARRAY_SIZE(Queue2) }
-#endif
-#if NUM_SERVICES > 3
-  , { Queue3, ARRAY_SIZE(Queue3) }
-#endif
-#if NUM_SERVICES > 4
-  , { Queue4, ARRAY_SIZE(Queue4) }
-#endif
-#if NUM_SERVICES > 5
-  , { Queue5, ARRAY_SIZE(Queue5) }
-#endif
-#if NUM_SERVICES > 6
-  , { Queue6, ARRAY_SIZE(Queue6) }
-#endif
-#if NUM_SERVICES > 7
-  , { Queue7, ARRAY_SIZE(Queue7) }
-#endif
-#if NUM_SERVICES > 8
-  , { Queue8, ARRAY_SIZE(Queue8) }
-#endif
-#if NUM_SERVICES > 9
-  , { Queue9, ARRAY_SIZE(Queue9) }
-#endif
-#if NUM_SERVICES > 10
-  , { Queue10, ARRAY_SIZE(Queue10) }
-#endif
-#if NUM_SERVICES > 11
-  , { Queue11, ARRAY_SIZE(Queue11) }
-#endif
-#if NUM_SERVICES > 12
-  , { Queue12, ARRAY_SIZE(Queue12) }
-#endif
-#if NUM_SERVICES > 13
-  , { Queue13, ARRAY_SIZE(Queue13) }
-#endif
-#if NUM_SERVICES > 14
-  , { Queue14, ARRAY_SIZE(Queue14) }
-#endif
-#if NUM_SERVICES > 15
-  , { Queue15, ARRAY_SIZE(Queue15) }
+  SERVICE_TABLE(SERV_QUEUE_ENTRY, BATCH_QUEUE_ENTRY)
+};
+
+#ifdef ES_USE_EVENT_POOL
+/****************************************************************************/
+// the shared event pool and each service's reservation in it, from
+// EVENT_POOL_RESERVE_TABLE in ES_Configure.h
+
+static ES_Event_t EventPool[ES_EVENT_POOL_SIZE];
+static uint8_t EventPoolFreeList[ES_EVENT_POOL_SIZE];
+
+static uint8_t const PoolReserve[NUM_SERVICES] = {
+  EVENT_POOL_RESERVE_TABLE(RESERVE_ENTRY)
+};
+
+ES_STATIC_ASSERT((ES_EVENT_POOL_SIZE > 0) &&
+    (ES_EVENT_POOL_SIZE <= ES_POOL_MAX_SIZE),
+    ES_EVENT_POOL_SIZE_out_of_range);
+ES_STATIC_ASSERT((0 EVENT_POOL_RESERVE_TABLE(RESERVE_SUM)) <=
+    ES_EVENT_POOL_SIZE, pool_reservations_add_up_to_more_than_the_pool);
 #endif
+
+/****************************************************************************/
+// what each service's queue does when it overflows, from QUEUE_POLICY_TABLE
+// in ES_Configure.h. Services that aren't listed are 0, ES_QUEUE_REJECT_NEW.
+
+static ES_QueuePolicy_t const QueuePolicy[NUM_SERVICES] = {
+  QUEUE_POLICY_TABLE(POLICY_ENTRY)
+};
+
+// high water marks and overflow counts, read with ES_GetQueueStats
+static ES_QueueStats_t QueueStats[NUM_SERVICES];
+
+/****************************************************************************/
+// the ISR inboxes, for the services listed in ISR_INBOX_TABLE
+
+ISR_INBOX_TABLE(INBOX_DECL)
+
+static ES_InboxDesc_t const Inboxes[NUM_SERVICES] = {
+  ISR_INBOX_TABLE(INBOX_ENTRY)
 };
 
+// each inbox's overflow count when the queue stats were last cleared, the
+// count itself belongs to the ISR
+static uint16_t InboxOverflowBase[NUM_SERVICES];
+
 /****************************************************************************/
 // Variable used to keep track of which queues have events in them
 
-uint16_t Ready;
+uint32_t Ready[NUM_READY_WORDS];
+
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+// the preemption level that is currently running. Services only preempt
+// when their level is above this.
+static volatile uint8_t CurrentLevel = LOCKED_LEVEL;
+// set when a run function called from Schedule returns an error, ES_Run
+// reports it
+static volatile bool RunFailed = false;
+// set when a scheduler request arrives while the level is locked, so that
+// whoever holds the lock goes round the drain again before releasing it
+static volatile bool MissedSchedule = false;
+#endif
+
+#ifdef _INCLUDE_LATENCY_STATS_
+// enqueue to run function latency of each service's events
+static ES_LatencyStats_t LatencyStats[NUM_SERVICES];
+#endif
+
+#ifdef ES_USE_TRACE
+// the service whose run function is executing, for the trace
+static uint8_t RunningService = ES_TRACE_FROM_IDLE;
+#endif
+// true while DrainInboxes is posting, for the trace & the latency stamp
+#if NUM_INBOXES > 0
+static bool DrainingInboxes = false;
+#else
+#define DrainingInboxes false
+#endif
+
+#ifdef _INCLUDE_DISPATCH_STATS_
+// counters for measuring dispatch throughput, read with ES_GetDispatchStats
+static ES_DispatchStats_t DispatchStats;
+// cycle count when each service last became ready and the longest it
+// has waited to be run, read with ES_GetMaxDispatchLatency
+static uint32_t ReadyStamp[NUM_SERVICES];
+static uint32_t MaxLatency[NUM_SERVICES];
+#endif
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -257,16 +406,36 @@ ES_Return_t ES_Initialize(TimerRate_t NewRate)
 {
   uint8_t i;
   ES_Timer_Init(NewRate);  // start up the timer subsystem
+  ES_InitDeferredWork();
+#ifdef ES_USE_EVENT_POOL
+  ES_Pool_Init(EventPool, EventPoolFreeList, ES_EVENT_POOL_SIZE);
+#endif
   // loop through the list testing for NULL pointers and
   for (i = 0; i < ARRAY_SIZE(ServDescList); i++)
   {
     if ((ServDescList[i].InitFunc == (pInitFunc)0) ||
-        (ServDescList[i].RunFunc == (pRunFunc)0))
+        ((ServDescList[i].RunFunc == (pRunFunc)0) &&
+         (ServDescList[i].RunBatchFunc == (pRunBatchFunc)0)))
     {
       return FailedPointer; // protect against NULL pointers
     }
+    // the table must be listed in priority order
+    if (ServDescList[i].Priority != i)
+    {
+      return FailedIndex;
+    }
     // and initializing the event queues (must happen before running inits)
+#ifdef ES_USE_EVENT_POOL
+    ES_Pool_InitRing(EventQueues[i].pMem, EventQueues[i].pIndices,
+        EventQueues[i].Size, PoolReserve[i]);
+#else
     ES_InitQueue(EventQueues[i].pMem, EventQueues[i].Size);
+#endif
+    if (Inboxes[i].pInbox != NULL)
+    {
+      ES_SPSC_Init(Inboxes[i].pInbox, Inboxes[i].pSlots,
+          Inboxes[i].NumSlots);
+    }
     // executing the init functions
     if (ServDescList[i].InitFunc(i) != true)
     {
@@ -299,26 +468,45 @@ ES_Return_t ES_Initialize(TimerRate_t NewRate)
 ****************************************************************************/
 ES_Return_t ES_Run(void)
 {
-  // make these static to improve speed
-  uint8_t         HighestPrior;
-  static ES_Event_t ThisEvent;
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  // start the kernel: from here on services are run by Schedule as soon as
+  // an event is posted to a service with a higher priority than the one
+  // running, so this loop becomes the idle level
+  _HW_SchedulerInit();
+  EnterCritical();
+  CurrentLevel = IDLE_LEVEL;
+  Schedule();   // run anything that was posted during initialization
+  if (MissedSchedule)
+  {
+    // an ISR asked for the scheduler before the kernel was started
+    MissedSchedule = false;
+    _HW_RequestSchedule();
+  }
+  ExitCritical();
+#else
+  uint8_t HighestPrior;
+#endif
 
   while (1)  // stay here unless we detect an error condition
-  { // loop through the list executing the run functions for services
-    // with a non-empty queue. Process any pending ints before testing
-    // Ready
-    while ((_HW_Process_Pending_Ints()) && (Ready != 0))
+  {
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+    if (RunFailed)
+    {
+      return FailedRun;
+    }
+#else
+    // loop through the list executing the run functions for services
+    // with a non-empty queue. Process any pending ints, run the work the
+    // ISRs have deferred and move any events they have left in the inboxes
+    // before testing Ready
+    while ((_HW_Process_Pending_Ints()) && ES_RunDeferredWork() &&
+        DrainInboxes() &&
+        ((HighestPrior = GetHighestReady()) != NO_SERVICE_READY))
     {
-      HighestPrior = ES_GetMSBitSet(Ready);
-      if (ES_DeQueue(EventQueues[HighestPrior].pMem, &ThisEvent) == 0)
-      {
-        Ready &= BitNum2ClrMask[HighestPrior]; // mark queue as now empty
-      }
 #ifdef _INCLUDE_BASIC_FRAMEWORK_DEBUG_
       _HW_DebugSetLine1();
 #endif
-      if (ServDescList[HighestPrior].RunFunc(ThisEvent).EventType !=
-          ES_NO_EVENT)
+      if (DispatchService(HighestPrior) != true)
       {
         return FailedRun;
       }
@@ -326,6 +514,7 @@ ES_Return_t ES_Run(void)
       _HW_DebugClearLine1();
 #endif
     }
+#endif /* ES_USE_PREEMPTIVE_KERNEL */
 
 #ifdef _INCLUDE_BASIC_FRAMEWORK_DEBUG_
     _HW_DebugSetLine2();
@@ -334,7 +523,23 @@ ES_Return_t ES_Run(void)
     if (!ES_CheckUserEvents()) // no new user events
     {
       Terminal_MoveBuffer2UART(); // try moving bytes, if available, to UART
+#ifdef ES_USE_IDLE_WAIT
+      // nothing to do, so idle the core until the next interrupt. The final
+      // tests are made with interrupts off so that a post from an ISR can't
+      // slip in between them and the wait.
+      EnterCritical();
+      if ((GetHighestReady() == NO_SERVICE_READY) && AreInboxesEmpty() &&
+          !ES_IsDeferredWorkPending() && Terminal_IsXmitIdle() &&
+          !IsNewKeyReady())
+      {
+        _HW_IdleWait();
+      }
+      ExitCritical();
+#endif
     }
+#ifdef _INCLUDE_DISPATCH_STATS_
+    DispatchStats.IdleLoops++;
+#endif
 #ifdef _INCLUDE_BASIC_FRAMEWORK_DEBUG_
     _HW_DebugClearLine2();
 #endif
@@ -361,14 +566,10 @@ bool ES_PostAll(ES_Event_t ThisEvent)
   // loop through the list executing the post functions
   for (i = 0; i < ARRAY_SIZE(EventQueues); i++)
   {
-    if (ES_EnQueueFIFO(EventQueues[i].pMem, ThisEvent) != true)
+    if (PostToQueue(i, ThisEvent, false) != true)
     {
       break; // this is a failed post
     }
-    else
-    {
-      Ready |= BitNum2SetMask[i]; // show queue as non-empty
-    }
   }
   if (i == ARRAY_SIZE(EventQueues))    // if no failures
   {
@@ -391,21 +592,25 @@ bool ES_PostAll(ES_Event_t ThisEvent)
  Description
    posts to one of the services' queues
  Notes
-   used by the timer library to associate a timer with a state machine
+   used by the timer library to associate a timer with a state machine.
+   Posts from an ISR to a service with an ISR inbox go to the inbox.
  Author
    J. Edward Carryer, 01/16/12,
 ****************************************************************************/
 bool ES_PostToService(uint8_t WhichService, ES_Event_t TheEvent)
 {
-  if ((WhichService < ARRAY_SIZE(EventQueues)) &&
-      (ES_EnQueueFIFO(EventQueues[WhichService].pMem, TheEvent) ==
-        true))
+  if (WhichService < ARRAY_SIZE(EventQueues))
   {
-    Ready |= BitNum2SetMask[WhichService]; // show queue as non-empty
-    return true;
+    if ((Inboxes[WhichService].pInbox != NULL) && _HW_InISR())
+    {
+      return PostToInbox(WhichService, TheEvent);
+    }
+    return PostToQueue(WhichService, TheEvent, false);
   }
   else
   {
+    ES_TRACE(ES_TRACE_POST_FAILED, TRACE_SOURCE(), WhichService, TheEvent,
+        0);
     return false;
   }
 }
@@ -427,22 +632,983 @@ bool ES_PostToService(uint8_t WhichService, ES_Event_t TheEvent)
 ****************************************************************************/
 bool ES_PostToServiceLIFO(uint8_t WhichService, ES_Event_t TheEvent)
 {
-  if ((WhichService < ARRAY_SIZE(EventQueues)) &&
-      (ES_EnQueueLIFO(EventQueues[WhichService].pMem, TheEvent) ==
-        true))
+  if (WhichService < ARRAY_SIZE(EventQueues))
   {
-    Ready |= BitNum2SetMask[WhichService]; // show queue as non-empty
-    return true;
+    return PostToQueue(WhichService, TheEvent, true);
   }
   else
   {
+    ES_TRACE(ES_TRACE_POST_FAILED, TRACE_SOURCE(), WhichService, TheEvent,
+        0);
     return false;
   }
 }
 
-//*********************************
-// private functions
-//*********************************
+/****************************************************************************
+ Function
+   ES_PostBatchToService
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   const ES_Event_t * : the events to post, in order
+   uint8_t : how many there are
+   bool : false to post FIFO, true to post each in turn LIFO
+ Returns
+   boolean : False if any of the events could not be posted
+ Description
+   posts a group of events to one of the services' queues, taking the
+   queue's critical region once for all of them rather than once each
+ Notes
+   used by ES_RecallEvents. Events that don't fit are handed to the
+   queue's overflow policy one at a time. From an ISR, FIFO posts to a
+   service with an ISR inbox go to the inbox one at a time.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_PostBatchToService(uint8_t WhichService, const ES_Event_t *pEvents,
+                           uint8_t NumEvents, bool AtFront)
+{
+  uint8_t i;
+  bool    AllPosted = true;
+
+  if (WhichService >= ARRAY_SIZE(EventQueues))
+  {
+    for (i = 0; i < NumEvents; i++)
+    {
+      ES_TRACE(ES_TRACE_POST_FAILED, TRACE_SOURCE(), WhichService,
+          pEvents[i], 0);
+    }
+    return false;
+  }
+  if (!AtFront && (Inboxes[WhichService].pInbox != NULL) && _HW_InISR())
+  {
+    for (i = 0; i < NumEvents; i++)
+    {
+      AllPosted = PostToInbox(WhichService, pEvents[i]) && AllPosted;
+    }
+    return AllPosted;
+  }
+  return PostBatchToQueue(WhichService, pEvents, NumEvents, AtFront);
+}
+
+#ifdef _INCLUDE_DISPATCH_STATS_
+/****************************************************************************
+ Function
+   ES_GetDispatchStats
+ Parameters
+   ES_DispatchStats_t * : where to copy the current counters
+ Returns
+   nothing
+ Description
+   copies out the dispatch counters kept by ES_Run. Sampling these twice,
+   a known time apart, gives the dispatch throughput in events/sec and the
+   average number of events handed over per run function call
+ Notes
+   only available when _INCLUDE_DISPATCH_STATS_ is defined
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_GetDispatchStats(ES_DispatchStats_t *pStats)
+{
+  EnterCritical();
+  *pStats = DispatchStats;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   ES_GetMaxDispatchLatency
+ Parameters
+   uint8_t : the service to report on
+ Returns
+   uint32_t : the longest time, in _HW_GetCycleCount counts, that the
+              service has waited between becoming ready and being run
+ Description
+   gives the worst case dispatch latency seen so far for one service. This
+   is measured the same way under the cooperative ES_Run and the preemptive
+   kernel so the two can be compared.
+ Notes
+   only available when _INCLUDE_DISPATCH_STATS_ is defined. The time a
+   service waits while further events sit in its queue behind the one it
+   is processing is not counted.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint32_t ES_GetMaxDispatchLatency(uint8_t WhichService)
+{
+  if (WhichService >= NUM_SERVICES)
+  {
+    return 0;
+  }
+  return MaxLatency[WhichService];
+}
+
+#endif
+/****************************************************************************
+ Function
+   ES_GetQueueStats
+ Parameters
+   uint8_t : the service to report on
+   ES_QueueStats_t * : where to copy the stats for its queue
+ Returns
+   bool : false if there is no such service
+ Description
+   reports the size of the service's queue, the most events that have been
+   in it at once and how many posts found it full. A high water mark well
+   below the size means the queue can be made smaller, any overflows mean
+   it should be bigger (or the policy changed).
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_GetQueueStats(uint8_t WhichService, ES_QueueStats_t *pStats)
+{
+  if (WhichService >= NUM_SERVICES)
+  {
+    return false;
+  }
+  EnterCritical();
+  *pStats = QueueStats[WhichService];
+  ExitCritical();
+#ifdef ES_USE_EVENT_POOL
+  pStats->Size = EventQueues[WhichService].Size;
+#else
+  pStats->Size = EventQueues[WhichService].Size - ES_QUEUE_HEADER_SLOTS;
+#endif
+  if (Inboxes[WhichService].pInbox != NULL)
+  {
+    // add in the posts that found the ISR inbox full
+    uint32_t Total = (uint32_t)pStats->NumOverflows +
+        (uint16_t)(ES_SPSC_GetOverflows(Inboxes[WhichService].pInbox) -
+        InboxOverflowBase[WhichService]);
+    pStats->NumOverflows = (Total > UINT16_MAX) ? UINT16_MAX :
+        (uint16_t)Total;
+  }
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ClearQueueStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   resets the high water marks and overflow counts of all of the queues,
+   and those of the event pool when it is in use
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_ClearQueueStats(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < NUM_SERVICES; i++)
+  {
+    EnterCritical();
+    QueueStats[i].HighWater = 0;
+    QueueStats[i].NumOverflows = 0;
+    ExitCritical();
+    if (Inboxes[i].pInbox != NULL)
+    {
+      InboxOverflowBase[i] = ES_SPSC_GetOverflows(Inboxes[i].pInbox);
+    }
+  }
+#ifdef ES_USE_EVENT_POOL
+  ES_Pool_ClearStats();
+#endif
+}
+
+#ifdef _INCLUDE_LATENCY_STATS_
+/****************************************************************************
+ Function
+   ES_GetLatencyStats
+ Parameters
+   uint8_t : the service to report on
+   ES_LatencyStats_t * : where to copy its statistics
+ Returns
+   bool : false if there is no such service
+ Description
+   copies out the histogram, max and total of the time from each event
+   being put in the service's queue to the service's run function being
+   called with it
+ Notes
+   only available when _INCLUDE_LATENCY_STATS_ is defined
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_GetLatencyStats(uint8_t WhichService, ES_LatencyStats_t *pStats)
+{
+  if (WhichService >= NUM_SERVICES)
+  {
+    return false;
+  }
+  EnterCritical();
+  *pStats = LatencyStats[WhichService];
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ClearLatencyStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   starts the latency statistics of all of the services over
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_ClearLatencyStats(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < NUM_SERVICES; i++)
+  {
+    EnterCritical();
+    memset(&LatencyStats[i], 0, sizeof(LatencyStats[i]));
+    ExitCritical();
+  }
+}
+
+#endif
+/****************************************************************************
+ Function
+   ES_MutexLock
+ Parameters
+   uint8_t : the priority ceiling, the priority of the highest priority
+             service that shares the resource being protected
+ Returns
+   ES_MutexState_t : the state to hand back to ES_MutexUnlock
+ Description
+   raises the preemption level to the ceiling so that none of the services
+   sharing the resource can preempt the caller. Services above the ceiling,
+   and all interrupts, still run.
+ Notes
+   for use from services only, not from ISRs. Locks nest as long as they are
+   released in the reverse order. Under the cooperative ES_Run nothing can
+   preempt a service, so this does nothing.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+ES_MutexState_t ES_MutexLock(uint8_t PrioCeiling)
+{
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  ES_MutexState_t PrevLevel;
+
+  EnterCritical();
+  PrevLevel = CurrentLevel;
+  if (LEVEL_OF(PrioCeiling) > CurrentLevel)
+  {
+    CurrentLevel = LEVEL_OF(PrioCeiling);
+  }
+  ExitCritical();
+  return PrevLevel;
+#else
+  (void)PrioCeiling;
+  return 0;
+#endif
+}
+
+/****************************************************************************
+ Function
+   ES_MutexUnlock
+ Parameters
+   ES_MutexState_t : the value returned by the matching ES_MutexLock
+ Returns
+   nothing
+ Description
+   drops the preemption level back down and runs any services that became
+   ready while the lock was held
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_MutexUnlock(ES_MutexState_t PrevState)
+{
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  EnterCritical();
+  CurrentLevel = PrevState;
+  Schedule();
+  ExitCritical();
+#else
+  (void)PrevState;
+#endif
+}
+
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+/****************************************************************************
+ Function
+   ES_ScheduleFromISR
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   the body of the port's scheduler software interrupt. Runs the timer tick
+   processing and then any ready services above the level that was
+   interrupted.
+ Notes
+   the port must have dropped the CPU priority back to 0 before calling this
+   so that the services run like task code and can be preempted by any
+   interrupt, including another scheduler request.
+   A request that arrives while the level is locked is remembered in
+   MissedSchedule rather than lost, and the drain is repeated before the
+   lock is released.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_ScheduleFromISR(void)
+{
+  uint8_t PrevLevel;
+
+  EnterCritical();
+  PrevLevel = CurrentLevel;
+  if (PrevLevel == LOCKED_LEVEL)
+  {
+    // the tick is already being processed (or the kernel hasn't started).
+    // Leave a note so that whoever holds the lock drains again before
+    // they release it.
+    MissedSchedule = true;
+    ExitCritical();
+    return;
+  }
+  CurrentLevel = LOCKED_LEVEL;
+
+  // posts from the timers only mark services ready while we are locked,
+  // and this is the one place the deferred work is run and the inboxes
+  // are drained from. An ISR that posts or defers work while we are at it
+  // finds the level locked and sets MissedSchedule, so go round again
+  // until a pass ends with no new requests.
+  do
+  {
+    MissedSchedule = false;
+    ExitCritical();
+    _HW_Process_Pending_Ints();
+    ES_RunDeferredWork();
+    DrainInboxes();
+    EnterCritical();
+  } while (MissedSchedule);
+
+  CurrentLevel = PrevLevel;
+  Schedule();
+  ExitCritical();
+}
+
+#endif
+//*********************************
+// private functions
+//*********************************
+/****************************************************************************
+ Function
+   GetHighestReady
+ Parameters
+   None
+ Returns
+   uint8_t : the priority of the highest priority service with a non-empty
+             queue, NO_SERVICE_READY if all of the queues are empty
+ Description
+   scans the Ready set from the top word down, using ES_GetMSBitSet32 (a
+   single clz on the PIC32) to find the highest bit set in a word
+ Notes
+   with NUM_SERVICES <= 32 the loop collapses to a single test & clz.
+   ES_NYBBLE_LOOKUP puts back the nybble walk (ES_GetMSBitSet) that the
+   16 service Ready set used, only so that make bench in HostPort can
+   compare the two.
+****************************************************************************/
+static uint8_t GetHighestReady(void)
+{
+#ifdef ES_NYBBLE_LOOKUP
+  if (Ready[0] != 0)
+  {
+    return ES_GetMSBitSet((uint16_t)Ready[0]);
+  }
+#else
+  uint8_t WordNum = NUM_READY_WORDS;
+
+  while (WordNum-- > 0)
+  {
+    if (Ready[WordNum] != 0)
+    {
+      return (uint8_t)((WordNum * BITS_PER_READY_WORD) +
+             ES_GetMSBitSet32(Ready[WordNum]));
+    }
+  }
+#endif
+  return NO_SERVICE_READY;
+}
+
+/****************************************************************************
+ Function
+   PostToQueue
+ Parameters
+   uint8_t : the service to post to, already range checked
+   ES_Event_t : the event to post
+   bool : true to put the event at the front of the queue (LIFO)
+ Returns
+   bool : true if the event was queued (or coalesced)
+ Description
+   queues the event, applying the service's overflow policy if the queue
+   is full, updates the queue stats and marks the service ready
+ Notes
+   for ES_QUEUE_DROP_OLDEST, a post to the front (a LIFO post or a recall)
+   drops the event at the back of the queue instead of the head, which
+   may be an earlier, more urgent, LIFO post.
+   The event is stamped for the latency stats here, unless it comes from
+   an ISR inbox, which stamped it when the ISR posted it.
+****************************************************************************/
+static bool PostToQueue(uint8_t WhichService, ES_Event_t ThisEvent,
+                        bool AtFront)
+{
+  ServQueue_t *pQueue = EventQueues[WhichService].pMem;
+  bool        Posted;
+  uint16_t    Depth;
+
+#ifdef _INCLUDE_LATENCY_STATS_
+  if (!DrainingInboxes || _HW_InISR()) // an ISR may post during the drain
+  {
+    ThisEvent.TimeStamp = _HW_GetCycleCount();
+  }
+#endif
+  if (AtFront)
+  {
+    Posted = QUEUE_ENQUEUE_LIFO(pQueue, ThisEvent);
+  }
+  else
+  {
+    Posted = QUEUE_ENQUEUE_FIFO(pQueue, ThisEvent);
+  }
+  if (Posted != true)
+  {
+    EnterCritical();
+    if (QueueStats[WhichService].NumOverflows != UINT16_MAX)
+    {
+      QueueStats[WhichService].NumOverflows++;
+    }
+    ExitCritical();
+    switch (QueuePolicy[WhichService])
+    {
+      case ES_QUEUE_DROP_OLDEST:
+      {
+        // one region for the drop and the add, so that an ISR can't take
+        // the slot in between
+        EnterCritical();
+        if (AtFront)
+        {
+          // the head may be an earlier LIFO post, so drop the last in line
+          QUEUE_DROP_NEWEST(pQueue);
+          Posted = QUEUE_ENQUEUE_LIFO(pQueue, ThisEvent);
+        }
+        else
+        {
+          QUEUE_DROP_OLDEST(pQueue);
+          Posted = QUEUE_ENQUEUE_FIFO(pQueue, ThisEvent);
+        }
+        ExitCritical();
+      }
+      break;
+
+      case ES_QUEUE_COALESCE:
+      {
+        Posted = QUEUE_REPLACE_SAME_EVENT(pQueue, ThisEvent);
+      }
+      break;
+
+      case ES_QUEUE_TRAP:
+      {
+        char Msg[48];
+
+        // call _fassert (terminal.c) directly rather than through assert,
+        // so that the halt is still there with NDEBUG defined. It sends
+        // the message & halts, from an ISR too.
+        snprintf(Msg, sizeof(Msg), "ES queue overflow: service %u, event %u",
+            WhichService, (unsigned)ThisEvent.EventType);
+        _fassert(__LINE__, __FILE__, Msg, __func__);
+      }
+      break;
+
+      default:  // ES_QUEUE_REJECT_NEW
+      {}
+      break;
+    }
+  }
+  if (Posted != true)
+  {
+    ES_TRACE(ES_TRACE_POST_FAILED, TRACE_SOURCE(), WhichService, ThisEvent,
+        QUEUE_DEPTH(pQueue));
+    return false;
+  }
+  Depth = QUEUE_DEPTH(pQueue);
+  ES_TRACE(ES_TRACE_POST, TRACE_SOURCE(), WhichService, ThisEvent, Depth);
+  UpdateHighWater(WhichService, Depth);
+  MarkReady(WhichService); // show queue as non-empty
+  return true;
+}
+
+/****************************************************************************
+ Function
+   PostBatchToQueue
+ Parameters
+   uint8_t : the service to post to, already range checked
+   const ES_Event_t * : the events to post
+   uint8_t : how many there are
+   bool : true to put each event in turn at the front of the queue
+ Returns
+   bool : true if all of the events were queued (or coalesced)
+ Description
+   queues as many of the events as fit with a single ES_EnQueueBatch and
+   passes any that are left to PostToQueue, so that the overflow policy
+   and stats are applied to them as usual
+****************************************************************************/
+static bool PostBatchToQueue(uint8_t WhichService, const ES_Event_t *pEvents,
+                             uint8_t NumEvents, bool AtFront)
+{
+  ServQueue_t *pQueue = EventQueues[WhichService].pMem;
+  uint16_t    Depth;
+  uint8_t     NumPosted;
+  uint8_t     i;
+  bool        AllPosted = true;
+
+  NumPosted = (uint8_t)QUEUE_ENQUEUE_BATCH(pQueue, pEvents, NumEvents,
+      AtFront);
+  if (NumPosted > 0)
+  {
+    Depth = QUEUE_DEPTH(pQueue);
+#ifdef ES_USE_TRACE
+    for (i = 0; i < NumPosted; i++)
+    {
+      ES_TRACE(ES_TRACE_POST, TRACE_SOURCE(), WhichService, pEvents[i],
+          Depth - (NumPosted - 1 - i));
+    }
+#endif
+    UpdateHighWater(WhichService, Depth);
+    MarkReady(WhichService); // show queue as non-empty
+  }
+  for (i = NumPosted; i < NumEvents; i++)
+  {
+    AllPosted = PostToQueue(WhichService, pEvents[i], AtFront) && AllPosted;
+  }
+  return AllPosted;
+}
+
+/****************************************************************************
+ Function
+   UpdateHighWater
+ Parameters
+   uint8_t : the service that was just posted to
+   uint16_t : the depth of its queue after the post
+ Returns
+   nothing
+ Description
+   raises the queue's high water mark if Depth is above it
+****************************************************************************/
+static void UpdateHighWater(uint8_t WhichService, uint16_t Depth)
+{
+  EnterCritical();
+  if (Depth > QueueStats[WhichService].HighWater)
+  {
+    QueueStats[WhichService].HighWater = Depth;
+  }
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   PostToInbox
+ Parameters
+   uint8_t : the service to post to, it must have an ISR inbox
+   ES_Event_t : the event to post
+ Returns
+   bool : false if the inbox was full
+ Description
+   the ISR side of the inboxes. Puts the event in the service's inbox
+   without disabling interrupts, ES_Run does the rest of the post later.
+ Notes
+   under the preemptive kernel the scheduler interrupt is requested, since
+   that is where the inboxes get drained
+****************************************************************************/
+static bool PostToInbox(uint8_t WhichService, ES_Event_t ThisEvent)
+{
+  if (!ES_SPSC_Put(Inboxes[WhichService].pInbox, ThisEvent))
+  {
+    return false;
+  }
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  _HW_RequestSchedule();
+#endif
+  return true;
+}
+
+/****************************************************************************
+ Function
+   DrainInboxes
+ Parameters
+   None
+ Returns
+   bool : always true, so that ES_Run can call it in its loop test
+ Description
+   moves the events the ISRs have put in the inboxes on to their services'
+   queues, with the usual overflow policy, stats and trace
+ Notes
+   the consumer side of the inboxes, so only ES_Run (or ES_ScheduleFromISR
+   under the preemptive kernel) may call it. Compiles to nothing when
+   ISR_INBOX_TABLE is empty. The latency stats of these
+   events start from when the ISR put them in the inbox.
+****************************************************************************/
+static bool DrainInboxes(void)
+{
+#if NUM_INBOXES > 0
+  ES_Event_t ThisEvent;
+  uint8_t i;
+
+  for (i = 0; i < NUM_SERVICES; i++)
+  {
+    if (Inboxes[i].pInbox != NULL)
+    {
+      while (ES_SPSC_Get(Inboxes[i].pInbox, &ThisEvent))
+      {
+        DrainingInboxes = true;
+        PostToQueue(i, ThisEvent, false);
+        DrainingInboxes = false;
+      }
+    }
+  }
+#endif
+  return true;
+}
+
+#ifdef ES_USE_IDLE_WAIT
+/****************************************************************************
+ Function
+   AreInboxesEmpty
+ Parameters
+   None
+ Returns
+   bool : true if none of the ISR inboxes have events waiting
+ Description
+   for the idle test in ES_Run
+****************************************************************************/
+static bool AreInboxesEmpty(void)
+{
+#if NUM_INBOXES > 0
+  uint8_t i;
+
+  for (i = 0; i < NUM_SERVICES; i++)
+  {
+    if ((Inboxes[i].pInbox != NULL) && !ES_SPSC_IsEmpty(Inboxes[i].pInbox))
+    {
+      return false;
+    }
+  }
+#endif
+  return true;
+}
+
+#endif
+/****************************************************************************
+ Function
+   MarkReady
+ Parameters
+   uint8_t : the service that was just posted to
+ Returns
+   nothing
+ Description
+   sets the service's bit in the Ready set. Under the preemptive kernel, if
+   the service is above the running level it is run now when posted from a
+   service, or the scheduler interrupt is requested when posted from an ISR
+   (or, by Schedule, from inside a service's critical region).
+****************************************************************************/
+static void MarkReady(uint8_t WhichService)
+{
+  EnterCritical();
+#ifdef _INCLUDE_DISPATCH_STATS_
+  if ((Ready[READY_WORD(WhichService)] & READY_MASK(WhichService)) == 0)
+  {
+    ReadyStamp[WhichService] = _HW_GetCycleCount();
+  }
+#endif
+  Ready[READY_WORD(WhichService)] |= READY_MASK(WhichService);
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  if (LEVEL_OF(WhichService) > CurrentLevel)
+  {
+    if (_HW_InISR())
+    {
+      _HW_RequestSchedule(); // runs when the last nested ISR returns
+    }
+    else
+    {
+      Schedule();
+    }
+  }
+#endif
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   MarkIfEmpty
+ Parameters
+   uint8_t : the service whose queue was just emptied by a DeQueue
+ Returns
+   nothing
+ Description
+   clears the service's bit in the Ready set
+ Notes
+   re-tests the queue inside the critical region in case an interrupt posted
+   to it after the DeQueue
+****************************************************************************/
+static void MarkIfEmpty(uint8_t WhichService)
+{
+  EnterCritical();
+  if (QUEUE_IS_EMPTY(EventQueues[WhichService].pMem))
+  {
+    Ready[READY_WORD(WhichService)] &= ~READY_MASK(WhichService);
+  }
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   DispatchService
+ Parameters
+   uint8_t : the service to run, it must have a non-empty queue
+ Returns
+   bool : false if the run function returned an error
+ Description
+   pulls the next event from the service's queue (or a batch of them for
+   batch services) and calls its run function
+ Notes
+   shared by the cooperative ES_Run loop and the preemptive Schedule
+****************************************************************************/
+static bool DispatchService(uint8_t WhichService)
+{
+  ES_Event_t ThisEvent;
+  uint16_t NumLeft;
+  bool ReturnVal;
+#ifdef ES_USE_TRACE
+  uint8_t PrevService = RunningService;
+#endif
+
+#ifdef _INCLUDE_DISPATCH_STATS_
+  RecordLatency(WhichService);
+#endif
+  NumLeft = QUEUE_DEQUEUE(EventQueues[WhichService].pMem, &ThisEvent);
+  ES_TRACE(ES_TRACE_DISPATCH, PrevService, WhichService, ThisEvent, NumLeft);
+#ifdef ES_USE_TRACE
+  RunningService = WhichService;
+#endif
+#ifdef _INCLUDE_DISPATCH_STATS_
+  DispatchStats.SchedulerPasses++;
+#endif
+  if (ServDescList[WhichService].MaxBatch != 0)
+  {
+    ReturnVal = DispatchBatch(WhichService, NumLeft, ThisEvent);
+  }
+  else
+  {
+    if (NumLeft == 0)
+    {
+      MarkIfEmpty(WhichService);
+    }
+#ifdef _INCLUDE_DISPATCH_STATS_
+    DispatchStats.RunCalls++;
+    DispatchStats.EventsDispatched++;
+#endif
+#ifdef _INCLUDE_LATENCY_STATS_
+    RecordEventLatency(WhichService, ThisEvent.TimeStamp);
+#endif
+    ReturnVal = ServDescList[WhichService].RunFunc(ThisEvent).EventType ==
+                ES_NO_EVENT;
+  }
+#ifdef ES_USE_TRACE
+  RunningService = PrevService;
+#endif
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   DispatchBatch
+ Parameters
+   uint8_t : the batch service to dispatch to
+   uint16_t : number of events left in its queue after FirstEvent was pulled
+   ES_Event_t : the event already pulled from the queue
+ Returns
+   bool : false if the run function returned an error
+ Description
+   drains the events that were in the queue at dispatch time, up to the
+   service's MaxBatch, into a buffer and hands them all to the service's
+   RunBatchFunc in one call
+ Notes
+   events posted while the batch is being drained wait for the next pass.
+   The buffer is on the stack because under the preemptive kernel a batch
+   service can be preempted by another one.
+****************************************************************************/
+static bool DispatchBatch(uint8_t WhichService, uint16_t NumLeft,
+                          ES_Event_t FirstEvent)
+{
+  ES_Event_t BatchBuffer[ES_MAX_BATCH];
+  uint8_t NumEvents = 1;
+  uint8_t NumToTake = ServDescList[WhichService].MaxBatch;
+
+  if (NumLeft < NumToTake)
+  {
+    NumToTake = NumLeft + 1;  // what was queued at dispatch time
+  }
+  BatchBuffer[0] = FirstEvent;
+  if (NumToTake > 1)
+  {
+    NumEvents += (uint8_t)QUEUE_DEQUEUE_BATCH(EventQueues[WhichService].pMem,
+        &BatchBuffer[1], NumToTake - 1);
+    NumLeft = QUEUE_DEPTH(EventQueues[WhichService].pMem);
+#ifdef ES_USE_TRACE
+    {
+      uint8_t i;
+      for (i = 1; i < NumEvents; i++)
+      {
+        ES_TRACE(ES_TRACE_DISPATCH, WhichService, WhichService,
+            BatchBuffer[i], NumLeft + (NumEvents - 1 - i));
+      }
+    }
+#endif
+  }
+  if (NumLeft == 0)
+  {
+    MarkIfEmpty(WhichService);
+  }
+#ifdef _INCLUDE_DISPATCH_STATS_
+  DispatchStats.RunCalls++;
+  DispatchStats.EventsDispatched += NumEvents;
+#endif
+#ifdef _INCLUDE_LATENCY_STATS_
+  {
+    uint8_t i;
+    for (i = 0; i < NumEvents; i++)
+    {
+      RecordEventLatency(WhichService, BatchBuffer[i].TimeStamp);
+    }
+  }
+#endif
+  return ServDescList[WhichService].RunBatchFunc(BatchBuffer,
+         NumEvents).EventType == ES_NO_EVENT;
+}
+
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+/****************************************************************************
+ Function
+   Schedule
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   runs, highest priority first, every ready service whose level is above
+   the level that was running when we were called. Each service runs at its
+   own level, so a post to a higher priority service from inside it
+   preempts it right there by calling back into Schedule.
+ Notes
+   must be called in a critical region, and returns in it. The region is
+   left while the services run, so if it is nested in a caller's region
+   (a post from inside EnterCritical) they would run with the IPL still
+   raised. Then the scheduler interrupt is requested instead, and runs
+   them when the outermost region puts the IPL back. All of the preempted
+   services share the one stack, so the stack has to be sized for the sum
+   of the worst case of each priority level.
+****************************************************************************/
+static void Schedule(void)
+{
+  uint8_t PrevLevel = CurrentLevel;
+  uint8_t HighestPrior;
+
+  if (_HW_CriticalNesting > 1)
+  {
+    _HW_RequestSchedule();
+    return;
+  }
+  while (((HighestPrior = GetHighestReady()) != NO_SERVICE_READY) &&
+      (LEVEL_OF(HighestPrior) > PrevLevel))
+  {
+    CurrentLevel = LEVEL_OF(HighestPrior);
+    ExitCritical();
+#ifdef _INCLUDE_BASIC_FRAMEWORK_DEBUG_
+    _HW_DebugSetLine1();
+#endif
+    if (DispatchService(HighestPrior) != true)
+    {
+      RunFailed = true;
+    }
+#ifdef _INCLUDE_BASIC_FRAMEWORK_DEBUG_
+    _HW_DebugClearLine1();
+#endif
+    EnterCritical();
+  }
+  CurrentLevel = PrevLevel;
+}
+
+#endif
+#ifdef _INCLUDE_DISPATCH_STATS_
+/****************************************************************************
+ Function
+   RecordLatency
+ Parameters
+   uint8_t : the service about to be run
+ Returns
+   nothing
+ Description
+   updates the service's worst case time from becoming ready to being run
+ Notes
+   if events remain in the queue after this dispatch, the service is ready
+   again from now, so the stamp is restarted
+****************************************************************************/
+static void RecordLatency(uint8_t WhichService)
+{
+  uint32_t Now = _HW_GetCycleCount();
+  uint32_t Latency = Now - ReadyStamp[WhichService];
+
+  if (Latency > MaxLatency[WhichService])
+  {
+    MaxLatency[WhichService] = Latency;
+  }
+  ReadyStamp[WhichService] = Now;
+}
+
+#endif
+#ifdef _INCLUDE_LATENCY_STATS_
+/****************************************************************************
+ Function
+   RecordEventLatency
+ Parameters
+   uint8_t : the service the event is being handed to
+   uint32_t : the TimeStamp the event was given when it was queued
+ Returns
+   nothing
+ Description
+   adds the time since the event was queued to the service's histogram.
+   The bucket is the position of the highest bit set, found with clz.
+****************************************************************************/
+static void RecordEventLatency(uint8_t WhichService, uint32_t TimeStamp)
+{
+  ES_LatencyStats_t *pStats = &LatencyStats[WhichService];
+  uint32_t Latency = _HW_GetCycleCount() - TimeStamp;
+  uint8_t  Bucket = 0;
+
+  if (Latency != 0)
+  {
+    Bucket = ES_GetMSBitSet32(Latency);
+  }
+  pStats->NumEvents++;
+  pStats->TotalLatency += Latency;
+  if (Latency > pStats->MaxLatency)
+  {
+    pStats->MaxLatency = Latency;
+  }
+  if (pStats->Buckets[Bucket] != UINT16_MAX)
+  {
+    pStats->Buckets[Bucket]++;
+  }
+}
+
+#endif
 #if 0
 /****************************************************************************
  Function
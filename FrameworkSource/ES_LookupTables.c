@@ -18,6 +18,10 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 11:50 ahb      pointed to make bench for the round trip
+ 10/17/26 04:40 ahb      noted that the timing covers the lookup alone
+ 10/16/26 09:12 ahb      test harness compares ES_GetMSBitSet against the clz
+                         based ES_GetMSBitSet32 for correctness and speed
  10/20/13 17:03 jec      converted Byte2MSBitNum array to a Nybble sized array
                          (15 entries) and made function GetMSBitSet() to figure
                          out the MSB set. This was done to facilitate moving to
@@ -32,6 +36,7 @@
 
 #include "ES_Types.h"
 #include "ES_General.h"
+#include "ES_LookupTables.h"
 #include "ES_Timers.h"
 #include "bitdefs.h"
 
@@ -107,6 +112,9 @@ uint8_t ES_GetMSBitSet(uint16_t Val2Check)
 #ifdef TEST
 #include <stdio.h>
 
+// number of passes over the full 16 bit range for the timing comparison
+#define TIMING_PASSES 4
+
 void main(void)
 {
   uint16_t  Counter = 0;
@@ -122,6 +130,45 @@ void main(void)
   {
     MSBit = ES_GetMSBitSet(Counter);
     printf("the MSB set in %u is bit %d\n\r", Counter, MSBit);
+    if (MSBit != ES_GetMSBitSet32(Counter))
+    {
+      printf("ES_GetMSBitSet32 disagrees for %u\n\r", Counter);
+    }
+  }
+
+  // Compare the cost of the scheduler's highest priority lookup for the
+  // nybble walk and the clz versions. This is only the lookup: the post and
+  // the dispatch also take a critical region each for the Ready updates,
+  // which isn't timed here, make bench in HostPort times the whole round
+  // trip with each lookup. Times are in core timer ticks (2 SYSCLKs each),
+  // the loop overhead is the same for both and is included in both numbers.
+  {
+    volatile uint8_t Sink; // keep the optimizer from removing the calls
+    uint32_t  StartTime;
+    uint32_t  NybbleTicks = 0;
+    uint32_t  ClzTicks    = 0;
+    uint8_t   Pass;
+
+    for (Pass = 0; Pass < TIMING_PASSES; Pass++)
+    {
+      StartTime = _CP0_GET_COUNT();
+      for (Counter = 1; Counter != 0; Counter++)
+      {
+        Sink = ES_GetMSBitSet(Counter);
+      }
+      NybbleTicks += _CP0_GET_COUNT() - StartTime;
+
+      StartTime = _CP0_GET_COUNT();
+      for (Counter = 1; Counter != 0; Counter++)
+      {
+        Sink = ES_GetMSBitSet32(Counter);
+      }
+      ClzTicks += _CP0_GET_COUNT() - StartTime;
+    }
+    printf("nybble walk: %lu ticks per 1000 lookups\n\r",
+        (unsigned long)(NybbleTicks / (TIMING_PASSES * 65535UL / 1000)));
+    printf("clz        : %lu ticks per 1000 lookups\n\r",
+        (unsigned long)(ClzTicks / (TIMING_PASSES * 65535UL / 1000)));
   }
 }
 
@@ -13,6 +13,28 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 05:40 ahb     _HW_GetCycleCount64 moves CountHalves on itself, so
+                        the 64 bit clock keeps going with the tick off
+ 10/17/26 03:40 ahb     an early wake from a stretched idle wait clears
+                        CTIF after moving the compare back
+ 10/17/26 01:20 ahb     ES_TICK_OVERRUN is published at most once every
+                        ES_TICK_OVERRUN_HOLDOFF ticks
+ 10/17/26 00:10 ahb     the tick interrupt keeps the missed tick and lateness
+                        stats, _HW_Process_Pending_Ints publishes
+                        ES_TICK_OVERRUN. intsThatShouldHaveHappened is 16
+                        bits so that a long hold off can't wrap it
+ 10/16/26 23:40 ahb     ES_MEASURE_CRITICAL is replaced by the profiler, the
+                        tick ISR is profiled
+ 10/16/26 23:10 ahb     critical regions raise the IPL to ES_CRITICAL_IPL
+                        and nest, the compare is reprogrammed with all
+                        interrupts off, added ES_MEASURE_CRITICAL
+ 10/16/26 22:10 ahb     added the tickless mode and a count of tick interrupts
+ 10/16/26 20:10 ahb     added _HW_GetCycleCount64, kept up to date by the tick
+ 10/16/26 19:40 ahb     pending ticks go to ES_Timer_AdvanceTicks in one call
+ 10/16/26 11:30 ahb     added the scheduler software interrupt for the
+                        preemptive kernel
+ 10/16/26 10:40 ahb     added _HW_IdleWait, stretched compare handling in the
+                        tick interrupt and the idle statistics
  08/06/21 15:43 jec     no changes just a test of using GIT from within MPLABX
  08/06/21 13:04 jec     cleaned things up in preparation for the 2021 AY
  10/05/20 18:52 ram     started work on port to PIC32MX170F256B
@@ -69,10 +91,13 @@
 
 #include <stdint.h>         // for exact size data types
 #include <stdbool.h>        // for the bool data type
+#include <string.h>         // for memset
 
 #include "ES_Port.h"        // the header file for this module
 #include "ES_Types.h"       // framework type definitions
 #include "ES_Timers.h"      // framework timer prototypes
+#include "ES_Framework.h"   // for ES_ScheduleFromISR
+#include "ES_LookupTables.h" // for ES_GetMSBitSet32
 
 #include "terminal.h"       // terminal prototypes for init function
 
@@ -83,7 +108,8 @@
 // need to post events from the interrupt response routine. This is necessary
 // for compilers like HTC for the midrange PICs which do not produce re-entrant
 // code so cannot post directly to the queues from within the interrupt resp.
-static volatile uint8_t TickCount;
+// In tickless mode it can be thousands of ticks, so it is 16 bits.
+static volatile uint16_t TickCount;
 
 // Global tick count to monitor number of SysTick Interrupts
 // make uint16_t to maintain backwards compatibility and not overly burden
@@ -94,14 +120,87 @@ static volatile uint16_t SysTickCounter = 0;
 // ensure the interrupts occur periodically
 static volatile TimerRate_t tickPeriod; 
 
+// The number of times the core timer has passed a multiple of 2^31 counts,
+// which is what extends it to 64 bits. The tick interrupt brings it up to
+// date with a single store and each _HW_GetCycleCount64 with an ll/sc
+// compare and swap, so reading it never needs to turn interrupts off, see
+// the notes there.
+static volatile uint32_t CountHalves;
+
+#ifdef ES_USE_IDLE_WAIT
+// When _HW_IdleWait pushes the compare out past the next tick, this holds
+// the number of ticks that the stretched compare stands for. The tick
+// interrupt uses it to credit all of them when the compare is reached.
+static volatile uint8_t StretchedTicks;
+
+static ES_IdleStats_t IdleStats;
+#endif
+
+#ifdef ES_USE_TICKLESS
+// the core timer count at the last tick that has been counted. The ticks
+// since then are only counted when they are needed, see CountElapsedTicks
+static volatile uint32_t LastTick;
+#endif
+
 // This variable is used to store the state of the interrupt mask when
-// doing EnterCritical/ExitCritical pairs
-// uint8_t _INTCON_temp;
+// doing EnterCritical/ExitCritical pairs: the Status register at the
+// outermost EnterCritical, and how deeply they are nested
+volatile uint32_t _HW_CriticalStatus;
+volatile uint8_t _HW_CriticalNesting;
 
+#ifdef ES_USE_TICK_STATS
+// kept by the tick interrupt, read with _HW_GetTickStats
+static ES_TickStats_t TickStats;
+// the most ticks missed by one interrupt since ES_TICK_OVERRUN was last
+// published, 0 if none has reached ES_TICK_OVERRUN_THRESHOLD
+static volatile uint16_t OverrunTicks;
+// _HW_GetTickCount when ES_TICK_OVERRUN was last published
+static uint16_t LastOverrunTime;
+#endif
 
 /****************************************************************************
  * Module Level defines
  ***************************************************************************/
+// the minimum number of core timer counts that must remain between 'now'
+// and a newly programmed compare value, see the notes in the tick handler.
+// Not even the ISRs above ES_CRITICAL_IPL may come in between working out
+// a compare value and programming it, so that is done with all interrupts
+// off.
+#define MIN_COMPARE_LEAD 12
+
+// the IPL field of the Status register for a critical region
+#define CRITICAL_IPL_BITS ((uint32_t)ES_CRITICAL_IPL << _CP0_STATUS_IPL_POSITION)
+
+#if (ES_CRITICAL_IPL < 3) || (ES_CRITICAL_IPL > 7)
+#error "ES_CRITICAL_IPL must be at least the tick's IPL3, and at most 7"
+#endif
+
+#if defined(ES_USE_IDLE_WAIT) && (ES_IDLE_MAX_TICKS >= 200)
+#error "ES_IDLE_MAX_TICKS must be less than 200"
+#endif
+
+#ifdef ES_USE_TICKLESS
+#ifndef ES_USE_IDLE_WAIT
+#error "ES_USE_TICKLESS needs ES_USE_IDLE_WAIT"
+#endif
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+#error "ES_USE_TICKLESS needs the cooperative ES_Run"
+#endif
+#if ES_TICKLESS_MAX_TICKS > 21474
+#error "ES_TICKLESS_MAX_TICKS must be at most 21474"
+#endif
+
+static void CountElapsedTicks(void);
+static uint16_t GetTicksToCompare(void);
+static void SetTickCompare(uint16_t Ticks);
+#endif
+
+#ifdef ES_USE_IDLE_WAIT
+static uint32_t WaitForInterrupt(void);
+#endif
+#ifdef ES_USE_TICK_STATS
+static void RecordTickInt(uint32_t Lateness, uint16_t CatchUp);
+#endif
 
 //#define LED_DEBUG
 /****************************************************************************
@@ -157,6 +256,9 @@ void _HW_Timer_Init(const TimerRate_t Rate)
         
     // get the current sys clock time
     uint32_t currTime = _CP0_GET_COUNT();
+#ifdef ES_USE_TICKLESS
+    LastTick = currTime;
+#endif
     // add the rate to i1t         
     // place value into compare register
     _CP0_SET_COMPARE(currTime + Rate);
@@ -202,19 +304,41 @@ void _HW_Timer_Init(const TimerRate_t Rate)
 ****************************************************************************/
 void __ISR(_CORE_TIMER_VECTOR, IPL3AUTO ) _HW_SysTickIntHandler(void)
 {
+#ifndef ES_USE_TICKLESS
   static uint32_t deltaTime; // static for speed
-  static uint8_t intsThatShouldHaveHappened;
+  static uint16_t intsThatShouldHaveHappened;
+  uint32_t IntState;
+#endif
+#ifdef ES_USE_TICK_STATS
+  uint32_t Lateness;
+  uint16_t CatchUp = 1;
+#endif
+  ES_PROFILE_ISR_ENTER();
   
   // clear interrupt flag using the atomic write to the CLR version of the
   // interrupt flag register
   IFS0CLR = _IFS0_CTIF_MASK;
   
-  // we create a critical region here in case a higher priority interrupt
+#ifdef ES_USE_TICKLESS
+  // the compare was set for the first timer to expire. Count the ticks up
+  // to here and leave it as far out as it goes, _HW_Process_Pending_Ints
+  // will set it for the next expiry once it has handed these ticks over.
+#ifdef ES_USE_TICK_STATS
+  Lateness = _CP0_GET_COUNT() - _CP0_GET_COMPARE();
+#endif
+  EnterCritical();
+  CountElapsedTicks();
+  SetTickCompare(ES_TICKLESS_MAX_TICKS);
+  ExitCritical();
+#else
+  // we turn all interrupts off here in case a higher priority interrupt
   // occurred between the calculation of deltaTime and the test & re-programming
   // of the compare register. If that happened, we could end up programming the 
   // compare for a time that had already passed, resulting in a loss of 
-  // tick interrupts until the CoreTimer rolled around.
-  EnterCritical();
+  // tick interrupts until the CoreTimer rolled around. A critical region
+  // wouldn't hold off the ISRs above ES_CRITICAL_IPL.
+  IntState = __builtin_disable_interrupts();
+  ES_PROFILE_BEGIN(IntsOff);
   // get the time difference since the interrupt
   deltaTime = _CP0_GET_COUNT() - _CP0_GET_COMPARE();
   
@@ -253,15 +377,44 @@ void __ISR(_CORE_TIMER_VECTOR, IPL3AUTO ) _HW_SysTickIntHandler(void)
     _CP0_SET_COMPARE(_CP0_GET_COMPARE() + 
       (intsThatShouldHaveHappened * tickPeriod));
   }// end if (deltaTime < tickPeriod - 12)
-  ExitCritical();
-  // and keep our tick counters going
+#ifdef ES_USE_TICK_STATS
+  // before the stretched ticks are added, they weren't missed
+  Lateness = deltaTime;
+  CatchUp = intsThatShouldHaveHappened;
+#endif
+#ifdef ES_USE_IDLE_WAIT
+  // if the compare had been stretched by _HW_IdleWait, it stood for
+  // StretchedTicks ticks rather than 1
+  if (StretchedTicks != 0)
+  {
+    intsThatShouldHaveHappened += StretchedTicks - 1;
+    StretchedTicks = 0;
+  }
+#endif
+  ES_PROFILE_END(IntsOff);
+  _CP0_SET_STATUS(IntState);
+  // keep our tick counters going
   TickCount += intsThatShouldHaveHappened;
   SysTickCounter += intsThatShouldHaveHappened;
+#endif /* ES_USE_TICKLESS */
+#ifdef ES_USE_TICK_STATS
+  RecordTickInt(Lateness, CatchUp);
+#endif
+  // keep the 64 bit clock's view of the core timer current
+  CountHalves = (uint32_t)(_HW_GetCycleCount64() >> 31);
+#ifdef ES_USE_IDLE_WAIT
+  IdleStats.NumTickInts++;
+#endif
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  // the timers are run from the scheduler interrupt, ahead of the services
+  _HW_RequestSchedule();
+#endif
 
 #ifdef LED_DEBUG
   // Toggle debug line
   LATBbits.LATB15 = ~LATBbits.LATB15;
 #endif
+  ES_PROFILE_ISR_EXIT();
 }
 
 /****************************************************************************
@@ -275,13 +428,195 @@ void __ISR(_CORE_TIMER_VECTOR, IPL3AUTO ) _HW_SysTickIntHandler(void)
     wrapper for access to SysTickCounter, needed to move increment of tick
     counter to this module to keep the timer ticking during blocking code
  Notes
-
+    in tickless mode the ticks since the last one counted are worked out
+    from the core timer, the read is tried again if the tick interrupt
+    counts some in the middle of it
  Author
     Ed Carryer, 10/27/14 13:55
 ****************************************************************************/
 uint16_t _HW_GetTickCount(void)
 {
+#ifdef ES_USE_TICKLESS
+  uint16_t Ticks;
+  uint32_t SinceLastTick;
+
+  if (tickPeriod == ES_Timer_RATE_OFF)
+  {
+    return SysTickCounter;
+  }
+  do
+  {
+    Ticks = SysTickCounter;
+    SinceLastTick = _CP0_GET_COUNT() - LastTick;
+  } while (Ticks != SysTickCounter);
+  return Ticks + (uint16_t)(SinceLastTick / tickPeriod);
+#else
   return SysTickCounter;
+#endif
+}
+
+#ifdef ES_USE_TICKLESS
+/****************************************************************************
+ Function
+    _HW_TakeElapsedTicks
+ Parameters
+    none
+ Returns
+    uint16_t   the ticks that have passed since the timers were last told
+ Description
+    counts the ticks up to now and hands over all of the ones that have
+    not yet gone to ES_Timer_AdvanceTicks
+ Notes
+    tickless mode only. ES_Timers calls it before it starts or stops a
+    timer, so that the timer counts from now and not from the last tick
+    that was processed.
+ Author
+    A. Brown, 10/16/26
+****************************************************************************/
+uint16_t _HW_TakeElapsedTicks(void)
+{
+  uint16_t NumTicks;
+
+  if (tickPeriod == ES_Timer_RATE_OFF)
+  {
+    return 0;
+  }
+  EnterCritical();
+  CountElapsedTicks();
+  NumTicks = TickCount;
+  TickCount = 0;
+  ExitCritical();
+  return NumTicks;
+}
+
+#endif /* ES_USE_TICKLESS */
+
+/****************************************************************************
+ Function
+    _HW_GetCycleCount64
+ Parameters
+    none
+ Returns
+    uint64_t   the core timer, extended to 64 bits so that it never wraps
+ Description
+    the clock behind ES_Time_Now. Safe to call from tasks and from ISRs at
+    any priority, and never disables interrupts.
+ Notes
+    CountHalves is the number of half turns of the core timer as of the last
+    tick. Bit 31 of the count tells us whether another half turn has gone by
+    since then, which is all the tick can be behind by, so a CountHalves read
+    either side of the tick's store gives the same answer. A read that sees
+    the half turn moves CountHalves on itself, if no one has beaten it to
+    it, so the clock is kept up by its readers as well as by the tick. It
+    only needs a tick or a read at least every 2^31 counts (107s), which
+    holds with the tick off (ES_Timer_RATE_OFF) too, as long as something
+    reads the time that often.
+ Author
+    A. Brown, 10/16/26
+****************************************************************************/
+uint64_t _HW_GetCycleCount64(void)
+{
+  uint32_t Halves = CountHalves;
+  uint32_t Count = _CP0_GET_COUNT();
+
+  if (((Halves ^ (Count >> 31)) & 1) != 0)
+  {
+    Halves++;
+    // only from the value we read, so a reader that was held off can't
+    // move it back
+    (void)__sync_bool_compare_and_swap(&CountHalves, Halves - 1, Halves);
+  }
+  return ((uint64_t)(Halves >> 1) << 32) | Count;
+}
+
+/****************************************************************************
+ Function
+     _HW_EnterCritical
+ Parameters
+     none
+ Returns
+     none
+ Description
+     EnterCritical. Raises the CPU's IPL to ES_CRITICAL_IPL, unless it is
+     already there or above, and if this is the outermost critical region
+     saves the Status register it found for _HW_ExitCritical.
+ Notes
+     An interrupt at or below ES_CRITICAL_IPL can only be taken while no
+     critical region is open, so one save slot is enough for every context
+     that can be in one. ISRs above ES_CRITICAL_IPL must not call this.
+     An interrupt between the read and the write of Status returns with
+     Status as it found it, so the write does not lose anything.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_EnterCritical(void)
+{
+  uint32_t Status = _CP0_GET_STATUS();
+
+  if ((Status & _CP0_STATUS_IPL_MASK) < CRITICAL_IPL_BITS)
+  {
+    _CP0_SET_STATUS((Status & ~_CP0_STATUS_IPL_MASK) | CRITICAL_IPL_BITS);
+    __asm__ volatile ("ehb");
+  }
+  if (_HW_CriticalNesting++ == 0)
+  {
+    _HW_CriticalStatus = Status;
+  }
+}
+
+/****************************************************************************
+ Function
+     _HW_ExitCritical
+ Parameters
+     none
+ Returns
+     none
+ Description
+     ExitCritical. Leaving the outermost critical region puts back the IPL
+     that _HW_EnterCritical found, inner ones leave it raised.
+ Notes
+     only the IPL is put back. The IE bit belongs to whoever last turned
+     interrupts on or off.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_ExitCritical(void)
+{
+  if (_HW_CriticalNesting == 0)
+  {
+    return; // not in a critical region
+  }
+  if (--_HW_CriticalNesting == 0)
+  {
+    _CP0_SET_STATUS((_CP0_GET_STATUS() & ~_CP0_STATUS_IPL_MASK) |
+        (_HW_CriticalStatus & _CP0_STATUS_IPL_MASK));
+  }
+}
+
+/****************************************************************************
+ Function
+     _HW_InISR
+ Parameters
+     none
+ Returns
+     bool : true when called from an ISR
+ Description
+     any IPL above 0 means an ISR. In a critical region the IPL is
+     ES_CRITICAL_IPL whoever we are, so there it is the IPL the region was
+     entered from that counts.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool _HW_InISR(void)
+{
+  uint32_t Status = _CP0_GET_STATUS();
+
+  if ((_HW_CriticalNesting != 0) &&
+      ((Status & _CP0_STATUS_IPL_MASK) == CRITICAL_IPL_BITS))
+  {
+    Status = _HW_CriticalStatus;
+  }
+  return (Status & _CP0_STATUS_IPL_MASK) != 0;
 }
 
 /****************************************************************************
@@ -307,17 +642,473 @@ uint16_t _HW_GetTickCount(void)
 ****************************************************************************/
 bool _HW_Process_Pending_Ints(void)
 {
+  uint16_t NumTicks;
+#ifdef ES_USE_TICK_STATS
+  ES_Event_t ThisEvent;
+#endif
+
+#ifdef ES_USE_TICKLESS
+  if (tickPeriod == ES_Timer_RATE_OFF)
+  {
+    return true;
+  }
+  NumTicks = _HW_TakeElapsedTicks();
+  if (NumTicks != 0)
+  {
+    ES_Timer_AdvanceTicks(NumTicks);
+  }
+  // the timers may have been started, stopped or expired since the compare
+  // was last set, so set it again for the first one to expire
+  EnterCritical();
+  CountElapsedTicks();
+  SetTickCompare(GetTicksToCompare());
+  ExitCritical();
+#else
   // in the case where there was a long delay in getting to this function,
   // multiple interrupts may have occurred (TickCount > 1), so process them all
-  while (TickCount > 0)
+  if (TickCount > 0)
   {
+    EnterCritical();
+    NumTicks = TickCount;
+    TickCount = 0;
+    ExitCritical();
     /* call the framework tick response to actually run the timers */
-    ES_Timer_Tick_Resp();
-    TickCount--;
+    ES_Timer_AdvanceTicks(NumTicks);
   }
+#endif /* ES_USE_TICKLESS */
+#ifdef ES_USE_TICK_STATS
+  // the tick interrupt can't publish, it is left to us. Overruns inside the
+  // holdoff are kept in OverrunTicks for the next one.
+  if ((OverrunTicks != 0) && ((uint16_t)(_HW_GetTickCount() -
+      LastOverrunTime) >= ES_TICK_OVERRUN_HOLDOFF))
+  {
+    LastOverrunTime = _HW_GetTickCount();
+    EnterCritical();
+    ThisEvent.EventParam = OverrunTicks;
+    OverrunTicks = 0;
+    ExitCritical();
+    ThisEvent.EventType = ES_TICK_OVERRUN;
+    ES_Publish(ThisEvent);
+  }
+#endif
   return true;  // always return true to allow loop test in ES_Run to proceed
 }
 
+#ifdef ES_USE_IDLE_WAIT
+/****************************************************************************
+ Function
+     _HW_IdleWait
+ Parameters
+     none
+ Returns
+     none
+ Description
+     puts the core into Idle mode with the MIPS wait instruction until the
+     next interrupt. The core timer compare is first moved out to the next
+     ES_Timers expiry (capped at ES_IDLE_MAX_TICKS) so that we are not woken
+     on every tick just to decrement timers.
+ Notes
+     Must be called in a critical region, after the caller has checked
+     that there is nothing to do. On the PIC32 an enabled interrupt with a
+     priority above the CPU IPL still wakes the core from wait when interrupts
+     are globally disabled; execution just continues after the wait and the
+     interrupt is taken when the caller re-enables interrupts. That closes
+     the window between the final 'is there work' test and the wait, see
+     WaitForInterrupt.
+     OSCCON.SLPEN must be 0 (the reset value) so that wait selects Idle, not
+     Sleep, and the core timer & peripherals keep running.
+     In tickless mode the compare is kept at the first expiry all of the
+     time, so there is nothing to stretch.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_IdleWait(void)
+{
+#ifdef ES_USE_TICKLESS
+  uint32_t LastTick4Wait;
+#else
+  uint16_t TicksToSleep;
+  uint32_t LastTick;
+  uint32_t Elapsed;
+#endif
+  uint32_t WakeTime;
+  uint32_t IntState;
+
+#ifdef ES_USE_TICKLESS
+  if (tickPeriod == ES_Timer_RATE_OFF)
+  {
+    return;
+  }
+  // the compare is already at the first expiry, unless a timer was started
+  // since _HW_Process_Pending_Ints set it
+  CountElapsedTicks();
+  if (TickCount != 0)
+  {
+    return;
+  }
+  SetTickCompare(GetTicksToCompare());
+  LastTick4Wait = LastTick;
+  Terminal_EnableRxWake();
+
+  IntState = WaitForInterrupt();
+
+  WakeTime = _CP0_GET_COUNT();
+  IdleStats.NumWaits++;
+  IdleStats.TicksSlept += (WakeTime - LastTick4Wait) / tickPeriod;
+  if ((int32_t)(WakeTime - _CP0_GET_COMPARE()) >= 0)
+  {
+    IdleStats.LastWakeLatency = WakeTime - _CP0_GET_COMPARE();
+    if (IdleStats.LastWakeLatency > IdleStats.MaxWakeLatency)
+    {
+      IdleStats.MaxWakeLatency = IdleStats.LastWakeLatency;
+    }
+  }
+#else
+  // don't go to sleep with tick processing still pending
+  if ((TickCount != 0) || (tickPeriod == ES_Timer_RATE_OFF))
+  {
+    return;
+  }
+  TicksToSleep = ES_Timer_GetTicksToNextExpiry();
+  if ((TicksToSleep == ES_Timer_NONE_ACTIVE) ||
+      (TicksToSleep > ES_IDLE_MAX_TICKS))
+  {
+    TicksToSleep = ES_IDLE_MAX_TICKS;
+  }
+  // the compare currently holds the time of the next tick
+  LastTick = _CP0_GET_COMPARE() - tickPeriod;
+  if (TicksToSleep > 1)
+  {
+    _CP0_SET_COMPARE(LastTick + (TicksToSleep * tickPeriod));
+    StretchedTicks = TicksToSleep;
+  }
+  // a UART RX interrupt is only used to wake us up, Check4Keystroke will
+  // read the character
+  Terminal_EnableRxWake();
+
+  IntState = WaitForInterrupt();
+
+  WakeTime = _CP0_GET_COUNT();
+  IdleStats.NumWaits++;
+  if ((int32_t)(WakeTime - _CP0_GET_COMPARE()) >= 0)
+  {
+    // woken by the (possibly stretched) tick. The tick interrupt is
+    // pending and will credit the ticks as soon as interrupts are enabled
+    IdleStats.TicksSlept += TicksToSleep;
+    IdleStats.LastWakeLatency = WakeTime - _CP0_GET_COMPARE();
+    if (IdleStats.LastWakeLatency > IdleStats.MaxWakeLatency)
+    {
+      IdleStats.MaxWakeLatency = IdleStats.LastWakeLatency;
+    }
+  }
+  else if (StretchedTicks != 0)
+  {
+    // woken early by some other interrupt, so account for the ticks that
+    // have passed and put the compare back on the next tick boundary
+    Elapsed = (WakeTime - LastTick) / tickPeriod;
+    if (((LastTick + ((Elapsed + 1) * tickPeriod)) - WakeTime) <
+        MIN_COMPARE_LEAD)
+    {
+      Elapsed++; // too close to the next boundary to program it safely
+    }
+    _CP0_SET_COMPARE(LastTick + ((Elapsed + 1) * tickPeriod));
+    // the stretched compare may have matched after WakeTime was read. The
+    // ticks up to it are credited here, so drop the latched flag, or the
+    // tick interrupt would run with COUNT still short of the new compare
+    IFS0CLR = _IFS0_CTIF_MASK;
+    StretchedTicks = 0;
+    TickCount += Elapsed;
+    SysTickCounter += Elapsed;
+    IdleStats.TicksSlept += Elapsed;
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+    if (Elapsed != 0)
+    {
+      _HW_RequestSchedule(); // get these ticks processed
+    }
+#endif
+  }
+#endif /* ES_USE_TICKLESS */
+  _CP0_SET_STATUS(IntState);
+#ifdef ES_USE_PROFILER
+  // the wait doesn't hold anything off, the caller's region starts again
+  ES_Profile_RestartCritical();
+#endif
+}
+
+/****************************************************************************
+ Function
+     _HW_GetIdleStats
+ Parameters
+     ES_IdleStats_t * : where to copy the counters
+ Returns
+     none
+ Description
+     copies out the idle counters. NumWaits sampled a known time apart gives
+     the idle loop wakeups/sec, NumTickInts the tick interrupts/sec, the
+     latencies are in core timer counts
+     (50ns each at 40MHz)
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_GetIdleStats(ES_IdleStats_t *pStats)
+{
+  EnterCritical();
+  *pStats = IdleStats;
+  ExitCritical();
+}
+
+#endif /* ES_USE_IDLE_WAIT */
+#ifdef ES_USE_TICK_STATS
+/****************************************************************************
+ Function
+     _HW_GetTickStats
+ Parameters
+     ES_TickStats_t * : where to copy the stats
+ Returns
+     none
+ Description
+     copies out the missed tick counts and the tick interrupt's lateness,
+     in core timer counts (50ns each)
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+void _HW_GetTickStats(ES_TickStats_t *pStats)
+{
+  EnterCritical();
+  *pStats = TickStats;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     _HW_ClearTickStats
+ Parameters
+     none
+ Returns
+     none
+ Description
+     starts the tick stats over
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+void _HW_ClearTickStats(void)
+{
+  EnterCritical();
+  memset(&TickStats, 0, sizeof(TickStats));
+  ExitCritical();
+}
+
+#endif /* ES_USE_TICK_STATS */
+#ifdef ES_USE_IDLE_WAIT
+
+/****************************************************************************
+ Function
+     WaitForInterrupt
+ Description
+     executes wait, returning once an interrupt that could give ES_Run some
+     work is pending, with all interrupts off. Returns the Status register
+     to put back once the caller has finished with the compare.
+ Notes
+     called in a critical region. That left the IPL at ES_CRITICAL_IPL,
+     which would keep the tick and every other interrupt at or below it
+     from waking us, so the wait is made at the IPL that ES_Run was at,
+     with interrupts turned off globally instead.
+****************************************************************************/
+static uint32_t WaitForInterrupt(void)
+{
+  uint32_t IntState = __builtin_disable_interrupts();
+
+  _CP0_SET_STATUS((IntState & ~(_CP0_STATUS_IPL_MASK | _CP0_STATUS_IE_MASK)) |
+      (_HW_CriticalStatus & _CP0_STATUS_IPL_MASK));
+  __asm__ volatile ("ehb");
+  __asm__ volatile ("wait");
+  // back to the critical region's IPL, still with interrupts off
+  _CP0_SET_STATUS(IntState & ~_CP0_STATUS_IE_MASK);
+  __asm__ volatile ("ehb");
+  return IntState;
+}
+
+#endif /* ES_USE_IDLE_WAIT */
+#ifdef ES_USE_TICKLESS
+/****************************************************************************
+ Function
+     CountElapsedTicks
+ Description
+     counts the ticks that have passed since LastTick, in TickCount and
+     SysTickCounter, and moves LastTick up to the last of them
+ Notes
+     called with interrupts disabled
+****************************************************************************/
+static void CountElapsedTicks(void)
+{
+  uint32_t Elapsed = (_CP0_GET_COUNT() - LastTick) / tickPeriod;
+
+  LastTick += Elapsed * tickPeriod;
+  TickCount += Elapsed;
+  SysTickCounter += Elapsed;
+}
+
+/****************************************************************************
+ Function
+     GetTicksToCompare
+ Description
+     the ticks from LastTick to the tick the compare should be set for: the
+     first timer's expiry, capped at ES_TICKLESS_MAX_TICKS, or the next tick
+     if there are counted ticks still to be handed over
+ Notes
+     called with interrupts disabled, just after CountElapsedTicks
+****************************************************************************/
+static uint16_t GetTicksToCompare(void)
+{
+  uint16_t Ticks = ES_Timer_GetTicksToNextExpiry();
+
+  if (TickCount != 0)
+  {
+    return 1;
+  }
+  if ((Ticks == ES_Timer_NONE_ACTIVE) || (Ticks > ES_TICKLESS_MAX_TICKS))
+  {
+    Ticks = ES_TICKLESS_MAX_TICKS;
+  }
+  return Ticks;
+}
+
+/****************************************************************************
+ Function
+     SetTickCompare
+ Description
+     sets the compare for the tick Ticks on from LastTick, or the one after
+     that if it is too close to be sure of catching
+ Notes
+     called in a critical region, just after CountElapsedTicks. The test
+     and the write are made with all interrupts off. That
+     leaves LastTick less than a tick behind, so only the next tick can be
+     too close and one step on is always enough.
+****************************************************************************/
+static void SetTickCompare(uint16_t Ticks)
+{
+  uint32_t Compare = LastTick + ((uint32_t)Ticks * tickPeriod);
+  uint32_t IntState = __builtin_disable_interrupts();
+
+  if ((int32_t)(Compare - _CP0_GET_COUNT()) < MIN_COMPARE_LEAD)
+  {
+    Compare += tickPeriod;
+  }
+  _CP0_SET_COMPARE(Compare);
+  _CP0_SET_STATUS(IntState);
+}
+
+#endif /* ES_USE_TICKLESS */
+#ifdef ES_USE_TICK_STATS
+/****************************************************************************
+ Function
+     RecordTickInt
+ Description
+     adds a tick interrupt, which ran Lateness counts after its compare
+     match and counted CatchUp ticks, to TickStats. More than one tick is
+     a miss, and enough of them an overrun for _HW_Process_Pending_Ints to
+     publish.
+ Notes
+     called from the tick interrupt, which nothing else that writes
+     TickStats or OverrunTicks can interrupt
+****************************************************************************/
+static void RecordTickInt(uint32_t Lateness, uint16_t CatchUp)
+{
+  uint8_t Bucket = 0;
+
+  if (Lateness != 0)
+  {
+    Bucket = ES_GetMSBitSet32(Lateness);
+    if (Bucket >= ES_TICK_LATE_BUCKETS)
+    {
+      Bucket = ES_TICK_LATE_BUCKETS - 1;
+    }
+  }
+  if (TickStats.LateBuckets[Bucket] != UINT16_MAX)
+  {
+    TickStats.LateBuckets[Bucket]++;
+  }
+  if (Lateness > TickStats.MaxLateness)
+  {
+    TickStats.MaxLateness = Lateness;
+  }
+  if (CatchUp > TickStats.MaxCatchUp)
+  {
+    TickStats.MaxCatchUp = CatchUp;
+  }
+  if (CatchUp > 1)
+  {
+    TickStats.NumMissedTicks += CatchUp - 1;
+    if ((CatchUp - 1) >= ES_TICK_OVERRUN_THRESHOLD)
+    {
+      TickStats.NumOverruns++;
+      if ((CatchUp - 1) > OverrunTicks)
+      {
+        OverrunTicks = CatchUp - 1;
+      }
+    }
+  }
+}
+
+#endif /* ES_USE_TICK_STATS */
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+/****************************************************************************
+ Function
+     _HW_SchedulerInit
+ Parameters
+     none
+ Returns
+     none
+ Description
+     sets up core software interrupt 0 as the scheduler interrupt for the
+     preemptive kernel. It is at IPL1, below every hardware interrupt, so it
+     only runs once the last nested ISR has returned.
+ Notes
+     called from ES_Run, after all of the services have been initialized
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_SchedulerInit(void)
+{
+  IEC0CLR = _IEC0_CS0IE_MASK;
+  IPC0bits.CS0IP = 1;
+  IPC0bits.CS0IS = 0;
+  IFS0CLR = _IFS0_CS0IF_MASK;
+  IEC0SET = _IEC0_CS0IE_MASK;
+  // any ticks that came in during initialization
+  _HW_RequestSchedule();
+}
+
+/****************************************************************************
+ Function
+     _HW_SchedulerIntHandler
+ Parameters
+     none
+ Returns
+     none
+ Description
+     the scheduler interrupt. Drops the CPU priority to 0 and then lets the
+     framework process the tick and run any services that were made ready by
+     ISRs.
+ Notes
+     with the IPL at 0 the services run exactly as they would from ES_Run:
+     every interrupt, including a new request for this one, can preempt
+     them. The prologue has already saved the Status register, so the
+     epilogue puts the IPL back before returning to whatever we interrupted.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void __ISR(_CORE_SOFTWARE_0_VECTOR, IPL1SOFT) _HW_SchedulerIntHandler(void)
+{
+  // the request is the IP0 bit in the Cause register, clear it along with
+  // the flag or we will be right back here
+  _CP0_BIC_CAUSE(_CP0_CAUSE_IP0_MASK);
+  IFS0CLR = _IFS0_CS0IF_MASK;
+  _CP0_SET_STATUS(_CP0_GET_STATUS() & ~_CP0_STATUS_IPL_MASK);
+  ES_ScheduleFromISR();
+}
+
+#endif /* ES_USE_PREEMPTIVE_KERNEL */
 /****************************************************************************
  Function
      _HW_ConsoleInit
@@ -2,13 +2,19 @@
  Module
      EF_PostList.c
  Description
-     source file for the module to post events to lists of state
-     machines
+     source file for the module to publish events to the services that have
+     subscribed to them
  Notes
+     The subscriptions are kept as one set of services for each event type,
+     initialized from SUBSCRIPTION_TABLE in ES_Configure.h. Publishing an
+     event only enqueues it for the subscribers, unlike ES_PostAll which
+     puts a copy in every service's queue.
 
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/16/26 12:10 ahb     replaced the distribution lists with a subscription
+                        table and ES_Publish/ES_Subscribe/ES_Unsubscribe
  10/26/17 18:20 jec     moved prototype of PostToList into the conditional to
                         eliminate warning when not using distribution lists
  08/05/13 15:04 jec      added #includes for ES_Port & ES_Types and converted
@@ -22,178 +28,122 @@
 #include "../FrameworkHeaders/ES_Types.h"
 #include "../FrameworkHeaders/ES_Configure.h"
 #include "../FrameworkHeaders/ES_General.h"
+#include "../FrameworkHeaders/ES_Framework.h"
+#include "../FrameworkHeaders/ES_LookupTables.h"
 #include "../FrameworkHeaders/ES_PostList.h"
-#include "../FrameworkHeaders/ES_ServiceHeaders.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// expands an entry in SUBSCRIPTION_TABLE into a designated initializer
+#define SUBSCRIPTION_ENTRY(Event, Services) [Event] = (Services),
+
+// one bit per service, so the services must fit in an ES_ServiceSet_t
+ES_STATIC_ASSERT(NUM_SERVICES <= (sizeof(ES_ServiceSet_t) * BITS_PER_BYTE),
+    too_many_services_for_ES_ServiceSet_t);
 
 /*---------------------------- Module Functions ---------------------------*/
 
 /*---------------------------- Module Variables ---------------------------*/
-// Fill in these arrays with the lists of posting funcitons for the state
-// machines that will have common events delivered to them.
-
-#if NUM_DIST_LISTS > 0
-static bool PostToList(PostFunc_t *const *FuncList, uint8_t ListSize, ES_Event_t NewEvent);
-static PostFunc_t *const DistList00[] = {
-  DIST_LIST0
-};
-// the endif for NUM_DIST_LISTS > 0 is at the end of the file
-#if NUM_DIST_LISTS > 1
-static PostFunc_t *const DistList01[] = {
-  DIST_LIST1
-};
-#endif
-#if NUM_DIST_LISTS > 2
-static PostFunc_t *const DistList02[] = {
-  DIST_LIST2
-};
-#endif
-#if NUM_DIST_LISTS > 3
-static PostFunc_t *const DistList03[] = {
-  DIST_LIST3
-};
-#endif
-#if NUM_DIST_LISTS > 4
-static PostFunc_t *const DistList04[] = {
-  DIST_LIST4
-};
-#endif
-#if NUM_DIST_LISTS > 5
-static PostFunc_t *const DistList05[] = {
-  DIST_LIST5
-};
-#endif
-#if NUM_DIST_LISTS > 6
-static PostFunc_t *const DistList06[] = {
-  DIST_LIST6
-};
-#endif
-#if NUM_DIST_LISTS > 7
-static PostFunc_t *const DistList07[] = {
-  DIST_LIST7
+// the services subscribed to each event type, indexed by ES_EventType_t
+static ES_ServiceSet_t Subscribers[NUM_ES_EVENT_TYPES] =
+{
+  SUBSCRIPTION_TABLE(SUBSCRIPTION_ENTRY)
 };
-#endif
 
 /*------------------------------ Module Code ------------------------------*/
-
-// Each of these list-specific functions is a wrapper that calls the generic
-// function to walk through the list, calling the listed posting functions
-
 /****************************************************************************
  Function
-   PostListxx
+   ES_Publish
  Parameters
-   ES_Event NewEvent : the new event to be passed to each of the state machine
-   posting functions in list xx
+   ES_Event_t ThisEvent : the event to be posted to each of the services
+   subscribed to its type
  Returns
-   bool: true if all the post functions succeeded, false if any failed
+   bool: false if the event type is out of range or any of the posts failed,
+         true otherwise (including when there are no subscribers)
  Description
-   Posts NewEvent to all of the state machines listed in the list
+   Posts ThisEvent to the subscribers, highest priority first
  Notes
-
+   may be called from ISRs, like ES_PostToService
  Author
-   J. Edward Carryer, 10/24/11, 07:48
+   A. Brown, 10/16/26
 ****************************************************************************/
-bool ES_PostList00(ES_Event_t NewEvent)
-{
-  return PostToList(DistList00, ARRAY_SIZE(DistList00), NewEvent);
-}
-
-#if NUM_DIST_LISTS > 1
-bool ES_PostList01(ES_Event_t NewEvent)
-{
-  return PostToList(DistList01, ARRAY_SIZE(DistList01), NewEvent);
-}
-
-#endif
-
-#if NUM_DIST_LISTS > 2
-bool ES_PostList02(ES_Event_t NewEvent)
-{
-  return PostToList(DistList02, ARRAY_SIZE(DistList02), NewEvent);
-}
-
-#endif
-
-#if NUM_DIST_LISTS > 3
-bool ES_PostList03(ES_Event_t NewEvent)
-{
-  return PostToList(DistList03, ARRAY_SIZE(DistList03), NewEvent);
-}
-
-#endif
-
-#if NUM_DIST_LISTS > 4
-bool ES_PostList04(ES_Event_t NewEvent)
-{
-  return PostToList(DistList04, ARRAY_SIZE(DistList04), NewEvent);
-}
-
-#endif
-
-#if NUM_DIST_LISTS > 5
-bool ES_PostList05(ES_Event_t NewEvent)
+bool ES_Publish(ES_Event_t ThisEvent)
 {
-  return PostToList(DistList05, ARRAY_SIZE(DistList05), NewEvent);
-}
+  ES_ServiceSet_t ToPost;
+  uint8_t         WhichService;
+  bool            ReturnVal = true;
 
-#endif
-
-#if NUM_DIST_LISTS > 6
-bool ES_PostList06(ES_Event_t NewEvent)
-{
-  return PostToList(DistList06, ARRAY_SIZE(DistList06), NewEvent);
+  if ((uint16_t)ThisEvent.EventType >= NUM_ES_EVENT_TYPES)
+  {
+    return false;
+  }
+  ToPost = Subscribers[ThisEvent.EventType];
+  while (ToPost != 0)
+  {
+    WhichService = ES_GetMSBitSet32(ToPost);
+    ToPost &= ~ES_SERVICE_BIT(WhichService);
+    if (ES_PostToService(WhichService, ThisEvent) != true)
+    {
+      ReturnVal = false; // keep going so the others still get it
+    }
+  }
+  return ReturnVal;
 }
 
-#endif
-
-#if NUM_DIST_LISTS > 7
-bool ES_PostList07(ES_Event_t NewEvent)
+/****************************************************************************
+ Function
+   ES_Subscribe
+ Parameters
+   uint8_t WhichService : the priority of the service subscribing
+   ES_EventType_t WhichEvent : the event type to subscribe to
+ Returns
+   bool: false if either parameter is out of range
+ Description
+   adds the service to the subscribers for the event type
+ Notes
+   subscribing twice has no extra effect
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Subscribe(uint8_t WhichService, ES_EventType_t WhichEvent)
 {
-  return PostToList(DistList07, ARRAY_SIZE(DistList07), NewEvent);
+  if ((WhichService >= NUM_SERVICES) ||
+      ((uint16_t)WhichEvent >= NUM_ES_EVENT_TYPES))
+  {
+    return false;
+  }
+  EnterCritical();
+  Subscribers[WhichEvent] |= ES_SERVICE_BIT(WhichService);
+  ExitCritical();
+  return true;
 }
 
-#endif
-
-// Implementations for private functions
 /****************************************************************************
  Function
-   PostToList
+   ES_Unsubscribe
  Parameters
-   PostFunc *const*List : pointer to the list of posting functions
-   unsigned char ListSize : number of elements in the list array
-   EF_Event NewEvent : the new event to be passed to each of the state machine
-   posting functions in the list
+   uint8_t WhichService : the priority of the service unsubscribing
+   ES_EventType_t WhichEvent : the event type to unsubscribe from
  Returns
-   bool: true if all the post functions succeeded, false if any failed
+   bool: false if either parameter is out of range
  Description
-   Posts NewEvent to all of the state machines listed in the list
+   removes the service from the subscribers for the event type
  Notes
-
+   events already in the service's queue are not removed
  Author
-   J. Edward Carryer, 10/24/11, 07:52
+   A. Brown, 10/16/26
 ****************************************************************************/
-static bool PostToList(PostFunc_t *const *List, uint8_t ListSize, ES_Event_t NewEvent)
+bool ES_Unsubscribe(uint8_t WhichService, ES_EventType_t WhichEvent)
 {
-  uint8_t i;
-  // loop through the list executing the post functions
-  for (i = 0; i < ListSize; i++)
-  {
-    if (List[i](NewEvent) != true)
-    {
-      break; // this is a failed post
-    }
-  }
-  if (i != ListSize)   // if no failures, i = ListSize
+  if ((WhichService >= NUM_SERVICES) ||
+      ((uint16_t)WhichEvent >= NUM_ES_EVENT_TYPES))
   {
     return false;
   }
-  else
-  {
-    return true;
-  }
+  EnterCritical();
+  Subscribers[WhichEvent] &= ~ES_SERVICE_BIT(WhichService);
+  ExitCritical();
+  return true;
 }
 
-#endif /* NUM_DIST_LISTS > 0*/
-
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,293 @@
+/****************************************************************************
+ Module
+     ES_Profile.c
+
+ Description
+     This is a module implementing the interrupt latency profiler: how long
+     the critical regions hold off the interrupts at or below
+     ES_CRITICAL_IPL, how long each ISR runs and how long the regions that
+     turn interrupts off by hand keep them off, kept for each place in the
+     code that it happens. See ES_Profile.h for how the places are marked.
+
+ Notes
+     The times are _HW_GetCycleCount counts, the core timer on the PIC32.
+     Only outermost critical regions are timed, from the EnterCritical that
+     opened the region to the ExitCritical that closes it, and charged to
+     that EnterCritical. As for the one save slot in the port, a single
+     start time does for every context that can be in a region.
+     A site's stats are only written by code that can't be interrupted by
+     anything else that writes them: a critical region's from inside the
+     region, an ISR's from that ISR. Sites are added to the end of the list
+     with _HW_AtomicSwapPtr, as the ISRs above ES_CRITICAL_IPL may add to it,
+     so a site keeps its place and the terminal can count through them while
+     new ones turn up.
+     ES_Profile_GetStats and ES_Profile_ClearStats read and clear a site
+     with all interrupts off rather than in a critical region, as the ISRs
+     above ES_CRITICAL_IPL (IC4 and SPI1) are profiled too and would
+     otherwise tear the 64 bit TotalCycles.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 12:30 ahb     stats are copied and cleared with all interrupts off
+ 10/16/26 23:40 ahb     started coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Port.h"
+#include "ES_Profile.h"
+#include "ES_LookupTables.h"
+
+#include <string.h>
+
+#ifdef ES_USE_PROFILER
+/*---------------------------- Module Functions ---------------------------*/
+static void AddSite(ES_ProfileSite_t *pSite);
+static void RecordTime(ES_ProfileSite_t *pSite, uint32_t Cycles);
+
+/*---------------------------- Module Variables ---------------------------*/
+// the sites that have run, in the order they first ran
+static ES_ProfileSite_t *volatile pFirstSite;
+
+// the outermost critical region, if one is open: the site that opened it
+// and when
+static ES_ProfileSite_t *pCriticalSite;
+static uint32_t CriticalStart;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_Profile_Begin
+ Parameters
+   ES_ProfileSite_t * pSite : the site, declared by ES_PROFILE_BEGIN or
+                              ES_PROFILE_ISR_ENTER
+ Returns
+   nothing
+ Description
+   notes the time, for ES_Profile_End at the same site
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Profile_Begin(ES_ProfileSite_t *pSite)
+{
+  if (!pSite->IsListed)
+  {
+    AddSite(pSite);
+  }
+  pSite->StartTime = _HW_GetCycleCount();
+}
+
+/****************************************************************************
+ Function
+   ES_Profile_End
+ Parameters
+   ES_ProfileSite_t * pSite : the site passed to ES_Profile_Begin
+ Returns
+   nothing
+ Description
+   adds the time since ES_Profile_Begin to the site's stats
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Profile_End(ES_ProfileSite_t *pSite)
+{
+  RecordTime(pSite, _HW_GetCycleCount() - pSite->StartTime);
+}
+
+/****************************************************************************
+ Function
+   ES_Profile_CriticalEntered
+ Parameters
+   ES_ProfileSite_t * pSite : the EnterCritical's site
+ Returns
+   nothing
+ Description
+   called by EnterCritical once the IPL has been raised. If it opened the
+   outermost region, starts timing the region.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Profile_CriticalEntered(ES_ProfileSite_t *pSite)
+{
+  if (_HW_CriticalNesting != 1)
+  {
+    return; // an inner region, the outer one is already being timed
+  }
+  if (!pSite->IsListed)
+  {
+    AddSite(pSite);
+  }
+  pCriticalSite = pSite;
+  CriticalStart = _HW_GetCycleCount();
+}
+
+/****************************************************************************
+ Function
+   ES_Profile_CriticalLeaving
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   called by ExitCritical before the IPL is put back. If it closes the
+   outermost region, charges the region's time to the site that opened it.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Profile_CriticalLeaving(void)
+{
+  if ((_HW_CriticalNesting != 1) || (pCriticalSite == NULL))
+  {
+    return;
+  }
+  RecordTime(pCriticalSite, _HW_GetCycleCount() - CriticalStart);
+  pCriticalSite = NULL;
+}
+
+/****************************************************************************
+ Function
+   ES_Profile_RestartCritical
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   starts timing the open critical region again from now
+ Notes
+   for _HW_IdleWait, which waits in ES_Run's critical region but doesn't
+   hold off the interrupts that wake it
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Profile_RestartCritical(void)
+{
+  CriticalStart = _HW_GetCycleCount();
+}
+
+/****************************************************************************
+ Function
+   ES_Profile_GetStats
+ Parameters
+   uint8_t Which : the site to report on, counting from 0
+   ES_ProfileStats_t * pStats : where to copy its stats
+ Returns
+   bool : false if fewer than Which + 1 sites have run
+ Description
+   copies out the stats of one site, so that a caller can go through them
+   all by counting Which up from 0 until it gets false
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Profile_GetStats(uint8_t Which, ES_ProfileStats_t *pStats)
+{
+  ES_ProfileSite_t *pSite = pFirstSite;
+  uint32_t IntState;
+
+  while ((pSite != NULL) && (Which != 0))
+  {
+    pSite = pSite->pNext;
+    Which--;
+  }
+  if (pSite == NULL)
+  {
+    return false;
+  }
+  // all of them off, the IPL7 ISRs write their sites' stats too
+  IntState = __builtin_disable_interrupts();
+  *pStats = pSite->Stats;
+  _CP0_SET_STATUS(IntState);
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_Profile_ClearStats
+ Parameters
+   None
+ Returns
+   nothing
+ Description
+   starts the stats of all of the sites over. The sites stay on the list.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_Profile_ClearStats(void)
+{
+  ES_ProfileSite_t *pSite;
+  uint32_t IntState;
+
+  for (pSite = pFirstSite; pSite != NULL; pSite = pSite->pNext)
+  {
+    // all interrupts off, as in ES_Profile_GetStats
+    IntState = __builtin_disable_interrupts();
+    pSite->Stats.NumRuns = 0;
+    pSite->Stats.MaxCycles = 0;
+    pSite->Stats.TotalCycles = 0;
+    memset(pSite->Stats.Buckets, 0, sizeof(pSite->Stats.Buckets));
+    _CP0_SET_STATUS(IntState);
+  }
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+   AddSite
+ Description
+   links a site onto the end of the list the first time it runs
+ Notes
+   the add can only be interrupted by the add of a different site, so if
+   the swap fails that one got the end first and we go on to its link
+****************************************************************************/
+static void AddSite(ES_ProfileSite_t *pSite)
+{
+  ES_ProfileSite_t *volatile *ppLink = &pFirstSite;
+
+  pSite->IsListed = true;
+  pSite->pNext = NULL;
+  do
+  {
+    while (*ppLink != NULL)
+    {
+      ppLink = &(*ppLink)->pNext;
+    }
+  }
+  while (!_HW_AtomicSwapPtr(ppLink, (ES_ProfileSite_t *)NULL, pSite));
+}
+
+/****************************************************************************
+ Function
+   RecordTime
+ Description
+   adds one time to a site's worst case, total and histogram
+****************************************************************************/
+static void RecordTime(ES_ProfileSite_t *pSite, uint32_t Cycles)
+{
+  ES_ProfileStats_t *pStats = &pSite->Stats;
+  uint8_t Bucket = 0;
+
+  if (Cycles != 0)
+  {
+    Bucket = ES_GetMSBitSet32(Cycles);
+    if (Bucket >= ES_PROFILE_BUCKETS)
+    {
+      Bucket = ES_PROFILE_BUCKETS - 1;
+    }
+  }
+  pStats->NumRuns++;
+  pStats->TotalCycles += Cycles;
+  if (Cycles > pStats->MaxCycles)
+  {
+    pStats->MaxCycles = Cycles;
+  }
+  if (pStats->Buckets[Bucket] != UINT16_MAX)
+  {
+    pStats->Buckets[Bucket]++;
+  }
+}
+
+#endif /* ES_USE_PROFILER */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -9,6 +9,32 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 11:30 ahb      a block declared the old way keeps all n entries,
+                         its indices wrap with a compare
+ 10/17/26 08:20 ahb      noted that ES_InitQueue rounds old style blocks down
+ 10/17/26 06:20 ahb      ES_EnQueueLIFO and ES_DeQueue take the critical
+                         region the same way as ES_EnQueueFIFO, which is
+                         empty without POST_FROM_INTS. ES_InitQueue refuses
+                         a block with no room past the header
+ 10/17/26 04:00 ahb      added ES_QueueDropNewest
+ 10/17/26 02:10 ahb      corrected the order the batch test expects
+ 10/17/26 02:00 ahb      the room test in ES_EnQueueFIFO/LIFO is made in the
+                         critical region, so a post from an ISR can't overfill
+ 10/17/26 01:40 ahb      single events are stamped by the framework's posts,
+                         not by ES_EnQueueFIFO/LIFO
+ 10/17/26 00:40 ahb      ES_QueueReplaceSameType is now ES_QueueReplaceSameEvent
+                         and matches the EventParam too
+ 10/16/26 18:40 ahb      added ES_EnQueueBatch, ES_DeQueueBatch, ES_PeekQueue
+                         and ES_PurgeQueue, one critical region each
+ 10/16/26 18:10 ahb      added ES_GetQueueMemory, to report the RAM that
+                         ES_COMPACT_EVENTS saves
+ 10/16/26 17:40 ahb      queue sizes are powers of 2 so the indices wrap with a
+                         mask instead of %, and the indices are 16 bits to
+                         allow queues of more than 255 events
+ 10/16/26 14:20 ahb      added ES_QueueDropOldest & ES_QueueReplaceSameType
+                         for the queue overflow policies
+ 10/16/26 13:40 ahb      stamp events as they are queued for latency stats
+ 10/16/26 13:00 ahb      added ES_GetQueueDepth
  01/15/12 09:34 jec      converted to use the new C99 types from types.h
  08/09/11 18:16 jec      started coding
 *****************************************************************************/
@@ -16,24 +42,49 @@
 #include "../FrameworkHeaders/ES_Configure.h"
 #include "../FrameworkHeaders/ES_Queue.h"
 #include "../FrameworkHeaders/ES_Port.h" /* get the macros for EnterCritical and ExitCritical */
+#include "../FrameworkHeaders/ES_General.h"
+#include "../FrameworkHeaders/ES_LookupTables.h"
 
 /*----------------------------- Module Defines ----------------------------*/
-// QueueSize is max number of entries in the queue
+// the queue holds QUEUE_SIZE entries, Mask + 1 for a power of 2
 // CurrentIndex is the 'read-from' index,
-// actually CurrentIndex + sizeof(EF_Queue_t)
-// entries are made to CurrentIndex + NumEntries + sizeof(ES_Queue_t)
+// actually CurrentIndex + ES_QUEUE_HEADER_SLOTS
+// entries are made to WRAP_INDEX(CurrentIndex + NumEntries) +
+// ES_QUEUE_HEADER_SLOTS
 typedef struct
 {
-  uint8_t QueueSize;
-  uint8_t CurrentIndex;
-  uint8_t NumEntries;
+  uint16_t Mask;
+  uint16_t CurrentIndex;
+  uint16_t NumEntries;
 }ES_Queue_t;
 
 typedef ES_Queue_t *pQueue_t;
 
+// step past the Queue struct at the beginning of the block
+#define SLOT(pBlock, Index) ((pBlock)[ES_QUEUE_HEADER_SLOTS + (Index)])
+
+// set in Mask for a queue whose size is not a power of 2 (a block declared
+// the old way), the rest of Mask is then the size less 1 and the indices
+// wrap with a compare instead of the mask
+#define WRAP_BY_COMPARE 0x8000u
+
+#define QUEUE_SIZE(pQueue) (((pQueue)->Mask & ~WRAP_BY_COMPARE) + 1)
+
+// Index wrapped into the queue, it may be up to twice the size less 1.
+// An index is backed up by wrapping Index + QUEUE_SIZE - 1.
+#define WRAP_INDEX(pQueue, Index)                                       \
+  (((pQueue)->Mask & WRAP_BY_COMPARE) ? WrapByCompare((pQueue), (Index)) : \
+   (uint16_t)((Index) & (pQueue)->Mask))
+
+ES_STATIC_ASSERT(sizeof(ES_Queue_t) <= ES_QUEUE_HEADER_BYTES,
+    ES_QUEUE_HEADER_BYTES_too_small);
+
 /*---------------------------- Module Functions ---------------------------*/
+static uint16_t WrapByCompare(pQueue_t pThisQueue, uint16_t Index);
 
 /*---------------------------- Module Variables ---------------------------*/
+// what has been handed to ES_InitQueue, for ES_GetQueueMemory
+static ES_QueueMemory_t QueueMemory;
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -41,30 +92,57 @@ typedef ES_Queue_t *pQueue_t;
    ES_InitQueue
  Parameters
    EF_Event * pBlock : pointer to the block of memory to use for the Queue
-   unsigned char BlockSize: size of the block pointed to by pBlock
+   uint16_t BlockSize: size of the block pointed to by pBlock, in events
  Returns
    max number of entries in the created queue
  Description
    Initializes a queue structure at the beginning of the block of memory
  Notes
-   you should pass it a block that is at least sizeof(ES_Queue_t) larger than
-   the number of entries that you want in the queue. Since the size of an
-   ES_Event (at 4 bytes; 2 enum, 2 param) is greater than the
-   sizeof(ES_Queue_t), you only need to declare an array of ES_Event
-   with 1 more element than you need for the actual queue.
+   the queue structure takes the first ES_QUEUE_HEADER_SLOTS events of the
+   block and the queue gets the rest. Declare the block with
+   ES_QUEUE_BLOCK_SIZE(n) to get a queue of at least n entries, a power of
+   2, whose indices wrap with a mask. A block sized the old way, n+1
+   events for n entries, still holds n, but unless n+1 less the header
+   slots is a power of 2 its indices wrap with a compare, which is a
+   little slower. Past 32768 entries the queue is rounded down to 32768.
+   A block with no room past the header is refused: 0 is returned and the
+   block must not be used.
  Author
    J. Edward Carryer, 08/09/11, 18:40
 ****************************************************************************/
-uint8_t ES_InitQueue(ES_Event_t *pBlock, uint8_t BlockSize)
+uint16_t ES_InitQueue(ES_Event_t *pBlock, uint16_t BlockSize)
 {
   pQueue_t pThisQueue;
+  uint16_t QueueSize;
+
+  if (BlockSize <= ES_QUEUE_HEADER_SLOTS)
+  {
+    return 0; // no room for even 1 entry
+  }
   // initialize the Queue by setting up initial values for elements
   pThisQueue = (pQueue_t)pBlock;
   // use all but the structure overhead as the Queue
-  pThisQueue->QueueSize     = BlockSize - 1;
+  QueueSize = BlockSize - ES_QUEUE_HEADER_SLOTS;
+  if ((QueueSize & (QueueSize - 1)) == 0)
+  {
+    pThisQueue->Mask = QueueSize - 1; // a power of 2, wraps with the mask
+  }
+  else if (QueueSize <= WRAP_BY_COMPARE)
+  {
+    pThisQueue->Mask = (QueueSize - 1) | WRAP_BY_COMPARE;
+  }
+  else
+  {
+    // too big to mark, round down to a power of 2
+    QueueSize = (uint16_t)1 << ES_GetMSBitSet32(QueueSize);
+    pThisQueue->Mask = QueueSize - 1;
+  }
   pThisQueue->CurrentIndex  = 0;
   pThisQueue->NumEntries    = 0;
-  return pThisQueue->QueueSize;
+  QueueMemory.NumQueues++;
+  QueueMemory.NumEntries += QueueSize;
+  QueueMemory.Bytes += (uint32_t)BlockSize * sizeof(ES_Event_t);
+  return QueueSize;
 }
 
 /****************************************************************************
@@ -85,23 +163,21 @@ uint8_t ES_InitQueue(ES_Event_t *pBlock, uint8_t BlockSize)
 bool ES_EnQueueFIFO(ES_Event_t *pBlock, ES_Event_t Event2Add)
 {
   pQueue_t pThisQueue;
-  pThisQueue = (pQueue_t)pBlock;
-  // index will go from 0 to QueueSize-1 so use '<' to test if there is space
-  if (pThisQueue->NumEntries < pThisQueue->QueueSize) // save the new event, use % to create circular buffer in block
-  {   
-    EnterCritical();  // save interrupt state, turn ints off
-// 1+ to step past the Queue struct at the beginning of the block
-	pBlock[1 + ((pThisQueue->CurrentIndex + pThisQueue->NumEntries)
-          % pThisQueue->QueueSize)] = Event2Add;
-    pThisQueue->NumEntries++; // inc number of entries
-    ExitCritical();    // restore saved interrupt state
+  bool     ReturnVal = false;
 
-    return true;
-  }
-  else
+  pThisQueue = (pQueue_t)pBlock;
+  // test for room in the same critical region as the add, or an ISR could
+  // fill the last slot in between
+  EnterCritical();  // save interrupt state, turn ints off
+  if (pThisQueue->NumEntries < QUEUE_SIZE(pThisQueue)) // save the new event, wrap the index to create circular buffer in block
   {
-    return false;
+    SLOT(pBlock, WRAP_INDEX(pThisQueue, pThisQueue->CurrentIndex +
+        pThisQueue->NumEntries)) = Event2Add;
+    pThisQueue->NumEntries++; // inc number of entries
+    ReturnVal = true;
   }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
 }
 
 /****************************************************************************
@@ -124,34 +200,24 @@ bool ES_EnQueueFIFO(ES_Event_t *pBlock, ES_Event_t Event2Add)
 bool ES_EnQueueLIFO(ES_Event_t *pBlock, ES_Event_t Event2Add)
 {
   pQueue_t pThisQueue;
+  bool     ReturnVal = false;
+
   pThisQueue = (pQueue_t)pBlock;
-  // index will go from 0 to QueueSize-1 so use '<' to test if there is space
-  if (pThisQueue->NumEntries < pThisQueue->QueueSize)
+  // test for room in the same critical region as the add, as in
+  // ES_EnQueueFIFO
+  EnterCritical();  // save interrupt state, turn ints off
+  if (pThisQueue->NumEntries < QUEUE_SIZE(pThisQueue))
   {
-#ifdef POST_FROM_INTS
-    EnterCritical();  // save interrupt state, turn ints off
-#endif
     // OK, there is space note that the queue now has 1 more entry
     pThisQueue->NumEntries++;
-    // Check to see if we need to wrap around as we back up index
-    if (pThisQueue->CurrentIndex == 0)
-    {
-      pThisQueue->CurrentIndex = pThisQueue->QueueSize - 1;
-    }
-    else
-    {
-      pThisQueue->CurrentIndex--;
-    }
-    pBlock[1 + pThisQueue->CurrentIndex] = Event2Add;
-#ifdef POST_FROM_INTS
-    ExitCritical();    // restore saved interrupt state
-#endif
-    return true;
-  }
-  else    // in case no room on the queue
-  {
-    return false;
+    // back up the index, wrapping it around from 0
+    pThisQueue->CurrentIndex = WRAP_INDEX(pThisQueue,
+        pThisQueue->CurrentIndex + QUEUE_SIZE(pThisQueue) - 1);
+    SLOT(pBlock, pThisQueue->CurrentIndex) = Event2Add;
+    ReturnVal = true;
   }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
 }
 
 /****************************************************************************
@@ -170,31 +236,21 @@ bool ES_EnQueueLIFO(ES_Event_t *pBlock, ES_Event_t Event2Add)
  Author
    J. Edward Carryer, 08/09/11, 19:11
 ****************************************************************************/
-uint8_t ES_DeQueue(ES_Event_t *pBlock, ES_Event_t *pReturnEvent)
+uint16_t ES_DeQueue(ES_Event_t *pBlock, ES_Event_t *pReturnEvent)
 {
   pQueue_t  pThisQueue;
-  uint8_t   NumLeft;
+  uint16_t  NumLeft;
 
   pThisQueue = (pQueue_t)pBlock;
+  EnterCritical();  // save interrupt state, turn ints off
   if (pThisQueue->NumEntries > 0)
   {
-#ifdef POST_FROM_INTS
-    EnterCritical();  // save interrupt state, turn ints off
-#endif
-    *pReturnEvent = pBlock[1 + pThisQueue->CurrentIndex];
-    // inc the index
-    pThisQueue->CurrentIndex++;
-    // this way we only do the modulo operation when we really need to
-    if (pThisQueue->CurrentIndex >= pThisQueue->QueueSize)
-    {
-      pThisQueue->CurrentIndex = (uint8_t)(pThisQueue->CurrentIndex % pThisQueue->QueueSize);
-    }
+    *pReturnEvent = SLOT(pBlock, pThisQueue->CurrentIndex);
+    // inc the index, wrapping it around
+    pThisQueue->CurrentIndex = WRAP_INDEX(pThisQueue,
+        pThisQueue->CurrentIndex + 1);
     //dec number of elements since we took 1 out
     NumLeft = --pThisQueue->NumEntries;
-#ifdef POST_FROM_INTS
-    ExitCritical();    // restore saved interrupt state
-#endif
-
   }
   else     // no items left in the queue
   {
@@ -202,6 +258,7 @@ uint8_t ES_DeQueue(ES_Event_t *pBlock, ES_Event_t *pReturnEvent)
     (*pReturnEvent).EventParam  = 0;
     NumLeft                     = 0;
   }
+  ExitCritical();    // restore saved interrupt state
   return NumLeft;
 }
 
@@ -227,6 +284,342 @@ bool ES_IsQueueEmpty(ES_Event_t *pBlock)
   return pThisQueue->NumEntries == 0;
 }
 
+/****************************************************************************
+ Function
+   ES_GetQueueDepth
+ Parameters
+   ES_Event_t * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   uint16_t : the number of entries in the Queue
+ Description
+   see above
+ Notes
+
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_GetQueueDepth(ES_Event_t *pBlock)
+{
+  return ((pQueue_t)pBlock)->NumEntries;
+}
+
+/****************************************************************************
+ Function
+   ES_QueueDropOldest
+ Parameters
+   ES_Event_t * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   bool : true if an event was thrown away, false if the Queue was empty
+ Description
+   discards the event at the head of the Queue to make room for a new one
+ Notes
+
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_QueueDropOldest(ES_Event_t *pBlock)
+{
+  pQueue_t pThisQueue;
+  bool     ReturnVal = false;
+
+  pThisQueue = (pQueue_t)pBlock;
+  EnterCritical();  // save interrupt state, turn ints off
+  if (pThisQueue->NumEntries > 0)
+  {
+    pThisQueue->CurrentIndex = WRAP_INDEX(pThisQueue,
+        pThisQueue->CurrentIndex + 1);
+    pThisQueue->NumEntries--;
+    ReturnVal = true;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_QueueDropNewest
+ Parameters
+   ES_Event_t * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   bool : true if an event was thrown away, false if the Queue was empty
+ Description
+   discards the event at the tail of the Queue, the last in line, to make
+   room for one that is going on the front
+ Notes
+
+ Author
+   A. Brown, 10/17/26
+****************************************************************************/
+bool ES_QueueDropNewest(ES_Event_t *pBlock)
+{
+  pQueue_t pThisQueue;
+  bool     ReturnVal = false;
+
+  pThisQueue = (pQueue_t)pBlock;
+  EnterCritical();  // save interrupt state, turn ints off
+  if (pThisQueue->NumEntries > 0)
+  {
+    pThisQueue->NumEntries--;
+    ReturnVal = true;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_QueueReplaceSameEvent
+ Parameters
+   ES_Event_t * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event_t NewEvent : event to merge with a queued copy of itself
+ Returns
+   bool : true if an event with the same EventType and EventParam was found
+ Description
+   searches the Queue, oldest first, for an event with NewEvent's EventType
+   and EventParam and overwrites it with NewEvent, so NewEvent is delivered
+   in the queued one's place in line without taking another slot
+ Notes
+   the EventParam must match as well, as it tells apart the events of one
+   type from different sources, e.g. the ES_TIMEOUTs of different timers
+
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_QueueReplaceSameEvent(ES_Event_t *pBlock, ES_Event_t NewEvent)
+{
+  pQueue_t pThisQueue;
+  uint16_t Index;
+  uint16_t i;
+  bool     ReturnVal = false;
+
+  pThisQueue = (pQueue_t)pBlock;
+  EnterCritical();  // save interrupt state, turn ints off
+  Index = pThisQueue->CurrentIndex;
+  for (i = 0; i < pThisQueue->NumEntries; i++)
+  {
+    if ((SLOT(pBlock, Index).EventType == NewEvent.EventType) &&
+        (SLOT(pBlock, Index).EventParam == NewEvent.EventParam))
+    {
+#ifdef _INCLUDE_LATENCY_STATS_
+      NewEvent.TimeStamp = SLOT(pBlock, Index).TimeStamp; // it has been waiting
+#endif
+      SLOT(pBlock, Index) = NewEvent;
+      ReturnVal = true;
+      break;
+    }
+    Index = WRAP_INDEX(pThisQueue, Index + 1);
+  }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_GetQueueMemory
+ Parameters
+   ES_QueueMemory_t * pMemory : where to copy the totals
+ Returns
+   nothing
+ Description
+   reports the number of queues set up with ES_InitQueue (the service
+   queues and the deferral queues), the events they can hold and the bytes
+   of RAM their blocks take up
+ Notes
+   a block that is initialized more than once is counted each time
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_GetQueueMemory(ES_QueueMemory_t *pMemory)
+{
+  *pMemory = QueueMemory;
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueueBatch
+ Parameters
+   ES_Event_t * pBlock : pointer to the block of memory in use as the Queue
+   const ES_Event_t * pEvents : the events to add, in order
+   uint16_t NumEvents : how many there are
+   bool AtFront : false to add them FIFO, true to add each in turn at the
+                  extraction point, as ES_EnQueueLIFO would
+ Returns
+   uint16_t : the number of events added, from the start of pEvents
+ Description
+   adds as many of the events as will fit in one critical region
+ Notes
+   with AtFront the last event added is the next one out, the same order
+   as calling ES_EnQueueLIFO for each in turn
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_EnQueueBatch(ES_Event_t *pBlock, const ES_Event_t *pEvents,
+                         uint16_t NumEvents, bool AtFront)
+{
+  pQueue_t pThisQueue;
+  uint16_t NumAdded;
+  uint16_t Index;
+  uint16_t i;
+#ifdef _INCLUDE_LATENCY_STATS_
+  uint32_t Now = _HW_GetCycleCount();
+#endif
+
+  pThisQueue = (pQueue_t)pBlock;
+  EnterCritical();  // save interrupt state, turn ints off
+  NumAdded = QUEUE_SIZE(pThisQueue) - pThisQueue->NumEntries; // room left
+  if (NumAdded > NumEvents)
+  {
+    NumAdded = NumEvents;
+  }
+  for (i = 0; i < NumAdded; i++)
+  {
+    if (AtFront)
+    {
+      pThisQueue->CurrentIndex = WRAP_INDEX(pThisQueue,
+          pThisQueue->CurrentIndex + QUEUE_SIZE(pThisQueue) - 1);
+      Index = pThisQueue->CurrentIndex;
+    }
+    else
+    {
+      Index = WRAP_INDEX(pThisQueue,
+          pThisQueue->CurrentIndex + pThisQueue->NumEntries);
+    }
+    SLOT(pBlock, Index) = pEvents[i];
+#ifdef _INCLUDE_LATENCY_STATS_
+    SLOT(pBlock, Index).TimeStamp = Now;
+#endif
+    pThisQueue->NumEntries++;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return NumAdded;
+}
+
+/****************************************************************************
+ Function
+   ES_DeQueueBatch
+ Parameters
+   ES_Event_t * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event_t * pEvents : where to copy the events, oldest first
+   uint16_t MaxEvents : the most to take
+ Returns
+   uint16_t : the number of events taken, 0 if the Queue was empty
+ Description
+   pulls up to MaxEvents entries from the Queue in one critical region
+ Notes
+   unlike ES_DeQueue this returns the number taken, not the number left,
+   use ES_GetQueueDepth for that
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_DeQueueBatch(ES_Event_t *pBlock, ES_Event_t *pEvents,
+                         uint16_t MaxEvents)
+{
+  pQueue_t pThisQueue;
+  uint16_t NumTaken;
+  uint16_t i;
+
+  pThisQueue = (pQueue_t)pBlock;
+  EnterCritical();  // save interrupt state, turn ints off
+  NumTaken = pThisQueue->NumEntries;
+  if (NumTaken > MaxEvents)
+  {
+    NumTaken = MaxEvents;
+  }
+  for (i = 0; i < NumTaken; i++)
+  {
+    pEvents[i] = SLOT(pBlock, pThisQueue->CurrentIndex);
+    pThisQueue->CurrentIndex = WRAP_INDEX(pThisQueue,
+        pThisQueue->CurrentIndex + 1);
+  }
+  pThisQueue->NumEntries -= NumTaken;
+  ExitCritical();    // restore saved interrupt state
+  return NumTaken;
+}
+
+/****************************************************************************
+ Function
+   ES_PeekQueue
+ Parameters
+   ES_Event_t * pBlock : pointer to the block of memory in use as the Queue
+   uint16_t Position : which entry, 0 is the next one ES_DeQueue would take
+   ES_Event_t * pReturnEvent : where to copy the entry
+ Returns
+   bool : false if the Queue has no entry at that Position
+ Description
+   copies out an entry without taking it off the Queue
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_PeekQueue(ES_Event_t *pBlock, uint16_t Position,
+                  ES_Event_t *pReturnEvent)
+{
+  pQueue_t pThisQueue;
+  bool     ReturnVal = false;
+
+  pThisQueue = (pQueue_t)pBlock;
+  EnterCritical();  // save interrupt state, turn ints off
+  if (Position < pThisQueue->NumEntries)
+  {
+    *pReturnEvent = SLOT(pBlock, WRAP_INDEX(pThisQueue,
+        pThisQueue->CurrentIndex + Position));
+    ReturnVal = true;
+  }
+  ExitCritical();    // restore saved interrupt state
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_PurgeQueue
+ Parameters
+   ES_Event_t * pBlock : pointer to the block of memory in use as the Queue
+   ES_QueueMatchFunc_t * pMatchFunc : returns true for events to remove
+   void * pContext : handed to pMatchFunc with each event
+ Returns
+   uint16_t : the number of events removed
+ Description
+   removes every entry that pMatchFunc picks out, in a single pass that
+   slides the ones that are kept up to close the gaps, so they stay in
+   order
+ Notes
+   pMatchFunc is called with interrupts off, so it must be short and must
+   not post or touch the Queue
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_PurgeQueue(ES_Event_t *pBlock, ES_QueueMatchFunc_t *pMatchFunc,
+                       void *pContext)
+{
+  pQueue_t pThisQueue;
+  uint16_t ReadIndex;
+  uint16_t WriteIndex;
+  uint16_t NumKept = 0;
+  uint16_t NumRemoved;
+  uint16_t i;
+
+  pThisQueue = (pQueue_t)pBlock;
+  EnterCritical();  // save interrupt state, turn ints off
+  ReadIndex = pThisQueue->CurrentIndex;
+  WriteIndex = ReadIndex;
+  for (i = 0; i < pThisQueue->NumEntries; i++)
+  {
+    if (!pMatchFunc(&SLOT(pBlock, ReadIndex), pContext))
+    {
+      if (WriteIndex != ReadIndex)
+      {
+        SLOT(pBlock, WriteIndex) = SLOT(pBlock, ReadIndex);
+      }
+      WriteIndex = WRAP_INDEX(pThisQueue, WriteIndex + 1);
+      NumKept++;
+    }
+    ReadIndex = WRAP_INDEX(pThisQueue, ReadIndex + 1);
+  }
+  NumRemoved = pThisQueue->NumEntries - NumKept;
+  pThisQueue->NumEntries = NumKept;
+  ExitCritical();    // restore saved interrupt state
+  return NumRemoved;
+}
+
 #if 0
 /****************************************************************************
  Function
@@ -257,18 +650,106 @@ void QueueFlushQueue(uint8_t *pBlock)
 /***************************************************************************
  private functions
  ***************************************************************************/
+/****************************************************************************
+ Function
+   WrapByCompare
+ Parameters
+   pQueue_t pThisQueue : a queue whose size is not a power of 2
+   uint16_t Index : an index up to twice the size less 1
+ Returns
+   uint16_t : Index wrapped into the queue
+ Description
+   WRAP_INDEX for the blocks declared the old way
+****************************************************************************/
+static uint16_t WrapByCompare(pQueue_t pThisQueue, uint16_t Index)
+{
+  uint16_t Size = QUEUE_SIZE(pThisQueue);
+
+  return (Index >= Size) ? (uint16_t)(Index - Size) : Index;
+}
+
 #ifdef TEST
 
 #include <stdio.h>
 #include "ES_General.h"
 
-static ES_Event   TestQueue[3 + 1];
-volatile uint8_t  NumLeft; // for debugging visibility
+// the number of post & dequeue pairs timed for the cycle counts
+#define TEST_REPS 1000
+
+static ES_Event_t TestQueue[ES_QUEUE_BLOCK_SIZE(4)];
+// declared the old way, for 5 events that aren't a power of 2
+static ES_Event_t OldStyleQueue[5 + ES_QUEUE_HEADER_SLOTS];
+volatile uint16_t NumLeft; // for debugging visibility
+
+// core timer counts (2 CPU clocks each) per post & dequeue pair, read them
+// with the debugger. ModuloCycles is for the same pair with the indices
+// wrapped with %, the way this module did it before the queue sizes were
+// powers of 2.
+volatile uint32_t MaskCycles;
+volatile uint32_t ModuloCycles;
+
+// the 8 bit, % based queue, kept here only to compare against
+typedef struct
+{
+  uint8_t QueueSize;
+  uint8_t CurrentIndex;
+  uint8_t NumEntries;
+}ModuloQueue_t;
+
+static ES_Event_t ModuloBlock[5 + 1];
+// volatile so that the compiler can't work out QueueSize and drop the %
+static ES_Event_t *volatile pModuloBlock = ModuloBlock;
+
+static bool ModuloEnQueue(ES_Event_t *pBlock, ES_Event_t Event2Add)
+{
+  ModuloQueue_t *pThisQueue = (ModuloQueue_t *)pBlock;
+
+  if (pThisQueue->NumEntries < pThisQueue->QueueSize)
+  {
+    EnterCritical();
+    pBlock[1 + ((pThisQueue->CurrentIndex + pThisQueue->NumEntries)
+        % pThisQueue->QueueSize)] = Event2Add;
+    pThisQueue->NumEntries++;
+    ExitCritical();
+    return true;
+  }
+  return false;
+}
+
+static uint8_t ModuloDeQueue(ES_Event_t *pBlock, ES_Event_t *pReturnEvent)
+{
+  ModuloQueue_t *pThisQueue = (ModuloQueue_t *)pBlock;
+  uint8_t NumLeft = 0;
+
+  if (pThisQueue->NumEntries > 0)
+  {
+    EnterCritical();
+    *pReturnEvent = pBlock[1 + pThisQueue->CurrentIndex];
+    pThisQueue->CurrentIndex++;
+    if (pThisQueue->CurrentIndex >= pThisQueue->QueueSize)
+    {
+      pThisQueue->CurrentIndex = (uint8_t)(pThisQueue->CurrentIndex %
+          pThisQueue->QueueSize);
+    }
+    NumLeft = --pThisQueue->NumEntries;
+    ExitCritical();
+  }
+  return NumLeft;
+}
+
+static bool IsEvenParam(const ES_Event_t *pEvent, void *pContext)
+{
+  (void)pContext;
+  return (pEvent->EventParam & 1) == 0;
+}
 
 void main(void)
 {
-  ES_Event  MyEvent;
-  bool      bReturn;
+  ES_Event_t  MyEvent;
+  ES_Event_t  BatchEvents[5];
+  bool        bReturn;
+  uint32_t    StartTime;
+  uint16_t    i;
 
   ES_InitQueue(TestQueue, ARRAY_SIZE(TestQueue));
   MyEvent.EventType   = 0;
@@ -282,8 +763,8 @@ void main(void)
   bReturn             = ES_EnQueueLIFO(TestQueue, MyEvent);
   bReturn             += 1; // keep that sily optimizer away
 
-  // at this point, the events in the queue should be 11,0
-  // so pull off the 11, leaving 1 entry
+  // at this point, the events in the queue should be 10,0
+  // so pull off the 10, leaving 1 entry
   NumLeft = ES_DeQueue(TestQueue, &MyEvent);
   if (NumLeft != 1)
   {
@@ -300,16 +781,21 @@ void main(void)
   bReturn             = ES_EnQueueFIFO(TestQueue, MyEvent);
   bReturn             += 1; // keep that sily optimizer away
 
+  MyEvent.EventType   = 12;
+  MyEvent.EventParam  = 13;
+  bReturn             = ES_EnQueueFIFO(TestQueue, MyEvent);
+  bReturn             += 1; // keep that sily optimizer away
+
   // queue is now full so this one should fail
   MyEvent.EventType   = 6;
   MyEvent.EventParam  = 7;
   bReturn             = ES_EnQueueFIFO(TestQueue, MyEvent);
   bReturn             += 1; // keep that sily optimizer away
 
-  // at this point, the events in the queue should be 0,2,4
-  // so pull off the 0, leaving 2 entries
+  // at this point, the events in the queue should be 0,2,4,12
+  // so pull off the 0, leaving 3 entries
   NumLeft = ES_DeQueue(TestQueue, &MyEvent);
-  if (NumLeft != 2)
+  if (NumLeft != 3)
   {
     bReturn = 0;
   }
@@ -319,11 +805,93 @@ void main(void)
   bReturn             = ES_EnQueueLIFO(TestQueue, MyEvent);
   bReturn             += 1; // keep that sily optimizer away
 
-  // at this point, the events in the queue should be 8,2,4
-  // so pull off the 8, leaving 2 entries
+  // at this point, the events in the queue should be 8,2,4,12
+  // so pull off the 8, leaving 3 entries
   NumLeft = ES_DeQueue(TestQueue, &MyEvent);
   NumLeft += 3; //to keep the compiler from optimizing away the last save
 
+  // now time post & dequeue pairs, with the queue part full so that the
+  // indices wrap around, first with the mask
+  StartTime = _HW_GetCycleCount();
+  for (i = 0; i < TEST_REPS; i++)
+  {
+    ES_EnQueueFIFO(TestQueue, MyEvent);
+    NumLeft = ES_DeQueue(TestQueue, &MyEvent);
+  }
+  MaskCycles = (_HW_GetCycleCount() - StartTime) / TEST_REPS;
+
+  // and then the same with %
+  ((ModuloQueue_t *)pModuloBlock)->QueueSize = ARRAY_SIZE(ModuloBlock) - 1;
+  ModuloEnQueue(pModuloBlock, MyEvent);
+  ModuloEnQueue(pModuloBlock, MyEvent);
+  StartTime = _HW_GetCycleCount();
+  for (i = 0; i < TEST_REPS; i++)
+  {
+    ModuloEnQueue(pModuloBlock, MyEvent);
+    NumLeft = ModuloDeQueue(pModuloBlock, &MyEvent);
+  }
+  ModuloCycles = (_HW_GetCycleCount() - StartTime) / TEST_REPS;
+
+  // the batch calls: empty the queue, then put 1,2 on the end and 4,5 on
+  // the front (each in turn, as ES_EnQueueLIFO would), leaving 5,4,1,2.
+  // Then the 3 doesn't fit.
+  ES_DeQueueBatch(TestQueue, BatchEvents, ARRAY_SIZE(BatchEvents));
+  for (i = 0; i < ARRAY_SIZE(BatchEvents); i++)
+  {
+    BatchEvents[i].EventType  = 0;
+    BatchEvents[i].EventParam = i + 1;
+  }
+  if (ES_EnQueueBatch(TestQueue, &BatchEvents[0], 2, false) != 2)
+  {
+    bReturn = 0;
+  }
+  if (ES_EnQueueBatch(TestQueue, &BatchEvents[3], 2, true) != 2)
+  {
+    bReturn = 0;
+  }
+  if (ES_EnQueueBatch(TestQueue, &BatchEvents[2], 1, false) != 0)
+  {
+    bReturn = 0;
+  }
+  if (!ES_PeekQueue(TestQueue, 1, &MyEvent) || (MyEvent.EventParam != 4) ||
+      ES_PeekQueue(TestQueue, 4, &MyEvent))
+  {
+    bReturn = 0;
+  }
+  // take out the even ones, leaving 5,1
+  if (ES_PurgeQueue(TestQueue, IsEvenParam, NULL) != 2)
+  {
+    bReturn = 0;
+  }
+  if ((ES_DeQueueBatch(TestQueue, BatchEvents, 3) != 2) ||
+      (BatchEvents[0].EventParam != 5) || (BatchEvents[1].EventParam != 1))
+  {
+    bReturn = 0;
+  }
+  NumLeft = bReturn;  // 1 if the batch calls all did what they should
+
+  // the old style block holds all 5. Fill it, take 2 off and put 2 more
+  // on, so that the indices wrap, and they must come off 2,3,4,5,6
+  bReturn = (ES_InitQueue(OldStyleQueue, ARRAY_SIZE(OldStyleQueue)) == 5);
+  for (i = 0; i < 5; i++)
+  {
+    MyEvent.EventParam = i;
+    bReturn = bReturn && ES_EnQueueFIFO(OldStyleQueue, MyEvent);
+  }
+  bReturn = bReturn && !ES_EnQueueFIFO(OldStyleQueue, MyEvent);
+  ES_DeQueueBatch(OldStyleQueue, BatchEvents, 2);
+  for (i = 5; i < 7; i++)
+  {
+    MyEvent.EventParam = i;
+    bReturn = bReturn && ES_EnQueueFIFO(OldStyleQueue, MyEvent);
+  }
+  for (i = 2; i < 7; i++)
+  {
+    ES_DeQueue(OldStyleQueue, &MyEvent);
+    bReturn = bReturn && (MyEvent.EventParam == i);
+  }
+  NumLeft += bReturn; // 2 if the old style block worked as well
+
   while (1)
   {
     ;
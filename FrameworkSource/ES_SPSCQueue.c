@@ -0,0 +1,382 @@
+//#define TEST
+/****************************************************************************
+ Module
+     ES_SPSCQueue.c
+ Description
+     Implements a lock free, single producer, single consumer circular
+     buffer of ES_Event_t. These are the ISR inboxes: an ISR puts events in
+     without turning interrupts off and ES_Run takes them out.
+ Notes
+     Only one producer and one consumer may use a queue. On the PIC32 that
+     means only ISRs at a single priority level may Put to it, since those
+     can't interrupt each other, and only one context may Get from it.
+     The event is written into its slot before Head is moved past it, and
+     read out of its slot before Tail is moved past it, with
+     _HW_MemoryBarrier between the two so the compiler can't swap them.
+     Each side reads the other's index only once per call, so an index
+     that changes part way through a call is never a problem.
+
+     The TEST build is a stress test for the host. It hammers a queue from
+     a high rate interval timer signal, which interrupts the consumer just
+     as an ISR does on the chip, and then from a second thread, which runs
+     the producer truly in parallel with it. From the top of the repo:
+       cc -DTEST -DES_HOST_PORT -O2 -pthread -IHostPort/include \
+          -IFrameworkHeaders -IProjectHeaders -o spsc_test \
+          FrameworkSource/ES_SPSCQueue.c && ./spsc_test
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 01:40 ahb      stamps events for the latency stats as they are put
+ 10/16/26 18:10 ahb      stress test allows for a compact EventType
+ 10/16/26 17:00 ahb      started coding
+*****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include "../FrameworkHeaders/ES_Configure.h"
+#include "../FrameworkHeaders/ES_SPSCQueue.h"
+#include "../FrameworkHeaders/ES_Port.h" /* get _HW_MemoryBarrier */
+
+/*----------------------------- Module Defines ----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+
+/*---------------------------- Module Variables ---------------------------*/
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_SPSC_Init
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to set up
+   ES_Event_t * pSlots : the array of events that holds the queued events
+   uint8_t NumSlots : the number of events in pSlots
+ Returns
+   nothing
+ Description
+   empties the queue and points it at its slots. The queue can hold one
+   fewer than NumSlots events.
+ Notes
+   must be called before either side uses the queue
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_SPSC_Init(ES_SPSCQueue_t *pQueue, ES_Event_t *pSlots,
+                  uint8_t NumSlots)
+{
+  pQueue->pSlots = pSlots;
+  pQueue->NumSlots = NumSlots;
+  pQueue->Head = 0;
+  pQueue->Tail = 0;
+  pQueue->NumOverflows = 0;
+}
+
+/****************************************************************************
+ Function
+   ES_SPSC_Put
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to add to
+   ES_Event_t Event2Add : event to be added to the queue
+ Returns
+   bool : true if the add was successful, false if the queue was full
+ Description
+   the producer side. Copies the event into the slot at Head and then moves
+   Head on, which is what makes it visible to the consumer.
+ Notes
+   never disables interrupts. Full queues are counted in NumOverflows.
+   With _INCLUDE_LATENCY_STATS_ the event is stamped here, so that its
+   latency counts the time it waits in the inbox.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_SPSC_Put(ES_SPSCQueue_t *pQueue, ES_Event_t Event2Add)
+{
+  uint8_t Head = pQueue->Head;
+  uint8_t NextHead = Head + 1;
+
+  if (NextHead == pQueue->NumSlots)
+  {
+    NextHead = 0;
+  }
+  if (NextHead == pQueue->Tail)
+  {
+    pQueue->NumOverflows++;
+    return false;
+  }
+#ifdef _INCLUDE_LATENCY_STATS_
+  Event2Add.TimeStamp = _HW_GetCycleCount();
+#endif
+  pQueue->pSlots[Head] = Event2Add;
+  _HW_MemoryBarrier();  // the event must be in place before Head moves
+  pQueue->Head = NextHead;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_SPSC_Get
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to take from
+   ES_Event_t * pReturnEvent : where to copy the event
+ Returns
+   bool : true if an event was copied out, false if the queue was empty
+ Description
+   the consumer side. Copies the event out of the slot at Tail and then
+   moves Tail on, which hands the slot back to the producer.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_SPSC_Get(ES_SPSCQueue_t *pQueue, ES_Event_t *pReturnEvent)
+{
+  uint8_t Tail = pQueue->Tail;
+  uint8_t NextTail;
+
+  if (Tail == pQueue->Head)
+  {
+    return false;
+  }
+  _HW_MemoryBarrier();  // don't read the slot before we have seen Head
+  *pReturnEvent = pQueue->pSlots[Tail];
+  NextTail = Tail + 1;
+  if (NextTail == pQueue->NumSlots)
+  {
+    NextTail = 0;
+  }
+  _HW_MemoryBarrier();  // the event must be out before the slot is freed
+  pQueue->Tail = NextTail;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_SPSC_IsEmpty
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to test
+ Returns
+   bool : true if the queue is empty
+ Description
+   a snapshot, the producer may add an event right after we look
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_SPSC_IsEmpty(const ES_SPSCQueue_t *pQueue)
+{
+  return pQueue->Head == pQueue->Tail;
+}
+
+/****************************************************************************
+ Function
+   ES_SPSC_GetOverflows
+ Parameters
+   ES_SPSCQueue_t * pQueue : the queue to report on
+ Returns
+   uint16_t : the number of Puts that have found the queue full
+ Description
+   the count wraps at 65535. Only the producer writes it, so to start the
+   count over keep the value read here and subtract it from later ones.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_SPSC_GetOverflows(const ES_SPSCQueue_t *pQueue)
+{
+  return pQueue->NumOverflows;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+
+#ifdef TEST
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/time.h>
+#include "ES_General.h"
+
+// a small queue, so that it is full a good part of the time
+#define TEST_SLOTS 8
+// events the timer signal tries to post, in bursts, every SIGNAL_PERIOD_US
+#define SIGNAL_POSTS 300000
+#define SIGNAL_BURST 3
+#define SIGNAL_PERIOD_US 10
+// events the producer thread posts, it retries until each one fits
+#define THREAD_POSTS 10000000
+
+static ES_Event_t TestSlots[TEST_SLOTS];
+static ES_SPSCQueue_t TestQueue;
+
+// producer side state, Accepted numbers the events that went in
+static volatile uint32_t Accepted;
+static volatile uint32_t Attempted;
+static volatile sig_atomic_t ProducerDone;
+
+/****************************************************************************
+ Function
+   MakeEvent
+ Description
+   event number n carries the low 16 bits of n in EventParam and their
+   complement (as much of it as fits) in EventType, so a torn copy of a
+   slot shows up
+****************************************************************************/
+static ES_Event_t MakeEvent(uint32_t n)
+{
+  ES_Event_t NewEvent;
+
+  memset(&NewEvent, 0, sizeof(NewEvent));
+  NewEvent.EventParam = (uint16_t)n;
+  NewEvent.EventType = (ES_EventType_t)(uint16_t)~n;
+  return NewEvent;
+}
+
+/****************************************************************************
+ Function
+   TimerISR
+ Description
+   the SIGALRM handler, standing in for a high rate timer ISR
+****************************************************************************/
+static void TimerISR(int Signal)
+{
+  uint8_t i;
+
+  (void)Signal;
+  for (i = 0; (i < SIGNAL_BURST) && !ProducerDone; i++)
+  {
+    if (ES_SPSC_Put(&TestQueue, MakeEvent(Accepted)))
+    {
+      Accepted++;
+    }
+    if (++Attempted == SIGNAL_POSTS)
+    {
+      ProducerDone = 1;
+    }
+  }
+}
+
+/****************************************************************************
+ Function
+   ProducerThread
+ Description
+   posts THREAD_POSTS events as fast as it can, from another core if
+   there is one
+****************************************************************************/
+static void *ProducerThread(void *pArg)
+{
+  (void)pArg;
+  while (Accepted < THREAD_POSTS)
+  {
+    if (ES_SPSC_Put(&TestQueue, MakeEvent(Accepted)))
+    {
+      Accepted++;
+    }
+    else
+    {
+      sched_yield();  // in case there is only the one core
+    }
+  }
+  ProducerDone = 1;
+  return NULL;
+}
+
+/****************************************************************************
+ Function
+   Consume
+ Description
+   takes events until the producer is done and the queue is empty, checking
+   that they come out whole, in order and without gaps or repeats. Every
+   so often it dawdles so that the queue fills up.
+ Returns
+   the number of bad events seen
+****************************************************************************/
+static uint32_t Consume(uint32_t *pNumReceived)
+{
+  ES_Event_t ThisEvent;
+  uint32_t Expected = 0;
+  uint32_t NumBad = 0;
+  uint32_t NumReceived = 0;
+  volatile uint32_t Dawdle;
+
+  while (!ProducerDone || !ES_SPSC_IsEmpty(&TestQueue))
+  {
+    if (ES_SPSC_Get(&TestQueue, &ThisEvent))
+    {
+      if ((ThisEvent.EventParam != (uint16_t)Expected) ||
+          (ThisEvent.EventType != (ES_EventType_t)(uint16_t)~Expected))
+      {
+        if (NumBad++ < 10)
+        {
+          printf("  event %u came out as %u/%u\n", (unsigned)Expected,
+              (unsigned)ThisEvent.EventParam,
+              (unsigned)ThisEvent.EventType);
+        }
+        Expected = (Expected & ~0xffffu) | ThisEvent.EventParam; // resync
+      }
+      Expected++;
+      if ((++NumReceived & 0x3ff) == 0)
+      {
+        for (Dawdle = 0; Dawdle < 2000; Dawdle++)
+        {}
+      }
+    }
+    else
+    {
+      sched_yield();
+    }
+  }
+  *pNumReceived = NumReceived;
+  return NumBad;
+}
+
+/****************************************************************************
+ Function
+   Report
+ Description
+   prints a test's result, returns true if it passed
+****************************************************************************/
+static bool Report(const char *pName, uint32_t NumBad, uint32_t NumReceived)
+{
+  bool Passed = (NumBad == 0) && (NumReceived == Accepted);
+
+  printf("%s: %u accepted, %u received, %u overflows, %u bad: %s\n",
+      pName, (unsigned)Accepted, (unsigned)NumReceived,
+      (unsigned)ES_SPSC_GetOverflows(&TestQueue), (unsigned)NumBad,
+      Passed ? "PASS" : "FAIL");
+  return Passed;
+}
+
+int main(void)
+{
+  struct itimerval Period;
+  pthread_t Producer;
+  uint32_t NumBad;
+  uint32_t NumReceived;
+  bool Passed;
+
+  // the producer interrupts the consumer, as an ISR would
+  ES_SPSC_Init(&TestQueue, TestSlots, ARRAY_SIZE(TestSlots));
+  signal(SIGALRM, TimerISR);
+  memset(&Period, 0, sizeof(Period));
+  Period.it_interval.tv_usec = SIGNAL_PERIOD_US;
+  Period.it_value.tv_usec = SIGNAL_PERIOD_US;
+  setitimer(ITIMER_REAL, &Period, NULL);
+  NumBad = Consume(&NumReceived);
+  memset(&Period, 0, sizeof(Period));
+  setitimer(ITIMER_REAL, &Period, NULL);
+  Passed = Report("timer signal", NumBad, NumReceived);
+
+  // the producer runs alongside the consumer
+  ES_SPSC_Init(&TestQueue, TestSlots, ARRAY_SIZE(TestSlots));
+  Accepted = 0;
+  ProducerDone = 0;
+  pthread_create(&Producer, NULL, ProducerThread, NULL);
+  NumBad = Consume(&NumReceived);
+  pthread_join(Producer, NULL);
+  Passed = Report("producer thread", NumBad, NumReceived) && Passed;
+
+  return Passed ? 0 : 1;
+}
+
+#endif
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
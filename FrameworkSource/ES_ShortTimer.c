@@ -1,187 +1,357 @@
-//#define DEBUG
 /****************************************************************************
  Module
    ES_ShortTimer.c
 
  Revision
-   1.0.1
+   2.0.0
 
  Description
    This is a library to provide for the creation of short time-outs
    (shorter than the resolution of the ES_Timer library).
 
  Notes
-   This module uses the Tiva Peripheral Driver Library functions and
-   the ability that it provides to 'hook' a function into an interrupt
-   response routine without modifying the vector table directly.
-   Uses timers A & B on 16/32 bit Timer Module 5
+   ES_NUM_SHORT_TIMERS one shot timers share Timer4/Timer5, run as a single
+   32 bit timer from the 20MHz peripheral clock. The running timers are
+   kept in a list in order of expiry, each holding the ES_Time_Now at
+   which it is due, and the hardware is only ever timing the gap to the
+   first of them. When that comes up, the interrupt posts ES_SHORT_TIMEOUT
+   (with the timer number in EventParam) for it and any others that are
+   due, then sets the hardware for the next.
+   The peripheral clock and the core timer run at the same rate, so a
+   count of one is a count of the other.
+   A timer that is due within MIN_LEAD_COUNTS of the interrupt goes with
+   it, so a timeout may come up to 1us early rather than a whole interrupt
+   late.
 
  History
  When           Who     What/Why
  -------------- ---     --------
- 10/11/15 10:30 jec     first pass
+ 10/17/26 11:00 ahb     a timer that timed out before ES_ShortTimerStart
+                        returned was posted twice
+ 10/16/26 23:40 ahb     profile the ISR
+ 10/16/26 23:10 ahb     check that the ISR is not above ES_CRITICAL_IPL
+ 10/16/26 21:40 ahb     rewritten for the PIC32 on Timer4/Timer5, with any
+                        number of timers
  10/11/15 18:10 jec     converted to post events to the framework
+ 10/11/15 10:30 jec     first pass
 
 ****************************************************************************/
-// the common headers for I/O, C99 types
-#include <stdio.h>
-#include <stdint.h>
-#include <stdbool.h>
-#include "BITDEFS.H"
-
-// the headers to access the GPIO subsystem
-#include "inc/hw_memmap.h"
-#include "inc/hw_types.h"
-#include "inc/hw_gpio.h"
-#include "inc/hw_sysctl.h"
-#include "inc/hw_timer.h"
-#include "inc/hw_ints.h"
-
-// the headers to access the TivaWare Library
-#include "driverlib/sysctl.h"
-#include "driverlib/pin_map.h"
-#include "driverlib/gpio.h"
-#include "driverlib/timer.h"
-#include "driverlib/interrupt.h"
+/*----------------------------- Include Files -----------------------------*/
+#include <xc.h>
+#include <sys/attribs.h>
 
 // the header to get the timing functions
 #include "ES_ShortTimer.h"
 
 // the framework headers
-#include "ES_Framework.h"
 #include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_Timers.h"
+#include "ES_Port.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+// the end of the list of running timers
+#define NO_TIMER 0xFF
 
-// module level functions
+// a timer closer to due than this when the list is looked at is treated
+// as due, it could not be timed by the hardware any more closely than that
+#define MIN_LEAD_COUNTS (1 * _HW_COUNTS_PER_US)
 
-// define for the timer pre-scaler. this sets the resolution of the
-// timing functions
-// the current values are based on a 40mHz clock rate to give 1uS resolution
-#define PRE_1uS 40
+// the interrupt priority, keep it in step with the IPL in the __ISR below
+#define SHORT_TIMER_IPL 6
 
-void ShortTimerAHandler(void);
-void ShortTimerBHandler(void);
+ES_STATIC_ASSERT(ES_NUM_SHORT_TIMERS < NO_TIMER, too_many_short_timers);
 
-// module level variables
+// the ISR posts, so it must be held off by the framework's critical regions
+#if SHORT_TIMER_IPL > ES_CRITICAL_IPL
+#error "SHORT_TIMER_IPL must not be above ES_CRITICAL_IPL"
+#endif
+
+/*---------------------------- Module Functions ---------------------------*/
+static void InsertTimer(uint8_t Which);
+static void RemoveTimer(uint8_t Which);
+static void ProgramHardware(void);
+void ShortTimerISR(void);
+
+/*---------------------------- Module Variables ---------------------------*/
+// the service each timer posts to
+static uint8_t ServicePriority[ES_NUM_SHORT_TIMERS];
 
-static uint8_t  Timer_A_Priority  = SHORT_TIMER_UNUSED;
-static uint8_t  Timer_B_Priority  = SHORT_TIMER_UNUSED;
+// the running timers in order of expiry, linked through NextTimer
+static uint64_t ExpiryTime[ES_NUM_SHORT_TIMERS];
+static uint8_t NextTimer[ES_NUM_SHORT_TIMERS];
+static bool IsRunning[ES_NUM_SHORT_TIMERS];
+static uint8_t FirstTimer = NO_TIMER;
 
-//******************************
-// ES_ShortTimerInit()
-// Initialize the timer subsystem and log the services to which the timeout
-// messages will be posted
-//******************************
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_ShortTimerInit
+ Parameters
+   uint8_t TimeAPrio : the service that TIMER_A's timeouts go to
+   uint8_t TimeBPrio : the service that TIMER_B's timeouts go to
+ Returns
+   nothing
+ Description
+   sets up Timer4/Timer5 and stops all of the short timers. Either service
+   may be SHORT_TIMER_UNUSED. The other timers go to no service until they
+   are given one with ES_ShortTimerSetService.
+ Notes
+   called from a service's init function
+ Author
+   J. Edward Carryer, 10/11/15 10:30
+****************************************************************************/
 void ES_ShortTimerInit(uint8_t TimeAPrio, uint8_t TimeBPrio)
 {
-#ifdef DEBUG
-// set up I/O lines for debugging
-  SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
-  GPIOPinTypeGPIOOutput(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1);
-// start with the lines low
-  GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1, BIT0LO & BIT1LO);
-#endif
+  uint8_t i;
+
+  // stop the hardware and keep it from interrupting while we set up
+  IEC0CLR = _IEC0_T5IE_MASK;
+  T4CONbits.ON = 0;
+  // a 32 bit timer from the peripheral clock with no prescale
+  T4CONbits.TCS = 0;
+  T4CONbits.TGATE = 0;
+  T4CONbits.TCKPS = 0;
+  T4CONbits.T32 = 1;
+  TMR4 = 0;
+
+  FirstTimer = NO_TIMER;
+  for (i = 0; i < ES_NUM_SHORT_TIMERS; i++)
+  {
+    IsRunning[i] = false;
+    ServicePriority[i] = SHORT_TIMER_UNUSED;
+  }
+  ServicePriority[SHORT_TIMER_A] = TimeAPrio;
+  ServicePriority[SHORT_TIMER_B] = TimeBPrio;
 
-// enable the clock to the timer module
-  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER5);
-// configure as 2 16 bit timers
-  TimerConfigure(TIMER5_BASE, TIMER_CFG_SPLIT_PAIR | TIMER_CFG_A_ONE_SHOT |
-      TIMER_CFG_B_ONE_SHOT);
-// set prescale to get 1uS resolution
-  TimerPrescaleSet(TIMER5_BASE, TIMER_BOTH, PRE_1uS);
-// log the service to which the timeout will be posted
-  Timer_A_Priority  = TimeAPrio;
-  Timer_B_Priority  = TimeBPrio;
+  // the 32 bit timer interrupts through Timer5
+  INTCONbits.MVEC = 1;
+  IPC5bits.T5IP = SHORT_TIMER_IPL;
+  IFS0CLR = _IFS0_T5IF_MASK;
+  IEC0SET = _IEC0_T5IE_MASK;
 }
 
+/****************************************************************************
+ Function
+   ES_ShortTimerSetService
+ Parameters
+   uint8_t Which : the timer
+   uint8_t Priority : the service its timeouts are to go to, or
+                      SHORT_TIMER_UNUSED
+ Returns
+   bool : false if there is no such timer
+ Description
+   for the timers after TIMER_A and TIMER_B, which ES_ShortTimerInit
+   can't name
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+bool ES_ShortTimerSetService(uint8_t Which, uint8_t Priority)
+{
+  if (Which >= ES_NUM_SHORT_TIMERS)
+  {
+    return false;
+  }
+  ServicePriority[Which] = Priority;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ShortTimerStart
+ Parameters
+   uint32_t Which : the timer to start
+   uint16_t TimeoutValue : the time to ES_SHORT_TIMEOUT, in microseconds
+ Returns
+   nothing
+ Description
+   (re)starts the timer to time out TimeoutValue microseconds from now. A
+   time too short to set the hardware for is posted right away.
+ Notes
+   for services. The list is shared with the interrupt, so it is changed
+   in a critical region.
+ Author
+   J. Edward Carryer, 10/11/15 10:30
+****************************************************************************/
 void ES_ShortTimerStart(uint32_t Which, uint16_t TimeoutValue)
 {
-  if ((Which != TIMER_A) && (Which != TIMER_B))
+  ES_Event_t ThisEvent;
+  uint32_t Counts = (uint32_t)TimeoutValue * _HW_COUNTS_PER_US;
+  bool PostNow;
+
+  if (Which >= ES_NUM_SHORT_TIMERS)
   {
     return;
   }
-  // for very short delays. just immediatly post. There is 10us of overhead
-  if (TimeoutValue < 11)
+  EnterCritical();
+  if (IsRunning[Which])
   {
-    if (Which == TIMER_A)
-    {
-      ShortTimerAHandler();
-    }
-    else
-    {
-      ShortTimerBHandler();
-    }
+    RemoveTimer(Which);
   }
-  TimerLoadSet(TIMER5_BASE, Which, TimeoutValue);
-
-  if (Which == TIMER_A) // local enable
+  // decided in here, once ExitCritical lets the ISR in it may already
+  // have timed the timer out and cleared IsRunning
+  PostNow = (Counts <= MIN_LEAD_COUNTS);
+  if (!PostNow)
   {
-    TimerIntEnable(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
-    // NVIC Enable
-    IntEnable(INT_TIMER5A_TM4C123);
+    ExpiryTime[Which] = ES_Time_Now() + Counts;
+    InsertTimer(Which);
   }
-  else
+  // the head of the list may have changed either way
+  ProgramHardware();
+  ExitCritical();
+
+  if (PostNow && (ServicePriority[Which] != SHORT_TIMER_UNUSED))
   {
-    // local enable
-    TimerIntEnable(TIMER5_BASE, TIMER_TIMB_TIMEOUT);
-    // NVIC Enable
-    IntEnable(INT_TIMER5B_TM4C123);
+    ThisEvent.EventType = ES_SHORT_TIMEOUT;
+    ThisEvent.EventParam = Which;
+    ES_PostToService(ServicePriority[Which], ThisEvent);
   }
+}
 
-  TimerEnable(TIMER5_BASE, Which);
-
-#ifdef DEBUG
-// raise I/O line to show we started
-  if (Which == TIMER_A)
+/****************************************************************************
+ Function
+   ES_ShortTimerStop
+ Parameters
+   uint32_t Which : the timer to stop
+ Returns
+   nothing
+ Description
+   stops the timer if it is running. A timeout that has already been
+   posted is not taken back.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void ES_ShortTimerStop(uint32_t Which)
+{
+  if (Which >= ES_NUM_SHORT_TIMERS)
   {
-    GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0HI);
+    return;
   }
-  else
+  EnterCritical();
+  if (IsRunning[Which])
   {
-    GPIOPinWrite(GPIO_PORTB_BASE, BIT1HI, BIT1HI);
+    RemoveTimer(Which);
+    ProgramHardware();
   }
-#endif
-  return;
+  ExitCritical();
 }
 
-void ShortTimerAHandler(void)
+/****************************************************************************
+ Function
+   ShortTimerISR
+ Parameters
+   none
+ Returns
+   nothing
+ Description
+   the Timer4/Timer5 period match, the first timer in the list is due.
+   Posts the timeouts of it and any others that are due, then sets up the
+   hardware for the next.
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void __ISR(_TIMER_5_VECTOR, IPL6SOFT) ShortTimerISR(void)
 {
   ES_Event_t ThisEvent;
+  uint64_t DueBy;
+  uint8_t Which;
 
-// start by clearing the source of the interrupt
-  TimerIntClear(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
-#ifdef DEBUG
-// lower I/O line to show we arrived
-  GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0LO);
-#endif
+  ES_PROFILE_ISR_ENTER();
+  T4CONbits.ON = 0;
+  IFS0CLR = _IFS0_T5IF_MASK;
 
-// post the timeout for this timer
-  ThisEvent.EventType   = ES_SHORT_TIMEOUT;
-  ThisEvent.EventParam  = TIMER_A;
-// protect against timer that was not correctly initialized
-  if (Timer_A_Priority != SHORT_TIMER_UNUSED)
+  ThisEvent.EventType = ES_SHORT_TIMEOUT;
+  DueBy = ES_Time_Now() + MIN_LEAD_COUNTS;
+  while ((FirstTimer != NO_TIMER) && (ExpiryTime[FirstTimer] <= DueBy))
   {
-    ES_PostToService(Timer_A_Priority, ThisEvent);
+    Which = FirstTimer;
+    FirstTimer = NextTimer[Which];
+    IsRunning[Which] = false;
+    // protect against timer that was not correctly initialized
+    if (ServicePriority[Which] != SHORT_TIMER_UNUSED)
+    {
+      ThisEvent.EventParam = Which;
+      ES_PostToService(ServicePriority[Which], ThisEvent);
+    }
   }
+  ProgramHardware();
+  ES_PROFILE_ISR_EXIT();
 }
 
-void ShortTimerBHandler(void)
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+   InsertTimer
+ Description
+   links a timer that is not running into the list at its ExpiryTime,
+   after any that are due at the same time
+ Notes
+   called with interrupts disabled
+****************************************************************************/
+static void InsertTimer(uint8_t Which)
 {
-  ES_Event_t ThisEvent;
+  uint8_t *pLink = &FirstTimer;
 
-// start by clearing the source of the interrupt
-  TimerIntClear(TIMER5_BASE, TIMER_TIMB_TIMEOUT);
-#ifdef DEBUG
-// lower I/O line to show we arrived
-  GPIOPinWrite(GPIO_PORTB_BASE, BIT1HI, BIT1LO);
-#endif
+  while ((*pLink != NO_TIMER) && (ExpiryTime[*pLink] <= ExpiryTime[Which]))
+  {
+    pLink = &NextTimer[*pLink];
+  }
+  NextTimer[Which] = *pLink;
+  *pLink = Which;
+  IsRunning[Which] = true;
+}
+
+/****************************************************************************
+ Function
+   RemoveTimer
+ Description
+   unlinks a running timer
+ Notes
+   called with interrupts disabled
+****************************************************************************/
+static void RemoveTimer(uint8_t Which)
+{
+  uint8_t *pLink = &FirstTimer;
 
-// post the timeout for this timer
-  ThisEvent.EventType   = ES_SHORT_TIMEOUT;
-  ThisEvent.EventParam  = TIMER_B;
-// protect against timer that was not correctly initialized
-  if (Timer_B_Priority != SHORT_TIMER_UNUSED)
+  while (*pLink != Which)
   {
-    ES_PostToService(Timer_B_Priority, ThisEvent);
+    pLink = &NextTimer[*pLink];
   }
+  *pLink = NextTimer[Which];
+  IsRunning[Which] = false;
 }
 
+/****************************************************************************
+ Function
+   ProgramHardware
+ Description
+   stops Timer4/Timer5 and, if any timer is running, restarts it to
+   interrupt when the first one is due
+ Notes
+   called with interrupts disabled, or from the ISR. The timer flags a
+   period match PR4 + 1 counts after it starts.
+****************************************************************************/
+static void ProgramHardware(void)
+{
+  uint64_t Now;
+  uint32_t Counts = MIN_LEAD_COUNTS;
+
+  T4CONbits.ON = 0;
+  IFS0CLR = _IFS0_T5IF_MASK;
+  if (FirstTimer == NO_TIMER)
+  {
+    return;
+  }
+  Now = ES_Time_Now();
+  if (ExpiryTime[FirstTimer] > Now + MIN_LEAD_COUNTS)
+  {
+    Counts = (uint32_t)(ExpiryTime[FirstTimer] - Now);
+  }
+  TMR4 = 0;
+  PR4 = Counts - 1;
+  T4CONbits.ON = 1;
+}
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -3,16 +3,47 @@
      ES_Timers.c
 
  Description
-     This is a module implementing  8 16 bit timers all using the RTI
-     timebase
+     This is a module implementing  16 16 bit timers all using the RTI
+     timebase, plus ES_NUM_DYNAMIC_TIMERS more that services take and give
+     back at run time
 
  Notes
      Everything is done in terms of RTI Ticks, which can change from
      application to application.
+     The active timers are kept in a delta list: a list in order of expiry
+     where each timer holds the ticks from the expiry of the timer before
+     it. A tick only has to decrement the first timer in the list, so it
+     costs the same however many timers are running, and only the timers
+     that expire cost more. Timers that expire on the same tick are kept
+     highest number first, the order the timers have always been posted in.
+     The dynamic timers are numbered on from the 16 fixed ones and share the
+     delta list with them. A service refers to one by a handle that holds
+     its number and a generation, which moves on each time the timer is
+     freed, so a handle kept after ES_Timer_Free is refused. The timeout
+     carries the timer's arming count in place of the generation, and
+     ES_Timer_IsTimeoutFrom tells a service whether it is from the latest
+     arming or left over from one that was since stopped or re-armed.
+     A periodic timer is put straight back in the list when it expires,
+     Period ticks on from the tick it was due on, so it keeps to its
+     schedule however late its timeouts are handled.
 
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 06:00 ahb      ES_Timer_SetTimer leaves a running timer running,
+                         with the new time, as it did before the delta list
+ 10/16/26 22:10 ahb      timers catch up on the ticks before the delta list is
+                         changed, for the tickless mode
+ 10/16/26 21:10 ahb      added periodic timers and the timer callbacks
+ 10/16/26 20:40 ahb      added the dynamic timers and their handles
+ 10/16/26 20:10 ahb      added the 64 bit ES_Time clock
+ 10/16/26 19:40 ahb      active timers are kept in a delta list so that a tick
+                         is O(1), added ES_Timer_AdvanceTicks and a tick cost
+                         benchmark
+ 10/16/26 13:00 ahb      trace timer expiries
+ 10/16/26 11:30 ahb      protect TMR_ActiveFlags updates from the tick when
+                         running under the preemptive kernel
+ 10/16/26 10:40 ahb      added ES_Timer_GetTicksToNextExpiry for idle mode
  10/27/14 14:02 jec      moved ticking of 'time' to ES_Port to allow it to tick
                          even while blocking. required change to ES_GetTime too
  10/20/13 10:48 jec      moved definition of BITS_PER_BYTE to ES_General.h
@@ -50,48 +81,134 @@
 #include "../FrameworkHeaders/ES_LookupTables.h"
 #include "../FrameworkHeaders/ES_Timers.h"
 #include "../FrameworkHeaders/ES_Port.h"
+#include "../FrameworkHeaders/ES_Trace.h"
 /*--------------------------- External Variables --------------------------*/
 
 /*----------------------------- Module Defines ----------------------------*/
+// under the preemptive kernel the tick is processed from the scheduler
+// interrupt, which can preempt a service part way through updating
+// TMR_ActiveFlags
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+#define TIMER_LOCK() EnterCritical()
+#define TIMER_UNLOCK() ExitCritical()
+#else
+#define TIMER_LOCK()
+#define TIMER_UNLOCK()
+#endif
+
+// in tickless mode the port only counts the ticks as they are needed. A
+// timer has to be started or stopped against the current tick, so before
+// the delta list is changed the timers are brought up to date.
+#ifdef ES_USE_TICKLESS
+#define CATCH_UP_TICKS() CatchUpTicks()
+#else
+#define CATCH_UP_TICKS()
+#endif
 
 /*------------------------------ Module Types -----------------------------*/
 
 /*
-   the size of Tflag sets the number of timers, uint8 = 8, uint16 = 16 ...)
-   to add more timers, you will need to change the data type and modify
-   the initialization of TMR_TimerArray and TMR_MaskArray
+   the size of Tflag sets the number of fixed timers, uint8 = 8,
+   uint16 = 16 ...) to add more of those, you will need to change the data
+   type and modify the initialization of Timer2PostFunc
 */
 
 typedef uint16_t Tflag_t;
 
 typedef uint16_t Timer_t; // sets size of timers to 16 bits
 
+#define FLAG_BITS (sizeof(Tflag_t) * BITS_PER_BYTE)
+#define NUM_STATIC_TIMERS FLAG_BITS
+#define NUM_TIMERS (NUM_STATIC_TIMERS + ES_NUM_DYNAMIC_TIMERS)
+
+// the end of the delta list, and of the list of free dynamic timers
+#define NO_TIMER 0xFF
+
+// the service of a dynamic timer that nobody has allocated
+#define NO_SERVICE 0xFF
+
+// each Tflag_t of TMR_ActiveFlags holds the flags of FLAG_BITS timers
+#define IS_ACTIVE(Num) \
+  ((TMR_ActiveFlags[(Num) / FLAG_BITS] & BitNum2SetMask[(Num) % FLAG_BITS]) \
+      != 0)
+#define SET_ACTIVE(Num) \
+  (TMR_ActiveFlags[(Num) / FLAG_BITS] |= BitNum2SetMask[(Num) % FLAG_BITS])
+#define CLR_ACTIVE(Num) \
+  (TMR_ActiveFlags[(Num) / FLAG_BITS] &= BitNum2ClrMask[(Num) % FLAG_BITS])
+
+// a handle is the timer number in the low byte and a generation in the
+// high byte
+#define HANDLE_NUM(Handle) ((uint8_t)(Handle))
+#define HANDLE_GEN(Handle) ((uint8_t)((Handle) >> 8))
+#define MAKE_HANDLE(Num, Gen) ((ES_TimerHandle_t)(((uint16_t)(Gen) << 8) | (Num)))
+
+// a fixed timer needs somewhere for its timeouts to go
+#ifdef ES_USE_TIMER_CALLBACKS
+#define HAS_NO_TARGET(Num) \
+  ((Timer2PostFunc[Num] == TIMER_UNUSED) && (TMR_Callback[Num] == NULL))
+#else
+#define HAS_NO_TARGET(Num) (Timer2PostFunc[Num] == TIMER_UNUSED)
+#endif
+
+// timer numbers must stay clear of NO_TIMER
+ES_STATIC_ASSERT(NUM_TIMERS < NO_TIMER, too_many_dynamic_timers);
+
+// the benchmark in the TEST build gives every timer a post function
+#ifdef TEST
+#define TIMER_POST_CONST
+#else
+#define TIMER_POST_CONST const
+#endif
+
 /*---------------------------- Module Functions ---------------------------*/
+static void InsertTimer(uint8_t Num, Timer_t NewTime);
+static void RemoveTimer(uint8_t Num);
+static void ExpireTimers(void);
+#ifdef ES_USE_TICKLESS
+static void CatchUpTicks(void);
+#endif
+#if ES_NUM_DYNAMIC_TIMERS > 0
+static uint8_t GetDynamicTimer(ES_TimerHandle_t Handle);
+static ES_TimerReturn_t ArmTimer(ES_TimerHandle_t Handle, Timer_t NewTime,
+                                 Timer_t Period);
+#endif
 
 /*---------------------------- Module Variables ---------------------------*/
-static Timer_t TMR_TimerArray[sizeof(Tflag_t) * BITS_PER_BYTE] =
-{
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0,
-  0x0
-};
+// for a timer that is not running, the time it will run for when started.
+// For a running timer, the ticks between the expiry of the timer before it
+// in the delta list (or now, for the first) and its own expiry.
+static Timer_t TMR_TimerArray[NUM_TIMERS];
+
+static Tflag_t TMR_ActiveFlags[(NUM_TIMERS + FLAG_BITS - 1) / FLAG_BITS];
+
+// the delta list, linked through the timer numbers in both directions.
+// The free dynamic timers are kept on a list linked through TMR_Next.
+static uint8_t TMR_First = NO_TIMER;
+static uint8_t TMR_Next[NUM_TIMERS];
+static uint8_t TMR_Prev[NUM_TIMERS];
 
-static Tflag_t TMR_ActiveFlags;
+// the ticks a periodic timer is reloaded with when it expires, 0 for a
+// one shot timer
+static Timer_t TMR_Period[NUM_TIMERS];
 
-static pPostFunc const Timer2PostFunc[sizeof(Tflag_t) * BITS_PER_BYTE] =
+#ifdef ES_USE_TIMER_CALLBACKS
+// called in place of the post function, if not NULL
+static ES_TimerCallback_t *TMR_Callback[NUM_STATIC_TIMERS];
+#endif
+
+#if ES_NUM_DYNAMIC_TIMERS > 0
+// for each dynamic timer, indexed from 0: the service its timeouts go
+// to, the generation in its handle and the number of times it has been
+// armed, stopped or freed
+static uint8_t TMR_Service[ES_NUM_DYNAMIC_TIMERS];
+static uint8_t TMR_Generation[ES_NUM_DYNAMIC_TIMERS];
+static uint8_t TMR_ArmCount[ES_NUM_DYNAMIC_TIMERS];
+
+// the head of the list of free dynamic timers
+static uint8_t TMR_FirstFree = NO_TIMER;
+#endif
+
+static pPostFunc TIMER_POST_CONST Timer2PostFunc[NUM_STATIC_TIMERS] =
 {
   TIMER0_RESP_FUNC,
   TIMER1_RESP_FUNC,
@@ -122,7 +239,7 @@ static pPostFunc const Timer2PostFunc[sizeof(Tflag_t) * BITS_PER_BYTE] =
      None.
  Description
      Initializes the timer module by setting up the tick at the requested
-    rate
+    rate, and puts all of the dynamic timers on the free list
  Notes
      None.
  Author
@@ -130,6 +247,17 @@ static pPostFunc const Timer2PostFunc[sizeof(Tflag_t) * BITS_PER_BYTE] =
 ****************************************************************************/
 void ES_Timer_Init(TimerRate_t Rate)
 {
+#if ES_NUM_DYNAMIC_TIMERS > 0
+  uint8_t i;
+
+  TMR_FirstFree = NO_TIMER;
+  for (i = ES_NUM_DYNAMIC_TIMERS; i > 0; i--)
+  {
+    TMR_Service[i - 1] = NO_SERVICE;
+    TMR_Next[NUM_STATIC_TIMERS + i - 1] = TMR_FirstFree;
+    TMR_FirstFree = NUM_STATIC_TIMERS + i - 1;
+  }
+#endif
   // call the hardware init routine
   _HW_Timer_Init(Rate);
 }
@@ -146,21 +274,35 @@ void ES_Timer_Init(TimerRate_t Rate)
  Description
      sets the time for a timer, but does not make it active.
  Notes
-     None.
+     a timer that is already running keeps running, with NewTime from now,
+     as it always has
  Author
      J. Edward Carryer, 02/24/97 17:11
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
 {
   /* tried to set a timer that doesn't exist */
-  if ((Num >= ARRAY_SIZE(TMR_TimerArray)) ||
+  if ((Num >= ARRAY_SIZE(Timer2PostFunc)) ||
       /* tried to set a timer without a service */
-      (Timer2PostFunc[Num] == TIMER_UNUSED) ||
+      HAS_NO_TARGET(Num) ||
       (NewTime == 0))   /* no time being set */
   {
     return ES_Timer_ERR;
   }
-  TMR_TimerArray[Num] = NewTime;
+  CATCH_UP_TICKS();
+  TIMER_LOCK();
+  TMR_Period[Num] = 0;
+  if (IS_ACTIVE(Num))
+  {
+    // move it to its new place in the delta list
+    RemoveTimer(Num);
+    InsertTimer(Num, NewTime);
+  }
+  else
+  {
+    TMR_TimerArray[Num] = NewTime;
+  }
+  TIMER_UNLOCK();
   return ES_Timer_OK;
 }
 
@@ -172,23 +314,33 @@ ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
  Returns
      ES_Timer_ERR for error ES_Timer_OK for success
  Description
-     simply sets the active flag in TMR_ActiveFlags to (re)start a
-     stopped timer.
+     puts a stopped timer into the delta list to (re)start it with the
+     time it has left.
  Notes
-     None.
+     starting a timer that is already running does nothing.
  Author
      J. Edward Carryer, 02/24/97 14:45
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num)
 {
   /* tried to set a timer that doesn't exist */
-  if ((Num >= ARRAY_SIZE(TMR_TimerArray)) ||
-      /* tried to set a timer with no time on it */
-      (TMR_TimerArray[Num] == 0))
+  if (Num >= ARRAY_SIZE(Timer2PostFunc))
   {
     return ES_Timer_ERR;
   }
-  TMR_ActiveFlags |= BitNum2SetMask[Num];  /* set timer as active */
+  CATCH_UP_TICKS();
+  TIMER_LOCK();
+  if (!IS_ACTIVE(Num))
+  {
+    /* tried to start a timer with no time on it */
+    if (TMR_TimerArray[Num] == 0)
+    {
+      TIMER_UNLOCK();
+      return ES_Timer_ERR;
+    }
+    InsertTimer(Num, TMR_TimerArray[Num]);
+  }
+  TIMER_UNLOCK();
   return ES_Timer_OK;
 }
 
@@ -200,20 +352,26 @@ ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num)
  Returns
      ES_Timer_ERR for error (timer doesn't exist) ES_Timer_OK for success.
  Description
-     simply clears the bit in TMR_ActiveFlags associated with this
-     timer. This will cause it to stop counting.
+     takes the timer out of the delta list. This will cause it to stop
+     counting, with the time it has left kept for ES_Timer_StartTimer.
  Notes
-     None.
+     working out the time left walks the list up to the timer.
  Author
      J. Edward Carryer, 02/24/97 14:48
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
 {
-  if (Num >= ARRAY_SIZE(TMR_TimerArray))
+  if (Num >= ARRAY_SIZE(Timer2PostFunc))
   {
     return ES_Timer_ERR;    /* tried to set a timer that doesn't exist */
   }
-  TMR_ActiveFlags &= BitNum2ClrMask[Num];  /* set timer as inactive */
+  CATCH_UP_TICKS();
+  TIMER_LOCK();
+  if (IS_ACTIVE(Num))
+  {
+    RemoveTimer(Num);
+  }
+  TIMER_UNLOCK();
   return ES_Timer_OK;
 }
 
@@ -229,25 +387,322 @@ ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
      sets the NewTime into the chosen timer and sets the timer active to
      begin counting.
  Notes
-     None.
+     a running timer is restarted with NewTime, as a one shot.
  Author
      J. Edward Carryer, 02/24/97 14:51
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
 {
   /* tried to set a timer that doesn't exist */
-  if ((Num >= ARRAY_SIZE(TMR_TimerArray)) ||
+  if ((Num >= ARRAY_SIZE(Timer2PostFunc)) ||
       /* tried to set a timer without a service */
-      (Timer2PostFunc[Num] == TIMER_UNUSED) ||
+      HAS_NO_TARGET(Num) ||
       /* tried to set a timer without putting any time on it */
       (NewTime == 0))
   {
     return ES_Timer_ERR;
   }
-  TMR_TimerArray[Num] = NewTime;
-  TMR_ActiveFlags     |= BitNum2SetMask[Num]; /* set timer as active */
+  CATCH_UP_TICKS();
+  TIMER_LOCK();
+  if (IS_ACTIVE(Num))
+  {
+    RemoveTimer(Num);
+  }
+  TMR_Period[Num] = 0;
+  InsertTimer(Num, NewTime);
+  TIMER_UNLOCK();
+  return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_InitPeriodic
+ Parameters
+     unsigned char Num, the number of the timer to start
+     unsigned int Period, the number of ticks between timeouts
+ Returns
+     ES_Timer_ERR if the requested timer does not exist, has no service or
+     Period is 0, ES_Timer_OK otherwise.
+ Description
+     starts the timer to expire every Period ticks, the first time Period
+     ticks from now, until it is stopped or restarted as a one shot
+ Notes
+     each reload counts from the tick the timer was due on, not from when
+     the timeout is handled, so the timeouts don't drift
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_InitPeriodic(uint8_t Num, uint16_t Period)
+{
+  if ((Num >= ARRAY_SIZE(Timer2PostFunc)) || HAS_NO_TARGET(Num) ||
+      (Period == 0))
+  {
+    return ES_Timer_ERR;
+  }
+  CATCH_UP_TICKS();
+  TIMER_LOCK();
+  if (IS_ACTIVE(Num))
+  {
+    RemoveTimer(Num);
+  }
+  TMR_Period[Num] = Period;
+  InsertTimer(Num, Period);
+  TIMER_UNLOCK();
+  return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_SetPeriod
+ Parameters
+     unsigned char Num, the number of the timer
+     unsigned int Period, the new number of ticks between timeouts, 0 to
+     stop after the next timeout
+ Returns
+     ES_Timer_ERR if the requested timer does not exist, ES_Timer_OK
+     otherwise.
+ Description
+     changes the reload of a timer without touching the time it has left,
+     so the new period starts from the timer's next expiry. Called on a
+     timeout it takes effect from the reload after the one that has just
+     been made.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_SetPeriod(uint8_t Num, uint16_t Period)
+{
+  if (Num >= ARRAY_SIZE(Timer2PostFunc))
+  {
+    return ES_Timer_ERR;
+  }
+  TIMER_LOCK();
+  TMR_Period[Num] = Period;
+  TIMER_UNLOCK();
+  return ES_Timer_OK;
+}
+
+#ifdef ES_USE_TIMER_CALLBACKS
+/****************************************************************************
+ Function
+     ES_Timer_SetCallback
+ Parameters
+     unsigned char Num, the number of the timer
+     ES_TimerCallback_t * pCallback, the function to call when the timer
+     expires, or NULL to go back to posting ES_TIMEOUT
+ Returns
+     ES_Timer_ERR if the requested timer does not exist, ES_Timer_OK
+     otherwise.
+ Description
+     has the timer call pCallback with its number when it expires, in
+     place of posting a timeout to its service. With a periodic timer that
+     makes for cheap housekeeping: no event, no queue and no dispatch.
+ Notes
+     the callback runs from _HW_Process_Pending_Ints, in the middle of the
+     tick processing, so it must be short. It may post events and start or
+     stop timers, itself included. A timer with a callback needs no post
+     function in ES_Configure.h.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_SetCallback(uint8_t Num,
+                                      ES_TimerCallback_t *pCallback)
+{
+  if (Num >= ARRAY_SIZE(Timer2PostFunc))
+  {
+    return ES_Timer_ERR;
+  }
+  TIMER_LOCK();
+  TMR_Callback[Num] = pCallback;
+  TIMER_UNLOCK();
   return ES_Timer_OK;
 }
+#endif
+
+#if ES_NUM_DYNAMIC_TIMERS > 0
+/****************************************************************************
+ Function
+     ES_Timer_Alloc
+ Parameters
+     uint8_t WhichService, the service that the timeouts are to go to
+ Returns
+     ES_TimerHandle_t, the handle for the timer, or ES_TIMER_NO_HANDLE if
+     all of the dynamic timers are taken
+ Description
+     takes a dynamic timer off the free list for a service. The timer is
+     stopped until it is armed with ES_Timer_Arm.
+ Notes
+     the timeout events carry the handle in EventParam, with the arming
+     count in place of the generation, see ES_Timer_IsTimeoutFrom
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+ES_TimerHandle_t ES_Timer_Alloc(uint8_t WhichService)
+{
+  uint8_t Num;
+
+  if (WhichService >= NUM_SERVICES)
+  {
+    return ES_TIMER_NO_HANDLE;
+  }
+  TIMER_LOCK();
+  Num = TMR_FirstFree;
+  if (Num == NO_TIMER)
+  {
+    TIMER_UNLOCK();
+    return ES_TIMER_NO_HANDLE;
+  }
+  TMR_FirstFree = TMR_Next[Num];
+  TMR_TimerArray[Num] = 0;
+  TMR_Service[Num - NUM_STATIC_TIMERS] = WhichService;
+  TIMER_UNLOCK();
+  return MAKE_HANDLE(Num, TMR_Generation[Num - NUM_STATIC_TIMERS]);
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_Free
+ Parameters
+     ES_TimerHandle_t Handle, from ES_Timer_Alloc
+ Returns
+     ES_Timer_ERR if the handle is not one that is allocated,
+     ES_Timer_OK otherwise
+ Description
+     stops the timer and puts it back on the free list. The handle, and any
+     timeout from the timer still in a queue, are no good from here on.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_Free(ES_TimerHandle_t Handle)
+{
+  uint8_t Num;
+
+  CATCH_UP_TICKS();
+  TIMER_LOCK();
+  Num = GetDynamicTimer(Handle);
+  if (Num == NO_TIMER)
+  {
+    TIMER_UNLOCK();
+    return ES_Timer_ERR;
+  }
+  if (IS_ACTIVE(Num))
+  {
+    RemoveTimer(Num);
+  }
+  TMR_ArmCount[Num - NUM_STATIC_TIMERS]++;
+  TMR_Generation[Num - NUM_STATIC_TIMERS]++;
+  TMR_Service[Num - NUM_STATIC_TIMERS] = NO_SERVICE;
+  TMR_Next[Num] = TMR_FirstFree;
+  TMR_FirstFree = Num;
+  TIMER_UNLOCK();
+  return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_Arm
+ Parameters
+     ES_TimerHandle_t Handle, from ES_Timer_Alloc
+     uint16_t NewTime, the number of ticks to be counted
+ Returns
+     ES_Timer_ERR if the handle is not one that is allocated or NewTime
+     is 0, ES_Timer_OK otherwise.
+ Description
+     ES_Timer_InitTimer for a dynamic timer. A timeout from an earlier
+     arming that is still in the service's queue becomes stale.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_Arm(ES_TimerHandle_t Handle, uint16_t NewTime)
+{
+  return ArmTimer(Handle, NewTime, 0);
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_ArmPeriodic
+ Parameters
+     ES_TimerHandle_t Handle, from ES_Timer_Alloc
+     uint16_t Period, the number of ticks between timeouts
+ Returns
+     ES_Timer_ERR if the handle is not one that is allocated or Period
+     is 0, ES_Timer_OK otherwise.
+ Description
+     ES_Timer_InitPeriodic for a dynamic timer. Every timeout until it is
+     next armed, disarmed or freed counts as current.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_ArmPeriodic(ES_TimerHandle_t Handle,
+                                      uint16_t Period)
+{
+  return ArmTimer(Handle, Period, Period);
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_Disarm
+ Parameters
+     ES_TimerHandle_t Handle, from ES_Timer_Alloc
+ Returns
+     ES_Timer_ERR if the handle is not one that is allocated,
+     ES_Timer_OK otherwise
+ Description
+     stops a dynamic timer. A timeout from it that is still in the
+     service's queue becomes stale.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_Disarm(ES_TimerHandle_t Handle)
+{
+  uint8_t Num;
+
+  CATCH_UP_TICKS();
+  TIMER_LOCK();
+  Num = GetDynamicTimer(Handle);
+  if (Num == NO_TIMER)
+  {
+    TIMER_UNLOCK();
+    return ES_Timer_ERR;
+  }
+  if (IS_ACTIVE(Num))
+  {
+    RemoveTimer(Num);
+  }
+  TMR_ArmCount[Num - NUM_STATIC_TIMERS]++;
+  TIMER_UNLOCK();
+  return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_IsTimeoutFrom
+ Parameters
+     ES_Event_t ThisEvent, an event the service has been given
+     ES_TimerHandle_t Handle, one of the service's dynamic timers
+ Returns
+     bool, true if ThisEvent is a timeout from the timer's latest arming
+ Description
+     lets a service pick out its timeouts and pass over stale ones, those
+     from a timer that has since been re-armed, stopped or freed. It only
+     compares the event with the timer's arming count, so it is cheap
+     enough to call for every timeout.
+ Notes
+     the arming count is 8 bits, so a timeout left in a queue while the
+     timer is armed exactly 256 more times would pass
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Timer_IsTimeoutFrom(ES_Event_t ThisEvent, ES_TimerHandle_t Handle)
+{
+  uint8_t Num = HANDLE_NUM(Handle);
+
+  return (ThisEvent.EventType == ES_TIMEOUT) &&
+         (HANDLE_NUM(ThisEvent.EventParam) == Num) &&
+         (Num >= NUM_STATIC_TIMERS) && (Num < NUM_TIMERS) &&
+         (HANDLE_GEN(ThisEvent.EventParam) ==
+          TMR_ArmCount[Num - NUM_STATIC_TIMERS]);
+}
+#endif
 
 /****************************************************************************
  Function
@@ -262,6 +717,8 @@ ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
  Notes
      this functionality is ancient, though this implementation in the library
      is new.
+     The count wraps every 65536 ticks, use ES_Time_Now for anything that
+     may take longer than that or needs better than tick resolution.
  Author
      J. Edward Carryer, 06/01/04 08:04
 ****************************************************************************/
@@ -270,6 +727,95 @@ uint16_t ES_Timer_GetTime(void)
   return _HW_GetTickCount();
 }
 
+/****************************************************************************
+ Function
+     ES_Time_Now
+ Parameters
+     None.
+ Returns
+     uint64_t : core timer counts since reset
+ Description
+     a monotonic time stamp that will not wrap in the life of the product.
+     Safe to call from ISRs as well as services.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint64_t ES_Time_Now(void)
+{
+  return _HW_GetCycleCount64();
+}
+
+/****************************************************************************
+ Function
+     ES_Time_Now_us, ES_Time_Now_ns
+ Parameters
+     None.
+ Returns
+     uint64_t : the time since reset in microseconds or nanoseconds
+ Notes
+     the microseconds take a 64 bit divide, which the PIC32 does in
+     software, so keep it out of the fast paths
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint64_t ES_Time_Now_us(void)
+{
+  return _HW_GetCycleCount64() / _HW_COUNTS_PER_US;
+}
+
+uint64_t ES_Time_Now_ns(void)
+{
+  return _HW_GetCycleCount64() * (1000 / _HW_COUNTS_PER_US);
+}
+
+/****************************************************************************
+ Function
+     ES_Time_Elapsed_us, ES_Time_Elapsed_ns
+ Parameters
+     uint64_t StartTime : an earlier ES_Time_Now
+ Returns
+     uint64_t : the time since StartTime in microseconds or nanoseconds
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint64_t ES_Time_Elapsed_us(uint64_t StartTime)
+{
+  return (_HW_GetCycleCount64() - StartTime) / _HW_COUNTS_PER_US;
+}
+
+uint64_t ES_Time_Elapsed_ns(uint64_t StartTime)
+{
+  return (_HW_GetCycleCount64() - StartTime) * (1000 / _HW_COUNTS_PER_US);
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_GetTicksToNextExpiry
+ Parameters
+     None.
+ Returns
+     the number of ticks until the next active timer expires,
+     ES_Timer_NONE_ACTIVE (0) if no timers are running
+ Description
+     Used by the idle code in ES_Port.c to decide how long it can leave
+     the core timer without a tick interrupt.
+ Notes
+     an active timer always has a count of at least 1, so 0 is free to mean
+     that nothing is running. That is the first timer in the delta list.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint16_t ES_Timer_GetTicksToNextExpiry(void)
+{
+  uint8_t First = TMR_First;
+
+  if (First == NO_TIMER)
+  {
+    return ES_Timer_NONE_ACTIVE;
+  }
+  return TMR_TimerArray[First];
+}
+
 /****************************************************************************
  Function
      ES_Timer_Tick_Resp
@@ -279,46 +825,390 @@ uint16_t ES_Timer_GetTime(void)
      None.
  Description
      This is the new Tick response routine to support the timer module.
-     It will increment time, to maintain the functionality of the
-     GetTime() timer and it will check through the active timers,
-     decrementing each active timers count, if the count goes to 0, it
-     will post an event to the corresponding SM and clear the active flag to
-     prevent further counting.
+     It counts down the first timer in the delta list. If that goes to 0,
+     it and any others that expire on the same tick are posted to their
+     SMs and taken out of the list.
  Notes
-     Called from _Timer_Int_Resp in ES_Port.c.
+     Called from _HW_Process_Pending_Ints in ES_Port.c.
  Author
      J. Edward Carryer, 02/24/97 15:06
 ****************************************************************************/
 void ES_Timer_Tick_Resp(void)
 {
-  static Tflag_t  NeedsProcessing;
-  static uint8_t  NextTimer2Process;
-  static ES_Event_t NewEvent;
+  if (TMR_First != NO_TIMER) /* then at least 1 timer is active */
+  {
+    if (--TMR_TimerArray[TMR_First] == 0)
+    {
+      ExpireTimers();
+    }
+  }
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_AdvanceTicks
+ Parameters
+     uint16_t NumTicks, the number of ticks that have passed
+ Returns
+     None.
+ Description
+     the same as calling ES_Timer_Tick_Resp NumTicks times, the timers that
+     expire are posted in the same order, but it only costs as much as
+     one tick plus the timers that expire
+ Notes
+     for the port, when it has a number of ticks to catch up on at once
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void ES_Timer_AdvanceTicks(uint16_t NumTicks)
+{
+  while ((NumTicks != 0) && (TMR_First != NO_TIMER))
+  {
+    if (TMR_TimerArray[TMR_First] > NumTicks)
+    {
+      TMR_TimerArray[TMR_First] -= NumTicks;
+      return;
+    }
+    NumTicks -= TMR_TimerArray[TMR_First];
+    TMR_TimerArray[TMR_First] = 0;
+    ExpireTimers();
+  }
+}
+
+//*********************************
+// private functions
+//*********************************
+#if ES_NUM_DYNAMIC_TIMERS > 0
+/****************************************************************************
+ Function
+     GetDynamicTimer
+ Parameters
+     ES_TimerHandle_t Handle, from a service
+ Returns
+     uint8_t, the number of the timer, or NO_TIMER if the handle is not for
+     an allocated dynamic timer of the current generation
+****************************************************************************/
+static uint8_t GetDynamicTimer(ES_TimerHandle_t Handle)
+{
+  uint8_t Num = HANDLE_NUM(Handle);
+
+  if ((Num < NUM_STATIC_TIMERS) || (Num >= NUM_TIMERS) ||
+      (TMR_Service[Num - NUM_STATIC_TIMERS] == NO_SERVICE) ||
+      (TMR_Generation[Num - NUM_STATIC_TIMERS] != HANDLE_GEN(Handle)))
+  {
+    return NO_TIMER;
+  }
+  return Num;
+}
+
+/****************************************************************************
+ Function
+     ArmTimer
+ Parameters
+     ES_TimerHandle_t Handle, from a service
+     Timer_t NewTime, the ticks to the first timeout
+     Timer_t Period, the reload, 0 for a one shot
+ Returns
+     ES_Timer_ERR for a bad handle or a NewTime of 0, ES_Timer_OK otherwise
+ Description
+     (re)starts a dynamic timer, moving on its arming count
+****************************************************************************/
+static ES_TimerReturn_t ArmTimer(ES_TimerHandle_t Handle, Timer_t NewTime,
+                                 Timer_t Period)
+{
+  uint8_t Num;
+
+  if (NewTime == 0)
+  {
+    return ES_Timer_ERR;
+  }
+  CATCH_UP_TICKS();
+  TIMER_LOCK();
+  Num = GetDynamicTimer(Handle);
+  if (Num == NO_TIMER)
+  {
+    TIMER_UNLOCK();
+    return ES_Timer_ERR;
+  }
+  if (IS_ACTIVE(Num))
+  {
+    RemoveTimer(Num);
+  }
+  TMR_ArmCount[Num - NUM_STATIC_TIMERS]++;
+  TMR_Period[Num] = Period;
+  InsertTimer(Num, NewTime);
+  TIMER_UNLOCK();
+  return ES_Timer_OK;
+}
+#endif
+
+/****************************************************************************
+ Function
+     InsertTimer
+ Parameters
+     uint8_t Num, a timer that is not in the delta list
+     Timer_t NewTime, the ticks until it is to expire, at least 1
+ Returns
+     None.
+ Description
+     walks the delta list to the place the timer expires and links it in
+     there, taking its delta from the timer after it. Among timers that
+     expire on the same tick the higher numbers go first.
+ Notes
+     called with the timers locked
+****************************************************************************/
+static void InsertTimer(uint8_t Num, Timer_t NewTime)
+{
+  uint8_t Prev = NO_TIMER;
+  uint8_t Next = TMR_First;
+
+  while ((Next != NO_TIMER) && ((TMR_TimerArray[Next] < NewTime) ||
+      ((TMR_TimerArray[Next] == NewTime) && (Next > Num))))
+  {
+    NewTime -= TMR_TimerArray[Next];
+    Prev = Next;
+    Next = TMR_Next[Next];
+  }
+  TMR_TimerArray[Num] = NewTime;
+  TMR_Prev[Num] = Prev;
+  TMR_Next[Num] = Next;
+  if (Next != NO_TIMER)
+  {
+    TMR_TimerArray[Next] -= NewTime;
+    TMR_Prev[Next] = Num;
+  }
+  if (Prev != NO_TIMER)
+  {
+    TMR_Next[Prev] = Num;
+  }
+  else
+  {
+    TMR_First = Num;
+  }
+  SET_ACTIVE(Num); /* set timer as active */
+}
+
+/****************************************************************************
+ Function
+     RemoveTimer
+ Parameters
+     uint8_t Num, a timer that is in the delta list
+ Returns
+     None.
+ Description
+     unlinks the timer, handing its delta on to the timer after it, and
+     leaves the ticks it had left in TMR_TimerArray
+ Notes
+     called with the timers locked
+****************************************************************************/
+static void RemoveTimer(uint8_t Num)
+{
+  uint8_t Prev = TMR_Prev[Num];
+  uint8_t Next = TMR_Next[Num];
+  uint8_t Before;
+  Timer_t TimeLeft = TMR_TimerArray[Num];
+
+  if (Next != NO_TIMER)
+  {
+    TMR_TimerArray[Next] += TMR_TimerArray[Num];
+    TMR_Prev[Next] = Prev;
+  }
+  if (Prev != NO_TIMER)
+  {
+    TMR_Next[Prev] = Next;
+  }
+  else
+  {
+    TMR_First = Next;
+  }
+  // add up the deltas in front of it to get the time it had left
+  for (Before = Prev; Before != NO_TIMER; Before = TMR_Prev[Before])
+  {
+    TimeLeft += TMR_TimerArray[Before];
+  }
+  TMR_TimerArray[Num] = TimeLeft;
+  CLR_ACTIVE(Num);  /* set timer as inactive */
+}
+
+/****************************************************************************
+ Function
+     ExpireTimers
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     the first timer in the list has counted down to 0. Takes it and any
+     that follow it with a delta of 0 out of the list and posts their
+     timeout events, or calls their callbacks. The periodic ones go back
+     in, Period ticks on from this one.
+****************************************************************************/
+static void ExpireTimers(void)
+{
+  ES_Event_t NewEvent;
+  uint8_t    Expired;
 
-  if (TMR_ActiveFlags != 0) /* if !=0 , then at least 1 timer is active */
+  NewEvent.EventType = ES_TIMEOUT;
+  while ((TMR_First != NO_TIMER) && (TMR_TimerArray[TMR_First] == 0))
   {
-    // start by getting a list of all the active timers
-    NeedsProcessing = TMR_ActiveFlags;
+    Expired = TMR_First;
+    /* stop counting */
+    TMR_First = TMR_Next[Expired];
+    if (TMR_First != NO_TIMER)
+    {
+      TMR_Prev[TMR_First] = NO_TIMER;
+    }
+    CLR_ACTIVE(Expired);
+    if (TMR_Period[Expired] != 0)
+    {
+      InsertTimer(Expired, TMR_Period[Expired]);
+    }
+#if ES_NUM_DYNAMIC_TIMERS > 0
+    if (Expired >= NUM_STATIC_TIMERS)
+    {
+      Expired -= NUM_STATIC_TIMERS;
+      NewEvent.EventParam = MAKE_HANDLE(Expired + NUM_STATIC_TIMERS,
+          TMR_ArmCount[Expired]);
+      ES_TRACE(ES_TRACE_TIMEOUT, Expired + NUM_STATIC_TIMERS, ES_TRACE_NONE,
+          NewEvent, 0);
+      ES_PostToService(TMR_Service[Expired], NewEvent);
+      continue;
+    }
+#endif
+    NewEvent.EventParam = Expired;
+    ES_TRACE(ES_TRACE_TIMEOUT, Expired, ES_TRACE_NONE, NewEvent, 0);
+#ifdef ES_USE_TIMER_CALLBACKS
+    if (TMR_Callback[Expired] != NULL)
+    {
+      TMR_Callback[Expired](Expired);
+      continue;
+    }
+#endif
+    /* post the timeout event to the right Service */
+    Timer2PostFunc[Expired](NewEvent);
+  }
+}
+
+#ifdef ES_USE_TICKLESS
+/****************************************************************************
+ Function
+     CatchUpTicks
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     runs the timers on by the ticks that have passed since the port last
+     handed any over, posting any timeouts that come due
+ Notes
+     may be called from a timer callback, part way through
+     ES_Timer_AdvanceTicks. The ticks it takes are new ones, so the inner
+     call just carries on where the outer one has got to.
+****************************************************************************/
+static void CatchUpTicks(void)
+{
+  uint16_t NumTicks = _HW_TakeElapsedTicks();
+
+  if (NumTicks != 0)
+  {
+    ES_Timer_AdvanceTicks(NumTicks);
+  }
+}
+
+#endif
+#ifdef TEST
+
+#include <stdio.h>
+
+// the number of ticks timed for each count of active timers
+#define TEST_TICKS 1000
+
+// core timer counts (2 CPU clocks each) per tick with n timers running,
+// TickCycles[n] for the delta list and ScanCycles[n] for the walk over all
+// of the active timers that this module did before. Read them with the
+// debugger, or over the terminal if it is set up.
+volatile uint32_t TickCycles[NUM_STATIC_TIMERS + 1];
+volatile uint32_t ScanCycles[NUM_STATIC_TIMERS + 1];
+
+// the old tick, kept here only to compare against
+static Timer_t ScanTimerArray[NUM_STATIC_TIMERS];
+static Tflag_t ScanActiveFlags;
+
+static void ScanTick(void)
+{
+  Tflag_t NeedsProcessing;
+  uint8_t NextTimer2Process;
+
+  if (ScanActiveFlags != 0)
+  {
+    NeedsProcessing = ScanActiveFlags;
     do
     {
-      // find the MSB that is set
       NextTimer2Process = ES_GetMSBitSet(NeedsProcessing);
-      /* decrement that timer, check if timed out */
-      if (--TMR_TimerArray[NextTimer2Process] == 0)
+      if (--ScanTimerArray[NextTimer2Process] == 0)
       {
-        NewEvent.EventType  = ES_TIMEOUT;
-        NewEvent.EventParam = NextTimer2Process;
-        /* post the timeout event to the right Service */
-        Timer2PostFunc[NextTimer2Process](NewEvent);
-        /* and stop counting */
-        TMR_ActiveFlags &= BitNum2ClrMask[NextTimer2Process];
+        ScanActiveFlags &= BitNum2ClrMask[NextTimer2Process];
       }
-      // mark off the active timer that we just processed
       NeedsProcessing &= BitNum2ClrMask[NextTimer2Process];
     } while (NeedsProcessing != 0);
   }
 }
 
+static bool TestPost(ES_Event_t ThisEvent)
+{
+  (void)ThisEvent;
+  return true;
+}
+
+void main(void)
+{
+  uint32_t StartTime;
+  uint16_t i;
+  uint8_t  NumActive;
+  uint8_t  Num;
+
+  for (Num = 0; Num < NUM_STATIC_TIMERS; Num++)
+  {
+    Timer2PostFunc[Num] = TestPost;
+  }
+  for (NumActive = 0; NumActive <= NUM_STATIC_TIMERS; NumActive++)
+  {
+    // start NumActive timers, long enough that none of them expire
+    for (Num = 0; Num < NUM_STATIC_TIMERS; Num++)
+    {
+      ES_Timer_StopTimer(Num);
+      ScanActiveFlags &= BitNum2ClrMask[Num];
+      if (Num < NumActive)
+      {
+        ES_Timer_InitTimer(Num, 2 * TEST_TICKS + Num);
+        ScanTimerArray[Num] = 2 * TEST_TICKS + Num;
+        ScanActiveFlags |= BitNum2SetMask[Num];
+      }
+    }
+    StartTime = _HW_GetCycleCount();
+    for (i = 0; i < TEST_TICKS; i++)
+    {
+      ES_Timer_Tick_Resp();
+    }
+    TickCycles[NumActive] = (_HW_GetCycleCount() - StartTime) / TEST_TICKS;
+    StartTime = _HW_GetCycleCount();
+    for (i = 0; i < TEST_TICKS; i++)
+    {
+      ScanTick();
+    }
+    ScanCycles[NumActive] = (_HW_GetCycleCount() - StartTime) / TEST_TICKS;
+    printf("%2u timers: delta list %lu, scan %lu counts per tick\r\n",
+        NumActive, (unsigned long)TickCycles[NumActive],
+        (unsigned long)ScanCycles[NumActive]);
+  }
+
+  while (1)
+  {
+    ;
+  }
+}
+
+#endif
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
 
@@ -0,0 +1,252 @@
+/****************************************************************************
+ Module
+     ES_Trace.c
+
+ Description
+     This is a module implementing the framework event trace: a ring of
+     fixed size records written by the framework and drained a byte at a
+     time by the terminal when it has nothing else to send.
+
+ Notes
+     The ring has many writers (services and ISRs) and one reader (the
+     terminal, from ES_Run). Writers reserve a slot with interrupts off, so
+     a record costs a call, a short critical region and 3 word stores.
+     When the ring is full new records are dropped and counted, the count
+     goes out as an ES_TRACE_DROPPED record as soon as there is room.
+
+     Each frame on the wire is:
+       0xA5 0x5A  Time(4)  EventType(2)  EventParam(2)
+       Kind(1) Source(1) Dest(1) QueueDepth(1)  XOR of the 12 record bytes
+     with the multi-byte fields little endian. Time is the core timer count,
+     the low 32 bits of ES_Time_Now. Only the low word is sent, it is cheap
+     to read in the post paths and the decoder unwraps it.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 20:10 ahb     noted that Time is the low word of ES_Time_Now
+ 10/16/26 17:40 ahb     queue depths are passed as 16 bits, 255 is recorded
+                        for anything deeper
+ 10/16/26 13:00 ahb     started coding
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Port.h"
+#include "ES_Trace.h"
+
+#ifdef ES_USE_TRACE
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+#define TRACE_MASK (ES_TRACE_SIZE - 1)
+#define RECORD_BYTES 12
+#define FRAME_BYTES (2 + RECORD_BYTES + 1)
+
+#if (ES_TRACE_SIZE & TRACE_MASK) != 0
+#error "ES_TRACE_SIZE must be a power of 2"
+#endif
+
+/*------------------------------ Module Types -----------------------------*/
+typedef struct
+{
+  uint32_t Time;
+  uint16_t EventType;
+  uint16_t EventParam;
+  uint8_t  Kind;
+  uint8_t  Source;
+  uint8_t  Dest;
+  uint8_t  QueueDepth;
+}TraceRecord_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static void BuildFrame(const TraceRecord_t *pRecord);
+
+/*---------------------------- Module Variables ---------------------------*/
+static TraceRecord_t Ring[ES_TRACE_SIZE];
+// free running indices, Head is written by the recorders, Tail by the
+// reader. They only wrap at 65536, so Head - Tail is the number in use.
+static volatile uint16_t Head;
+static volatile uint16_t Tail;
+static volatile uint16_t NumDropped;
+
+// the frame being sent and the index of the next byte to go out of it,
+// FrameIndex == FRAME_BYTES means no frame is open
+static uint8_t Frame[FRAME_BYTES];
+static uint8_t FrameIndex = FRAME_BYTES;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_Trace_Record
+ Parameters
+     ES_TraceKind_t Kind : what happened
+     uint8_t Source : the service (or ES_TRACE_FROM_xx) it came from, the
+                      timer number for ES_TRACE_TIMEOUT
+     uint8_t Dest : the service it went to, or ES_TRACE_NONE
+     ES_Event_t ThisEvent : the event involved
+     uint16_t QueueDepth : entries in Dest's queue afterwards, recorded
+                           as 255 if there are more than that
+ Returns
+     nothing
+ Description
+     adds a time stamped record to the ring, or counts it as dropped if the
+     ring is full
+ Notes
+     called through the ES_TRACE macro so that it disappears when the trace
+     is not built. Safe to call from ISRs.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void ES_Trace_Record(ES_TraceKind_t Kind, uint8_t Source, uint8_t Dest,
+    ES_Event_t ThisEvent, uint16_t QueueDepth)
+{
+  TraceRecord_t *pRecord;
+
+  EnterCritical();
+  if ((uint16_t)(Head - Tail) >= ES_TRACE_SIZE)
+  {
+    NumDropped++;
+    ExitCritical();
+    return;
+  }
+  pRecord = &Ring[Head & TRACE_MASK];
+  pRecord->Time = _HW_GetCycleCount();
+  pRecord->EventType = (uint16_t)ThisEvent.EventType;
+  pRecord->EventParam = ThisEvent.EventParam;
+  pRecord->Kind = (uint8_t)Kind;
+  pRecord->Source = Source;
+  pRecord->Dest = Dest;
+  pRecord->QueueDepth = (QueueDepth > UINT8_MAX) ? UINT8_MAX :
+      (uint8_t)QueueDepth;
+  Head++;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_Trace_GetByte
+ Parameters
+     uint8_t * : where to put the next byte to send
+ Returns
+     bool : true if there was a byte to send
+ Description
+     returns the next byte of the open frame. When no frame is open, starts
+     a new one from the oldest record (or from the dropped count)
+ Notes
+     only called by the terminal, it decides when a frame may be started
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Trace_GetByte(uint8_t *pByte)
+{
+  TraceRecord_t Record;
+
+  if (FrameIndex == FRAME_BYTES)
+  {
+    if (NumDropped != 0)
+    {
+      EnterCritical();
+      Record.EventParam = NumDropped;
+      NumDropped = 0;
+      ExitCritical();
+      Record.Time = _HW_GetCycleCount();
+      Record.EventType = ES_NO_EVENT;
+      Record.Kind = ES_TRACE_DROPPED;
+      Record.Source = ES_TRACE_NONE;
+      Record.Dest = ES_TRACE_NONE;
+      Record.QueueDepth = 0;
+    }
+    else if (Head != Tail)
+    {
+      Record = Ring[Tail & TRACE_MASK];
+      Tail++;
+    }
+    else
+    {
+      return false;
+    }
+    BuildFrame(&Record);
+  }
+  *pByte = Frame[FrameIndex++];
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_Trace_IsFrameOpen
+ Parameters
+     none
+ Returns
+     bool : true if a frame has been started but not finished
+ Description
+     the terminal must not send text in the middle of a frame
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Trace_IsFrameOpen(void)
+{
+  return FrameIndex != FRAME_BYTES;
+}
+
+/****************************************************************************
+ Function
+     ES_Trace_IsPending
+ Parameters
+     none
+ Returns
+     bool : true if there is anything left to send
+ Description
+     used to keep the core out of the idle wait while the trace drains
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool ES_Trace_IsPending(void)
+{
+  return (FrameIndex != FRAME_BYTES) || (Head != Tail) || (NumDropped != 0);
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     BuildFrame
+ Parameters
+     const TraceRecord_t * : the record to send
+ Returns
+     nothing
+ Description
+     lays the record out byte by byte, so the wire format does not depend
+     on the compiler's struct layout, and opens the frame
+****************************************************************************/
+static void BuildFrame(const TraceRecord_t *pRecord)
+{
+  uint8_t Check = 0;
+  uint8_t i;
+
+  Frame[0] = ES_TRACE_SYNC0;
+  Frame[1] = ES_TRACE_SYNC1;
+  Frame[2] = (uint8_t)pRecord->Time;
+  Frame[3] = (uint8_t)(pRecord->Time >> 8);
+  Frame[4] = (uint8_t)(pRecord->Time >> 16);
+  Frame[5] = (uint8_t)(pRecord->Time >> 24);
+  Frame[6] = (uint8_t)pRecord->EventType;
+  Frame[7] = (uint8_t)(pRecord->EventType >> 8);
+  Frame[8] = (uint8_t)pRecord->EventParam;
+  Frame[9] = (uint8_t)(pRecord->EventParam >> 8);
+  Frame[10] = pRecord->Kind;
+  Frame[11] = pRecord->Source;
+  Frame[12] = pRecord->Dest;
+  Frame[13] = pRecord->QueueDepth;
+  for (i = 2; i < (2 + RECORD_BYTES); i++)
+  {
+    Check ^= Frame[i];
+  }
+  Frame[FRAME_BYTES - 1] = Check;
+  FrameIndex = 0;
+}
+
+#endif /* ES_USE_TRACE */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -17,18 +17,24 @@
  -------------- ---     --------
  08/29/20 14:46 ram     first pass
  10/05/20 19:38 ram     starting work on PIC32 port
+ 10/16/26 13:00 ahb     send the framework event trace when there is no text
+ 10/16/26 23:40 ahb     profile the RX wake ISR
+ 10/17/26 02:20 ahb     text and trace frames take turns, so a busy trace
+                        can't hold back printf output
  ***************************************************************************/
 
 /*----------------------------- Include Files -----------------------------*/
 
 // Hardware
 #include <xc.h>
+#include <sys/attribs.h>
 #include <stdio.h>
 
 #include "ES_General.h"
 #include "ES_Port.h"
 #include "circular_buffer.h"
 #include "dbprintf.h"
+#include "ES_Trace.h"
 
 //this module
 #include "terminal.h"
@@ -36,6 +42,10 @@
 #define BAUD_CONST 42 // sets up baud rate for 115200
 //#define BAUD_CONST 21 // sets up baud rate for 230400
 
+// with the event trace built in, the most text bytes sent between two
+// trace frames when both are waiting, about a frame's worth
+#define TEXT_TURN_BYTES 16
+
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this service.They should be functions
    relevant to the behavior of this service
@@ -189,16 +199,111 @@ void _mon_putc (char c)
  * Description: this functions pulls bytes, if any available, from the
  *              circular buffer and stuffs them into the UART1 buffer
  *              until we either run out of bytes in the circular buffer
- *              or we run out of space in the UART FIFO
+ *              or we run out of space in the UART FIFO.
+ *              With the event trace built in, text and trace frames take
+ *              turns when both are waiting: up to TEXT_TURN_BYTES of text,
+ *              then one frame. A frame, once started, is always finished
+ *              before any more text goes out so that the two never
+ *              interleave.
  ******************************************************************************/
 void Terminal_MoveBuffer2UART( void )
 {
+  uint8_t byte2Xmit;
+#ifdef ES_USE_TRACE
+  static uint8_t TextSent; // text bytes sent since the last frame
+
+  while (!U1STAbits.UTXBF)
+  {
+    if (ES_Trace_IsFrameOpen() || (ES_Trace_IsPending() &&
+        ((TextSent >= TEXT_TURN_BYTES) ||
+        circular_buf_empty(xmitBufferHandle))))
+    {
+      if (!ES_Trace_GetByte(&byte2Xmit))
+      {
+        break;
+      }
+      U1TXREG = byte2Xmit;
+      if (!ES_Trace_IsFrameOpen())
+      {
+        TextSent = 0; // that frame is done, the text's turn
+      }
+    }
+    else if (!circular_buf_empty(xmitBufferHandle))
+    {
+      circular_buf_get(xmitBufferHandle, &byte2Xmit);
+      U1TXREG = byte2Xmit;
+      if (TextSent < TEXT_TURN_BYTES)
+      {
+        TextSent++;
+      }
+    }
+    else
+    {
+      break;
+    }
+  }
+#else
   while ( (!circular_buf_empty(xmitBufferHandle)) && (!U1STAbits.UTXBF))
   {
-    uint8_t byte2Xmit;
     circular_buf_get(xmitBufferHandle, &byte2Xmit);
     U1TXREG = byte2Xmit;
   }
+#endif
+}
+
+/*******************************************************************************
+ * Function: Terminal_IsXmitIdle
+ * Arguments: none
+ * Returns true if there is nothing left in the transmit buffer (or trace)
+ * 
+ * Created by: A. Brown
+ * Description: used by the framework to decide that it may idle the core.
+ *              Bytes already in the UART FIFO keep going while we wait.
+ ******************************************************************************/
+bool Terminal_IsXmitIdle(void)
+{
+#ifdef ES_USE_TRACE
+  if (ES_Trace_IsPending())
+  {
+    return false;
+  }
+#endif
+  return circular_buf_empty(xmitBufferHandle);
+}
+
+/*******************************************************************************
+ * Function: Terminal_EnableRxWake
+ * Arguments: none
+ * Returns nothing
+ * 
+ * Created by: A. Brown
+ * Description: enables the UART1 receive interrupt so that an arriving
+ *              character wakes the core from the idle wait. The interrupt
+ *              response turns itself back off, Check4Keystroke still reads
+ *              the character.
+ ******************************************************************************/
+void Terminal_EnableRxWake(void)
+{
+  IPC8bits.U1IP = 1;
+  IFS1CLR = _IFS1_U1RXIF_MASK;
+  IEC1SET = _IEC1_U1RXIE_MASK;
+}
+
+/*******************************************************************************
+ * Function: Terminal_RxWakeISR
+ * Arguments: none
+ * Returns nothing
+ * 
+ * Created by: A. Brown
+ * Description: only here to wake the core, so just shut the interrupt off
+ *              and leave the character in the receive FIFO
+ ******************************************************************************/
+void __ISR(_UART_1_VECTOR, IPL1SOFT) Terminal_RxWakeISR(void)
+{
+  ES_PROFILE_ISR_ENTER();
+  IEC1CLR = _IEC1_U1RXIE_MASK;
+  IFS1CLR = _IFS1_U1RXIF_MASK;
+  ES_PROFILE_ISR_EXIT();
 }
 
 void __attribute__((noreturn)) _fassert(int nLineNumber,
@@ -0,0 +1,1312 @@
+/****************************************************************************
+ Module
+   ES_Port_Host.c
+
+ Revision
+   1.0.1
+
+ Description
+   The hardware specific functions of the Events & Services Framework for
+   the host (Linux/POSIX) port. Takes the place of ES_Port.c when the
+   framework is built with HostPort/Makefile.
+
+ Notes
+   There are no real interrupts here. The tick and the peripheral models
+   are looked at each time ES_Run calls _HW_Process_Pending_Ints, during
+   HostPort_Busy and, under the preemptive kernel, at the end of each
+   critical region. An interrupt raised at or below the simulated IPL is
+   held until the IPL drops, see DeliverInterrupts. See HostPort.h for the
+   two clocks.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 12:50 ahb     RunIsOver is only kept with ES_USE_IDLE_WAIT
+ 10/17/26 12:30 ahb     the simulated Status holds IE, HostPort_DisableInts
+                        returns it
+ 10/17/26 11:50 ahb     added HostPort_GetCriticalCount
+ 10/17/26 10:30 ahb     runs the preemptive kernel: masked interrupts are
+                        held until the IPL drops, the scheduler interrupt is
+                        core software interrupt 0 as on the PIC
+ 10/17/26 09:40 ahb     added HostPort_Busy
+ 10/17/26 09:00 ahb     added HostPort_GetHostTime
+ 10/17/26 03:00 ahb     the run summary gives each service's worst
+                        dispatch latency
+ 10/17/26 02:50 ahb     the run summary gives the worst wake latency on
+                        the real clock
+ 10/17/26 02:40 ahb     the run summary gives the dispatch counts when
+                        _INCLUDE_DISPATCH_STATS_ is defined
+ 10/17/26 01:20 ahb     ES_TICK_OVERRUN is rate limited as on the PIC
+ 10/17/26 00:10 ahb     keeps the tick stats on the real clock, publishes
+                        ES_TICK_OVERRUN
+ 10/16/26 23:40 ahb     ES_MEASURE_CRITICAL is replaced by the profiler
+ 10/16/26 23:10 ahb     critical regions raise the simulated IPL and nest,
+                        added ES_MEASURE_CRITICAL
+ 10/16/26 22:10 ahb     added the tickless mode, and counts the tick interrupts
+                        the PIC would have taken
+ 10/16/26 20:10 ahb     added _HW_GetCycleCount64
+ 10/16/26 19:40 ahb     pending ticks go to ES_Timer_AdvanceTicks in one call
+ 10/16/26 16:10 ahb     simulated clock jumps straight to the next event
+ 10/16/26 15:00 ahb     started coding
+ ***************************************************************************/
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/select.h>
+
+#include "ES_Port.h"        // the header file for this module
+#include "ES_Types.h"       // framework type definitions
+#include "ES_Timers.h"      // framework timer prototypes
+#include "ES_Framework.h"   // for ES_Publish, ES_GetDispatchStats
+#include "ES_LookupTables.h" // for ES_GetMSBitSet32
+#include "terminal.h"       // terminal prototypes for init function
+#include "HostPort.h"
+
+/****************************************************************************
+ * Module Level defines
+ ***************************************************************************/
+#define NS_PER_COUNT (1000000000u / HOST_COUNTS_PER_SEC)
+
+// the most interrupts that can be waiting for the IPL to drop, each one
+// has its own flag so it can only be waiting once
+#define MAX_PENDING_INTS 8
+
+// the preemptive ES_Run never calls _HW_Process_Pending_Ints, so it is the
+// idle wait that moves the simulated clock on
+#if defined(ES_USE_PREEMPTIVE_KERNEL) && !defined(ES_USE_IDLE_WAIT)
+#error "the host port's preemptive kernel needs ES_USE_IDLE_WAIT"
+#endif
+
+#if defined(ES_USE_TICKLESS) && !defined(ES_USE_IDLE_WAIT)
+#error "ES_USE_TICKLESS needs ES_USE_IDLE_WAIT"
+#endif
+
+// TickCount is the number of ticks that have come due since the last
+// call to _HW_Process_Pending_Ints. A slow host can fall a long way
+// behind, so it is wider than on the PIC.
+static uint16_t TickCount;
+
+// Global tick count, as on the PIC
+static uint16_t SysTickCounter = 0;
+
+// Rate value in core timer counts, 0 until _HW_Timer_Init
+static TimerRate_t tickPeriod;
+
+// the time the next tick is due, in core timer counts from the start
+static uint64_t NextTickTime;
+
+// the core timer compare: when the PIC would next take a tick interrupt,
+// and how far apart they would come after that if it were left alone.
+// Only used to count the interrupts and, in tickless mode, to wake.
+static uint64_t CompareTime;
+static uint64_t CompareStride;
+
+// the clock: with SimClock set, time is SimTime and only moves in the
+// idle wait, otherwise it is CLOCK_MONOTONIC since StartTime
+static bool SimClock;
+static uint64_t SimTime;
+static struct timespec StartTime;
+
+// ES_HOST_RUN_MS in core timer counts, 0 to run forever
+static uint64_t RunLimit;
+
+// the simulated interrupt state, read back through _CP0_GET_STATUS
+static bool IntsEnabled;
+static uint8_t CurrentIPL;
+
+// interrupts raised at or below CurrentIPL, in the order they were raised
+typedef struct
+{
+  HostIsr_t *pIsr;
+  uint8_t Priority;
+}PendingInt_t;
+static PendingInt_t PendingInts[MAX_PENDING_INTS];
+static uint8_t NumPendingInts;
+
+// the Cause register, of which only IP0 (the scheduler request) is used
+static uint32_t Cause;
+
+// the Status register at the outermost EnterCritical, and how deeply they
+// are nested, as on the PIC
+volatile uint32_t _HW_CriticalStatus;
+volatile uint8_t _HW_CriticalNesting;
+
+// outermost critical regions entered, for HostPort_GetCriticalCount
+static uint32_t CriticalCount;
+
+static HostModel_t *Models[HOST_MAX_MODELS];
+static uint8_t NumModels;
+// the earliest time any of the models asked to be stepped again
+static uint64_t ModelWakeTime = HOST_TIME_NEVER;
+// set while they are being stepped. The peripherals all move together, so
+// the waiting interrupts and the scheduler are left until they all have.
+static bool SteppingModels;
+
+#ifdef ES_USE_IDLE_WAIT
+static ES_IdleStats_t IdleStats;
+// set when the simulated clock finds that nothing else can happen
+static bool RunIsOver;
+#endif
+
+#ifdef ES_USE_TICK_STATS
+// kept by CreditTicks on the real clock, where a slow trip round ES_Run
+// is the host's held off interrupt. The simulated clock is never late.
+static ES_TickStats_t TickStats;
+// the most ticks missed at once since ES_TICK_OVERRUN was last published
+static uint16_t OverrunTicks;
+// _HW_GetTickCount when ES_TICK_OVERRUN was last published
+static uint16_t LastOverrunTime;
+#endif
+
+static uint64_t ReadClock(void);
+static void CreditTicks(void);
+static void StepModels(void);
+static void TakeTimedInterrupts(void);
+static void RunInterrupt(HostIsr_t *pIsr, uint8_t Priority);
+static void DeliverInterrupts(void);
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+static void SchedulerIntHandler(void);
+#endif
+#ifdef ES_USE_TICKLESS
+static void SetTickCompare(void);
+#endif
+#ifdef ES_USE_IDLE_WAIT
+static void SimIdleWait(uint16_t TicksToNext);
+#endif
+#ifdef ES_USE_TICK_STATS
+static void RecordTickInt(uint32_t Lateness, uint16_t CatchUp);
+#endif
+static void PrintRunSummary(void);
+
+/****************************************************************************
+ Function
+    _HW_PIC32Init
+ Parameters
+    none
+ Returns
+     None.
+ Description
+    picks the clock, installs the peripheral stand-ins and sets up the
+    terminal
+ Notes
+    keeps the PIC32 name so that main() is the same for both ports
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_PIC32Init(void)
+{
+  const char *pSetting;
+
+  clock_gettime(CLOCK_MONOTONIC, &StartTime);
+  pSetting = getenv("ES_HOST_CLOCK");
+  SimClock = (pSetting != NULL) && (strcmp(pSetting, "sim") == 0);
+  pSetting = getenv("ES_HOST_RUN_MS");
+  if (pSetting != NULL)
+  {
+    RunLimit = strtoull(pSetting, NULL, 10) * (HOST_COUNTS_PER_SEC / 1000);
+  }
+  HostPeripherals_Init();
+  Terminal_HWInit();
+  atexit(PrintRunSummary);
+}
+
+/****************************************************************************
+ Function
+     _HW_Timer_Init
+ Parameters
+     TimerRate_t Rate set to one of the TMR_RATE_XX enum values to set the
+     Tick rate
+ Returns
+     None.
+ Description
+     starts the tick. The rates are in core timer counts, as on the PIC.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_Timer_Init(const TimerRate_t Rate)
+{
+  if (Rate > 0)
+  {
+    tickPeriod = Rate;
+    NextTickTime = HostPort_GetTime() + Rate;
+    CompareTime = NextTickTime;
+    CompareStride = Rate;
+    IntsEnabled = true;
+  }
+}
+
+/****************************************************************************
+ Function
+     _HW_GetTickCount()
+ Parameters
+    none
+ Returns
+    uint16_t   count of number of system ticks that have occurred.
+ Description
+    wrapper for access to SysTickCounter
+ Notes
+    in tickless mode the ticks are counted up to now first, as on the PIC
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint16_t _HW_GetTickCount(void)
+{
+#ifdef ES_USE_TICKLESS
+  CreditTicks();
+#endif
+  return SysTickCounter;
+}
+
+#ifdef ES_USE_TICKLESS
+/****************************************************************************
+ Function
+     _HW_TakeElapsedTicks
+ Parameters
+    none
+ Returns
+    uint16_t   the ticks that have passed since the timers were last told
+ Description
+    counts the ticks up to now and hands over all of the ones that have
+    not yet gone to ES_Timer_AdvanceTicks
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint16_t _HW_TakeElapsedTicks(void)
+{
+  uint16_t NumTicks;
+
+  CreditTicks();
+  NumTicks = TickCount;
+  TickCount = 0;
+  return NumTicks;
+}
+
+#endif /* ES_USE_TICKLESS */
+
+/****************************************************************************
+ Function
+     _HW_GetCycleCount64
+ Parameters
+    none
+ Returns
+    uint64_t   the core timer, extended to 64 bits so that it never wraps
+ Description
+    the host clock is already 64 bits
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint64_t _HW_GetCycleCount64(void)
+{
+  return HostPort_GetTime();
+}
+
+/****************************************************************************
+ Function
+     _HW_Process_Pending_Ints
+ Parameters
+     none
+ Returns
+     always true.
+ Description
+     delivers the interrupts: credits the ticks that have come due, steps
+     the peripheral models, then runs the framework tick response once for
+     each tick
+ Notes
+     also where a run with ES_HOST_RUN_MS set comes to an end
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool _HW_Process_Pending_Ints(void)
+{
+#ifdef ES_USE_TICK_STATS
+  ES_Event_t ThisEvent;
+#endif
+
+#ifndef ES_USE_IDLE_WAIT
+  // with no idle wait the simulated clock moves a tick each time through
+  if (SimClock && (tickPeriod != ES_Timer_RATE_OFF))
+  {
+    SimTime = NextTickTime;
+  }
+#endif
+  CreditTicks();
+  StepModels();
+  if (TickCount > 0)
+  {
+    ES_Timer_AdvanceTicks(TickCount);
+    TickCount = 0;
+  }
+#ifdef ES_USE_TICKLESS
+  SetTickCompare();
+#endif
+#ifdef ES_USE_TICK_STATS
+  if ((OverrunTicks != 0) && ((uint16_t)(_HW_GetTickCount() -
+      LastOverrunTime) >= ES_TICK_OVERRUN_HOLDOFF))
+  {
+    LastOverrunTime = _HW_GetTickCount();
+    ThisEvent.EventType = ES_TICK_OVERRUN;
+    ThisEvent.EventParam = OverrunTicks;
+    OverrunTicks = 0;
+    ES_Publish(ThisEvent);
+  }
+#endif
+  if ((RunLimit != 0) && (HostPort_GetTime() >= RunLimit))
+  {
+    exit(0);
+  }
+  return true;  // always return true to allow loop test in ES_Run to proceed
+}
+
+#ifdef ES_USE_IDLE_WAIT
+/****************************************************************************
+ Function
+     _HW_IdleWait
+ Parameters
+     none
+ Returns
+     none
+ Description
+     waits for the next ES_Timers expiry (capped at ES_IDLE_MAX_TICKS, or
+     ES_TICKLESS_MAX_TICKS in tickless mode), or for a key to arrive, the
+     same as the wait on the PIC. With the real
+     clock this sleeps in pselect on the terminal input. The simulated
+     clock is not held to ES_IDLE_MAX_TICKS, see SimIdleWait.
+ Notes
+     called with interrupts disabled, like the PIC version. The output is
+     flushed first so that everything printed is seen before we sleep.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_IdleWait(void)
+{
+  uint16_t TicksToSleep;
+  uint64_t WakeUpTime;
+  uint64_t Now;
+  fd_set Input;
+  int RxFd;
+  struct timespec Timeout;
+
+#ifdef ES_USE_TICKLESS
+  CreditTicks();
+#endif
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  // nothing else steps the models here, and a service may have set up a
+  // peripheral since. An interrupt they raise waits for the IPL to drop,
+  // and like a scheduler request it keeps us from waiting, as on the PIC.
+  StepModels();
+  if ((NumPendingInts != 0) || (Cause != 0))
+  {
+    return;
+  }
+#endif
+  if ((TickCount != 0) || (tickPeriod == ES_Timer_RATE_OFF))
+  {
+    return;
+  }
+  TicksToSleep = ES_Timer_GetTicksToNextExpiry();
+  IdleStats.NumWaits++;
+#ifdef ES_USE_TICKLESS
+  SetTickCompare();
+#else
+  // the PIC stretches the compare out to the expiry, ES_IDLE_MAX_TICKS at
+  // a time
+  CompareStride = (uint64_t)ES_IDLE_MAX_TICKS * tickPeriod;
+  if ((TicksToSleep != ES_Timer_NONE_ACTIVE) &&
+      (TicksToSleep < ES_IDLE_MAX_TICKS))
+  {
+    CompareTime = NextTickTime + ((uint64_t)(TicksToSleep - 1) * tickPeriod);
+  }
+  else
+  {
+    CompareTime = NextTickTime + CompareStride - tickPeriod;
+  }
+#endif
+  if (SimClock)
+  {
+    SimIdleWait(TicksToSleep);
+#ifdef ES_USE_PROFILER
+    ES_Profile_RestartCritical();
+#endif
+    return;
+  }
+#ifdef ES_USE_TICKLESS
+  if ((TicksToSleep == ES_Timer_NONE_ACTIVE) ||
+      (TicksToSleep > ES_TICKLESS_MAX_TICKS))
+  {
+    TicksToSleep = ES_TICKLESS_MAX_TICKS;
+  }
+#else
+  if ((TicksToSleep == ES_Timer_NONE_ACTIVE) ||
+      (TicksToSleep > ES_IDLE_MAX_TICKS))
+  {
+    TicksToSleep = ES_IDLE_MAX_TICKS;
+  }
+#endif
+  WakeUpTime = NextTickTime + ((uint64_t)(TicksToSleep - 1) * tickPeriod);
+  fflush(stdout);
+  Now = HostPort_GetTime();
+  if (Now < WakeUpTime)
+  {
+    Timeout.tv_sec = (WakeUpTime - Now) / HOST_COUNTS_PER_SEC;
+    Timeout.tv_nsec = ((WakeUpTime - Now) % HOST_COUNTS_PER_SEC) *
+        NS_PER_COUNT;
+    FD_ZERO(&Input);
+    RxFd = Terminal_GetRxFd();
+    if (RxFd >= 0)
+    {
+      FD_SET(RxFd, &Input);
+    }
+    pselect(RxFd + 1, &Input, NULL, NULL, &Timeout, NULL);
+  }
+  Now = HostPort_GetTime();
+  if (Now >= WakeUpTime)
+  {
+    IdleStats.TicksSlept += TicksToSleep;
+    IdleStats.LastWakeLatency = (uint32_t)(Now - WakeUpTime);
+    if (IdleStats.LastWakeLatency > IdleStats.MaxWakeLatency)
+    {
+      IdleStats.MaxWakeLatency = IdleStats.LastWakeLatency;
+    }
+  }
+  else if (Now >= NextTickTime)
+  {
+    // woken early by a key
+    IdleStats.TicksSlept += ((Now - NextTickTime) / tickPeriod) + 1;
+  }
+#ifdef ES_USE_PROFILER
+  // the wait doesn't hold anything off, the caller's region starts again
+  ES_Profile_RestartCritical();
+#endif
+}
+
+/****************************************************************************
+ Function
+     _HW_GetIdleStats
+ Parameters
+     ES_IdleStats_t * : where to copy the counters
+ Returns
+     none
+ Description
+     copies out the idle counters, the latencies are in core timer counts
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_GetIdleStats(ES_IdleStats_t *pStats)
+{
+  *pStats = IdleStats;
+}
+
+#endif /* ES_USE_IDLE_WAIT */
+#ifdef ES_USE_TICK_STATS
+/****************************************************************************
+ Function
+     _HW_GetTickStats
+ Parameters
+     ES_TickStats_t * : where to copy the stats
+ Returns
+     none
+ Description
+     copies out the missed tick counts and the tick lateness, in core timer
+     counts. All 0 on the simulated clock.
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+void _HW_GetTickStats(ES_TickStats_t *pStats)
+{
+  *pStats = TickStats;
+}
+
+/****************************************************************************
+ Function
+     _HW_ClearTickStats
+ Parameters
+     none
+ Returns
+     none
+ Description
+     starts the tick stats over
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+void _HW_ClearTickStats(void)
+{
+  memset(&TickStats, 0, sizeof(TickStats));
+}
+
+#endif /* ES_USE_TICK_STATS */
+/****************************************************************************
+ Function
+     _HW_ConsoleInit
+ Parameters
+     none
+ Returns
+     none.
+ Description
+  Initializes the terminal for console I/O
+ Author
+     A. Brown, 10/16/26
+ ****************************************************************************/
+void _HW_ConsoleInit(void)
+{
+  Terminal_HWInit();
+}
+
+/****************************************************************************
+ Function
+     _HW_EnterCritical, _HW_ExitCritical
+ Parameters
+     none
+ Returns
+     none
+ Description
+     EnterCritical and ExitCritical. Raise the simulated IPL to
+     ES_CRITICAL_IPL and put it back at the end of the outermost region,
+     as on the PIC, which takes any interrupts that were held off
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void _HW_EnterCritical(void)
+{
+  uint32_t Status = HostPort_GetStatus();
+
+  if (CurrentIPL < ES_CRITICAL_IPL)
+  {
+    CurrentIPL = ES_CRITICAL_IPL;
+  }
+  if (_HW_CriticalNesting++ == 0)
+  {
+    _HW_CriticalStatus = Status;
+    CriticalCount++;
+  }
+}
+
+void _HW_ExitCritical(void)
+{
+  if (_HW_CriticalNesting == 0)
+  {
+    return; // not in a critical region
+  }
+  if (--_HW_CriticalNesting == 0)
+  {
+    CurrentIPL = (uint8_t)((_HW_CriticalStatus & _CP0_STATUS_IPL_MASK) >>
+        _CP0_STATUS_IPL_POSITION);
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+    // nothing else would look at the tick or the models while the idle
+    // loop runs
+    TakeTimedInterrupts();
+#endif
+    DeliverInterrupts();
+  }
+}
+
+/****************************************************************************
+ Function
+     _HW_InISR
+ Parameters
+     none
+ Returns
+     bool : true when called from an ISR, that is from a model through
+            HostPort_RaiseInterrupt
+ Description
+     as on the PIC, in a critical region it is the IPL the region was
+     entered from that counts
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool _HW_InISR(void)
+{
+  uint32_t Status = HostPort_GetStatus();
+
+  if ((_HW_CriticalNesting != 0) && (CurrentIPL == ES_CRITICAL_IPL))
+  {
+    Status = _HW_CriticalStatus;
+  }
+  return (Status & _CP0_STATUS_IPL_MASK) != 0;
+}
+
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+/****************************************************************************
+ Function
+     _HW_SchedulerInit
+ Parameters
+     none
+ Returns
+     none
+ Description
+     sets up core software interrupt 0 as the scheduler interrupt, at IPL1
+     as on the PIC
+ Notes
+     called from ES_Run, after all of the services have been initialized
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+void _HW_SchedulerInit(void)
+{
+  IEC0CLR = _IEC0_CS0IE_MASK;
+  IPC0bits.CS0IP = 1;
+  IPC0bits.CS0IS = 0;
+  IFS0CLR = _IFS0_CS0IF_MASK;
+  IEC0SET = _IEC0_CS0IE_MASK;
+  // any ticks that came in during initialization
+  _HW_RequestSchedule();
+}
+
+#endif /* ES_USE_PREEMPTIVE_KERNEL */
+/****************************************************************************
+ Function
+     HostPort_AddModel
+ Parameters
+     HostModel_t * : the model to step
+ Returns
+     bool : false if there is no room for another model
+ Description
+     adds a peripheral model, it is stepped each time the interrupts are
+     delivered and raises any interrupts the peripheral would have
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool HostPort_AddModel(HostModel_t *pModel)
+{
+  if (NumModels >= HOST_MAX_MODELS)
+  {
+    return false;
+  }
+  Models[NumModels++] = pModel;
+  return true;
+}
+
+/****************************************************************************
+ Function
+     HostPort_RaiseInterrupt
+ Parameters
+     HostIsr_t * : the interrupt response to run
+     uint8_t Priority : its IPL
+ Returns
+     nothing
+ Description
+     runs the interrupt response as the PIC would: at its own IPL, so that
+     _HW_InISR is true, and with interrupts enabled. If the IPL is already
+     at or above Priority, or interrupts are disabled, it waits until they
+     are not.
+ Notes
+     for the models, and for tests that stand in for an interrupt
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void HostPort_RaiseInterrupt(HostIsr_t *pIsr, uint8_t Priority)
+{
+  uint8_t i;
+
+  if (IntsEnabled && (Priority > CurrentIPL))
+  {
+    RunInterrupt(pIsr, Priority);
+    return;
+  }
+  for (i = 0; i < NumPendingInts; i++)
+  {
+    if (PendingInts[i].pIsr == pIsr)
+    {
+      return; // its flag is already set
+    }
+  }
+  if (NumPendingInts >= MAX_PENDING_INTS)
+  {
+    fprintf(stderr, "host port: more than %u interrupts pending\n",
+        MAX_PENDING_INTS);
+    exit(1);
+  }
+  PendingInts[NumPendingInts].pIsr = pIsr;
+  PendingInts[NumPendingInts].Priority = Priority;
+  NumPendingInts++;
+}
+
+/****************************************************************************
+ Function
+     HostPort_GetTime
+ Parameters
+     none
+ Returns
+     uint64_t : core timer counts since the start of the run
+ Description
+     the host port's clock, 50ns per count like the core timer, but 64 bits
+     wide so it never wraps
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint64_t HostPort_GetTime(void)
+{
+  return SimClock ? SimTime : ReadClock();
+}
+
+/****************************************************************************
+ Function
+     HostPort_GetHostTime
+ Parameters
+     none
+ Returns
+     uint64_t : CLOCK_MONOTONIC since the start of the run, in core timer
+                counts
+ Description
+     the host's own time on either clock, for timing the host itself
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+uint64_t HostPort_GetHostTime(void)
+{
+  return ReadClock();
+}
+
+/****************************************************************************
+ Function
+     HostPort_GetCriticalCount
+ Parameters
+     none
+ Returns
+     uint32_t : the critical regions entered so far, nested ones not counted
+ Description
+     for counting what a piece of the framework costs in critical regions
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+uint32_t HostPort_GetCriticalCount(void)
+{
+  return CriticalCount;
+}
+
+/****************************************************************************
+ Function
+     HostPort_Busy
+ Parameters
+     uint32_t Counts : how long, in core timer counts
+ Returns
+     nothing
+ Description
+     stands in for that much work by the caller: moves the simulated clock
+     on, or spins on the real one. The tick and the peripherals' interrupts
+     are taken as they come due, and under the preemptive kernel a service
+     they make ready runs from the scheduler interrupt part way through.
+ Notes
+     services take no time on the simulated clock otherwise. The ticks are
+     only counted, under the cooperative ES_Run the timers still see them
+     the next time round ES_Run.
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+void HostPort_Busy(uint32_t Counts)
+{
+  uint64_t Until = HostPort_GetTime() + Counts;
+  uint64_t Next;
+
+  // the caller may have set up a peripheral since the models were stepped
+  ModelWakeTime = HostPort_GetTime();
+  TakeTimedInterrupts();
+  while (HostPort_GetTime() < Until)
+  {
+    if (SimClock)
+    {
+      // on to the next thing that can interrupt, or the end
+      Next = Until;
+      if ((ModelWakeTime > SimTime) && (ModelWakeTime < Next))
+      {
+        Next = ModelWakeTime;
+      }
+      if ((tickPeriod != ES_Timer_RATE_OFF) && (NextTickTime > SimTime) &&
+          (NextTickTime < Next))
+      {
+        Next = NextTickTime;
+      }
+      SimTime = Next;
+    }
+    TakeTimedInterrupts();
+  }
+}
+
+/****************************************************************************
+ Function
+     HostPort_IsSimClock
+ Parameters
+     none
+ Returns
+     bool : true when running on the simulated clock
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+bool HostPort_IsSimClock(void)
+{
+  return SimClock;
+}
+
+/****************************************************************************
+ Function
+     HostPort_DisableInts, HostPort_EnableInts, HostPort_GetCount,
+     HostPort_GetStatus, HostPort_SetStatus, HostPort_SetCause,
+     HostPort_ClearCause
+ Description
+     what the XC32 builtins and CP0 accesses in the sources turn into on
+     the host, see xc.h
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+uint32_t HostPort_DisableInts(void)
+{
+  uint32_t Status = HostPort_GetStatus();
+
+  IntsEnabled = false;
+  return Status;
+}
+
+void HostPort_EnableInts(void)
+{
+  IntsEnabled = true;
+  DeliverInterrupts();
+}
+
+uint32_t HostPort_GetCount(void)
+{
+  return (uint32_t)HostPort_GetTime();
+}
+
+uint32_t HostPort_GetStatus(void)
+{
+  return ((uint32_t)CurrentIPL << _CP0_STATUS_IPL_POSITION) |
+      (IntsEnabled ? _CP0_STATUS_IE_MASK : 0);
+}
+
+void HostPort_SetStatus(uint32_t Status)
+{
+  CurrentIPL = (uint8_t)((Status & _CP0_STATUS_IPL_MASK) >>
+      _CP0_STATUS_IPL_POSITION);
+  IntsEnabled = ((Status & _CP0_STATUS_IE_MASK) != 0);
+  DeliverInterrupts();
+}
+
+void HostPort_SetCause(uint32_t Mask)
+{
+  Cause |= Mask;
+  DeliverInterrupts();
+}
+
+void HostPort_ClearCause(uint32_t Mask)
+{
+  Cause &= ~Mask;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     ReadClock
+ Returns
+     uint64_t : CLOCK_MONOTONIC since the start, in core timer counts
+****************************************************************************/
+static uint64_t ReadClock(void)
+{
+  struct timespec Now;
+
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return ((uint64_t)(Now.tv_sec - StartTime.tv_sec) * HOST_COUNTS_PER_SEC) +
+         ((int64_t)(Now.tv_nsec - StartTime.tv_nsec) / (int64_t)NS_PER_COUNT);
+}
+
+/****************************************************************************
+ Function
+     CreditTicks
+ Description
+     the host's tick interrupt: counts the ticks that have come due since
+     the last time we looked, and the interrupts that the PIC would have
+     taken for them
+****************************************************************************/
+static void CreditTicks(void)
+{
+  uint64_t Now;
+  uint64_t NumTicks;
+
+  if (tickPeriod == ES_Timer_RATE_OFF)
+  {
+    return;
+  }
+  Now = HostPort_GetTime();
+  if (Now >= CompareTime)
+  {
+#ifdef ES_USE_TICK_STATS
+    // the simulated clock jumps over strides in the idle wait, where the
+    // PIC would have been woken for each, so only the real one is timed
+    if (!SimClock)
+    {
+#ifdef ES_USE_TICKLESS
+      RecordTickInt((uint32_t)(Now - CompareTime), 1);
+#else
+      RecordTickInt((uint32_t)(Now - CompareTime),
+          (uint16_t)(1 + ((Now - CompareTime) / CompareStride)));
+#endif
+    }
+#endif
+#ifdef ES_USE_IDLE_WAIT
+    IdleStats.NumTickInts += 1 + ((Now - CompareTime) / CompareStride);
+#endif
+#ifdef ES_USE_TICKLESS
+    // as far out as it goes, until SetTickCompare brings it back in
+    CompareStride = (uint64_t)ES_TICKLESS_MAX_TICKS * tickPeriod;
+    CompareTime += (1 + ((Now - CompareTime) / CompareStride)) *
+        CompareStride;
+#endif
+  }
+  if (Now >= NextTickTime)
+  {
+    NumTicks = ((Now - NextTickTime) / tickPeriod) + 1;
+    NextTickTime += NumTicks * tickPeriod;
+    TickCount += NumTicks;
+    SysTickCounter += NumTicks;
+  }
+#ifndef ES_USE_TICKLESS
+  // the compare goes back to the next tick until the idle wait stretches it
+  if (Now >= CompareTime)
+  {
+    CompareTime = NextTickTime;
+    CompareStride = tickPeriod;
+  }
+#endif
+}
+
+/****************************************************************************
+ Function
+     StepModels
+ Description
+     steps every peripheral model and notes when they next need to be,
+     then takes the interrupts they raised that had to wait
+****************************************************************************/
+static void StepModels(void)
+{
+  uint8_t i;
+  uint64_t WakeTime;
+
+  SteppingModels = true;
+  ModelWakeTime = HOST_TIME_NEVER;
+  for (i = 0; i < NumModels; i++)
+  {
+    WakeTime = Models[i]();
+    if (WakeTime < ModelWakeTime)
+    {
+      ModelWakeTime = WakeTime;
+    }
+  }
+  SteppingModels = false;
+  DeliverInterrupts();
+}
+
+/****************************************************************************
+ Function
+     TakeTimedInterrupts
+ Description
+     the tick and the peripherals' interrupts, if either has come due.
+     Under the preemptive kernel the tick requests the scheduler interrupt,
+     which runs the timers, as the PIC's tick interrupt does.
+ Notes
+     does nothing from an interrupt raised while the models are stepped
+****************************************************************************/
+static void TakeTimedInterrupts(void)
+{
+  uint64_t Now = HostPort_GetTime();
+
+  if (SteppingModels)
+  {
+    return;
+  }
+  if ((tickPeriod != ES_Timer_RATE_OFF) && (Now >= NextTickTime))
+  {
+    CreditTicks();
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+    _HW_RequestSchedule();
+#endif
+  }
+  if (Now >= ModelWakeTime)
+  {
+    StepModels();
+  }
+}
+
+/****************************************************************************
+ Function
+     RunInterrupt
+ Description
+     runs an interrupt response at its own IPL with interrupts enabled,
+     then takes any that it held off
+****************************************************************************/
+static void RunInterrupt(HostIsr_t *pIsr, uint8_t Priority)
+{
+  bool WasEnabled = IntsEnabled;
+  uint8_t LastIPL = CurrentIPL;
+
+  CurrentIPL = Priority;
+  IntsEnabled = true;
+  pIsr();
+  CurrentIPL = LastIPL;
+  IntsEnabled = WasEnabled;
+  if (!SteppingModels)
+  {
+    // it may have set up a peripheral, so step them again before the
+    // clock moves on
+    ModelWakeTime = HostPort_GetTime();
+  }
+  DeliverInterrupts();
+}
+
+/****************************************************************************
+ Function
+     DeliverInterrupts
+ Description
+     called whenever the IPL may have dropped or interrupts been enabled.
+     Runs the waiting interrupts that are now above the IPL, highest
+     priority first, and then, under the preemptive kernel, the scheduler
+     interrupt if it has been requested.
+****************************************************************************/
+static void DeliverInterrupts(void)
+{
+  uint8_t i;
+  uint8_t Which;
+  PendingInt_t ThisInt;
+
+  while (IntsEnabled && !SteppingModels)
+  {
+    Which = NumPendingInts;
+    for (i = 0; i < NumPendingInts; i++)
+    {
+      if ((PendingInts[i].Priority > CurrentIPL) && ((Which == NumPendingInts)
+          || (PendingInts[i].Priority > PendingInts[Which].Priority)))
+      {
+        Which = i;
+      }
+    }
+    if (Which != NumPendingInts)
+    {
+      ThisInt = PendingInts[Which];
+      NumPendingInts--;
+      memmove(&PendingInts[Which], &PendingInts[Which + 1],
+          (NumPendingInts - Which) * sizeof(PendingInts[0]));
+      RunInterrupt(ThisInt.pIsr, ThisInt.Priority);
+      continue;
+    }
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+    if (((Cause & _CP0_CAUSE_IP0_MASK) != 0) &&
+        ((IEC0 & _IEC0_CS0IE_MASK) != 0) && (IPC0bits.CS0IP > CurrentIPL))
+    {
+      IFS0SET = _IFS0_CS0IF_MASK;
+      RunInterrupt(SchedulerIntHandler, IPC0bits.CS0IP);
+      continue;
+    }
+#endif
+    break;
+  }
+}
+
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+/****************************************************************************
+ Function
+     SchedulerIntHandler
+ Description
+     the scheduler interrupt, as on the PIC. Clears the request, drops the
+     IPL to 0 and lets the framework process the tick and run the services
+     that ISRs have made ready.
+****************************************************************************/
+static void SchedulerIntHandler(void)
+{
+  _CP0_BIC_CAUSE(_CP0_CAUSE_IP0_MASK);
+  IFS0CLR = _IFS0_CS0IF_MASK;
+  _CP0_SET_STATUS(_CP0_GET_STATUS() & ~_CP0_STATUS_IPL_MASK);
+  ES_ScheduleFromISR();
+}
+
+#endif /* ES_USE_PREEMPTIVE_KERNEL */
+#ifdef ES_USE_TICKLESS
+/****************************************************************************
+ Function
+     SetTickCompare
+ Description
+     sets the compare for the first ES_Timers expiry, capped at
+     ES_TICKLESS_MAX_TICKS, or for the next tick if there are ticks still
+     to be handed over
+****************************************************************************/
+static void SetTickCompare(void)
+{
+  uint16_t Ticks = ES_Timer_GetTicksToNextExpiry();
+
+  if (tickPeriod == ES_Timer_RATE_OFF)
+  {
+    return;
+  }
+  if (TickCount != 0)
+  {
+    Ticks = 1;
+  }
+  else if ((Ticks == ES_Timer_NONE_ACTIVE) || (Ticks > ES_TICKLESS_MAX_TICKS))
+  {
+    Ticks = ES_TICKLESS_MAX_TICKS;
+  }
+  CompareTime = NextTickTime + ((uint64_t)(Ticks - 1) * tickPeriod);
+  CompareStride = (uint64_t)ES_TICKLESS_MAX_TICKS * tickPeriod;
+}
+
+#endif /* ES_USE_TICKLESS */
+
+#ifdef ES_USE_TICK_STATS
+/****************************************************************************
+ Function
+     RecordTickInt
+ Description
+     adds a tick interrupt, Lateness counts after its compare and counting
+     CatchUp ticks, to TickStats as the PIC port does
+****************************************************************************/
+static void RecordTickInt(uint32_t Lateness, uint16_t CatchUp)
+{
+  uint8_t Bucket = 0;
+
+  if (Lateness != 0)
+  {
+    Bucket = ES_GetMSBitSet32(Lateness);
+    if (Bucket >= ES_TICK_LATE_BUCKETS)
+    {
+      Bucket = ES_TICK_LATE_BUCKETS - 1;
+    }
+  }
+  if (TickStats.LateBuckets[Bucket] != UINT16_MAX)
+  {
+    TickStats.LateBuckets[Bucket]++;
+  }
+  if (Lateness > TickStats.MaxLateness)
+  {
+    TickStats.MaxLateness = Lateness;
+  }
+  if (CatchUp > TickStats.MaxCatchUp)
+  {
+    TickStats.MaxCatchUp = CatchUp;
+  }
+  if (CatchUp > 1)
+  {
+    TickStats.NumMissedTicks += CatchUp - 1;
+    if ((CatchUp - 1) >= ES_TICK_OVERRUN_THRESHOLD)
+    {
+      TickStats.NumOverruns++;
+      if ((CatchUp - 1) > OverrunTicks)
+      {
+        OverrunTicks = CatchUp - 1;
+      }
+    }
+  }
+}
+
+#endif /* ES_USE_TICK_STATS */
+#ifdef ES_USE_IDLE_WAIT
+/****************************************************************************
+ Function
+     SimIdleWait
+ Parameters
+     uint16_t : ticks to the next ES_Timers expiry, or ES_Timer_NONE_ACTIVE
+ Description
+     the idle wait on the simulated clock. Moves the time on to the first
+     thing that can happen next, or ends the run if there is nothing.
+ Notes
+     Polled event checkers only get to look at the times that something
+     happens, which is all they would see change anyway. Nothing here
+     depends on the host's own timing, so replays are repeatable.
+****************************************************************************/
+static void SimIdleWait(uint16_t TicksToNext)
+{
+  uint64_t WakeUpTime = HOST_TIME_NEVER;
+  uint64_t KeyTime;
+
+  if (TicksToNext != ES_Timer_NONE_ACTIVE)
+  {
+    WakeUpTime = NextTickTime + ((uint64_t)(TicksToNext - 1) * tickPeriod);
+  }
+  if (ModelWakeTime < WakeUpTime)
+  {
+    WakeUpTime = ModelWakeTime;
+  }
+  KeyTime = Terminal_GetNextRxTime();
+  if (KeyTime < WakeUpTime)
+  {
+    WakeUpTime = KeyTime;
+  }
+  if (WakeUpTime == HOST_TIME_NEVER)
+  {
+    RunIsOver = true;
+    exit(0);
+  }
+  if ((RunLimit != 0) && (WakeUpTime > RunLimit))
+  {
+    WakeUpTime = RunLimit;
+  }
+  if (WakeUpTime > SimTime)
+  {
+    if (WakeUpTime >= NextTickTime)
+    {
+      IdleStats.TicksSlept += ((WakeUpTime - NextTickTime) / tickPeriod) + 1;
+    }
+    SimTime = WakeUpTime;
+  }
+}
+
+#endif /* ES_USE_IDLE_WAIT */
+/****************************************************************************
+ Function
+     PrintRunSummary
+ Description
+     at exit, reports how far the framework got and how long it took
+****************************************************************************/
+static void PrintRunSummary(void)
+{
+  uint64_t HostTime = ReadClock();
+  uint64_t RunMs = HostPort_GetTime() / (HOST_COUNTS_PER_SEC / 1000);
+
+  fflush(stdout);
+  fprintf(stderr, "\nhost port: %s clock, %llu ms run in %llu ms of host time\n",
+      SimClock ? "sim" : "real",
+      (unsigned long long)RunMs,
+      (unsigned long long)(HostTime / (HOST_COUNTS_PER_SEC / 1000)));
+#ifdef ES_USE_IDLE_WAIT
+  fprintf(stderr, "host port: %lu idle waits%s\n",
+      (unsigned long)IdleStats.NumWaits,
+      RunIsOver ? ", ended with nothing left to happen" : "");
+  fprintf(stderr, "host port: %lu tick interrupts, %llu per second%s\n",
+      (unsigned long)IdleStats.NumTickInts,
+      (unsigned long long)((RunMs == 0) ? 0 :
+          ((uint64_t)IdleStats.NumTickInts * 1000) / RunMs),
+#ifdef ES_USE_TICKLESS
+      " (tickless)"
+#else
+      ""
+#endif
+      );
+  if (!SimClock)
+  {
+    fprintf(stderr, "host port: max wake latency %lu uS\n",
+        (unsigned long)(IdleStats.MaxWakeLatency / (HOST_COUNTS_PER_SEC /
+        1000000)));
+  }
+#endif
+#ifdef _INCLUDE_DISPATCH_STATS_
+  {
+    ES_DispatchStats_t Stats;
+    uint8_t i;
+
+    ES_GetDispatchStats(&Stats);
+    fprintf(stderr, "host port: %lu events dispatched in %lu run calls, "
+        "%lu scheduler passes, %lu idle loops\n",
+        (unsigned long)Stats.EventsDispatched, (unsigned long)Stats.RunCalls,
+        (unsigned long)Stats.SchedulerPasses, (unsigned long)Stats.IdleLoops);
+    fprintf(stderr, "host port: max dispatch latency (uS):");
+    for (i = 0; i < NUM_SERVICES; i++)
+    {
+      fprintf(stderr, " %lu", (unsigned long)(ES_GetMaxDispatchLatency(i) /
+          (HOST_COUNTS_PER_SEC / 1000000)));
+    }
+    fprintf(stderr, "\n");
+  }
+#endif
+}
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,419 @@
+/****************************************************************************
+ Module
+     HostPeripherals.c
+
+ Description
+     stand-ins for the robot's peripherals on the host: timers 2 & 3, the
+     32 bit timer 4/5 pair, the beacon on input capture 4, the SPI to the drivetrain and launcher,
+     the ADC and the I/O ports.
+
+ Notes
+     The peripheral clock on the robot runs at 20MHz, the same rate as the
+     host port's clock, so the timer models count HostPort_GetTime.
+     Each model only does as much as the robot's code relies on:
+       Timers 2 & 3  count while on, set the flag and raise the interrupt
+                     (if enabled) on reaching the period
+       Timers 4/5    the same, as one 32 bit timer when T4CON.T32 is set,
+                     which interrupts as timer 5 (ES_ShortTimer's)
+       IC4           captures a falling edge from the beacon every
+                     HostPeripherals_SetBeaconPeriod microseconds (none
+                     until it is set), timed by timer 2
+       SPI1          a byte written to SPI1BUF goes out once the transmit
+                     interrupt is enabled. The listener, if any, sees it
+                     and supplies the byte that comes back.
+       ADC           the result buffers hold the values given to
+                     HostPeripherals_SetAnalogInput, in scan order
+       PORTA/PORTB   pins set as outputs read back their LAT value, the
+                     inputs are whatever has been written to
+                     HostReg_PORTx.Value
+     The interrupt responses are the robot's own, declared with __ISR in
+     SensorService.c, BeaconTestHarness.c, LeaderSPI.c and
+     ES_ShortTimer.c. Nothing in the
+     robot's build answers timer 2 any more, so Timer2ISR is weak and
+     only raised if a test harness supplies it, and ShortTimerISR is weak
+     for a build without the short timers.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 21:40 ahb     added timers 4/5 and 32 bit timers
+ 10/16/26 20:10 ahb     Timer2ISR is optional now SensorService doesn't use it
+ 10/16/26 16:10 ahb     the models report when they next need to run
+ 10/16/26 15:00 ahb     started coding
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <xc.h>
+#include <stddef.h>
+
+#include "HostPort.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define IC4_FIFO_SIZE 4
+#define NUM_ANALOG_INPUTS 16
+#define CS_PINS ((1u << 12) | (1u << 15))
+
+/*------------------------------ Module Types -----------------------------*/
+// what we need to know to run one of the type B timers
+typedef struct
+{
+  HostReg_t *pCon;
+  HostReg_t *pTmr;
+  HostReg_t *pPr;
+  uint32_t FlagMask;
+  HostIsr_t *pIsr;
+  uint64_t LastTime;
+}TimerModel_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static uint64_t StepTimer(TimerModel_t *pTimer, uint8_t Priority);
+static uint64_t Timer2Model(void);
+static uint64_t Timer3Model(void);
+static uint64_t Timer45Model(void);
+static uint64_t IC4Model(void);
+static uint64_t SPI1Model(void);
+static void ReadIC4BUF(HostReg_t *pReg);
+static void ReadAD1CON2(HostReg_t *pReg);
+static void ReadPortA(HostReg_t *pReg);
+static void ReadPortB(HostReg_t *pReg);
+
+// the robot's interrupt responses
+void IC4ISR(void);
+void Timer2ISR(void) __attribute__((weak));
+void Timer3ISR(void);
+void ShortTimerISR(void) __attribute__((weak));
+void __SPI1_ISR(void);
+
+/*---------------------------- Module Variables ---------------------------*/
+// prescale for each value of TCKPS
+static const uint16_t Prescale[8] = { 1, 2, 4, 8, 16, 32, 64, 256 };
+
+static TimerModel_t Timer2 = {
+  &HostReg_T2CON, &HostReg_TMR2, &HostReg_PR2, _IFS0_T2IF_MASK, Timer2ISR, 0
+};
+static TimerModel_t Timer3 = {
+  &HostReg_T3CON, &HostReg_TMR3, &HostReg_PR3, _IFS0_T3IF_MASK, Timer3ISR, 0
+};
+static TimerModel_t Timer45 = {
+  &HostReg_T4CON, &HostReg_TMR4, &HostReg_PR4, _IFS0_T5IF_MASK, ShortTimerISR,
+  0
+};
+
+static uint64_t BeaconPeriod;   // in core timer counts, 0 for no beacon
+static uint64_t NextEdgeTime;
+static uint16_t IC4Fifo[IC4_FIFO_SIZE];
+static uint8_t IC4Count;
+
+static uint16_t AnalogInputs[NUM_ANALOG_INPUTS];
+
+static HostSPIListener_t *pSPIListener;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     HostPeripherals_Init
+ Parameters
+     none
+ Returns
+     nothing
+ Description
+     plugs in the register stand-ins and adds the models to the host port
+ Notes
+     called from _HW_PIC32Init
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void HostPeripherals_Init(void)
+{
+  // the reset values that the robot's code counts on
+  HostReg_TRISA.Value = 0x001f;
+  HostReg_TRISB.Value = 0xffff;
+  HostReg_SPI1STAT.Value = _SPI1STAT_SPIRBE_MASK | _SPI1STAT_SPITBE_MASK;
+  HostPort_PlugRegister(&HostReg_IC4BUF, ReadIC4BUF);
+  HostPort_PlugRegister(&HostReg_AD1CON2, ReadAD1CON2);
+  HostPort_PlugRegister(&HostReg_PORTA, ReadPortA);
+  HostPort_PlugRegister(&HostReg_PORTB, ReadPortB);
+  HostPort_AddModel(Timer2Model);
+  HostPort_AddModel(Timer3Model);
+  HostPort_AddModel(Timer45Model);
+  HostPort_AddModel(IC4Model);
+  HostPort_AddModel(SPI1Model);
+}
+
+/****************************************************************************
+ Function
+     HostPeripherals_SetBeaconPeriod
+ Parameters
+     uint32_t PeriodUS : time between falling edges, 0 to turn it off
+ Returns
+     nothing
+ Description
+     sets the beacon seen by input capture 4
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void HostPeripherals_SetBeaconPeriod(uint32_t PeriodUS)
+{
+  BeaconPeriod = (uint64_t)PeriodUS * (HOST_COUNTS_PER_SEC / 1000000);
+  NextEdgeTime = HostPort_GetTime() + BeaconPeriod;
+}
+
+/****************************************************************************
+ Function
+     HostPeripherals_SetAnalogInput
+ Parameters
+     uint8_t Channel : the AN input
+     uint16_t Value : its reading, 0 to 1023
+ Returns
+     nothing
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void HostPeripherals_SetAnalogInput(uint8_t Channel, uint16_t Value)
+{
+  if (Channel < NUM_ANALOG_INPUTS)
+  {
+    AnalogInputs[Channel] = Value;
+  }
+}
+
+/****************************************************************************
+ Function
+     HostPeripherals_SetSPIListener
+ Parameters
+     HostSPIListener_t * : called with each byte sent, or NULL
+ Returns
+     nothing
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void HostPeripherals_SetSPIListener(HostSPIListener_t *pListener)
+{
+  pSPIListener = pListener;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     StepTimer
+ Description
+     advances a timer by the time since it was last stepped, returns when
+     it will next interrupt
+ Notes
+     TMR and PR are 32 bits wide when T32 is set, only timers 2 and 4 are
+     ever set up that way. The interrupt response may set the timer up
+     afresh, so after one the timer is stepped again to find out when it
+     next needs to run.
+****************************************************************************/
+static uint64_t StepTimer(TimerModel_t *pTimer, uint8_t Priority)
+{
+  volatile __T2CONbits_t *pBits;
+  uint64_t Now = HostPort_GetTime();
+  uint64_t Counts;
+  uint64_t Period;
+  uint32_t Mask;
+  uint32_t Count;
+
+  pBits = (volatile __T2CONbits_t *)HostReg_Access(pTimer->pCon);
+  if (!pBits->ON)
+  {
+    pTimer->LastTime = Now;
+    return HOST_TIME_NEVER;
+  }
+  Counts = (Now - pTimer->LastTime) / Prescale[pBits->TCKPS];
+  pTimer->LastTime += Counts * Prescale[pBits->TCKPS];
+  Mask = pBits->T32 ? 0xffffffff : 0xffff;
+  Period = (uint64_t)(*HostReg_Access(pTimer->pPr) & Mask) + 1;
+  Count = *HostReg_Access(pTimer->pTmr) & Mask;
+  Counts += Count;
+  Count = (uint32_t)(Counts % Period);
+  *HostReg_Access(pTimer->pTmr) = Count;
+  if (Counts >= Period)
+  {
+    IFS0SET = pTimer->FlagMask;
+    if (((IEC0 & pTimer->FlagMask) != 0) && (pTimer->pIsr != NULL))
+    {
+      HostPort_RaiseInterrupt(pTimer->pIsr, Priority);
+      return StepTimer(pTimer, Priority);
+    }
+  }
+  if ((IEC0 & pTimer->FlagMask) == 0)
+  {
+    return HOST_TIME_NEVER;
+  }
+  return pTimer->LastTime +
+      ((Period - Count) * Prescale[pBits->TCKPS]);
+}
+
+/****************************************************************************
+ Function
+     Timer2Model, Timer3Model, Timer45Model
+****************************************************************************/
+static uint64_t Timer2Model(void)
+{
+  return StepTimer(&Timer2, IPC2bits.T2IP);
+}
+
+static uint64_t Timer3Model(void)
+{
+  return StepTimer(&Timer3, IPC3bits.T3IP);
+}
+
+static uint64_t Timer45Model(void)
+{
+  return StepTimer(&Timer45, IPC5bits.T5IP);
+}
+
+/****************************************************************************
+ Function
+     IC4Model
+ Description
+     queues a capture of timer 2 for each beacon edge that has come due,
+     returns the time of the next edge
+****************************************************************************/
+static uint64_t IC4Model(void)
+{
+  uint64_t Now = HostPort_GetTime();
+  uint32_t Behind;
+
+  if (BeaconPeriod == 0)
+  {
+    return HOST_TIME_NEVER;
+  }
+  if (!IC4CONbits.ON && (NextEdgeTime <= Now))
+  {
+    // nothing is captured while it is off, so skip the missed edges
+    NextEdgeTime += (((Now - NextEdgeTime) / BeaconPeriod) + 1) *
+        BeaconPeriod;
+  }
+  while (NextEdgeTime <= Now)
+  {
+    if (IC4CONbits.ON)
+    {
+      // timer 2 has already counted past the edge, so back it out
+      Behind = (Now - NextEdgeTime) / Prescale[T2CONbits.TCKPS];
+      if (IC4Count < IC4_FIFO_SIZE)
+      {
+        IC4Fifo[IC4Count++] = (uint16_t)(TMR2 - Behind);
+      }
+      else
+      {
+        IC4CONbits.ICOV = 1;
+      }
+      IC4CONbits.ICBNE = 1;
+      IFS0SET = _IFS0_IC4IF_MASK;
+    }
+    NextEdgeTime += BeaconPeriod;
+  }
+  if ((IC4Count != 0) && ((IEC0 & _IEC0_IC4IE_MASK) != 0))
+  {
+    HostPort_RaiseInterrupt(IC4ISR, IPC4bits.IC4IP);
+  }
+  return IC4CONbits.ON ? NextEdgeTime : HOST_TIME_NEVER;
+}
+
+/****************************************************************************
+ Function
+     SPI1Model
+ Description
+     sends the byte in SPI1BUF once the transmit interrupt is enabled, then
+     reports the transfer complete through the interrupt. The transfer
+     takes no time.
+****************************************************************************/
+static uint64_t SPI1Model(void)
+{
+  uint8_t Sent;
+  uint8_t Received = 0;
+
+  if (!SPI1CONbits.ON || !IEC1bits.SPI1TXIE)
+  {
+    return HOST_TIME_NEVER;
+  }
+  Sent = (uint8_t)SPI1BUF;
+  if (pSPIListener != NULL)
+  {
+    Received = pSPIListener(Sent, ~LATB & CS_PINS);
+  }
+  SPI1BUF = Received;
+  SPI1STATbits.SPITBE = 1;
+  SPI1STATbits.SRMT = 1;
+  SPI1STATbits.SPIRBE = 0;
+  IFS1SET = _IFS1_SPI1TXIF_MASK | _IFS1_SPI1RXIF_MASK;
+  HostPort_RaiseInterrupt(__SPI1_ISR, IPC7bits.SPI1IP);
+  return HOST_TIME_NEVER;
+}
+
+/****************************************************************************
+ Function
+     ReadIC4BUF
+ Description
+     the IC4BUF stand-in, pops the oldest capture
+****************************************************************************/
+static void ReadIC4BUF(HostReg_t *pReg)
+{
+  uint8_t i;
+
+  if (IC4Count == 0)
+  {
+    return;
+  }
+  pReg->Value = IC4Fifo[0];
+  IC4Count--;
+  for (i = 0; i < IC4Count; i++)
+  {
+    IC4Fifo[i] = IC4Fifo[i + 1];
+  }
+  if (IC4Count == 0)
+  {
+    IC4CONbits.ICBNE = 0;
+  }
+}
+
+/****************************************************************************
+ Function
+     ReadAD1CON2
+ Description
+     the ADC results are read right after BUFS in AD1CON2 is looked at, so
+     this fills both halves of the buffer with the inputs selected in
+     AD1CSSL, lowest numbered first as the scan would
+****************************************************************************/
+static void ReadAD1CON2(HostReg_t *pReg)
+{
+  uint32_t Scan = AD1CSSL;
+  uint8_t Channel;
+  uint8_t Slot = 0;
+
+  (void)pReg;
+  for (Channel = 0; (Channel < NUM_ANALOG_INPUTS) && (Slot < 8); Channel++)
+  {
+    if ((Scan & (1u << Channel)) != 0)
+    {
+      HostADC1BUF[4 * Slot] = AnalogInputs[Channel];
+      HostADC1BUF[4 * (Slot + 8)] = AnalogInputs[Channel];
+      Slot++;
+    }
+  }
+}
+
+/****************************************************************************
+ Function
+     ReadPortA, ReadPortB
+ Description
+     the port stand-ins, output pins read back what was written to LAT
+****************************************************************************/
+static void ReadPortA(HostReg_t *pReg)
+{
+  uint32_t Inputs = TRISA;
+
+  pReg->Value = (pReg->Value & Inputs) | (LATA & ~Inputs);
+}
+
+static void ReadPortB(HostReg_t *pReg)
+{
+  uint32_t Inputs = TRISB;
+
+  pReg->Value = (pReg->Value & Inputs) | (LATB & ~Inputs);
+}
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,117 @@
+/****************************************************************************
+ Module
+     HostPort.h
+ Description
+     header file for the host (Linux/POSIX) port of the framework. Building
+     with ES_HOST_PORT defined (HostPort/Makefile does this) replaces
+     ES_Port.c and terminal.c with ES_Port_Host.c and terminal_host.c and
+     the XC32 device headers with the stand-ins in HostPort/include, so the
+     framework and the robot run as an ordinary executable.
+ Notes
+     The host port is single threaded. Interrupts are delivered by the host
+     port each time ES_Run calls _HW_Process_Pending_Ints: the tick first,
+     then each peripheral model in turn, and a model runs an interrupt
+     response with HostPort_RaiseInterrupt. Code is only interrupted part
+     way through where it calls HostPort_Busy, which stands in for work
+     that takes time, so the host is only a model of the timing on the
+     chip, not a copy of it. An interrupt raised at or below the simulated
+     IPL waits until the IPL drops (the end of a critical region, or the
+     end of the interrupt that held it off).
+
+     With ES_USE_PREEMPTIVE_KERNEL the scheduler interrupt is core software
+     interrupt 0 at IPL1, as on the PIC, and _HW_RequestSchedule sets its
+     request in a simulated Cause register. The tick and the models are
+     then also looked at at the end of every critical region, since the
+     preemptive ES_Run never calls _HW_Process_Pending_Ints. It needs
+     ES_USE_IDLE_WAIT.
+
+     The clock is chosen at run time with the ES_HOST_CLOCK environment
+     variable:
+       real  the tick follows CLOCK_MONOTONIC and, with ES_USE_IDLE_WAIT,
+             the idle wait sleeps until the next tick is due or a key
+             arrives (the default)
+       sim   a simulated clock for replays. Services take no time, and
+             whenever all of the queues are empty the clock jumps
+             straight to whichever comes first: the next ES_Timers
+             expiry, the next time a peripheral model needs to run, or
+             the next key in the replay script. The ticks in between are
+             still all given to ES_Timer_AdvanceTicks. Nothing depends on
+             the host's own timing, so the same script gives the same
+             events in the same order on every run. Without
+             ES_USE_IDLE_WAIT there is no idle to jump from, and the clock
+             moves on a tick each time round ES_Run instead.
+     On the simulated clock stdin is the replay script rather than the
+     keyboard. Each line is a time in ms and the keys to deliver at that
+     time, e.g. "1500 s"; blank lines and lines starting with # are
+     skipped. The run ends when there is nothing left that could happen.
+     ES_HOST_RUN_MS, if set, ends the run after that much (real or
+     simulated) time. Either way a summary goes to stderr.
+
+     make test builds the host port with ES_HOST_TEST defined, which adds
+     HostTestService (see HostTest.h), and runs it on the scripts in tests.
+     make bench times a post and its dispatch with the test build, once
+     with the scheduler's clz lookup and once with ES_NYBBLE_LOOKUP.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 12:10 ahb     ES_USE_IDLE_WAIT is no longer on by default
+ 10/17/26 11:50 ahb     added HostPort_GetCriticalCount
+ 10/17/26 10:30 ahb     runs the preemptive kernel, masked interrupts wait
+ 10/17/26 09:40 ahb     added HostPort_Busy
+ 10/17/26 09:00 ahb     added the test build and HostPort_GetHostTime
+ 10/16/26 19:40 ahb     ticks are credited with ES_Timer_AdvanceTicks
+ 10/16/26 16:10 ahb     simulated clock jumps to the next event, replay scripts
+ 10/16/26 15:00 ahb     started coding
+*****************************************************************************/
+#ifndef HostPort_H
+#define HostPort_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <xc.h>
+
+// an interrupt response, as declared with __ISR in the sources
+typedef void HostIsr_t(void);
+
+// a model of a peripheral, stepped each time interrupts are delivered.
+// Returns the time it next needs to be stepped (for the simulated clock),
+// or HOST_TIME_NEVER if that is up to the code using the peripheral.
+typedef uint64_t HostModel_t(void);
+
+// 'never' for HostModel_t and Terminal_GetNextRxTime
+#define HOST_TIME_NEVER UINT64_MAX
+
+// called with each byte the SPI sends and the chip selects (LATB) that
+// were low at the time, returns the byte clocked back in
+typedef uint8_t HostSPIListener_t(uint8_t Byte, uint32_t ChipSelects);
+
+// the most models that can be added with HostPort_AddModel
+#define HOST_MAX_MODELS 8
+
+// the core timer counts at 20MHz on the chip, so do the host's
+#define HOST_COUNTS_PER_SEC 20000000u
+
+// ES_Port_Host.c
+bool HostPort_AddModel(HostModel_t *pModel);
+void HostPort_RaiseInterrupt(HostIsr_t *pIsr, uint8_t Priority);
+uint64_t HostPort_GetTime(void);
+uint64_t HostPort_GetHostTime(void);
+uint32_t HostPort_GetCriticalCount(void);
+void HostPort_Busy(uint32_t Counts);
+bool HostPort_IsSimClock(void);
+
+// HostRegisters.c
+void HostPort_PlugRegister(HostReg_t *pReg, HostRegHook_t *pHook);
+
+// HostPeripherals.c, the stand-ins for the robot's own peripherals
+void HostPeripherals_Init(void);
+void HostPeripherals_SetBeaconPeriod(uint32_t PeriodUS);
+void HostPeripherals_SetAnalogInput(uint8_t Channel, uint16_t Value);
+void HostPeripherals_SetSPIListener(HostSPIListener_t *pListener);
+
+// terminal_host.c
+int Terminal_GetRxFd(void);
+uint64_t Terminal_GetNextRxTime(void);
+
+#endif /* HostPort_H */
@@ -0,0 +1,134 @@
+/****************************************************************************
+ Module
+     HostRegisters.c
+
+ Description
+     the register stand-ins behind the host port's xc.h. Holds the value of
+     each register and folds writes to the CLR/SET/INV aliases into it.
+
+ Notes
+     A write to an alias can't be seen as it happens, the macros in xc.h
+     hand back a pointer and the caller stores through it. So the write is
+     left pending and applied the next time that register is accessed by
+     any name. Nothing can see the register in between, so the effect is
+     the same as on the chip.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/16/26 15:00 ahb     started coding
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <xc.h>
+#include <stddef.h>
+
+#include "HostPort.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define HOST_DEFINE_REG(r) HostReg_t HostReg_##r = { .pName = #r };
+
+/*---------------------------- Module Functions ---------------------------*/
+static void ApplyPending(HostReg_t *pReg);
+
+/*---------------------------- Module Variables ---------------------------*/
+HOST_REGISTER_TABLE(HOST_DEFINE_REG)
+
+volatile uint32_t HostADC1BUF[16 * 4];
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     HostReg_Access
+ Parameters
+     HostReg_t * : the register
+ Returns
+     volatile uint32_t * : where the value of the register is held
+ Description
+     brings the register up to date, lets a plugged in stand-in refresh
+     it, and returns the value for the caller to read or write
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+volatile uint32_t *HostReg_Access(HostReg_t *pReg)
+{
+  ApplyPending(pReg);
+  if (pReg->pHook != NULL)
+  {
+    pReg->pHook(pReg);
+  }
+  return &pReg->Value;
+}
+
+/****************************************************************************
+ Function
+     HostReg_Clr, HostReg_Set, HostReg_Inv
+ Parameters
+     HostReg_t * : the register
+ Returns
+     volatile uint32_t * : where the caller stores the write to the alias
+ Description
+     the CLR, SET and INV aliases. Any earlier write is applied first, so
+     back to back writes to the aliases all take effect.
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+volatile uint32_t *HostReg_Clr(HostReg_t *pReg)
+{
+  ApplyPending(pReg);
+  return &pReg->PendingClr;
+}
+
+volatile uint32_t *HostReg_Set(HostReg_t *pReg)
+{
+  ApplyPending(pReg);
+  return &pReg->PendingSet;
+}
+
+volatile uint32_t *HostReg_Inv(HostReg_t *pReg)
+{
+  ApplyPending(pReg);
+  return &pReg->PendingInv;
+}
+
+/****************************************************************************
+ Function
+     HostPort_PlugRegister
+ Parameters
+     HostReg_t * : the register, e.g. &HostReg_IC4BUF
+     HostRegHook_t * : the stand-in, or NULL to go back to plain storage
+ Returns
+     nothing
+ Description
+     installs a stand-in that is called before every access to the
+     register, so it can supply the value that the hardware would have
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void HostPort_PlugRegister(HostReg_t *pReg, HostRegHook_t *pHook)
+{
+  pReg->pHook = pHook;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     ApplyPending
+ Parameters
+     HostReg_t * : the register
+ Returns
+     nothing
+ Description
+     folds any pending writes to the aliases into the register value
+****************************************************************************/
+static void ApplyPending(HostReg_t *pReg)
+{
+  pReg->Value = ((pReg->Value & ~pReg->PendingClr) | pReg->PendingSet) ^
+      pReg->PendingInv;
+  pReg->PendingClr = 0;
+  pReg->PendingSet = 0;
+  pReg->PendingInv = 0;
+}
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
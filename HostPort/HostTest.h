@@ -0,0 +1,42 @@
+/****************************************************************************
+ Module
+     HostTest.h
+ Description
+     the configuration of the host port's test build, which is made with
+     ES_HOST_TEST defined (make test). ES_Configure.h includes this to add
+     HostTestService and HostTestProbe after the robot's services.
+ Notes
+     With ES_HOST_TEST_BATCH also defined HostTestService is a BATCH_SERVICE
+     rather than a SERVICE, so that make test can time a burst both ways.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 10:30 ahb     added HostTestProbe
+ 10/17/26 09:40 ahb     HostTestService has an ISR inbox
+ 10/17/26 09:00 ahb     started coding
+*****************************************************************************/
+#ifndef HostTest_H
+#define HostTest_H
+
+#define HOST_TEST_NUM_SERVICES 2
+
+// HostTestProbe is only ever posted to by the preempt test ('x')
+#ifdef ES_HOST_TEST_BATCH
+#define HOST_TEST_SERVICES(SERVICE, BATCH_SERVICE)                          \
+  BATCH_SERVICE(5, InitHostTestService, RunHostTestBatch, 16, 8)           \
+  SERVICE(6, InitHostTestProbe, RunHostTestProbe, 1)
+#else
+#define HOST_TEST_SERVICES(SERVICE, BATCH_SERVICE)                          \
+  SERVICE(5, InitHostTestService, RunHostTestService, 16)                 \
+  SERVICE(6, InitHostTestProbe, RunHostTestProbe, 1)
+#endif
+
+// the inbox test ('n') posts to HostTestService from an ISR at IPL 6
+#define HOST_TEST_INBOXES(INBOX)                                            \
+  INBOX(5, 8)
+
+#define SERV_5_HEADER "HostTestService.h"
+#define SERV_6_HEADER "HostTestService.h"
+
+#endif /* HostTest_H */
@@ -0,0 +1,670 @@
+/****************************************************************************
+ Module
+   HostTestService.c
+
+ Revision
+   1.0.0
+
+ Description
+   The services that the host port's test build adds after the robot's,
+   see HostTest.h. Each test is started by a key from a script in
+   HostPort/tests and prints a "host test:" line that ends in PASS or FAIL,
+   which is what make test looks for.
+
+ Notes
+   'b'  burst: posts NUM_BURSTS bursts of BURST_SIZE events to this service,
+        each with one ES_PostBatchToService, posting the next when the last
+        of the one before has been handled. Checks that every event arrives
+        in order, then gives the scheduler passes and run calls it took and
+        the host time per event. make test runs it with the service as a
+        SERVICE and as a BATCH_SERVICE.
+   'n'  inbox: raises a simulated ISR at IPL 6 that posts INBOX_TEST_POSTS
+        events to this service, more than its ISR inbox holds, then keeps
+        busy for INBOX_TEST_BUSY so that they are drained later than they
+        were posted. Checks that the ones that fit arrive in order with the
+        time stamp the ISR gave them, and that the rest are counted as
+        overflows by ES_GetQueueStats.
+   'x'  preempt: starts a short timer that posts to HostTestProbe, the
+        service above this one, PROBE_TIMEOUT from now, then keeps busy for
+        PROBE_BUSY. Under the preemptive kernel the probe must run as soon
+        as its timeout is posted, under the cooperative ES_Run once this
+        service is done. Either way gives the probe's dispatch latency.
+   'e'  round trip: posts HOST_TEST_ECHO to this service, which posts it
+        to itself again from its run function until it has been through
+        ES_Run ROUND_TRIPS times. Gives the host time and the critical
+        regions that a post and its dispatch take. make bench runs it with
+        the scheduler's clz lookup and with ES_NYBBLE_LOOKUP.
+   'u'  short timer race: starts a RACE_TIMEOUT short timer to this
+        service with an interrupt made to come up inside
+        ES_ShortTimerStart's critical region. That interrupt keeps busy
+        past the timeout when the critical region ends, so the timer times
+        out before ES_ShortTimerStart returns. Checks that exactly one
+        ES_SHORT_TIMEOUT arrives.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 11:50 ahb     added the round trip test
+ 10/17/26 11:00 ahb     added the short timer race test
+ 10/17/26 10:30 ahb     added HostTestProbe and the preempt test
+ 10/17/26 09:40 ahb     added the inbox test
+ 10/17/26 09:00 ahb     started coding, the burst test
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_Port.h"
+#include "ES_ShortTimer.h"
+#include "ES_Timers.h"
+
+#include "HostTestService.h"
+#include "HostPort.h"
+
+#ifdef ES_HOST_TEST
+/*----------------------------- Module Defines ----------------------------*/
+// the burst test, a burst is the most a BATCH_SERVICE takes in one call
+#define BURST_SIZE ES_MAX_BATCH
+#define NUM_BURSTS 1000
+
+// the inbox test, INBOX(5, 8) in HostTest.h
+#define INBOX_SIZE 8
+#define INBOX_TEST_POSTS (INBOX_SIZE + 2)
+#define INBOX_TEST_BUSY (10 * _HW_COUNTS_PER_US)
+
+// the preempt test
+#define PROBE_TIMER 2
+#define PROBE_TIMEOUT 500         // us
+#define PROBE_BUSY 2000           // us
+
+// the round trip test
+#define ROUND_TRIPS 1000000UL
+
+// the short timer race test, RACE_ISR_BUSY must be well past RACE_TIMEOUT
+#define RACE_TIMER 3
+#define RACE_TIMEOUT 2            // us
+#define RACE_ISR_IPL 5
+#define RACE_ISR_BUSY (5 * _HW_COUNTS_PER_US)
+#define RACE_WAIT 10              // ticks, for any second timeout to arrive
+
+#if !defined(_INCLUDE_DISPATCH_STATS_) || !defined(_INCLUDE_LATENCY_STATS_)
+#error "the host port's test build needs _INCLUDE_DISPATCH_STATS_ and _INCLUDE_LATENCY_STATS_"
+#endif
+
+/*---------------------------- Module Functions ---------------------------*/
+static void StartBurstTest(void);
+static void PostBurst(void);
+static void ReceiveBurstEvent(uint16_t Param);
+static void ReportBurstTest(void);
+static void StartInboxTest(void);
+static void InboxTestISR(void);
+static void ReceiveInboxEvent(ES_Event_t ThisEvent);
+static void StartPreemptTest(void);
+static void StartRoundTripTest(void);
+static void ReportRoundTripTest(void);
+static void StartRaceTest(void);
+static void RaceHook(HostReg_t *pReg);
+static void RaceTestISR(void);
+static void ReportRaceTest(void);
+
+/*---------------------------- Module Variables ---------------------------*/
+static uint8_t MyPriority;
+
+// the burst test
+static uint16_t BurstsLeft;
+static uint16_t NextInBurst;      // the EventParam the next event should have
+static uint32_t NumReceived;
+static bool InOrder;
+static uint64_t StartTime;        // host time, see HostPort_GetHostTime
+static ES_DispatchStats_t StartStats;
+
+// the inbox test
+static uint32_t IsrTime;          // _HW_GetCycleCount in InboxTestISR
+static uint16_t InboxReceived;
+static bool StampsKept;
+static ES_QueueStats_t StartQueueStats;
+
+// the preempt test
+static uint8_t ProbePriority;
+static uint64_t ProbeDueTime;     // ES_Time_Now for the probe's timeout
+static bool IsBusy;               // this service is in HostPort_Busy
+
+// the round trip test
+static uint32_t TripsLeft;
+static uint64_t TripStartTime;    // host time, see HostPort_GetHostTime
+static uint32_t TripStartCriticals;
+static ES_DispatchStats_t TripStartStats;
+
+// the short timer race test
+static uint8_t RaceTimeouts;
+static ES_TimerHandle_t RaceWaitTimer;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     InitHostTestService
+ Parameters
+     uint8_t : the priority of this service
+ Returns
+     bool, false if error in initialization, true otherwise
+ Description
+     the tests are started from the keyboard, so subscribes to EV_NEW_KEY.
+     RACE_TIMER's timeouts come here.
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+bool InitHostTestService(uint8_t Priority)
+{
+  MyPriority = Priority;
+  // nothing in the robot uses the short timers
+  ES_ShortTimerInit(SHORT_TIMER_UNUSED, SHORT_TIMER_UNUSED);
+  ES_ShortTimerSetService(RACE_TIMER, MyPriority);
+  return ES_Subscribe(MyPriority, EV_NEW_KEY);
+}
+
+/****************************************************************************
+ Function
+     PostHostTestService
+ Parameters
+     ES_Event_t ThisEvent ,the event to post to the queue
+ Returns
+     bool false if the Enqueue operation failed, true otherwise
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+bool PostHostTestService(ES_Event_t ThisEvent)
+{
+  return ES_PostToService(MyPriority, ThisEvent);
+}
+
+/****************************************************************************
+ Function
+    RunHostTestService
+ Parameters
+   ES_Event_t : the event to process
+ Returns
+   ES_Event_t, ES_NO_EVENT if no error ES_ERROR otherwise
+ Description
+   starts the test for a key, and runs the tests that are under way
+ Author
+   A. Brown, 10/17/26
+****************************************************************************/
+ES_Event_t RunHostTestService(ES_Event_t ThisEvent)
+{
+  ES_Event_t ReturnEvent;
+  ReturnEvent.EventType = ES_NO_EVENT; // assume no errors
+
+  switch (ThisEvent.EventType)
+  {
+    case EV_NEW_KEY:
+    {
+      if (ThisEvent.EventParam == 'b')
+      {
+        StartBurstTest();
+      }
+      else if (ThisEvent.EventParam == 'n')
+      {
+        StartInboxTest();
+      }
+      else if (ThisEvent.EventParam == 'x')
+      {
+        StartPreemptTest();
+      }
+      else if (ThisEvent.EventParam == 'e')
+      {
+        StartRoundTripTest();
+      }
+      else if (ThisEvent.EventParam == 'u')
+      {
+        StartRaceTest();
+      }
+    }
+    break;
+
+    case HOST_TEST_BURST:
+    {
+      ReceiveBurstEvent(ThisEvent.EventParam);
+    }
+    break;
+
+    case HOST_TEST_INBOX:
+    {
+      ReceiveInboxEvent(ThisEvent);
+    }
+    break;
+
+    case HOST_TEST_ECHO:
+    {
+      if (--TripsLeft > 0)
+      {
+        PostHostTestService(ThisEvent);
+      }
+      else
+      {
+        ReportRoundTripTest();
+      }
+    }
+    break;
+
+    case ES_SHORT_TIMEOUT:
+    {
+      if (ThisEvent.EventParam == RACE_TIMER)
+      {
+        RaceTimeouts++;
+      }
+    }
+    break;
+
+    case ES_TIMEOUT:
+    {
+      if (ES_Timer_IsTimeoutFrom(ThisEvent, RaceWaitTimer))
+      {
+        ReportRaceTest();
+      }
+    }
+    break;
+  }
+  return ReturnEvent;
+}
+
+/****************************************************************************
+ Function
+    RunHostTestBatch
+ Parameters
+   const ES_Event_t * : the events taken from the queue
+   uint8_t : how many there are
+ Returns
+   ES_Event_t, ES_NO_EVENT if no error ES_ERROR otherwise
+ Description
+   the run function when this is a BATCH_SERVICE, handles each event as
+   RunHostTestService would
+ Author
+   A. Brown, 10/17/26
+****************************************************************************/
+ES_Event_t RunHostTestBatch(const ES_Event_t *pEvents, uint8_t NumEvents)
+{
+  ES_Event_t ReturnEvent;
+  uint8_t i;
+
+  ReturnEvent.EventType = ES_NO_EVENT;
+  for (i = 0; (i < NumEvents) && (ReturnEvent.EventType == ES_NO_EVENT); i++)
+  {
+    ReturnEvent = RunHostTestService(pEvents[i]);
+  }
+  return ReturnEvent;
+}
+
+/****************************************************************************
+ Function
+     InitHostTestProbe
+ Parameters
+     uint8_t : the priority of this service
+ Returns
+     bool, false if error in initialization, true otherwise
+ Description
+     the probe's timeouts come from PROBE_TIMER
+ Author
+     A. Brown, 10/17/26
+****************************************************************************/
+bool InitHostTestProbe(uint8_t Priority)
+{
+  ProbePriority = Priority;
+  return ES_ShortTimerSetService(PROBE_TIMER, ProbePriority);
+}
+
+/****************************************************************************
+ Function
+    RunHostTestProbe
+ Parameters
+   ES_Event_t : the event to process
+ Returns
+   ES_Event_t, ES_NO_EVENT if no error ES_ERROR otherwise
+ Description
+   the other half of the preempt test, prints the result
+ Author
+   A. Brown, 10/17/26
+****************************************************************************/
+ES_Event_t RunHostTestProbe(ES_Event_t ThisEvent)
+{
+  ES_Event_t ReturnEvent;
+  uint64_t Now;
+  uint32_t Lateness;
+  uint32_t MaxLatency;
+  bool Passed;
+
+  ReturnEvent.EventType = ES_NO_EVENT;
+  if (ThisEvent.EventType != ES_SHORT_TIMEOUT)
+  {
+    return ReturnEvent;
+  }
+  Now = ES_Time_Now();
+  // a timeout can come up to 1us early
+  Lateness = (Now > ProbeDueTime) ? (uint32_t)(Now - ProbeDueTime) : 0;
+  MaxLatency = ES_GetMaxDispatchLatency(ProbePriority);
+#ifdef ES_USE_PREEMPTIVE_KERNEL
+  Passed = IsBusy;
+#else
+  Passed = !IsBusy;
+#endif
+  printf("host test: preempt, the probe ran %lu us after its timeout, %s a "
+      "lower priority service's %u us of work, max dispatch latency %lu us, "
+      "%s\n", (unsigned long)(Lateness / _HW_COUNTS_PER_US),
+      IsBusy ? "part way through" : "after", PROBE_BUSY,
+      (unsigned long)(MaxLatency / _HW_COUNTS_PER_US),
+      Passed ? "PASS" : "FAIL");
+  return ReturnEvent;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+   StartBurstTest
+ Description
+   notes the dispatch stats and the host time and posts the first burst
+****************************************************************************/
+static void StartBurstTest(void)
+{
+  ES_GetDispatchStats(&StartStats);
+  StartTime = HostPort_GetHostTime();
+  BurstsLeft = NUM_BURSTS;
+  NumReceived = 0;
+  InOrder = true;
+  PostBurst();
+}
+
+/****************************************************************************
+ Function
+   PostBurst
+ Description
+   posts BURST_SIZE events to this service in one go, numbered from 0 in
+   EventParam
+****************************************************************************/
+static void PostBurst(void)
+{
+  ES_Event_t Burst[BURST_SIZE];
+  uint8_t i;
+
+  for (i = 0; i < BURST_SIZE; i++)
+  {
+    Burst[i].EventType = HOST_TEST_BURST;
+    Burst[i].EventParam = i;
+  }
+  NextInBurst = 0;
+  BurstsLeft--;
+  if (!ES_PostBatchToService(MyPriority, Burst, BURST_SIZE, false))
+  {
+    InOrder = false;
+  }
+}
+
+/****************************************************************************
+ Function
+   ReceiveBurstEvent
+ Description
+   checks that the events of a burst come in the order they were posted,
+   and posts the next burst after the last of this one
+****************************************************************************/
+static void ReceiveBurstEvent(uint16_t Param)
+{
+  NumReceived++;
+  if (Param != NextInBurst)
+  {
+    InOrder = false;
+  }
+  if (++NextInBurst < BURST_SIZE)
+  {
+    return;
+  }
+  if (BurstsLeft > 0)
+  {
+    PostBurst();
+  }
+  else
+  {
+    ReportBurstTest();
+  }
+}
+
+/****************************************************************************
+ Function
+   ReportBurstTest
+ Description
+   prints the result. The stats were read during the dispatch of the 'b'
+   key and are read again during the dispatch of the last event, so the
+   difference is the bursts alone. Nothing else can run in between, this
+   is the highest priority service.
+****************************************************************************/
+static void ReportBurstTest(void)
+{
+  ES_DispatchStats_t Stats;
+  uint64_t HostTime = HostPort_GetHostTime() - StartTime;
+  uint32_t NumEvents = (uint32_t)NUM_BURSTS * BURST_SIZE;
+  uint32_t Passes;
+  uint32_t RunCalls;
+  bool Passed;
+
+  ES_GetDispatchStats(&Stats);
+  Passes = Stats.SchedulerPasses - StartStats.SchedulerPasses;
+  RunCalls = Stats.RunCalls - StartStats.RunCalls;
+  // a SERVICE takes a pass per event, a BATCH_SERVICE a pass per burst
+#ifdef ES_HOST_TEST_BATCH
+  Passed = (Passes == NUM_BURSTS);
+#else
+  Passed = (Passes == NumEvents);
+#endif
+  Passed = Passed && InOrder && (NumReceived == NumEvents) &&
+      (RunCalls == Passes) &&
+      ((Stats.EventsDispatched - StartStats.EventsDispatched) == NumEvents);
+  printf("host test: burst %s, %lu events in %u bursts of %u: "
+      "%lu scheduler passes, %lu run calls, %lu ns per event, %s\n",
+#ifdef ES_HOST_TEST_BATCH
+      "BATCH_SERVICE",
+#else
+      "SERVICE",
+#endif
+      (unsigned long)NumReceived, NUM_BURSTS, BURST_SIZE,
+      (unsigned long)Passes, (unsigned long)RunCalls,
+      (unsigned long)((HostTime * (1000000000u / HOST_COUNTS_PER_SEC)) /
+          NumEvents),
+      Passed ? "PASS" : "FAIL");
+}
+
+/****************************************************************************
+ Function
+   StartInboxTest
+ Description
+   raises InboxTestISR and keeps busy, so that ES_Run drains the inbox
+   INBOX_TEST_BUSY after the ISR filled it
+****************************************************************************/
+static void StartInboxTest(void)
+{
+  ES_GetQueueStats(MyPriority, &StartQueueStats);
+  InboxReceived = 0;
+  StampsKept = true;
+  HostPort_RaiseInterrupt(InboxTestISR, 6);
+  HostPort_Busy(INBOX_TEST_BUSY);
+}
+
+/****************************************************************************
+ Function
+   InboxTestISR
+ Description
+   posts INBOX_TEST_POSTS events, numbered from 0 in EventParam. Being in
+   an ISR, they go to the inbox.
+****************************************************************************/
+static void InboxTestISR(void)
+{
+  ES_Event_t ThisEvent;
+  uint8_t i;
+
+  IsrTime = _HW_GetCycleCount();
+  ThisEvent.EventType = HOST_TEST_INBOX;
+  for (i = 0; i < INBOX_TEST_POSTS; i++)
+  {
+    ThisEvent.EventParam = i;
+    PostHostTestService(ThisEvent);
+  }
+}
+
+/****************************************************************************
+ Function
+   ReceiveInboxEvent
+ Description
+   checks each event that made it through the inbox, and prints the result
+   after the last of them
+****************************************************************************/
+static void ReceiveInboxEvent(ES_Event_t ThisEvent)
+{
+  ES_QueueStats_t Stats;
+  uint16_t Overflows;
+  bool Passed;
+
+  if ((ThisEvent.EventParam != InboxReceived) ||
+      (ThisEvent.TimeStamp != IsrTime))
+  {
+    StampsKept = false;
+  }
+  if (++InboxReceived < INBOX_SIZE)
+  {
+    return;
+  }
+  ES_GetQueueStats(MyPriority, &Stats);
+  Overflows = Stats.NumOverflows - StartQueueStats.NumOverflows;
+  Passed = StampsKept && (Overflows == (INBOX_TEST_POSTS - INBOX_SIZE));
+  printf("host test: inbox, %u of %u posts from the ISR arrived %lu counts "
+      "after it, %s its time stamp, %u overflows counted, %s\n",
+      InboxReceived, INBOX_TEST_POSTS,
+      (unsigned long)(_HW_GetCycleCount() - IsrTime),
+      StampsKept ? "in order with" : "NOT in order with",
+      Overflows, Passed ? "PASS" : "FAIL");
+}
+
+/****************************************************************************
+ Function
+   StartPreemptTest
+ Description
+   starts the probe's timer and keeps busy past it
+****************************************************************************/
+static void StartPreemptTest(void)
+{
+  ProbeDueTime = ES_Time_Now() + (PROBE_TIMEOUT * _HW_COUNTS_PER_US);
+  ES_ShortTimerStart(PROBE_TIMER, PROBE_TIMEOUT);
+  IsBusy = true;
+  HostPort_Busy(PROBE_BUSY * _HW_COUNTS_PER_US);
+  IsBusy = false;
+}
+
+/****************************************************************************
+ Function
+   StartRoundTripTest
+ Description
+   notes the dispatch stats, the critical regions and the host time and
+   posts the first echo
+****************************************************************************/
+static void StartRoundTripTest(void)
+{
+  ES_Event_t ThisEvent;
+
+  ES_GetDispatchStats(&TripStartStats);
+  TripStartCriticals = HostPort_GetCriticalCount();
+  TripStartTime = HostPort_GetHostTime();
+  TripsLeft = ROUND_TRIPS;
+  ThisEvent.EventType = HOST_TEST_ECHO;
+  ThisEvent.EventParam = 0;
+  PostHostTestService(ThisEvent);
+}
+
+/****************************************************************************
+ Function
+   ReportRoundTripTest
+ Description
+   prints the result, from the dispatch of the last echo. As in
+   ReportBurstTest nothing else runs in between.
+****************************************************************************/
+static void ReportRoundTripTest(void)
+{
+  ES_DispatchStats_t Stats;
+  uint64_t HostTime = HostPort_GetHostTime() - TripStartTime;
+  uint32_t Criticals = HostPort_GetCriticalCount() - TripStartCriticals;
+  uint32_t Dispatched;
+
+  ES_GetDispatchStats(&Stats);
+  Dispatched = Stats.EventsDispatched - TripStartStats.EventsDispatched;
+  printf("host test: round trip, %s lookup, %lu posts and dispatches: "
+      "%lu ns and %lu.%02lu critical regions each, %s\n",
+#ifdef ES_NYBBLE_LOOKUP
+      "nybble walk",
+#else
+      "clz",
+#endif
+      (unsigned long)Dispatched,
+      (unsigned long)((HostTime * (1000000000u / HOST_COUNTS_PER_SEC)) /
+          ROUND_TRIPS),
+      (unsigned long)(Criticals / ROUND_TRIPS),
+      (unsigned long)((Criticals % ROUND_TRIPS) * 100 / ROUND_TRIPS),
+      (Dispatched == ROUND_TRIPS) ? "PASS" : "FAIL");
+}
+
+/****************************************************************************
+ Function
+   StartRaceTest
+ Description
+   starts RACE_TIMER with RaceHook plugged into PR4, which
+   ES_ShortTimerStart writes inside its critical region, then waits
+   RACE_WAIT for the timeouts to come in
+****************************************************************************/
+static void StartRaceTest(void)
+{
+  RaceTimeouts = 0;
+  HostPort_PlugRegister(&HostReg_PR4, RaceHook);
+  ES_ShortTimerStart(RACE_TIMER, RACE_TIMEOUT);
+  HostPort_PlugRegister(&HostReg_PR4, NULL);
+  RaceWaitTimer = ES_Timer_Alloc(MyPriority);
+  ES_Timer_Arm(RaceWaitTimer, RACE_WAIT);
+}
+
+/****************************************************************************
+ Function
+   RaceHook
+ Description
+   raises RaceTestISR the first time PR4 is written. Interrupts are held
+   off there, so it waits for the end of the critical region.
+****************************************************************************/
+static void RaceHook(HostReg_t *pReg)
+{
+  HostPort_PlugRegister(pReg, NULL);
+  HostPort_RaiseInterrupt(RaceTestISR, RACE_ISR_IPL);
+}
+
+/****************************************************************************
+ Function
+   RaceTestISR
+ Description
+   an interrupt that takes long enough for the short timer's own
+   interrupt, above it, to come up part way through
+****************************************************************************/
+static void RaceTestISR(void)
+{
+  HostPort_Busy(RACE_ISR_BUSY);
+}
+
+/****************************************************************************
+ Function
+   ReportRaceTest
+ Description
+   prints the result and gives back the wait timer
+****************************************************************************/
+static void ReportRaceTest(void)
+{
+  ES_Timer_Free(RaceWaitTimer);
+  printf("host test: short timer race, a %u us timer that timed out before "
+      "ES_ShortTimerStart returned posted %u timeouts, %s\n", RACE_TIMEOUT,
+      RaceTimeouts, (RaceTimeouts == 1) ? "PASS" : "FAIL");
+}
+
+#endif /* ES_HOST_TEST */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
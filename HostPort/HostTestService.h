@@ -0,0 +1,25 @@
+/****************************************************************************
+
+  Header file for the host port's test service, see HostTest.h
+  based on the Gen 2 Events and Services Framework
+
+ ****************************************************************************/
+
+#ifndef HostTestService_H
+#define HostTestService_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ES_Events.h"
+
+// Public Function Prototypes
+
+bool InitHostTestService(uint8_t Priority);
+bool PostHostTestService(ES_Event_t ThisEvent);
+ES_Event_t RunHostTestService(ES_Event_t ThisEvent);
+ES_Event_t RunHostTestBatch(const ES_Event_t *pEvents, uint8_t NumEvents);
+bool InitHostTestProbe(uint8_t Priority);
+ES_Event_t RunHostTestProbe(ES_Event_t ThisEvent);
+
+#endif /* HostTestService_H */
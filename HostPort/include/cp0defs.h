@@ -0,0 +1,7 @@
+/****************************************************************************
+ Module
+     cp0defs.h (host port)
+ Description
+     the core registers that the sources use are stood in for in xc.h
+*****************************************************************************/
+#include <xc.h>
@@ -0,0 +1,7 @@
+/****************************************************************************
+ Module
+     p32xxxx.h (host port)
+ Description
+     the device registers are stood in for in xc.h
+*****************************************************************************/
+#include <xc.h>
@@ -0,0 +1,7 @@
+/****************************************************************************
+ Module
+     proc/p32mx170f256b.h (host port)
+ Description
+     the device registers are stood in for in xc.h
+*****************************************************************************/
+#include <xc.h>
@@ -0,0 +1,14 @@
+/****************************************************************************
+ Module
+     sys/attribs.h (host port)
+ Description
+     on the host an interrupt response is an ordinary function. The host
+     port, or a stand-in for the peripheral, calls it through
+     HostPort_RaiseInterrupt.
+*****************************************************************************/
+#ifndef HOST_SYS_ATTRIBS_H
+#define HOST_SYS_ATTRIBS_H
+
+#define __ISR(Vector, Priority)
+
+#endif /* HOST_SYS_ATTRIBS_H */
@@ -0,0 +1,874 @@
+/****************************************************************************
+ Module
+     xc.h (host port)
+ Description
+     stand-in for the XC32 device header when the framework and the robot
+     are built as a Linux executable. Each special function register that
+     the sources use becomes a HostReg_t, with its CLR/SET/INV aliases and
+     its bit fields laid out as on the PIC32MX170F256B so that the masks
+     and the bit fields agree.
+ Notes
+     Every access goes through HostReg_Access (or one of the alias
+     functions) so that writes to the CLR/SET/INV aliases are folded into
+     the register before it is next looked at, and so that a stand-in
+     plugged in with HostPort_PlugRegister can supply the value of a data
+     register (SPI1BUF, IC4BUF) as it is read.
+     The ADC result buffers are plain words in one array, 16 bytes apart as
+     on the chip, because PIC32_AD_Lib walks them with a pointer.
+     Only the registers and bits used by this project are here, add to
+     HOST_REGISTER_TABLE and the bit field types as needed.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+ 10/17/26 12:30 ahb     __builtin_disable_interrupts returns the Status, which
+                        holds IE, as on the PIC
+ 10/17/26 10:30 ahb     added the Cause register and _CP0_SET_STATUS for the
+                        preemptive kernel
+ 10/16/26 21:40 ahb     added Timer4/Timer5 for ES_ShortTimer
+ 10/16/26 15:00 ahb     started coding
+*****************************************************************************/
+#ifndef HOST_XC_H
+#define HOST_XC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// XC32 keywords and builtins that have no meaning on the host
+#define __reentrant
+#define __builtin_disable_interrupts() HostPort_DisableInts()
+#define __builtin_enable_interrupts() HostPort_EnableInts()
+
+/*----------------------------- Register model ----------------------------*/
+typedef struct HostReg_t HostReg_t;
+
+// a stand-in for a register, called just before each access to it
+typedef void HostRegHook_t(HostReg_t *pReg);
+
+struct HostReg_t
+{
+  uint32_t Value;
+  uint32_t PendingClr;  // last write to the CLR alias, not yet applied
+  uint32_t PendingSet;  // last write to the SET alias, not yet applied
+  uint32_t PendingInv;  // last write to the INV alias, not yet applied
+  HostRegHook_t *pHook;
+  const char *pName;
+};
+
+volatile uint32_t *HostReg_Access(HostReg_t *pReg);
+volatile uint32_t *HostReg_Clr(HostReg_t *pReg);
+volatile uint32_t *HostReg_Set(HostReg_t *pReg);
+volatile uint32_t *HostReg_Inv(HostReg_t *pReg);
+
+uint32_t HostPort_DisableInts(void);
+void HostPort_EnableInts(void);
+uint32_t HostPort_GetCount(void);
+uint32_t HostPort_GetStatus(void);
+void HostPort_SetStatus(uint32_t Status);
+void HostPort_SetCause(uint32_t Mask);
+void HostPort_ClearCause(uint32_t Mask);
+
+#define HOST_REG(r) (*HostReg_Access(&HostReg_##r))
+#define HOST_REG_CLR(r) (*HostReg_Clr(&HostReg_##r))
+#define HOST_REG_SET(r) (*HostReg_Set(&HostReg_##r))
+#define HOST_REG_INV(r) (*HostReg_Inv(&HostReg_##r))
+#define HOST_REG_BITS(r) \
+  (*(volatile __##r##bits_t *)HostReg_Access(&HostReg_##r))
+
+/*--------------------------- Core (CP0) registers ------------------------*/
+#define _CP0_GET_COUNT() HostPort_GetCount()
+#define _CP0_GET_STATUS() HostPort_GetStatus()
+#define _CP0_SET_STATUS(Status) HostPort_SetStatus(Status)
+#define _CP0_STATUS_IPL_POSITION 10
+#define _CP0_STATUS_IPL_MASK 0x0001FC00
+#define _CP0_STATUS_IE_MASK 0x00000001
+// only the request for core software interrupt 0 is modelled
+#define _CP0_BIS_CAUSE(Mask) HostPort_SetCause(Mask)
+#define _CP0_BIC_CAUSE(Mask) HostPort_ClearCause(Mask)
+#define _CP0_CAUSE_IP0_MASK 0x00000100
+
+/*------------------------------- Bit fields ------------------------------*/
+typedef struct
+{
+  unsigned DONE:1;
+  unsigned SAMP:1;
+  unsigned ASAM:1;
+  unsigned :1;
+  unsigned CLRASAM:1;
+  unsigned SSRC:3;
+  unsigned FORM:3;
+  unsigned :2;
+  unsigned SIDL:1;
+  unsigned :1;
+  unsigned ON:1;
+}__AD1CON1bits_t;
+
+typedef struct
+{
+  unsigned ALTS:1;
+  unsigned BUFM:1;
+  unsigned SMPI:4;
+  unsigned :1;
+  unsigned BUFS:1;
+  unsigned :2;
+  unsigned CSCNA:1;
+  unsigned :1;
+  unsigned OFFCAL:1;
+  unsigned VCFG:3;
+}__AD1CON2bits_t;
+
+typedef struct
+{
+  unsigned ADCS:8;
+  unsigned SAMC:5;
+  unsigned :2;
+  unsigned ADRC:1;
+}__AD1CON3bits_t;
+
+typedef struct
+{
+  unsigned :13;
+  unsigned SIDL:1;
+  unsigned :1;
+  unsigned ON:1;
+}__CNCONAbits_t;
+
+typedef __CNCONAbits_t __CNCONBbits_t;
+
+typedef struct
+{
+  unsigned ICM:3;
+  unsigned ICBNE:1;
+  unsigned ICOV:1;
+  unsigned ICI:2;
+  unsigned ICTMR:1;
+  unsigned C32:1;
+  unsigned FEDGE:1;
+  unsigned :3;
+  unsigned SIDL:1;
+  unsigned :1;
+  unsigned ON:1;
+}__IC4CONbits_t;
+
+typedef struct
+{
+  unsigned CTIF:1;
+  unsigned CS0IF:1;
+  unsigned CS1IF:1;
+  unsigned INT0IF:1;
+  unsigned T1IF:1;
+  unsigned IC1EIF:1;
+  unsigned IC1IF:1;
+  unsigned OC1IF:1;
+  unsigned INT1IF:1;
+  unsigned T2IF:1;
+  unsigned IC2EIF:1;
+  unsigned IC2IF:1;
+  unsigned OC2IF:1;
+  unsigned INT2IF:1;
+  unsigned T3IF:1;
+  unsigned IC3EIF:1;
+  unsigned IC3IF:1;
+  unsigned OC3IF:1;
+  unsigned INT3IF:1;
+  unsigned T4IF:1;
+  unsigned IC4EIF:1;
+  unsigned IC4IF:1;
+  unsigned OC4IF:1;
+  unsigned INT4IF:1;
+  unsigned T5IF:1;
+  unsigned IC5EIF:1;
+  unsigned IC5IF:1;
+  unsigned OC5IF:1;
+  unsigned AD1IF:1;
+  unsigned FSCMIF:1;
+  unsigned RTCCIF:1;
+  unsigned FCEIF:1;
+}__IFS0bits_t;
+
+typedef struct
+{
+  unsigned CTIE:1;
+  unsigned CS0IE:1;
+  unsigned CS1IE:1;
+  unsigned INT0IE:1;
+  unsigned T1IE:1;
+  unsigned IC1EIE:1;
+  unsigned IC1IE:1;
+  unsigned OC1IE:1;
+  unsigned INT1IE:1;
+  unsigned T2IE:1;
+  unsigned IC2EIE:1;
+  unsigned IC2IE:1;
+  unsigned OC2IE:1;
+  unsigned INT2IE:1;
+  unsigned T3IE:1;
+  unsigned IC3EIE:1;
+  unsigned IC3IE:1;
+  unsigned OC3IE:1;
+  unsigned INT3IE:1;
+  unsigned T4IE:1;
+  unsigned IC4EIE:1;
+  unsigned IC4IE:1;
+  unsigned OC4IE:1;
+  unsigned INT4IE:1;
+  unsigned T5IE:1;
+  unsigned IC5EIE:1;
+  unsigned IC5IE:1;
+  unsigned OC5IE:1;
+  unsigned AD1IE:1;
+  unsigned FSCMIE:1;
+  unsigned RTCCIE:1;
+  unsigned FCEIE:1;
+}__IEC0bits_t;
+
+typedef struct
+{
+  unsigned CMP1IF:1;
+  unsigned CMP2IF:1;
+  unsigned CMP3IF:1;
+  unsigned USBIF:1;
+  unsigned SPI1EIF:1;
+  unsigned SPI1RXIF:1;
+  unsigned SPI1TXIF:1;
+  unsigned U1EIF:1;
+  unsigned U1RXIF:1;
+  unsigned U1TXIF:1;
+}__IFS1bits_t;
+
+typedef struct
+{
+  unsigned CMP1IE:1;
+  unsigned CMP2IE:1;
+  unsigned CMP3IE:1;
+  unsigned USBIE:1;
+  unsigned SPI1EIE:1;
+  unsigned SPI1RXIE:1;
+  unsigned SPI1TXIE:1;
+  unsigned U1EIE:1;
+  unsigned U1RXIE:1;
+  unsigned U1TXIE:1;
+}__IEC1bits_t;
+
+typedef struct
+{
+  unsigned :12;
+  unsigned MVEC:1;
+}__INTCONbits_t;
+
+typedef struct
+{
+  unsigned CTIS:2;
+  unsigned CTIP:3;
+  unsigned :3;
+  unsigned CS0IS:2;
+  unsigned CS0IP:3;
+}__IPC0bits_t;
+
+typedef struct
+{
+  unsigned T2IS:2;
+  unsigned T2IP:3;
+}__IPC2bits_t;
+
+typedef struct
+{
+  unsigned T3IS:2;
+  unsigned T3IP:3;
+}__IPC3bits_t;
+
+typedef struct
+{
+  unsigned T4IS:2;
+  unsigned T4IP:3;
+  unsigned :3;
+  unsigned IC4IS:2;
+  unsigned IC4IP:3;
+}__IPC4bits_t;
+
+typedef struct
+{
+  unsigned T5IS:2;
+  unsigned T5IP:3;
+}__IPC5bits_t;
+
+typedef struct
+{
+  unsigned :24;
+  unsigned SPI1IS:2;
+  unsigned SPI1IP:3;
+}__IPC7bits_t;
+
+typedef struct
+{
+  unsigned U1IS:2;
+  unsigned U1IP:3;
+}__IPC8bits_t;
+
+typedef struct
+{
+  unsigned OCM:3;
+  unsigned OCTSEL:1;
+  unsigned OCFLT:1;
+  unsigned OC32:1;
+  unsigned :7;
+  unsigned SIDL:1;
+  unsigned :1;
+  unsigned ON:1;
+}__OC2CONbits_t;
+
+typedef struct
+{
+  unsigned SRXISEL:2;
+  unsigned STXISEL:2;
+  unsigned DISSDI:1;
+  unsigned MSTEN:1;
+  unsigned CKP:1;
+  unsigned SSEN:1;
+  unsigned CKE:1;
+  unsigned SMP:1;
+  unsigned MODE16:1;
+  unsigned MODE32:1;
+  unsigned DISSDO:1;
+  unsigned SIDL:1;
+  unsigned :1;
+  unsigned ON:1;
+  unsigned ENHBUF:1;
+  unsigned SPIFE:1;
+  unsigned :5;
+  unsigned MCLKSEL:1;
+  unsigned FRMCNT:3;
+  unsigned FRMSYPW:1;
+  unsigned MSSEN:1;
+  unsigned FRMPOL:1;
+  unsigned FRMSYNC:1;
+  unsigned FRMEN:1;
+}__SPI1CONbits_t;
+
+typedef struct
+{
+  unsigned SPIRBF:1;
+  unsigned SPITBF:1;
+  unsigned :1;
+  unsigned SPITBE:1;
+  unsigned :1;
+  unsigned SPIRBE:1;
+  unsigned SPIROV:1;
+  unsigned SRMT:1;
+  unsigned SPITUR:1;
+  unsigned :2;
+  unsigned SPIBUSY:1;
+}__SPI1STATbits_t;
+
+typedef struct
+{
+  unsigned :1;
+  unsigned TCS:1;
+  unsigned :1;
+  unsigned T32:1;
+  unsigned TCKPS:3;
+  unsigned TGATE:1;
+  unsigned :5;
+  unsigned SIDL:1;
+  unsigned :1;
+  unsigned ON:1;
+}__T2CONbits_t;
+
+typedef __T2CONbits_t __T3CONbits_t;
+typedef __T2CONbits_t __T4CONbits_t;
+
+typedef struct
+{
+  unsigned URXDA:1;
+  unsigned OERR:1;
+  unsigned FERR:1;
+  unsigned PERR:1;
+  unsigned RIDLE:1;
+  unsigned ADDEN:1;
+  unsigned URXISEL:2;
+  unsigned TRMT:1;
+  unsigned UTXBF:1;
+  unsigned UTXEN:1;
+  unsigned UTXBRK:1;
+  unsigned URXEN:1;
+  unsigned UTXINV:1;
+  unsigned UTXISEL:2;
+}__U1STAbits_t;
+
+typedef struct
+{
+  unsigned LATA0:1;
+  unsigned LATA1:1;
+  unsigned LATA2:1;
+  unsigned LATA3:1;
+  unsigned LATA4:1;
+}__LATAbits_t;
+
+typedef struct
+{
+  unsigned LATB0:1;
+  unsigned LATB1:1;
+  unsigned LATB2:1;
+  unsigned LATB3:1;
+  unsigned LATB4:1;
+  unsigned LATB5:1;
+  unsigned LATB6:1;
+  unsigned LATB7:1;
+  unsigned LATB8:1;
+  unsigned LATB9:1;
+  unsigned LATB10:1;
+  unsigned LATB11:1;
+  unsigned LATB12:1;
+  unsigned LATB13:1;
+  unsigned LATB14:1;
+  unsigned LATB15:1;
+}__LATBbits_t;
+
+typedef struct
+{
+  unsigned RA0:1;
+  unsigned RA1:1;
+  unsigned RA2:1;
+  unsigned RA3:1;
+  unsigned RA4:1;
+}__PORTAbits_t;
+
+typedef struct
+{
+  unsigned RB0:1;
+  unsigned RB1:1;
+  unsigned RB2:1;
+  unsigned RB3:1;
+  unsigned RB4:1;
+  unsigned RB5:1;
+  unsigned RB6:1;
+  unsigned RB7:1;
+  unsigned RB8:1;
+  unsigned RB9:1;
+  unsigned RB10:1;
+  unsigned RB11:1;
+  unsigned RB12:1;
+  unsigned RB13:1;
+  unsigned RB14:1;
+  unsigned RB15:1;
+}__PORTBbits_t;
+
+typedef struct
+{
+  unsigned TRISA0:1;
+  unsigned TRISA1:1;
+  unsigned TRISA2:1;
+  unsigned TRISA3:1;
+  unsigned TRISA4:1;
+}__TRISAbits_t;
+
+typedef struct
+{
+  unsigned TRISB0:1;
+  unsigned TRISB1:1;
+  unsigned TRISB2:1;
+  unsigned TRISB3:1;
+  unsigned TRISB4:1;
+  unsigned TRISB5:1;
+  unsigned TRISB6:1;
+  unsigned TRISB7:1;
+  unsigned TRISB8:1;
+  unsigned TRISB9:1;
+  unsigned TRISB10:1;
+  unsigned TRISB11:1;
+  unsigned TRISB12:1;
+  unsigned TRISB13:1;
+  unsigned TRISB14:1;
+  unsigned TRISB15:1;
+}__TRISBbits_t;
+
+
+/*---------------------------------- Masks --------------------------------*/
+#define _IFS0_CTIF_MASK   0x00000001
+#define _IFS0_CS0IF_MASK  0x00000002
+#define _IFS0_T2IF_MASK   0x00000200
+#define _IFS0_T3IF_MASK   0x00004000
+#define _IFS0_IC4IF_MASK  0x00200000
+#define _IFS0_T5IF_MASK   0x01000000
+#define _IFS0_AD1IF_MASK  0x10000000
+#define _IEC0_CTIE_MASK   0x00000001
+#define _IEC0_CS0IE_MASK  0x00000002
+#define _IEC0_T2IE_MASK   0x00000200
+#define _IEC0_T3IE_MASK   0x00004000
+#define _IEC0_IC4IE_MASK  0x00200000
+#define _IEC0_T5IE_MASK   0x01000000
+#define _IEC0_AD1IE_MASK  0x10000000
+
+#define _IFS1_SPI1EIF_MASK  0x00000010
+#define _IFS1_SPI1RXIF_MASK 0x00000020
+#define _IFS1_SPI1TXIF_MASK 0x00000040
+#define _IFS1_U1RXIF_MASK   0x00000100
+#define _IEC1_SPI1EIE_MASK  0x00000010
+#define _IEC1_SPI1RXIE_MASK 0x00000020
+#define _IEC1_SPI1TXIE_MASK 0x00000040
+#define _IEC1_U1RXIE_MASK   0x00000100
+
+#define _SPI1CON_DISSDI_MASK  0x00000010
+#define _SPI1CON_MSTEN_MASK   0x00000020
+#define _SPI1CON_CKP_MASK     0x00000040
+#define _SPI1CON_CKE_MASK     0x00000100
+#define _SPI1CON_SMP_MASK     0x00000200
+#define _SPI1CON_MODE16_MASK  0x00000400
+#define _SPI1CON_MODE32_MASK  0x00000800
+#define _SPI1CON_ON_MASK      0x00008000
+#define _SPI1CON_ENHBUF_MASK  0x00010000
+#define _SPI1CON_MCLKSEL_MASK 0x00800000
+#define _SPI1CON_MSSEN_MASK   0x10000000
+#define _SPI1CON_FRMPOL_MASK  0x20000000
+#define _SPI1CON_FRMEN_MASK   0x80000000
+
+#define _SPI1STAT_SPITBE_MASK 0x00000008
+#define _SPI1STAT_SPIRBE_MASK 0x00000020
+#define _SPI1STAT_SPIROV_MASK 0x00000040
+#define _SPI1STAT_SRMT_MASK   0x00000080
+
+/*------------------------------ ADC buffers ------------------------------*/
+// one array with the results 4 words (16 bytes) apart, as on the chip
+extern volatile uint32_t HostADC1BUF[16 * 4];
+
+#define ADC1BUF0 HostADC1BUF[0]
+#define ADC1BUF1 HostADC1BUF[4]
+#define ADC1BUF2 HostADC1BUF[8]
+#define ADC1BUF3 HostADC1BUF[12]
+#define ADC1BUF4 HostADC1BUF[16]
+#define ADC1BUF5 HostADC1BUF[20]
+#define ADC1BUF6 HostADC1BUF[24]
+#define ADC1BUF7 HostADC1BUF[28]
+#define ADC1BUF8 HostADC1BUF[32]
+#define ADC1BUF9 HostADC1BUF[36]
+#define ADC1BUFA HostADC1BUF[40]
+#define ADC1BUFB HostADC1BUF[44]
+#define ADC1BUFC HostADC1BUF[48]
+#define ADC1BUFD HostADC1BUF[52]
+#define ADC1BUFE HostADC1BUF[56]
+#define ADC1BUFF HostADC1BUF[60]
+
+/*------------------------------- Registers -------------------------------*/
+#define HOST_REGISTER_TABLE(REG) \
+  REG(AD1CHS) \
+  REG(AD1CON1) \
+  REG(AD1CON2) \
+  REG(AD1CON3) \
+  REG(AD1CSSL) \
+  REG(ANSELA) \
+  REG(ANSELB) \
+  REG(CNCONA) \
+  REG(CNCONB) \
+  REG(CNENA) \
+  REG(CNENB) \
+  REG(CNPDA) \
+  REG(CNPDB) \
+  REG(CNPUA) \
+  REG(CNPUB) \
+  REG(IC4BUF) \
+  REG(IC4CON) \
+  REG(IC4R) \
+  REG(IEC0) \
+  REG(IEC1) \
+  REG(IFS0) \
+  REG(IFS1) \
+  REG(INTCON) \
+  REG(IPC0) \
+  REG(IPC2) \
+  REG(IPC3) \
+  REG(IPC4) \
+  REG(IPC5) \
+  REG(IPC7) \
+  REG(IPC8) \
+  REG(LATA) \
+  REG(LATB) \
+  REG(OC2CON) \
+  REG(OC2R) \
+  REG(OC2RS) \
+  REG(ODCA) \
+  REG(ODCB) \
+  REG(PORTA) \
+  REG(PORTB) \
+  REG(PR2) \
+  REG(PR3) \
+  REG(PR4) \
+  REG(RPB11R) \
+  REG(RPB5R) \
+  REG(SPI1BRG) \
+  REG(SPI1BUF) \
+  REG(SPI1CON) \
+  REG(SPI1STAT) \
+  REG(T2CON) \
+  REG(T3CON) \
+  REG(T4CON) \
+  REG(TMR2) \
+  REG(TMR3) \
+  REG(TMR4) \
+  REG(TRISA) \
+  REG(TRISB) \
+  REG(U1STA)
+
+#define HOST_DECLARE_REG(r) extern HostReg_t HostReg_##r;
+HOST_REGISTER_TABLE(HOST_DECLARE_REG)
+
+#define AD1CHS       HOST_REG(AD1CHS)
+#define AD1CHSCLR    HOST_REG_CLR(AD1CHS)
+#define AD1CHSSET    HOST_REG_SET(AD1CHS)
+#define AD1CHSINV    HOST_REG_INV(AD1CHS)
+#define AD1CON1      HOST_REG(AD1CON1)
+#define AD1CON1CLR   HOST_REG_CLR(AD1CON1)
+#define AD1CON1SET   HOST_REG_SET(AD1CON1)
+#define AD1CON1INV   HOST_REG_INV(AD1CON1)
+#define AD1CON1bits  HOST_REG_BITS(AD1CON1)
+#define AD1CON2      HOST_REG(AD1CON2)
+#define AD1CON2CLR   HOST_REG_CLR(AD1CON2)
+#define AD1CON2SET   HOST_REG_SET(AD1CON2)
+#define AD1CON2INV   HOST_REG_INV(AD1CON2)
+#define AD1CON2bits  HOST_REG_BITS(AD1CON2)
+#define AD1CON3      HOST_REG(AD1CON3)
+#define AD1CON3CLR   HOST_REG_CLR(AD1CON3)
+#define AD1CON3SET   HOST_REG_SET(AD1CON3)
+#define AD1CON3INV   HOST_REG_INV(AD1CON3)
+#define AD1CON3bits  HOST_REG_BITS(AD1CON3)
+#define AD1CSSL      HOST_REG(AD1CSSL)
+#define AD1CSSLCLR   HOST_REG_CLR(AD1CSSL)
+#define AD1CSSLSET   HOST_REG_SET(AD1CSSL)
+#define AD1CSSLINV   HOST_REG_INV(AD1CSSL)
+#define ANSELA       HOST_REG(ANSELA)
+#define ANSELACLR    HOST_REG_CLR(ANSELA)
+#define ANSELASET    HOST_REG_SET(ANSELA)
+#define ANSELAINV    HOST_REG_INV(ANSELA)
+#define ANSELB       HOST_REG(ANSELB)
+#define ANSELBCLR    HOST_REG_CLR(ANSELB)
+#define ANSELBSET    HOST_REG_SET(ANSELB)
+#define ANSELBINV    HOST_REG_INV(ANSELB)
+#define CNCONA       HOST_REG(CNCONA)
+#define CNCONACLR    HOST_REG_CLR(CNCONA)
+#define CNCONASET    HOST_REG_SET(CNCONA)
+#define CNCONAINV    HOST_REG_INV(CNCONA)
+#define CNCONAbits   HOST_REG_BITS(CNCONA)
+#define CNCONB       HOST_REG(CNCONB)
+#define CNCONBCLR    HOST_REG_CLR(CNCONB)
+#define CNCONBSET    HOST_REG_SET(CNCONB)
+#define CNCONBINV    HOST_REG_INV(CNCONB)
+#define CNCONBbits   HOST_REG_BITS(CNCONB)
+#define CNENA        HOST_REG(CNENA)
+#define CNENACLR     HOST_REG_CLR(CNENA)
+#define CNENASET     HOST_REG_SET(CNENA)
+#define CNENAINV     HOST_REG_INV(CNENA)
+#define CNENB        HOST_REG(CNENB)
+#define CNENBCLR     HOST_REG_CLR(CNENB)
+#define CNENBSET     HOST_REG_SET(CNENB)
+#define CNENBINV     HOST_REG_INV(CNENB)
+#define CNPDA        HOST_REG(CNPDA)
+#define CNPDACLR     HOST_REG_CLR(CNPDA)
+#define CNPDASET     HOST_REG_SET(CNPDA)
+#define CNPDAINV     HOST_REG_INV(CNPDA)
+#define CNPDB        HOST_REG(CNPDB)
+#define CNPDBCLR     HOST_REG_CLR(CNPDB)
+#define CNPDBSET     HOST_REG_SET(CNPDB)
+#define CNPDBINV     HOST_REG_INV(CNPDB)
+#define CNPUA        HOST_REG(CNPUA)
+#define CNPUACLR     HOST_REG_CLR(CNPUA)
+#define CNPUASET     HOST_REG_SET(CNPUA)
+#define CNPUAINV     HOST_REG_INV(CNPUA)
+#define CNPUB        HOST_REG(CNPUB)
+#define CNPUBCLR     HOST_REG_CLR(CNPUB)
+#define CNPUBSET     HOST_REG_SET(CNPUB)
+#define CNPUBINV     HOST_REG_INV(CNPUB)
+#define IC4BUF       HOST_REG(IC4BUF)
+#define IC4BUFCLR    HOST_REG_CLR(IC4BUF)
+#define IC4BUFSET    HOST_REG_SET(IC4BUF)
+#define IC4BUFINV    HOST_REG_INV(IC4BUF)
+#define IC4CON       HOST_REG(IC4CON)
+#define IC4CONCLR    HOST_REG_CLR(IC4CON)
+#define IC4CONSET    HOST_REG_SET(IC4CON)
+#define IC4CONINV    HOST_REG_INV(IC4CON)
+#define IC4CONbits   HOST_REG_BITS(IC4CON)
+#define IC4R         HOST_REG(IC4R)
+#define IC4RCLR      HOST_REG_CLR(IC4R)
+#define IC4RSET      HOST_REG_SET(IC4R)
+#define IC4RINV      HOST_REG_INV(IC4R)
+#define IEC0         HOST_REG(IEC0)
+#define IEC0CLR      HOST_REG_CLR(IEC0)
+#define IEC0SET      HOST_REG_SET(IEC0)
+#define IEC0INV      HOST_REG_INV(IEC0)
+#define IEC0bits     HOST_REG_BITS(IEC0)
+#define IEC1         HOST_REG(IEC1)
+#define IEC1CLR      HOST_REG_CLR(IEC1)
+#define IEC1SET      HOST_REG_SET(IEC1)
+#define IEC1INV      HOST_REG_INV(IEC1)
+#define IEC1bits     HOST_REG_BITS(IEC1)
+#define IFS0         HOST_REG(IFS0)
+#define IFS0CLR      HOST_REG_CLR(IFS0)
+#define IFS0SET      HOST_REG_SET(IFS0)
+#define IFS0INV      HOST_REG_INV(IFS0)
+#define IFS0bits     HOST_REG_BITS(IFS0)
+#define IFS1         HOST_REG(IFS1)
+#define IFS1CLR      HOST_REG_CLR(IFS1)
+#define IFS1SET      HOST_REG_SET(IFS1)
+#define IFS1INV      HOST_REG_INV(IFS1)
+#define IFS1bits     HOST_REG_BITS(IFS1)
+#define INTCON       HOST_REG(INTCON)
+#define INTCONCLR    HOST_REG_CLR(INTCON)
+#define INTCONSET    HOST_REG_SET(INTCON)
+#define INTCONINV    HOST_REG_INV(INTCON)
+#define INTCONbits   HOST_REG_BITS(INTCON)
+#define IPC0         HOST_REG(IPC0)
+#define IPC0CLR      HOST_REG_CLR(IPC0)
+#define IPC0SET      HOST_REG_SET(IPC0)
+#define IPC0INV      HOST_REG_INV(IPC0)
+#define IPC0bits     HOST_REG_BITS(IPC0)
+#define IPC2         HOST_REG(IPC2)
+#define IPC2CLR      HOST_REG_CLR(IPC2)
+#define IPC2SET      HOST_REG_SET(IPC2)
+#define IPC2INV      HOST_REG_INV(IPC2)
+#define IPC2bits     HOST_REG_BITS(IPC2)
+#define IPC3         HOST_REG(IPC3)
+#define IPC3CLR      HOST_REG_CLR(IPC3)
+#define IPC3SET      HOST_REG_SET(IPC3)
+#define IPC3INV      HOST_REG_INV(IPC3)
+#define IPC3bits     HOST_REG_BITS(IPC3)
+#define IPC4         HOST_REG(IPC4)
+#define IPC4CLR      HOST_REG_CLR(IPC4)
+#define IPC4SET      HOST_REG_SET(IPC4)
+#define IPC4INV      HOST_REG_INV(IPC4)
+#define IPC4bits     HOST_REG_BITS(IPC4)
+#define IPC5         HOST_REG(IPC5)
+#define IPC5CLR      HOST_REG_CLR(IPC5)
+#define IPC5SET      HOST_REG_SET(IPC5)
+#define IPC5INV      HOST_REG_INV(IPC5)
+#define IPC5bits     HOST_REG_BITS(IPC5)
+#define IPC7         HOST_REG(IPC7)
+#define IPC7CLR      HOST_REG_CLR(IPC7)
+#define IPC7SET      HOST_REG_SET(IPC7)
+#define IPC7INV      HOST_REG_INV(IPC7)
+#define IPC7bits     HOST_REG_BITS(IPC7)
+#define IPC8         HOST_REG(IPC8)
+#define IPC8CLR      HOST_REG_CLR(IPC8)
+#define IPC8SET      HOST_REG_SET(IPC8)
+#define IPC8INV      HOST_REG_INV(IPC8)
+#define IPC8bits     HOST_REG_BITS(IPC8)
+#define LATA         HOST_REG(LATA)
+#define LATACLR      HOST_REG_CLR(LATA)
+#define LATASET      HOST_REG_SET(LATA)
+#define LATAINV      HOST_REG_INV(LATA)
+#define LATAbits     HOST_REG_BITS(LATA)
+#define LATB         HOST_REG(LATB)
+#define LATBCLR      HOST_REG_CLR(LATB)
+#define LATBSET      HOST_REG_SET(LATB)
+#define LATBINV      HOST_REG_INV(LATB)
+#define LATBbits     HOST_REG_BITS(LATB)
+#define OC2CON       HOST_REG(OC2CON)
+#define OC2CONCLR    HOST_REG_CLR(OC2CON)
+#define OC2CONSET    HOST_REG_SET(OC2CON)
+#define OC2CONINV    HOST_REG_INV(OC2CON)
+#define OC2CONbits   HOST_REG_BITS(OC2CON)
+#define OC2R         HOST_REG(OC2R)
+#define OC2RCLR      HOST_REG_CLR(OC2R)
+#define OC2RSET      HOST_REG_SET(OC2R)
+#define OC2RINV      HOST_REG_INV(OC2R)
+#define OC2RS        HOST_REG(OC2RS)
+#define OC2RSCLR     HOST_REG_CLR(OC2RS)
+#define OC2RSSET     HOST_REG_SET(OC2RS)
+#define OC2RSINV     HOST_REG_INV(OC2RS)
+#define ODCA         HOST_REG(ODCA)
+#define ODCACLR      HOST_REG_CLR(ODCA)
+#define ODCASET      HOST_REG_SET(ODCA)
+#define ODCAINV      HOST_REG_INV(ODCA)
+#define ODCB         HOST_REG(ODCB)
+#define ODCBCLR      HOST_REG_CLR(ODCB)
+#define ODCBSET      HOST_REG_SET(ODCB)
+#define ODCBINV      HOST_REG_INV(ODCB)
+#define PORTA        HOST_REG(PORTA)
+#define PORTACLR     HOST_REG_CLR(PORTA)
+#define PORTASET     HOST_REG_SET(PORTA)
+#define PORTAINV     HOST_REG_INV(PORTA)
+#define PORTAbits    HOST_REG_BITS(PORTA)
+#define PORTB        HOST_REG(PORTB)
+#define PORTBCLR     HOST_REG_CLR(PORTB)
+#define PORTBSET     HOST_REG_SET(PORTB)
+#define PORTBINV     HOST_REG_INV(PORTB)
+#define PORTBbits    HOST_REG_BITS(PORTB)
+#define PR2          HOST_REG(PR2)
+#define PR2CLR       HOST_REG_CLR(PR2)
+#define PR2SET       HOST_REG_SET(PR2)
+#define PR2INV       HOST_REG_INV(PR2)
+#define PR3          HOST_REG(PR3)
+#define PR3CLR       HOST_REG_CLR(PR3)
+#define PR3SET       HOST_REG_SET(PR3)
+#define PR3INV       HOST_REG_INV(PR3)
+#define PR4          HOST_REG(PR4)
+#define PR4CLR       HOST_REG_CLR(PR4)
+#define PR4SET       HOST_REG_SET(PR4)
+#define PR4INV       HOST_REG_INV(PR4)
+#define RPB11R       HOST_REG(RPB11R)
+#define RPB11RCLR    HOST_REG_CLR(RPB11R)
+#define RPB11RSET    HOST_REG_SET(RPB11R)
+#define RPB11RINV    HOST_REG_INV(RPB11R)
+#define RPB5R        HOST_REG(RPB5R)
+#define RPB5RCLR     HOST_REG_CLR(RPB5R)
+#define RPB5RSET     HOST_REG_SET(RPB5R)
+#define RPB5RINV     HOST_REG_INV(RPB5R)
+#define SPI1BRG      HOST_REG(SPI1BRG)
+#define SPI1BRGCLR   HOST_REG_CLR(SPI1BRG)
+#define SPI1BRGSET   HOST_REG_SET(SPI1BRG)
+#define SPI1BRGINV   HOST_REG_INV(SPI1BRG)
+#define SPI1BUF      HOST_REG(SPI1BUF)
+#define SPI1BUFCLR   HOST_REG_CLR(SPI1BUF)
+#define SPI1BUFSET   HOST_REG_SET(SPI1BUF)
+#define SPI1BUFINV   HOST_REG_INV(SPI1BUF)
+#define SPI1CON      HOST_REG(SPI1CON)
+#define SPI1CONCLR   HOST_REG_CLR(SPI1CON)
+#define SPI1CONSET   HOST_REG_SET(SPI1CON)
+#define SPI1CONINV   HOST_REG_INV(SPI1CON)
+#define SPI1CONbits  HOST_REG_BITS(SPI1CON)
+#define SPI1STAT     HOST_REG(SPI1STAT)
+#define SPI1STATCLR  HOST_REG_CLR(SPI1STAT)
+#define SPI1STATSET  HOST_REG_SET(SPI1STAT)
+#define SPI1STATINV  HOST_REG_INV(SPI1STAT)
+#define SPI1STATbits HOST_REG_BITS(SPI1STAT)
+#define T2CON        HOST_REG(T2CON)
+#define T2CONCLR     HOST_REG_CLR(T2CON)
+#define T2CONSET     HOST_REG_SET(T2CON)
+#define T2CONINV     HOST_REG_INV(T2CON)
+#define T2CONbits    HOST_REG_BITS(T2CON)
+#define T3CON        HOST_REG(T3CON)
+#define T3CONCLR     HOST_REG_CLR(T3CON)
+#define T3CONSET     HOST_REG_SET(T3CON)
+#define T3CONINV     HOST_REG_INV(T3CON)
+#define T3CONbits    HOST_REG_BITS(T3CON)
+#define T4CON        HOST_REG(T4CON)
+#define T4CONCLR     HOST_REG_CLR(T4CON)
+#define T4CONSET     HOST_REG_SET(T4CON)
+#define T4CONINV     HOST_REG_INV(T4CON)
+#define T4CONbits    HOST_REG_BITS(T4CON)
+#define TMR2         HOST_REG(TMR2)
+#define TMR2CLR      HOST_REG_CLR(TMR2)
+#define TMR2SET      HOST_REG_SET(TMR2)
+#define TMR2INV      HOST_REG_INV(TMR2)
+#define TMR3         HOST_REG(TMR3)
+#define TMR3CLR      HOST_REG_CLR(TMR3)
+#define TMR3SET      HOST_REG_SET(TMR3)
+#define TMR3INV      HOST_REG_INV(TMR3)
+#define TMR4         HOST_REG(TMR4)
+#define TMR4CLR      HOST_REG_CLR(TMR4)
+#define TMR4SET      HOST_REG_SET(TMR4)
+#define TMR4INV      HOST_REG_INV(TMR4)
+#define TRISA        HOST_REG(TRISA)
+#define TRISACLR     HOST_REG_CLR(TRISA)
+#define TRISASET     HOST_REG_SET(TRISA)
+#define TRISAINV     HOST_REG_INV(TRISA)
+#define TRISAbits    HOST_REG_BITS(TRISA)
+#define TRISB        HOST_REG(TRISB)
+#define TRISBCLR     HOST_REG_CLR(TRISB)
+#define TRISBSET     HOST_REG_SET(TRISB)
+#define TRISBINV     HOST_REG_INV(TRISB)
+#define TRISBbits    HOST_REG_BITS(TRISB)
+#define U1STA        HOST_REG(U1STA)
+#define U1STACLR     HOST_REG_CLR(U1STA)
+#define U1STASET     HOST_REG_SET(U1STA)
+#define U1STAINV     HOST_REG_INV(U1STA)
+#define U1STAbits    HOST_REG_BITS(U1STA)
+
+#endif /* HOST_XC_H */
@@ -0,0 +1,316 @@
+/*******************************************************************************
+ * File: terminal_host.c
+ *
+ * Created by: A. Brown
+ * Description: the terminal functions for the host port, in place of
+ *              terminal.c. Input comes from stdin, which is put into
+ *              non-canonical mode when it is a terminal so that keys
+ *              arrive one at a time without echo, and printf goes
+ *              straight to stdout. With the trace built in, the trace
+ *              frames go to the file named by ES_HOST_TRACE, ready for
+ *              Tools/es_trace_decode.py.
+ *              On the simulated clock stdin is a replay script instead,
+ *              see HostPort.h, and each key is held back until the
+ *              simulated time on its line.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+
+#include "ES_Port.h"
+#include "ES_Trace.h"
+#include "terminal.h"
+#include "HostPort.h"
+
+#define SCRIPT_LINE_SIZE 256
+
+static int  RxFd = STDIN_FILENO;  // -1 once stdin has closed
+static int  NextRxByte = -1;      // read ahead by Terminal_IsRxData
+static bool TermiosSaved = false;
+static struct termios SavedTermios;
+
+// the replay script: the keys from the current line still to be delivered
+// and the time they are due, HOST_TIME_NEVER once the script has ended
+static char ScriptLine[SCRIPT_LINE_SIZE];
+static char *pScriptKey = ScriptLine;
+static uint64_t ScriptKeyTime = HOST_TIME_NEVER;
+
+#ifdef ES_USE_TRACE
+static FILE *TraceFile;
+#endif
+
+static void RestoreTerminal(void);
+static void ReadScriptLine(void);
+
+/*******************************************************************************
+ * Function: Terminal_HWInit
+ * Arguments: None
+ * Returns nothing
+ *
+ * Created by: A. Brown
+ * Description: sets up stdin and stdout to serve as the terminal
+ ******************************************************************************/
+void Terminal_HWInit(void)
+{
+  struct termios Settings;
+
+  if (HostPort_IsSimClock())
+  {
+    ReadScriptLine();
+  }
+  else if (!TermiosSaved && (tcgetattr(RxFd, &SavedTermios) == 0))
+  {
+    TermiosSaved = true;
+    Settings = SavedTermios;
+    Settings.c_lflag &= ~(ICANON | ECHO);
+    Settings.c_cc[VMIN] = 1;
+    Settings.c_cc[VTIME] = 0;
+    tcsetattr(RxFd, TCSANOW, &Settings);
+    atexit(RestoreTerminal);
+  }
+  // the buffer is flushed before each idle wait
+  setvbuf(stdout, NULL, _IOFBF, XMIT_BUFFER_SIZE);
+#ifdef ES_USE_TRACE
+  if ((TraceFile == NULL) && (getenv("ES_HOST_TRACE") != NULL))
+  {
+    TraceFile = fopen(getenv("ES_HOST_TRACE"), "wb");
+  }
+#endif
+}
+
+/*******************************************************************************
+ * Function: Terminal_ReadByte
+ * Arguments: None
+ * Returns byte
+ *
+ * Created by: A. Brown
+ * Description: returns the next byte from stdin, waiting for it if need be.
+ *              Returns 0 if stdin has closed.
+ ******************************************************************************/
+uint8_t Terminal_ReadByte(void)
+{
+  struct pollfd Input;
+  uint8_t ThisByte;
+
+  while (!Terminal_IsRxData())
+  {
+    if ((RxFd < 0) || HostPort_IsSimClock())
+    {
+      return 0;
+    }
+    Input.fd = RxFd;
+    Input.events = POLLIN;
+    poll(&Input, 1, -1);
+  }
+  ThisByte = (uint8_t)NextRxByte;
+  NextRxByte = -1;
+  return ThisByte;
+}
+
+/*******************************************************************************
+ * Function: Terminal_WriteByte
+ * Arguments: byte to write
+ * Returns nothing
+ *
+ * Created by: A. Brown
+ * Description: writes the byte to stdout
+ ******************************************************************************/
+void Terminal_WriteByte(uint8_t txByte)
+{
+  putchar(txByte);
+}
+
+/*******************************************************************************
+ * Function: Terminal_IsRxData
+ * Arguments: none
+ * Returns status
+ *
+ * Created by: A. Brown
+ * Description: Returns true if there is a byte waiting on stdin, without
+ *              waiting for one. The byte is read ahead and held for
+ *              Terminal_ReadByte.
+ ******************************************************************************/
+bool Terminal_IsRxData(void)
+{
+  struct pollfd Input;
+  uint8_t ThisByte;
+
+  if (HostPort_IsSimClock())
+  {
+    if ((NextRxByte < 0) && (HostPort_GetTime() >= ScriptKeyTime))
+    {
+      NextRxByte = (uint8_t)*pScriptKey++;
+      if (*pScriptKey == '\0')
+      {
+        ReadScriptLine();
+      }
+    }
+  }
+  else if ((NextRxByte < 0) && (RxFd >= 0))
+  {
+    Input.fd = RxFd;
+    Input.events = POLLIN;
+    if (poll(&Input, 1, 0) > 0)
+    {
+      if (read(RxFd, &ThisByte, 1) == 1)
+      {
+        NextRxByte = ThisByte;
+      }
+      else
+      {
+        RxFd = -1;  // end of file, stop looking
+      }
+    }
+  }
+  return NextRxByte >= 0;
+}
+
+/*******************************************************************************
+ * Function: Terminal_MoveBuffer2UART
+ * Arguments: none
+ * Returns none
+ *
+ * Created by: A. Brown
+ * Description: printf has already gone to stdout, so all that is left to
+ *              move is the event trace, which goes to the trace file (or
+ *              nowhere) in one go
+ ******************************************************************************/
+void Terminal_MoveBuffer2UART( void )
+{
+#ifdef ES_USE_TRACE
+  uint8_t byte2Xmit;
+
+  while (ES_Trace_GetByte(&byte2Xmit))
+  {
+    if (TraceFile != NULL)
+    {
+      fputc(byte2Xmit, TraceFile);
+    }
+  }
+#endif
+}
+
+/*******************************************************************************
+ * Function: Terminal_IsXmitIdle
+ * Arguments: none
+ * Returns true if there is nothing left to send
+ *
+ * Created by: A. Brown
+ * Description: only the trace is ever left waiting on the host
+ ******************************************************************************/
+bool Terminal_IsXmitIdle(void)
+{
+#ifdef ES_USE_TRACE
+  return !ES_Trace_IsPending();
+#else
+  return true;
+#endif
+}
+
+/*******************************************************************************
+ * Function: Terminal_EnableRxWake
+ * Arguments: none
+ * Returns nothing
+ *
+ * Created by: A. Brown
+ * Description: nothing to do, the idle wait watches stdin itself
+ ******************************************************************************/
+void Terminal_EnableRxWake(void)
+{
+}
+
+/*******************************************************************************
+ * Function: Terminal_GetRxFd
+ * Arguments: none
+ * Returns the file descriptor keys arrive on, -1 once it has closed
+ *
+ * Created by: A. Brown
+ * Description: for the idle wait, which sleeps until it is readable
+ ******************************************************************************/
+int Terminal_GetRxFd(void)
+{
+  return HostPort_IsSimClock() ? -1 : RxFd;
+}
+
+/*******************************************************************************
+ * Function: Terminal_GetNextRxTime
+ * Arguments: none
+ * Returns the simulated time the next key in the replay script is due, or
+ *         HOST_TIME_NEVER if there are no more
+ *
+ * Created by: A. Brown
+ * Description: for the idle wait on the simulated clock
+ ******************************************************************************/
+uint64_t Terminal_GetNextRxTime(void)
+{
+  return (NextRxByte >= 0) ? HostPort_GetTime() : ScriptKeyTime;
+}
+
+/*******************************************************************************
+ * Function: _fassert
+ * Arguments: the line, file, expression and function of the failed test
+ * Returns never
+ *
+ * Created by: A. Brown
+ * Description: the host's stand in for the halt in terminal.c, for code
+ *              that calls it directly rather than through assert
+ ******************************************************************************/
+void __attribute__((noreturn)) _fassert(int nLineNumber,
+                                        const char * sFileName,
+                                        const char * sFailedExpression,
+                                        const char * sFunction )
+{
+  fflush(stdout);
+  fprintf(stderr, "Assert \"%s\" Failed at Line: %d, in File: %s (%s)\n",
+      sFailedExpression, nLineNumber, sFileName, sFunction);
+  abort();
+}
+
+/*******************************************************************************
+ * Function: RestoreTerminal
+ * Arguments: none
+ * Returns nothing
+ *
+ * Created by: A. Brown
+ * Description: puts stdin back the way we found it, at exit
+ ******************************************************************************/
+static void RestoreTerminal(void)
+{
+  fflush(stdout);
+  tcsetattr(STDIN_FILENO, TCSANOW, &SavedTermios);
+}
+
+/*******************************************************************************
+ * Function: ReadScriptLine
+ * Arguments: none
+ * Returns nothing
+ *
+ * Created by: A. Brown
+ * Description: reads the next "<ms> <keys>" line of the replay script,
+ *              skipping blank lines, comments and lines with no keys.
+ *              Waits for the line, so the host's timing never matters.
+ ******************************************************************************/
+static void ReadScriptLine(void)
+{
+  unsigned long long DueMS;
+  int KeysAt;
+
+  ScriptKeyTime = HOST_TIME_NEVER;
+  while (fgets(ScriptLine, sizeof(ScriptLine), stdin) != NULL)
+  {
+    ScriptLine[strcspn(ScriptLine, "\r\n")] = '\0';
+    if ((ScriptLine[0] != '#') &&
+        (sscanf(ScriptLine, "%llu %n", &DueMS, &KeysAt) == 1) &&
+        (ScriptLine[KeysAt] != '\0'))
+    {
+      pScriptKey = &ScriptLine[KeysAt];
+      ScriptKeyTime = DueMS * (HOST_COUNTS_PER_SEC / 1000);
+      return;
+    }
+  }
+}
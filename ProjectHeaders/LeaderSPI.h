@@ -25,6 +25,7 @@ bool InitLeaderSPI(uint8_t Priority);
 bool PostLeaderSPI(ES_Event_t ThisEvent);
 ES_Event_t RunLeaderSPI(ES_Event_t ThisEvent);
 LeaderSPIState_t QueryLeaderSPI(void);
+void FinishLeaderSPIXfer(uint32_t Unused);
 
 #endif /* LeaderSPI_H */
 
@@ -23,6 +23,7 @@ typedef union {
 bool InitSensorService(uint8_t Priority);
 bool PostSensorService(ES_Event_t ThisEvent);
 ES_Event_t RunSensorService(ES_Event_t ThisEvent);
+void ProcessBeaconEdge(uint32_t EdgeTime);
 
 #endif /* SensorService_H */
 
@@ -15,6 +15,7 @@
  -------------- ---     --------
  01/16/12 09:58 jec      began conversion from TemplateFSM.c
  02/17/22 19:04 ahb     beacon test harness code
+ 10/16/26 23:40 ahb     profile Timer3ISR and the interrupts off region in it
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
 // This module
@@ -223,14 +224,18 @@ static void SetupPWM()
 /*------------------------------- ISRs -------------------------------*/
 void __ISR(_TIMER_3_VECTOR, IPL5SOFT) Timer3ISR(void)
 {
+    ES_PROFILE_ISR_ENTER();
     // Disable interrupts globally
     __builtin_disable_interrupts();
+    ES_PROFILE_BEGIN(IntsOff);
     if (IFS0bits.T3IF == 1)
     {
         IFS0CLR = _IFS0_T3IF_MASK; // clear the interrupt
     }
+    ES_PROFILE_END(IntsOff);
     // Enable interrupts globally
     __builtin_enable_interrupts();
+    ES_PROFILE_ISR_EXIT();
 }
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
@@ -16,6 +16,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/16/26 12:10 ahb     Check4Keystroke publishes EV_NEW_KEY rather than
+                        posting it to every service
  08/06/13 13:36 jec     initial version
 ****************************************************************************/
 
@@ -27,8 +29,8 @@
 // this will get us the structure definition for events, which we will need
 // in order to post events in response to detecting events
 #include "ES_Events.h"
-// if you want to use distribution lists then you need those function
-// definitions too.
+// if you want to publish events to their subscribers then you need the
+// ES_Publish prototype too.
 #include "ES_PostList.h"
 // This include will pull in all of the headers from the service modules
 // providing the prototypes for all of the post functions
@@ -74,7 +76,7 @@ bool Check4Lock(void)
     ES_Event ThisEvent;
     ThisEvent.EventType   = ES_LOCK;
     ThisEvent.EventParam  = 1;
-    // this could be any of the service post functions, ES_PostListx or
+    // this could be any of the service post functions, ES_Publish or
     // ES_PostAll functions
     ES_PostAll(ThisEvent);
     ReturnVal = true;
@@ -95,7 +97,8 @@ bool Check4Lock(void)
    bool: true if a new key was detected & posted
  Description
    checks to see if a new key from the keyboard is detected and, if so,
-   retrieves the key and posts an ES_NewKey event to TestHarnessService0
+   retrieves the key and publishes an EV_NEW_KEY event to the services
+   subscribed to it (see SUBSCRIPTION_TABLE in ES_Configure.h)
  Notes
    The functions that actually check the serial hardware for characters
    and retrieve them are assumed to be in ES_Port.c
@@ -113,7 +116,7 @@ bool Check4Keystroke(void)
     ES_Event_t ThisEvent;
     ThisEvent.EventType   = EV_NEW_KEY;
     ThisEvent.EventParam  = GetNewKey();
-    ES_PostAll(ThisEvent);
+    ES_Publish(ThisEvent);
     return true;
   }
   return false;
@@ -14,6 +14,14 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 12:40 ahb      rData in ConfigureLeaderSPI is marked as used
+ 10/17/26 12:20 ahb      InitLeaderSPI ends the interrupts off region and
+                         turns interrupts back on when it fails
+ 10/16/26 23:40 ahb      profile the SPI ISR and the interrupts off region
+                         in InitLeaderSPI
+ 10/16/26 22:40 ahb      the recall at the end of a transfer is deferred
+                         from the SPI ISR to FinishLeaderSPIXfer
+ 10/16/26 17:40 ahb      size the deferral queue with ES_QUEUE_BLOCK_SIZE
  01/16/12 09:58 jec      began conversion from TemplateFSM.c
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
@@ -48,7 +56,7 @@ static LeaderSPIState_t CurrentState;
 // with the introduction of Gen2, we need a module level Priority variable
 static uint8_t MyPriority;
 
-static ES_Event_t DeferralQueue[3+1];
+static ES_Event_t DeferralQueue[ES_QUEUE_BLOCK_SIZE(3)];
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -81,14 +89,22 @@ bool InitLeaderSPI(uint8_t Priority)
   INTCONbits.MVEC = 1;
   
   __builtin_disable_interrupts();
+  ES_PROFILE_BEGIN(IntsOff);
   
-  if (!PortSetup_ConfigureDigitalOutputs(_Port_B, _Pin_12)) return false; // CS1
-  if (!PortSetup_ConfigureDigitalOutputs(_Port_B, _Pin_15)) return false; // CS2
+  if (!PortSetup_ConfigureDigitalOutputs(_Port_B, _Pin_12) || // CS1
+      !PortSetup_ConfigureDigitalOutputs(_Port_B, _Pin_15))   // CS2
+  {
+    // close the profiled region on the way out too
+    ES_PROFILE_END(IntsOff);
+    __builtin_enable_interrupts();
+    return false;
+  }
   
   LATBSET = BIT12HI | BIT15HI;    // Set both CS high
   
   ConfigureLeaderSPI();
   
+  ES_PROFILE_END(IntsOff);
   __builtin_enable_interrupts();
   ////////////////////////
   
@@ -304,6 +320,33 @@ ES_Event_t RunLeaderSPI(ES_Event_t ThisEvent)
   return ReturnEvent;
 }
 
+/****************************************************************************
+ Function
+    FinishLeaderSPIXfer
+
+ Parameters
+   uint32_t : not used
+
+ Returns
+   nothing
+
+ Description
+   the deferred half of the SPI ISR, run from ES_Run once a byte has gone
+   out. Goes back to Waiting and recalls the commands that came in while we
+   were sending.
+ Notes
+   the recall walks the deferral queue, which is why it is not done in the
+   ISR
+ Author
+   A. Brown, 10/16/26
+****************************************************************************/
+void FinishLeaderSPIXfer(uint32_t Unused)
+{
+  (void)Unused;
+  CurrentState = Waiting;
+  ES_RecallEvents(MyPriority, DeferralQueue);
+}
+
 /***************************************************************************
  private functions
  ***************************************************************************/
@@ -327,6 +370,7 @@ static void ConfigureLeaderSPI(void)
 //    SDI1R = 0b0011; // Set SDI1 to RB11 (MOSI))
     
     rData = SPI1BUF;                            //Clear buffer
+    (void)rData;                                // only read to clear it
     
     // Clear any existing flags
     IFS1CLR = _IFS1_SPI1EIF_MASK;
@@ -368,6 +412,7 @@ static void ConfigureLeaderSPI(void)
 
 void __ISR(_SPI_1_VECTOR,IPL7SOFT)__SPI1_ISR(void)
 {
+    ES_PROFILE_ISR_ENTER();
     //printf("\n\rEntering SPI ISR...\r\n");
     
     /*if (IFS1bits.SPI1RXIF)      // If receive buffer full intrpt flag
@@ -426,8 +471,8 @@ void __ISR(_SPI_1_VECTOR,IPL7SOFT)__SPI1_ISR(void)
 //            }
             LATBSET = BIT12HI | BIT15HI;
             
-            CurrentState = Waiting;
-            ES_RecallEvents(MyPriority, DeferralQueue);
+            // back to Waiting and the recall are done in FinishLeaderSPIXfer
+            ES_DeferWork(DEFER_SPI_XFER_DONE);
             
             IEC1bits.SPI1TXIE = 0;                  // Disable transmit intrpt
         }
@@ -442,6 +487,7 @@ void __ISR(_SPI_1_VECTOR,IPL7SOFT)__SPI1_ISR(void)
     IFS1bits.SPI1EIF = 0;
     IFS1bits.SPI1RXIF = 0;
     IFS1bits.SPI1TXIF = 0;
+    ES_PROFILE_ISR_EXIT();
 }
 
 /*------------------------------- Footnotes -------------------------------*/
@@ -11,7 +11,7 @@
  History
  When           Who     What/Why
  -------------- ---     --------
-
+ 10/17/26 12:40 ahb     LocalResult in ADC_MultiRead is marked as used
  10/27/20 16:10 jec     cleaned up the documentation to meet SPDL Standards
  10/20/20 16:38 jec     Began Coding
 ****************************************************************************/
@@ -140,6 +140,7 @@ for (i=0; i < numChanInSet; i++)
     LocalResult= adcResults[i] = *(resultSet+(4*i)); // read the results from the ADC1BUFx registers
     
 }
+(void)LocalResult; // only there to watch in the debugger
 AD1CON1bits.ASAM = 1;  // restart automatic sampling
 IFS0CLR = BIT28HI;     // clear ADC interrupt flag, see table 7-1, pg 68
 }
\ No newline at end of file
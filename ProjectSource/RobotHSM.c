@@ -24,6 +24,7 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/16/26 21:10 ahb     game timer is periodic rather than re-armed by hand
  02/16/22 11:39 ahb     Began Coding
 ****************************************************************************/
 /*----------------------------- Include Files -----------------------------*/
@@ -424,7 +425,7 @@ static ES_Event_t DuringWaitingState( ES_Event_t Event)
         // repeat for any concurrently running state machines
         // now do any local exit functionality
         printf("\r***GAME TIMER STARTED***\r\n");
-        ES_Timer_InitTimer(GAME_TIMER, ONE_MIN);
+        ES_Timer_InitPeriodic(GAME_TIMER, ONE_MIN);
         
         IsPlaying = true;
         
@@ -581,16 +582,17 @@ static void HandleGameTimer()
     { 
         Game_Minute++;
         printf("\r MINUTE: %d \r\n", Game_Minute);
-        ES_Timer_InitTimer(GAME_TIMER, ONE_MIN);
+        // the second minute is already being timed, count seconds after it
+        ES_Timer_SetPeriod(GAME_TIMER, ONE_SEC);
     }
     else if (Game_Second < 18)
     {
         printf("\r TWO MINUTES AND %d SECONDS \r\n", Game_Second);
         Game_Second++;
-        ES_Timer_InitTimer(GAME_TIMER, ONE_SEC);
     }
     else
     {
+        ES_Timer_StopTimer(GAME_TIMER);
         IsPlaying = false;
         
         ES_Event_t NewEvent;
@@ -14,6 +14,21 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/17/26 12:40 ahb     the LED helpers are left out of the host build
+ 10/17/26 00:10 ahb     reports ES_TICK_OVERRUN, added 'k' and 'K' keys to
+                        print & clear the tick stats
+ 10/16/26 23:40 ahb     'c' prints the profiler's critical region, ISR and
+                        interrupts off times, Timer2ISR is profiled
+ 10/16/26 23:10 ahb     added 'c' and 'C' keys to print & clear the longest
+                        critical region
+ 10/16/26 22:40 ahb     added 'd' and 'D' keys to print & clear the deferred
+                        work stats
+ 10/16/26 19:10 ahb     'q' prints the event pool's occupancy when it is in use
+ 10/16/26 18:10 ahb     'q' also prints the RAM taken by the queues
+ 10/16/26 14:20 ahb     added 'q' and 'Q' keys to print & clear the queue stats
+ 10/16/26 13:40 ahb     added 'h' and 'H' keys to print & clear the latency
+                        histograms
+ 10/16/26 11:30 ahb     added 'l' key to print the worst case dispatch latency
  10/26/17 18:26 jec     moves definition of ALL_BITS to ES_Port.h
  10/19/17 21:28 jec     meaningless change to test updating
  10/19/17 18:42 jec     removed referennces to driverlib and programmed the
@@ -37,6 +52,7 @@
 #include "ES_Configure.h"
 #include "ES_Framework.h"
 #include "ES_DeferRecall.h"
+#include "ES_EventPool.h"
 #include "ES_Port.h"
 #include "terminal.h"
 
@@ -45,6 +61,8 @@
 #include "LeaderSPI.h"
 #include "commdefs.h"
 
+#include <string.h>
+
 /*----------------------------- Module Defines ----------------------------*/
 // these times assume a 10.000mS/tick timing
 #define ONE_SEC 1000
@@ -60,6 +78,15 @@
 /* prototypes for private functions for this service.They should be functions
    relevant to the behavior of this service
 */
+#ifdef _INCLUDE_LATENCY_STATS_
+static void PrintLatencyStats(void);
+#endif
+#ifdef ES_USE_PROFILER
+static void PrintProfileStats(void);
+#endif
+#ifdef ES_USE_TICK_STATS
+static void PrintTickStats(void);
+#endif
 
 /*---------------------------- Module Variables ---------------------------*/
 // with the introduction of Gen2, we need a module level Priority variable
@@ -232,10 +259,127 @@ ES_Event_t RunRobotTestHarness(ES_Event_t ThisEvent)
             NewEvent.EventParam = STOP;
             PostLeaderSPI(NewEvent);
         }
+        else if ('q' == ThisEvent.EventParam)
+        {
+            // use these to right-size the queues in SERVICE_TABLE
+            ES_QueueStats_t Stats;
+            ES_QueueMemory_t Memory;
+            uint8_t i;
+            for (i = 0; i < NUM_SERVICES; i++)
+            {
+                ES_GetQueueStats(i, &Stats);
+                printf("Service %u queue: size %u, high water %u, "
+                    "overflows %u\r\n", i, Stats.Size, Stats.HighWater,
+                    Stats.NumOverflows);
+            }
+            // and the RAM all of the queues (deferral queues too) take up
+            ES_GetQueueMemory(&Memory);
+            printf("%u queues: %lu events, %lu bytes", Memory.NumQueues,
+                (unsigned long)Memory.NumEntries,
+                (unsigned long)Memory.Bytes);
+#ifdef ES_COMPACT_EVENTS
+            // the same queues, with a header slot each, in wide events
+            printf(", %lu saved by ES_COMPACT_EVENTS",
+                (unsigned long)((Memory.NumEntries + Memory.NumQueues) *
+                ES_WIDE_EVENT_BYTES - Memory.Bytes));
+#endif
+            printf("\r\n");
+#ifdef ES_USE_EVENT_POOL
+            {
+                // the services' queues are in the pool, not counted above
+                ES_PoolStats_t Pool;
+                ES_Pool_GetStats(&Pool);
+                printf("Event pool: %u of %u in use, high water %u, "
+                    "%u reserved, %u refused, %u bytes\r\n", Pool.InUse,
+                    Pool.Size, Pool.HighWater, Pool.NumReserved,
+                    Pool.NumRefused, Pool.Bytes);
+            }
+#endif
+        }
+        else if ('Q' == ThisEvent.EventParam)
+        {
+            ES_ClearQueueStats();
+            printf("Queue statistics cleared\r\n");
+        }
+        else if ('d' == ThisEvent.EventParam)
+        {
+            // the time taken by the handlers of the deferred interrupt
+            // work, the counts are 50ns each so /20 gives uS
+            ES_DeferredWorkStats_t Stats;
+            uint8_t i;
+            for (i = 0; i < NUM_DEFERRED_WORK; i++)
+            {
+                ES_GetDeferredWorkStats(i, &Stats);
+                printf("Deferred work %u: %lu runs, mean %lu uS, "
+                    "max %lu uS, %u lost\r\n", i,
+                    (unsigned long)Stats.NumRuns,
+                    (unsigned long)((Stats.NumRuns == 0) ? 0 :
+                        (Stats.TotalCycles / Stats.NumRuns) / 20),
+                    (unsigned long)(Stats.MaxCycles / 20),
+                    Stats.NumOverflows);
+            }
+        }
+        else if ('D' == ThisEvent.EventParam)
+        {
+            ES_ClearDeferredWorkStats();
+            printf("Deferred work statistics cleared\r\n");
+        }
+#ifdef ES_USE_TICK_STATS
+        else if ('k' == ThisEvent.EventParam)
+        {
+            PrintTickStats();
+        }
+        else if ('K' == ThisEvent.EventParam)
+        {
+            _HW_ClearTickStats();
+            printf("Tick statistics cleared\r\n");
+        }
+#endif
+#ifdef ES_USE_PROFILER
+        else if ('c' == ThisEvent.EventParam)
+        {
+            PrintProfileStats();
+        }
+        else if ('C' == ThisEvent.EventParam)
+        {
+            ES_Profile_ClearStats();
+            printf("Profile statistics cleared\r\n");
+        }
+#endif
+#ifdef _INCLUDE_DISPATCH_STATS_
+        else if ('l' == ThisEvent.EventParam)
+        {
+            // worst case time from ready to run for each service, the
+            // counts are 50ns each so /20 gives uS
+            uint8_t i;
+            for (i = 0; i < NUM_SERVICES; i++)
+            {
+                printf("Service %u max dispatch latency %lu uS\r\n", i,
+                    (unsigned long)(ES_GetMaxDispatchLatency(i) / 20));
+            }
+        }
+#endif
+#ifdef _INCLUDE_LATENCY_STATS_
+        else if ('h' == ThisEvent.EventParam)
+        {
+            PrintLatencyStats();
+        }
+        else if ('H' == ThisEvent.EventParam)
+        {
+            ES_ClearLatencyStats();
+            printf("Latency statistics cleared\r\n");
+        }
+#endif
         
         
     }
     break;
+
+    case ES_TICK_OVERRUN:   // interrupts were held off past a tick
+    {
+        printf("Tick overrun: %u ticks missed\r\n", ThisEvent.EventParam);
+    }
+    break;
     
     default:
     {}
@@ -248,6 +392,143 @@ ES_Event_t RunRobotTestHarness(ES_Event_t ThisEvent)
 /***************************************************************************
  private functions
  ***************************************************************************/
+#ifdef ES_USE_TICK_STATS
+/****************************************************************************
+ Function
+   PrintTickStats
+
+ Description
+   prints the ticks the tick interrupt has had to catch up on and how late
+   it has run after the compare match, then the non-empty buckets of the
+   lateness histogram on one line. The core timer counts are 50nS each.
+ Author
+   Aaron Brown, 10/17/26
+****************************************************************************/
+static void PrintTickStats(void)
+{
+  ES_TickStats_t Stats;
+  uint8_t Bucket;
+
+  _HW_GetTickStats(&Stats);
+  printf("Ticks: %lu missed, %u overruns, most caught up at once %u, "
+      "max late %lu uS\r\n", (unsigned long)Stats.NumMissedTicks,
+      Stats.NumOverruns, Stats.MaxCatchUp,
+      (unsigned long)(Stats.MaxLateness / 20));
+  for (Bucket = 0; Bucket < ES_TICK_LATE_BUCKETS; Bucket++)
+  {
+    if (Stats.LateBuckets[Bucket] != 0)
+    {
+      printf(" >=%lunS:%u",
+          (Bucket == 0) ? 0UL : (unsigned long)(1UL << Bucket) * 50,
+          Stats.LateBuckets[Bucket]);
+    }
+  }
+  printf("\r\n");
+}
+
+#endif
+#ifdef ES_USE_PROFILER
+/****************************************************************************
+ Function
+   PrintProfileStats
+
+ Description
+   prints, for each place in the code the profiler has seen run since the
+   stats were cleared, the mean & max time that it held interrupts off or
+   ran for, then the non-empty histogram buckets on one line. The core
+   timer counts are 50nS each, so /20 gives uS and %20 * 5 hundredths.
+ Author
+   Aaron Brown, 10/16/26
+****************************************************************************/
+static void PrintProfileStats(void)
+{
+  static const char *const KindNames[] = { "?", "critical", "ISR", "ints off" };
+  ES_ProfileStats_t Stats;
+  const char *pName;
+  uint32_t Mean;
+  uint8_t i;
+  uint8_t Bucket;
+
+  for (i = 0; ES_Profile_GetStats(i, &Stats); i++)
+  {
+    if (Stats.NumRuns == 0)
+    {
+      continue;
+    }
+    Mean = (uint32_t)(Stats.TotalCycles / Stats.NumRuns);
+    // just the file name, not the path it was compiled with
+    pName = strrchr(Stats.pFile, '/');
+    pName = (pName == NULL) ? Stats.pFile : pName + 1;
+    printf("%s:%u %s: %lu runs, mean %lu.%02lu uS, max %lu.%02lu uS\r\n",
+        pName, Stats.Line, KindNames[(Stats.Kind <= ES_PROFILE_INTS_OFF) ?
+            Stats.Kind : 0],
+        (unsigned long)Stats.NumRuns,
+        (unsigned long)(Mean / 20), (unsigned long)((Mean % 20) * 5),
+        (unsigned long)(Stats.MaxCycles / 20),
+        (unsigned long)((Stats.MaxCycles % 20) * 5));
+    for (Bucket = 0; Bucket < ES_PROFILE_BUCKETS; Bucket++)
+    {
+      if (Stats.Buckets[Bucket] != 0)
+      {
+        printf(" >=%lunS:%u",
+            (Bucket == 0) ? 0UL : (unsigned long)(1UL << Bucket) * 50,
+            Stats.Buckets[Bucket]);
+      }
+    }
+    printf("\r\n");
+  }
+}
+
+#endif
+#ifdef _INCLUDE_LATENCY_STATS_
+/****************************************************************************
+ Function
+   PrintLatencyStats
+
+ Description
+   prints, for each service, the mean & max time from an event being queued
+   to the run function seeing it, then the non-empty histogram buckets.
+   The core timer counts are 50nS each.
+ Author
+   Aaron Brown, 10/16/26
+****************************************************************************/
+static void PrintLatencyStats(void)
+{
+  ES_LatencyStats_t Stats;
+  uint8_t i;
+  uint8_t Bucket;
+
+  for (i = 0; i < NUM_SERVICES; i++)
+  {
+    ES_GetLatencyStats(i, &Stats);
+    printf("Service %u: %lu events, mean %lu uS, max %lu uS\r\n", i,
+        (unsigned long)Stats.NumEvents,
+        (unsigned long)((Stats.NumEvents == 0) ? 0 :
+            (Stats.TotalLatency / Stats.NumEvents) / 20),
+        (unsigned long)(Stats.MaxLatency / 20));
+    for (Bucket = 0; Bucket < ES_LATENCY_BUCKETS; Bucket++)
+    {
+      if (Stats.Buckets[Bucket] == 0)
+      {
+        continue;
+      }
+      if (Bucket < 16)
+      {
+        printf("  >= %lu nS: %u\r\n", (unsigned long)(1UL << Bucket) * 50,
+            Stats.Buckets[Bucket]);
+      }
+      else
+      {
+        printf("  >= %lu uS: %u\r\n", (unsigned long)(1UL << Bucket) / 20,
+            Stats.Buckets[Bucket]);
+      }
+    }
+  }
+}
+
+#endif
+// LED helpers for debugging on the board, nothing calls them on the host
+#ifndef ES_HOST_PORT
 #define LED LATBbits.LATB6
 static void InitLED(void)
 {
@@ -260,6 +541,7 @@ static void BlinkLED(void)
   // toggle state of LED
   LED = ~LED;
 }
+#endif
 
 #ifdef TEST_INT_POST
 #include <sys/attribs.h> // for ISR macors
@@ -298,6 +580,7 @@ static void StartTMR2(void)
 
 void __ISR(_TIMER_2_VECTOR, IPL2AUTO) Timer2ISR(void)
 {
+  ES_PROFILE_ISR_ENTER();
   // clear flag
   IFS0bits.T2IF = 0;
   // post event
@@ -306,6 +589,7 @@ void __ISR(_TIMER_2_VECTOR, IPL2AUTO) Timer2ISR(void)
   
   // stop timer
   T2CONbits.ON = 0;
+  ES_PROFILE_ISR_EXIT();
   return;
 }
 #endif
@@ -23,6 +23,7 @@ Aaron Brown
 #include "ES_Framework.h"
 //#include "ES_DeferRecall.h"
 #include "ES_Port.h"
+#include "ES_Timers.h"
 #include "terminal.h"
 
 // HALs
@@ -44,9 +45,12 @@ Aaron Brown
 #define FALLING 0
 #define RISING 1
 
-// 50ns*16 = 1250 ticks/ms
-#define FOUR_US 5
-#define ONE_MS 1250
+// the core timer and the peripheral clock both run at 20MHz, so each
+// timer 2 tick is 16 core timer counts
+#define COUNTS_PER_T2_TICK 16
+
+// periods are timed with ES_Time_Now, in core timer counts
+#define FOUR_US (4*_HW_COUNTS_PER_US)
 #define PERIOD_A 75*FOUR_US // 300 uS (3333 Hz) 
 #define PERIOD_B 275*FOUR_US // 1100 uS (909 Hz)
 #define PERIOD_TOL 3*FOUR_US
@@ -62,9 +66,9 @@ static void StopInputCapture(void);
 /*---------------------------- Module Variables ---------------------------*/
 static uint8_t MyPriority;
 static bool LastEdge;
-static timer32_t LastTime;
-static timer32_t ThisTime;
-static uint16_t RolloverCounter;
+// the low 32 bits of the ES_Time of the last edge, which is plenty for
+// periods of a few ms
+static uint32_t LastTime;
 static uint32_t Period;
 
 /*------------------------------ Module Code ------------------------------*/
@@ -185,6 +189,45 @@ ES_Event_t RunSensorService(ES_Event_t ThisEvent)
     return ReturnEvent;
 }
 
+/****************************************************************************
+ Function
+     ProcessBeaconEdge
+
+ Parameters
+     uint32_t : the low 32 bits of the ES_Time of the edge
+
+ Returns
+     nothing
+
+ Description
+     the deferred half of IC4ISR, run from ES_Run. Times the period from the
+     last edge and posts EV_BEACON_FOUND_A or _B to RobotSM if it is one of
+     the beacons'.
+ Notes
+
+ Author
+     A. Brown, 10/16/26
+****************************************************************************/
+void ProcessBeaconEdge(uint32_t EdgeTime)
+{
+    ES_Event_t NewEvent;
+
+    Period = EdgeTime - LastTime;
+    LastTime = EdgeTime; // update LastTime
+    NewEvent.EventParam = 0; // so that RobotSM's queue can coalesce them
+
+    if (Period > PERIOD_A-PERIOD_TOL && Period < PERIOD_A+PERIOD_TOL)
+    {
+        NewEvent.EventType = EV_BEACON_FOUND_A;
+        PostRobotSM(NewEvent);
+    }
+    else if (Period > PERIOD_B-PERIOD_TOL && Period < PERIOD_B+PERIOD_TOL)
+    {
+        NewEvent.EventType = EV_BEACON_FOUND_B;
+        PostRobotSM(NewEvent);
+    }
+}
+
 /***************************************************************************
  private functions
  ***************************************************************************/
@@ -192,8 +235,7 @@ static void InitInputCapture(void)
 {
     // Reset static variables
     LastEdge = FALLING;
-    LastTime.Time = 0;
-    RolloverCounter = 0;
+    LastTime = 0;
     Period = 0;
     
     // Make sure input capture is disabled before configuring
@@ -232,10 +274,8 @@ static void InitInputCapture(void)
     T2CONbits.TCKPS = 0b100;
     // Set timeout to specified period
     PR2 = MC_TIMEOUT;
-    // Enable local timeout interrupt
-    IEC0SET = _IEC0_T2IE_MASK;
-    // Set the interrupt priority for the timer to level 6
-    IPC2bits.T2IP = 6;
+    // No rollover interrupt, the captures are extended with ES_Time_Now
+    IEC0CLR = _IEC0_T2IE_MASK;
     
     // Make sure interrupts are enabled globally
     __builtin_enable_interrupts();
@@ -245,8 +285,7 @@ static void StartInputCapture(void)
 {
     // Reset static variables
     LastEdge = FALLING;
-    LastTime.Time = 0;
-    RolloverCounter = 0;
+    LastTime = 0;
     Period = 0;
     
     // Clear any pending flags
@@ -273,49 +312,30 @@ static void StopInputCapture(void)
     IC4CONbits.ON = 0;
 }
 
+// The capture is taken by the hardware, so it is exact however late we get
+// here. It is turned into an ES_Time by reading timer 2 and the 64 bit
+// clock together and backing out the timer 2 ticks since the capture,
+// which works as long as we get here within a turn of timer 2 (52ms).
+// The rest of the work is deferred to ProcessBeaconEdge.
 void __ISR(_INPUT_CAPTURE_4_VECTOR, IPL7SOFT) IC4ISR(void)
 {
     static uint16_t CapturedTime; // static for speed
+    static uint16_t TimerNow;
+    uint64_t EdgeTime;
+    ES_PROFILE_ISR_ENTER();
     do
     {
         CapturedTime = (uint16_t) IC4BUF; // Grab the captured time
-        if (IFS0bits.T2IF == 1 && CapturedTime < 0x8000)
-        {
-            // timer 2 flag pending and time is after rollover
-            ++RolloverCounter; // increment rollover counter
-            IFS0CLR = _IFS0_T2IF_MASK; // clear the rollover interrupt
-        }
-        ThisTime.ByBytes[0] = CapturedTime;
-        ThisTime.ByBytes[1] = RolloverCounter;
-        Period = ThisTime.Time - LastTime.Time;
-        LastTime.Time = ThisTime.Time; // update LastTime
-        
-        ES_Event_t NewEvent;
-        if (Period > PERIOD_A-PERIOD_TOL && Period < PERIOD_A+PERIOD_TOL)
-        {
-            NewEvent.EventType = EV_BEACON_FOUND_A;
-            PostRobotSM(NewEvent);
-        }
-        else if (Period > PERIOD_B-PERIOD_TOL && Period < PERIOD_B+PERIOD_TOL)
-        {
-            NewEvent.EventType = EV_BEACON_FOUND_B;
-            PostRobotSM(NewEvent);
-        }
+        // nothing can interrupt us between these two at IPL7
+        TimerNow = (uint16_t) TMR2;
+        EdgeTime = ES_Time_Now();
+        EdgeTime -= (uint32_t)(uint16_t)(TimerNow - CapturedTime) *
+            COUNTS_PER_T2_TICK;
+        ES_DeferWorkWithData(DEFER_BEACON_EDGE, (uint32_t)EdgeTime);
     } while (IC4CONbits.ICBNE != 0); // until we have pulled all of the captures
     // Clear the capture interrupt
     IFS0CLR = _IFS0_IC4IF_MASK;
-}
-void __ISR(_TIMER_2_VECTOR, IPL6SOFT) Timer2ISR(void)
-{
-    // Disable interrupts globally
-    __builtin_disable_interrupts();
-    if (IFS0bits.T2IF == 1)
-    {
-        ++RolloverCounter; // increment the rollover counter
-        IFS0CLR = _IFS0_T2IF_MASK; // clear the rollover interrupt
-    }
-    // Enable interrupts globally
-    __builtin_enable_interrupts();
+    ES_PROFILE_ISR_EXIT();
 }
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
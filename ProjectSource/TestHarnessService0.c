@@ -14,6 +14,8 @@
  History
  When           Who     What/Why
  -------------- ---     --------
+ 10/16/26 23:40 ahb     profile Timer2ISR
+ 10/16/26 17:40 ahb     size the deferral queue with ES_QUEUE_BLOCK_SIZE
  10/26/17 18:26 jec     moves definition of ALL_BITS to ES_Port.h
  10/19/17 21:28 jec     meaningless change to test updating
  10/19/17 18:42 jec     removed referennces to driverlib and programmed the
@@ -70,7 +72,7 @@ static void StartTMR2(void);
 // with the introduction of Gen2, we need a module level Priority variable
 static uint8_t MyPriority;
 // add a deferral queue for up to 3 pending deferrals +1 to allow for overhead
-static ES_Event_t DeferralQueue[3 + 1];
+static ES_Event_t DeferralQueue[ES_QUEUE_BLOCK_SIZE(3)];
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -293,6 +295,7 @@ static void StartTMR2(void)
 
 void __ISR(_TIMER_2_VECTOR, IPL2AUTO) Timer2ISR(void)
 {
+  ES_PROFILE_ISR_ENTER();
   // clear flag
   IFS0bits.T2IF = 0;
   // post event
@@ -301,6 +304,7 @@ void __ISR(_TIMER_2_VECTOR, IPL2AUTO) Timer2ISR(void)
   
   // stop timer
   T2CONbits.ON = 0;
+  ES_PROFILE_ISR_EXIT();
   return;
 }
 #endif
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Decode the Events & Services framework event trace.
+
+The framework (built with ES_USE_TRACE, see FrameworkHeaders/ES_Trace.h)
+sends one 15 byte frame per record over the terminal UART whenever it has no
+text to send:
+
+    0xA5 0x5A  Time(4)  EventType(2)  EventParam(2)
+    Kind(1) Source(1) Dest(1) QueueDepth(1)  XOR of the 12 record bytes
+
+Everything outside of a valid frame is ordinary printf text. This script
+pulls the frames out of a capture file (or straight from the serial port)
+and prints a timeline, naming events from the ES_EventType_t enum and
+services from SERVICE_TABLE in ES_Configure.h.
+
+    es_trace_decode.py capture.bin
+    es_trace_decode.py --port /dev/ttyUSB0
+    es_trace_decode.py --check       (make -C HostPort test runs this)
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+RECORD_BYTES = 12
+FRAME_BYTES = 2 + RECORD_BYTES + 1
+
+# must match ES_TraceKind_t and the ES_TRACE_xx values in ES_Trace.h
+KINDS = {1: "POST", 2: "POST_FAILED", 3: "DISPATCH", 4: "TIMEOUT",
+         5: "DROPPED"}
+FROM_IDLE, FROM_ISR, NONE = 0xFD, 0xFE, 0xFF
+
+CORE_TIMER_HZ = 20000000  # the PIC32 core timer counts at SYSCLK / 2
+
+
+def strip_comments(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"//[^\n]*", "", text)
+    # drop #ifdef and the like, e.g. around the host test events, and keep
+    # what they enclose: those events come after all of the others
+    return re.sub(r"^[ \t]*#[ \t]*(?:if|ifdef|ifndef|elif|else|endif)\b.*$",
+                  "", text, flags=re.M)
+
+
+def load_config(path):
+    """Returns ({value: event name}, {priority: service name})."""
+    with open(path) as f:
+        text = strip_comments(f.read())
+
+    events = {}
+    # the enum may carry an attribute macro, e.g. ES_EVENT_TYPE_PACKING
+    body = re.search(r"typedef\s+enum\s*(?:\w+\s*)?{(.*?)}\s*ES_EventType_t",
+                     text, re.S)
+    if body:
+        value = 0
+        for entry in body.group(1).split(","):
+            entry = entry.strip()
+            if not entry:
+                continue
+            name, _, init = entry.partition("=")
+            if init.strip():
+                value = int(init.strip(), 0)
+            events[value] = name.strip()
+            value += 1
+
+    services = {}
+    for prio, run in re.findall(
+            r"\b(?:BATCH_)?SERVICE\(\s*(\d+)\s*,\s*\w+\s*,\s*(\w+)", text):
+        name = re.sub(r"^Run", "", run)
+        services[int(prio)] = re.sub(r"Batch$", "", name)
+    return events, services
+
+
+def check_config(path):
+    """Makes sure that the events and services can still be read from the
+    header, returns the exit status."""
+    events, services = load_config(path)
+    names = set(events.values())
+    if (events.get(0) != "ES_NO_EVENT" or "NUM_ES_EVENT_TYPES" not in names
+            or 0 not in services):
+        print("%s: can't read the events and services (%d events, "
+              "%d services)" % (path, len(events), len(services)))
+        return 1
+    print("%s: %d events, %d services" % (path, len(events) - 1,
+                                           len(services)))
+    return 0
+
+
+def who(value, services):
+    if value == FROM_IDLE:
+        return "idle"
+    if value == FROM_ISR:
+        return "ISR"
+    if value == NONE:
+        return "-"
+    return services.get(value, "svc%d" % value)
+
+
+def frames(stream, show_text):
+    """Yields the records found in stream, as tuples."""
+    buf = b""
+    text = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            break
+        buf += chunk
+        while True:
+            at = buf.find(SYNC)
+            if at < 0:
+                # keep a possible first sync byte for the next chunk
+                keep = 1 if buf.endswith(SYNC[:1]) else 0
+                text += buf[:len(buf) - keep]
+                buf = buf[len(buf) - keep:]
+                break
+            text += buf[:at]
+            if len(buf) - at < FRAME_BYTES:
+                buf = buf[at:]
+                break
+            record = buf[at + 2:at + 2 + RECORD_BYTES]
+            check = 0
+            for b in record:
+                check ^= b
+            if check != buf[at + FRAME_BYTES - 1]:
+                text += buf[at:at + 1]  # not a frame after all
+                buf = buf[at + 1:]
+                continue
+            if show_text and text.strip():
+                yield ("text", text.decode("ascii", "replace"))
+            text = b""
+            yield ("record", struct.unpack("<IHHBBBB", record))
+            buf = buf[at + FRAME_BYTES:]
+    if show_text and text.strip():
+        yield ("text", text.decode("ascii", "replace"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?",
+                        help="raw capture of the terminal UART")
+    parser.add_argument("--port", help="read live from this serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--config", default="FrameworkHeaders/ES_Configure.h",
+                        help="ES_Configure.h used for the build")
+    parser.add_argument("--text", action="store_true",
+                        help="also show the printf text between records")
+    parser.add_argument("--check", action="store_true",
+                        help="only check that --config can be read")
+    args = parser.parse_args()
+
+    if args.check:
+        sys.exit(check_config(args.config))
+
+    events, services = load_config(args.config)
+    if args.port:
+        import serial  # pyserial, only needed for live capture
+        stream = serial.Serial(args.port, args.baud, timeout=None)
+    elif args.capture:
+        stream = open(args.capture, "rb")
+    else:
+        stream = sys.stdin.buffer
+
+    last = None
+    elapsed = 0
+    print("%12s  %-11s %-20s %-20s %-28s %s" %
+          ("time ms", "kind", "source", "dest", "event(param)", "depth"))
+    for kind, item in frames(stream, args.text):
+        if kind == "text":
+            for line in item.splitlines():
+                if line.strip():
+                    print("%12s  # %s" % ("", line.strip()))
+            continue
+        time, etype, param, rkind, source, dest, depth = item
+        # the core timer is 32 bits and wraps every 214s, unwrap it
+        if last is not None:
+            elapsed += (time - last) & 0xFFFFFFFF
+        last = time
+        ms = elapsed * 1000.0 / CORE_TIMER_HZ
+        kname = KINDS.get(rkind, "kind%d" % rkind)
+        if rkind == 4:  # TIMEOUT, Source is the timer number
+            src = "timer %d" % source
+        else:
+            src = who(source, services)
+        if rkind == 5:
+            print("%12.3f  %-11s %d records lost" % (ms, kname, param))
+            continue
+        ename = events.get(etype, "event%d" % etype)
+        print("%12.3f  %-11s %-20s %-20s %-28s %d" %
+              (ms, kname, src, who(dest, services),
+               "%s(%d)" % (ename, param), depth))
+
+
+if __name__ == "__main__":
+    main()